@@ -5,6 +5,7 @@
 //------------------------------------------------------------------------------
 #include "TestFramework/UnitTest.h"
 
+#include "Core/Mem/Mem.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Thread.h"
 
@@ -88,6 +89,10 @@ private:
     void SubU32() const;
     void Sub64() const;
     void SubU64() const;
+
+    // CompareExchange
+    void CompareExchangePtr() const;
+    void CompareExchangePtr_Contended() const;
 };
 
 // Register Tests
@@ -112,6 +117,10 @@ REGISTER_TESTS_BEGIN( TestAtomic )
     // Sub
     REGISTER_TEST( Sub32 )
     REGISTER_TEST( Sub64 )
+
+    // CompareExchange
+    REGISTER_TEST( CompareExchangePtr )
+    REGISTER_TEST( CompareExchangePtr_Contended )
 REGISTER_TESTS_END
 
 // Add32
@@ -186,4 +195,95 @@ void TestAtomic::SubU64() const
     TEST_ASSERT( AtomicSubU64( &u64, 9876543210 ) == 0 );
 }
 
+// CompareExchangePtr
+//------------------------------------------------------------------------------
+void TestAtomic::CompareExchangePtr() const
+{
+    int a = 0;
+    int b = 0;
+    int * volatile p = &a;
+
+    // Exchange fails if comparand doesn't match, returning current value
+    TEST_ASSERT( AtomicCompareExchangePtr( &p, &b, static_cast< int * >( nullptr ) ) == &a );
+    TEST_ASSERT( p == &a );
+
+    // Exchange succeeds if comparand matches, returning previous value
+    TEST_ASSERT( AtomicCompareExchangePtr( &p, &b, &a ) == &a );
+    TEST_ASSERT( p == &b );
+}
+
+// CompareExchangePtr_Contended
+//------------------------------------------------------------------------------
+namespace
+{
+    struct ListNode
+    {
+        ListNode * m_Next;
+    };
+    struct CompareExchangeUserData
+    {
+        ListNode * volatile m_Head;
+        volatile uint32_t   m_BarrierCounter;
+        uint32_t            m_NumThreads;
+        ListNode *          m_Nodes;
+    };
+    const uint32_t kNodesPerThread = 10000;
+
+    uint32_t CompareExchangeThreadFunc( void * userData )
+    {
+        CompareExchangeUserData & data = *( static_cast< CompareExchangeUserData * >( userData ) );
+        const uint32_t threadIndex = AtomicIncU32( &data.m_BarrierCounter ) - 1;
+        while ( AtomicLoadAcquire( &data.m_BarrierCounter ) != data.m_NumThreads ) {}
+
+        // Push nodes onto a shared list using CAS publication
+        for ( uint32_t i = 0; i < kNodesPerThread; ++i )
+        {
+            ListNode * node = &data.m_Nodes[ ( threadIndex * kNodesPerThread ) + i ];
+            for ( ;; )
+            {
+                ListNode * head = AtomicLoadAcquire( &data.m_Head );
+                node->m_Next = head;
+                if ( AtomicCompareExchangePtr( &data.m_Head, node, head ) == head )
+                {
+                    break;
+                }
+            }
+        }
+        return 0;
+    }
+}
+void TestAtomic::CompareExchangePtr_Contended() const
+{
+    const uint32_t numThreads = 64;
+
+    CompareExchangeUserData data;
+    data.m_Head = nullptr;
+    data.m_BarrierCounter = 0;
+    data.m_NumThreads = numThreads;
+    data.m_Nodes = FNEW_ARRAY( ListNode[ numThreads * kNodesPerThread ] );
+
+    Thread::ThreadHandle handles[ numThreads ];
+    for ( Thread::ThreadHandle & h : handles )
+    {
+        h = Thread::CreateThread( CompareExchangeThreadFunc, "CAS", ( 64 * KILOBYTE ), &data );
+    }
+    for ( Thread::ThreadHandle & h : handles )
+    {
+        bool timedOut = false;
+        Thread::WaitForThread( h, 10000, timedOut );
+        TEST_ASSERT( timedOut == false );
+        Thread::CloseHandle( h );
+    }
+
+    // Every node must have been published exactly once
+    size_t count = 0;
+    for ( const ListNode * node = data.m_Head; node; node = node->m_Next )
+    {
+        ++count;
+    }
+    TEST_ASSERT( count == ( numThreads * kNodesPerThread ) );
+
+    FDELETE_ARRAY data.m_Nodes;
+}
+
 //------------------------------------------------------------------------------
@@ -6,7 +6,9 @@
 #include "TestFramework/UnitTest.h"
 
 // Core
+#include "Core/Containers/Array.h"
 #include "Core/Containers/UniquePtr.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Semaphore.h"
@@ -17,6 +19,9 @@
 #include "Core/Tracing/Tracing.h"
 
 #include <memory.h> // for memset
+#if defined( __LINUX__ )
+    #include <sys/resource.h> // for getrlimit/setrlimit
+#endif
 
 // Defines
 //------------------------------------------------------------------------------
@@ -47,9 +52,14 @@ private:
     void TestMultipleServersOneClient() const;
     void TestConnectionCount() const;
     void TestDataTransfer() const;
+    void TestDataTransferFromBuffers() const;
+    void TestManyConnections() const;
 
     void TestConnectionStuckDuringSend() const;
     static uint32_t TestConnectionStuckDuringSend_ThreadFunc( void * userData );
+    #if defined( __LINUX__ )
+        void TestSendToBusyReceiver() const;
+    #endif
 
     void TestConnectionFailure() const;
 };
@@ -74,7 +84,12 @@ REGISTER_TESTS_BEGIN( TestTestTCPConnectionPool )
     REGISTER_TEST( TestMultipleServersOneClient )
     REGISTER_TEST( TestConnectionCount )
     REGISTER_TEST( TestDataTransfer )
+    REGISTER_TEST( TestDataTransferFromBuffers )
+    REGISTER_TEST( TestManyConnections )
     REGISTER_TEST( TestConnectionStuckDuringSend )
+    #if defined( __LINUX__ )
+        REGISTER_TEST( TestSendToBusyReceiver ) // Sends are queued, rather than waiting for the receiver
+    #endif
     REGISTER_TEST( TestConnectionFailure )
 REGISTER_TESTS_END
 
@@ -264,6 +279,172 @@ void TestTestTCPConnectionPool::TestDataTransfer() const
     client.ShutdownAllConnections();
 }
 
+// TestDataTransferFromBuffers
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestDataTransferFromBuffers() const
+{
+    // a server which checks each message and its payload arrive intact
+    class TestServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~TestServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo *, void * data, uint32_t size, bool & ) override
+        {
+            if ( ( m_NumReceived % 2 ) == 0 )
+            {
+                TEST_ASSERT( size == sizeof( m_ExpectedMessage ) );
+                TEST_ASSERT( memcmp( data, m_ExpectedMessage, size ) == 0 );
+            }
+            else
+            {
+                TEST_ASSERT( size == m_ExpectedPayloadSize );
+                TEST_ASSERT( memcmp( data, m_ExpectedPayload, size ) == 0 );
+                m_PayloadReceivedSemaphore.Signal();
+            }
+            ++m_NumReceived;
+        }
+        uint32_t m_NumReceived = 0;
+        const char m_ExpectedMessage[ 8 ] = { 'M', 'e', 's', 's', 'a', 'g', 'e', '\0' };
+        const char * m_ExpectedPayload = nullptr;
+        size_t m_ExpectedPayloadSize = 0;
+        Semaphore m_PayloadReceivedSemaphore;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+
+    // a big piece of data, initialized to some known pattern
+    const size_t dataSize( 1024 * 1024 * 4 );
+    UniquePtr< char > data( (char *)ALLOC( dataSize ) );
+    for ( size_t i = 0; i < dataSize; ++i )
+    {
+        data.Get()[ i ] = (char)i;
+    }
+
+    // split into more buffers than can be sent at once, of varying sizes
+    Array< TCPConnectionPool::SendBuffer > buffers;
+    size_t offset = 0;
+    uint32_t bufferSize = 7;
+    while ( offset < dataSize )
+    {
+        const uint32_t size = (uint32_t)Math::Min< size_t >( bufferSize, dataSize - offset );
+        buffers.Append( TCPConnectionPool::SendBuffer{ size, data.Get() + offset } );
+        offset += size;
+        bufferSize = ( bufferSize * 2 ) + 33; // +33 to avoid powers of 2
+    }
+    TEST_ASSERT( buffers.GetSize() > 16 );
+
+    TestServer server;
+    server.m_ExpectedPayload = data.Get();
+    server.m_ExpectedPayloadSize = dataSize;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    // client
+    TCPConnectionPool client;
+    const ConnectionInfo * ci = client.Connect( AStackString<>( "127.0.0.1" ), testPort );
+    TEST_ASSERT( ci );
+
+    // payload should arrive as if sent from one contiguous buffer
+    for ( size_t i = 0; i < 4; ++i )
+    {
+        TEST_ASSERT( client.Send( ci, server.m_ExpectedMessage, sizeof( server.m_ExpectedMessage ), buffers.Begin(), (uint32_t)buffers.GetSize() ) );
+        server.m_PayloadReceivedSemaphore.Wait();
+    }
+
+    client.ShutdownAllConnections();
+}
+
+// TestManyConnections
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestManyConnections() const
+{
+    // a server which echoes back everything it receives
+    class EchoServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~EchoServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & ) override
+        {
+            Send( connection, data, size );
+        }
+    };
+
+    // a client which checks each reply arrives on the connection it was sent from
+    class EchoClient : public TCPConnectionPool
+    {
+    public:
+        virtual ~EchoClient() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & ) override
+        {
+            TEST_ASSERT( size == sizeof( uint32_t ) );
+            TEST_ASSERT( *static_cast< const uint32_t * >( data ) == (uint32_t)(size_t)connection->GetUserData() );
+            AtomicIncU32( &m_NumReplies );
+        }
+        volatile uint32_t m_NumReplies = 0;
+    };
+
+    // Each connection uses a socket at each end
+    #if defined( __LINUX__ )
+        uint32_t numConnections = 2000;
+        struct rlimit limit;
+        if ( getrlimit( RLIMIT_NOFILE, &limit ) == 0 )
+        {
+            // Use as many file descriptors as we are allowed to
+            if ( limit.rlim_cur < limit.rlim_max )
+            {
+                limit.rlim_cur = limit.rlim_max;
+                if ( setrlimit( RLIMIT_NOFILE, &limit ) != 0 )
+                {
+                    VERIFY( getrlimit( RLIMIT_NOFILE, &limit ) == 0 );
+                }
+            }
+
+            // Leave some for the rest of the process
+            numConnections = ( limit.rlim_cur > 256 ) ? (uint32_t)Math::Min< rlim_t >( numConnections, ( limit.rlim_cur - 256 ) / 2 )
+                                                      : 32;
+        }
+    #else
+        const uint32_t numConnections = 64; // a thread is used per connection
+    #endif
+
+    const uint16_t testPort( TEST_PORT );
+
+    EchoServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    Timer timer;
+
+    // connect
+    EchoClient client;
+    Array< const ConnectionInfo * > connections( numConnections, false );
+    for ( uint32_t i = 0; i < numConnections; ++i )
+    {
+        // Allow each connection to be retried in case of local resource exhaustion
+        Timer t;
+        const ConnectionInfo * ci;
+        while ( ( ci = client.Connect( AStackString<>( "127.0.0.1" ), testPort, 2000, (void *)(size_t)i ) ) == nullptr )
+        {
+            TEST_ASSERTM( t.GetElapsed() < 5.0f, "Failed to connect. (Connection %u)", i );
+            Thread::Sleep( 50 );
+        }
+        connections.Append( ci );
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == numConnections );
+    const float connectTime = timer.GetElapsed();
+
+    // send a message on every connection and wait for them all to be echoed back
+    for ( uint32_t i = 0; i < numConnections; ++i )
+    {
+        TEST_ASSERT( client.Send( connections[ i ], &i, sizeof( i ) ) );
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &client.m_NumReplies ) == numConnections );
+
+    OUTPUT( "Connections: %u, Connect: %2.3fs, Echo: %2.3fs\n", numConnections, (double)connectTime, (double)( timer.GetElapsed() - connectTime ) );
+
+    // disconnect
+    client.ShutdownAllConnections();
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == 0 );
+}
+
 // TestConnectionStuckDuringSend
 //------------------------------------------------------------------------------
 void TestTestTCPConnectionPool::TestConnectionStuckDuringSend() const
@@ -328,6 +509,57 @@ void TestTestTCPConnectionPool::TestConnectionStuckDuringSend() const
     return 0;
 }
 
+// TestSendToBusyReceiver
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+void TestTestTCPConnectionPool::TestSendToBusyReceiver() const
+{
+    // create a server which stops receiving until released
+    class BusyServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~BusyServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo *, void *, uint32_t size, bool & ) override
+        {
+            if ( AtomicIncU32( &m_NumReceived ) == 1 )
+            {
+                m_Release.Wait();
+            }
+            AtomicAddU64( &m_BytesReceived, size );
+        }
+        Semaphore           m_Release;
+        volatile uint32_t   m_NumReceived = 0;
+        volatile uint64_t   m_BytesReceived = 0;
+    };
+    BusyServer busyServer;
+    const uint16_t testPort( TEST_PORT );
+    TEST_ASSERT( busyServer.Listen( testPort ) );
+
+    TCPConnectionPool client;
+    const ConnectionInfo * ci = client.Connect( AStackString<>( "127.0.0.1" ), testPort );
+    TEST_ASSERT( ci );
+
+    // Sends should not wait for the receiver, as long as the amount of
+    // outstanding data is reasonable
+    const uint32_t numSends = 32;
+    UniquePtr< char > mem( (char *)ALLOC( MEGABYTE ) );
+    memset( mem.Get(), 0, MEGABYTE );
+    Timer timer;
+    for ( uint32_t i = 0; i < numSends; ++i )
+    {
+        TEST_ASSERT( client.Send( ci, mem.Get(), MEGABYTE ) );
+    }
+    TEST_ASSERT( timer.GetElapsed() < 5.0f ); // would be stuck until released if sends blocked
+
+    // All data should arrive once the receiver continues
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &busyServer.m_NumReceived ) >= 1 );
+    busyServer.m_Release.Signal();
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &busyServer.m_BytesReceived ) == ( (uint64_t)numSends * MEGABYTE ) );
+
+    client.ShutdownAllConnections();
+}
+#endif
+
 // TestConnectionFailure
 //------------------------------------------------------------------------------
 void TestTestTCPConnectionPool::TestConnectionFailure() const
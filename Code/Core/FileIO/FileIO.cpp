@@ -35,6 +35,7 @@
 #if defined( __APPLE__ )
     #include <copyfile.h>
     #include <dlfcn.h>
+    #include <fcntl.h>
     #include <sys/time.h>
 #endif
 
@@ -703,7 +704,7 @@
             t[ 0 ].tv_sec = fileTime / 1000000000ULL;
             t[ 0 ].tv_nsec = ( fileTime % 1000000000ULL );
             t[ 1 ] = t[ 0 ];
-            return ( (gOSXHelper_utimensat.m_FuncPtr)( 0, fileName.Get(), t, 0 ) == 0 );
+            return ( (gOSXHelper_utimensat.m_FuncPtr)( AT_FDCWD, fileName.Get(), t, 0 ) == 0 );
         }
     
         // Fallback to regular low-resolution filetime setting
@@ -717,7 +718,7 @@
         t[ 0 ].tv_sec = fileTime / 1000000000ULL;
         t[ 0 ].tv_nsec = ( fileTime % 1000000000ULL );
         t[ 1 ] = t[ 0 ];
-        return ( utimensat( 0, fileName.Get(), t, 0 ) == 0 );
+        return ( utimensat( AT_FDCWD, fileName.Get(), t, 0 ) == 0 );
     #else
         #error Unknown platform
     #endif
@@ -734,13 +735,13 @@
         // Use higher precision function if available
         if ( gOSXHelper_utimensat.m_FuncPtr )
         {
-            return ( (gOSXHelper_utimensat.m_FuncPtr)( 0, fileName.Get(), nullptr, 0 ) == 0 );
+            return ( (gOSXHelper_utimensat.m_FuncPtr)( AT_FDCWD, fileName.Get(), nullptr, 0 ) == 0 );
         }
     
         // Fallback to regular low-resolution filetime setting
         return ( utimes( fileName.Get(), nullptr ) == 0 );
     #elif defined( __LINUX__ )
-        return ( utimensat( 0, fileName.Get(), nullptr, 0 ) == 0 );
+        return ( utimensat( AT_FDCWD, fileName.Get(), nullptr, 0 ) == 0 );
     #else
         #error Unknown platform
     #endif
@@ -8,6 +8,7 @@
 
 // Core
 #include "Core/Env/ErrorFormat.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Network/Network.h"
 #include "Core/Process/Atomic.h"
@@ -31,6 +32,11 @@
     #include <sys/socket.h>
     #include <sys/uio.h>
     #include <unistd.h>
+    #if defined( __LINUX__ )
+        #include <poll.h>
+        #include <sys/epoll.h>
+        #include <sys/eventfd.h>
+    #endif
     #define INVALID_SOCKET ( -1 )
     #define SOCKET_ERROR -1
 #else
@@ -127,6 +133,62 @@
     #define TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( threadType ) (void)0
 #endif
 
+// TCPConnectionPool::EventLoop
+//  - Services many connections from a single thread using epoll
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+    class TCPConnectionPool::EventLoop
+    {
+    public:
+        explicit EventLoop( TCPConnectionPool * pool )
+            : m_Pool( pool )
+            , m_EpollFD( epoll_create1( EPOLL_CLOEXEC ) )
+            , m_WakeFD( eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK ) )
+            , m_Thread( INVALID_THREAD_HANDLE )
+            , m_Exit( false )
+            , m_CheckForDisconnects( false )
+            , m_ListenConnection( nullptr )
+            , m_NewConnections( 8, true )
+            , m_Connections( 8, true )
+        {
+            ASSERT( m_EpollFD != -1 );
+            ASSERT( m_WakeFD != -1 );
+
+            // Wake-ups are distinguished from socket events by having no ConnectionInfo
+            epoll_event event;
+            memset( &event, 0, sizeof( event ) );
+            event.events = EPOLLIN;
+            event.data.ptr = nullptr;
+            VERIFY( epoll_ctl( m_EpollFD, EPOLL_CTL_ADD, m_WakeFD, &event ) == 0 );
+        }
+        ~EventLoop()
+        {
+            close( m_WakeFD );
+            close( m_EpollFD );
+        }
+
+        void Wake() const
+        {
+            eventfd_write( m_WakeFD, 1 );
+        }
+
+        TCPConnectionPool *         m_Pool;
+        int                         m_EpollFD;
+        int                         m_WakeFD;
+        Thread::ThreadHandle        m_Thread;
+        volatile bool               m_Exit;
+        volatile bool               m_CheckForDisconnects;  // Set when connections need closing
+        ConnectionInfo *            m_ListenConnection;     // If this loop services the listen socket
+        Mutex                       m_NewConnectionsMutex;
+        Array< ConnectionInfo * >   m_NewConnections;       // Connections to start servicing
+        Array< ConnectionInfo * >   m_Connections;          // Connections being serviced (only accessed by loop thread)
+    };
+
+    // Event loop threads must never wait for queued data to be sent, as they
+    // are responsible for sending it
+    static THREAD_LOCAL bool s_IsEventLoopThread = false;
+#endif
+
 // CONSTRUCTOR - ConnectionInfo
 //------------------------------------------------------------------------------
 ConnectionInfo::ConnectionInfo( TCPConnectionPool * ownerPool )
@@ -136,6 +198,17 @@ ConnectionInfo::ConnectionInfo( TCPConnectionPool * ownerPool )
     , m_ThreadQuitNotification( false )
     , m_TCPConnectionPool( ownerPool )
     , m_UserData( nullptr )
+    #if defined( __LINUX__ )
+        , m_EventLoopIndex( 0 )
+        , m_ReceiveSize( 0 )
+        , m_ReceiveSizeBytes( 0 )
+        , m_ReceiveDataBytes( 0 )
+        , m_ReceiveBuffer( nullptr )
+        , m_SendQueue( 0, true )
+        , m_SendQueueFirst( 0 )
+        , m_SendQueueOffset( 0 )
+        , m_SendQueueBytes( 0 )
+    #endif
     #ifdef DEBUG
         , m_InUse( false )
     #endif
@@ -149,6 +222,10 @@ TCPConnectionPool::TCPConnectionPool()
     : m_ListenConnection( nullptr )
     , m_Connections( 8, true )
     , m_ShuttingDown( false )
+    #if defined( __LINUX__ )
+        , m_EventLoops( NUM_EVENT_LOOPS, false )
+        , m_NextEventLoop( 0 )
+    #endif
 {
 }
 
@@ -197,6 +274,11 @@ void TCPConnectionPool::ShutdownAllConnections()
         m_ConnectionsMutex.Lock();
     }
     m_ConnectionsMutex.Unlock();
+
+    #if defined( __LINUX__ )
+        // all connections are closed, so the event loops are no longer needed
+        StopEventLoops();
+    #endif
 }
 
 // GetAddressAsString
@@ -245,16 +327,23 @@ bool TCPConnectionPool::Listen( uint16_t port )
 
     // listen
     TCPDEBUG( "Listen on port %i (%x)\n", port, (uint32_t)sockfd );
-    if ( listen( sockfd, 0 ) == SOCKET_ERROR ) // no backlog
+    #if defined( __LINUX__ )
+        // connections are accepted by an event loop which may be busy servicing
+        // other connections, so allow them to queue up
+        const int backlog = SOMAXCONN;
+    #else
+        const int backlog = 0; // no backlog
+    #endif
+    if ( listen( sockfd, backlog ) == SOCKET_ERROR )
     {
         TCPDEBUG( "Listen FAILED %i (%x)\n", port, (uint32_t)sockfd );
         CloseSocket( sockfd );
         return false;
     }
 
-    // spawn the handler thread
+    // spawn the handler thread (or add to an event loop)
     uint32_t loopback = 127 & ( 1 << 24 ); // 127.0.0.1
-    CreateListenThread( sockfd, loopback, port );
+    CreateListenConnection( sockfd, loopback, port );
 
     // everything is ok - we are now listening, managing connections on the other thread
     return true;
@@ -324,27 +413,43 @@ const ConnectionInfo * TCPConnectionPool::Connect( uint32_t hostIP, uint16_t por
     // wait for connection
     for ( ;; )
     {
-        fd_set write, err;
-        FD_ZERO( &write );
-        FD_ZERO( &err );
-        PRAGMA_DISABLE_PUSH_MSVC( 4548 ) // warning C4548: expression before comma has no effect; expected expression with side-effect
-        PRAGMA_DISABLE_PUSH_MSVC( 6319 ) // warning C6319: Use of the comma-operator in a tested expression...
-        PRAGMA_DISABLE_PUSH_CLANG_WINDOWS( "-Wcomma" ) // possible misuse of comma operator here [-Wcomma]
-        PRAGMA_DISABLE_PUSH_CLANG_WINDOWS( "-Wunused-value" ) // expression result unused [-Wunused-value]
-        FD_SET( sockfd, &write );
-        FD_SET( sockfd, &err );
-        PRAGMA_DISABLE_POP_CLANG_WINDOWS // -Wunused-value
-        PRAGMA_DISABLE_POP_CLANG_WINDOWS // -Wcomma
-        PRAGMA_DISABLE_POP_MSVC // 6319
-        PRAGMA_DISABLE_POP_MSVC // 4548
-
-        // check connection every 10ms
-        timeval pollingTimeout;
-        memset( &pollingTimeout, 0, sizeof( timeval ) );
-        pollingTimeout.tv_usec = 10 * 1000;
-
-        // check if the socket is ready
-        int selRet = Select( sockfd + 1, nullptr, &write, &err, &pollingTimeout );
+        #if defined( __LINUX__ )
+            // NOTE: poll() is used as sockets can exceed FD_SETSIZE when there
+            // are many connections, which select() can't handle
+            struct pollfd pollSocket;
+            pollSocket.fd = sockfd;
+            pollSocket.events = POLLOUT;
+            pollSocket.revents = 0;
+
+            // check if the socket is ready (checking connection every 10ms)
+            int selRet = poll( &pollSocket, 1, 10 );
+            const bool writeSet = ( ( pollSocket.revents & POLLOUT ) != 0 );
+            const bool errorSet = ( ( pollSocket.revents & ( POLLERR | POLLHUP ) ) != 0 );
+        #else
+            fd_set write, err;
+            FD_ZERO( &write );
+            FD_ZERO( &err );
+            PRAGMA_DISABLE_PUSH_MSVC( 4548 ) // warning C4548: expression before comma has no effect; expected expression with side-effect
+            PRAGMA_DISABLE_PUSH_MSVC( 6319 ) // warning C6319: Use of the comma-operator in a tested expression...
+            PRAGMA_DISABLE_PUSH_CLANG_WINDOWS( "-Wcomma" ) // possible misuse of comma operator here [-Wcomma]
+            PRAGMA_DISABLE_PUSH_CLANG_WINDOWS( "-Wunused-value" ) // expression result unused [-Wunused-value]
+            FD_SET( sockfd, &write );
+            FD_SET( sockfd, &err );
+            PRAGMA_DISABLE_POP_CLANG_WINDOWS // -Wunused-value
+            PRAGMA_DISABLE_POP_CLANG_WINDOWS // -Wcomma
+            PRAGMA_DISABLE_POP_MSVC // 6319
+            PRAGMA_DISABLE_POP_MSVC // 4548
+
+            // check connection every 10ms
+            timeval pollingTimeout;
+            memset( &pollingTimeout, 0, sizeof( timeval ) );
+            pollingTimeout.tv_usec = 10 * 1000;
+
+            // check if the socket is ready
+            int selRet = Select( sockfd + 1, nullptr, &write, &err, &pollingTimeout );
+            const bool writeSet = ( selRet > 0 ) && FD_ISSET( sockfd, &write );
+            const bool errorSet = ( selRet > 0 ) && FD_ISSET( sockfd, &err );
+        #endif
         if ( selRet == SOCKET_ERROR )
         {
             // connection failed
@@ -388,7 +493,7 @@ const ConnectionInfo * TCPConnectionPool::Connect( uint32_t hostIP, uint16_t por
             continue;
         }
 
-        if ( FD_ISSET( sockfd, &err ) )
+        if ( errorSet )
         {
             // connection failed
             #ifdef TCPCONNECTION_DEBUG
@@ -411,7 +516,7 @@ const ConnectionInfo * TCPConnectionPool::Connect( uint32_t hostIP, uint16_t por
             return nullptr;
         }
 
-        if ( FD_ISSET( sockfd, &write ) )
+        if ( writeSet )
         {
             #if defined( __APPLE__ ) || defined( __LINUX__ )
                 // On Linux a write flag set by select() doesn't mean that
@@ -446,7 +551,7 @@ const ConnectionInfo * TCPConnectionPool::Connect( uint32_t hostIP, uint16_t por
         ASSERT( false ); // should never get here
     }
 
-    return CreateConnectionThread( sockfd, hostIP, port, userData );
+    return CreateConnection( sockfd, hostIP, port, userData );
 }
 
 // Disconnect
@@ -464,16 +569,16 @@ void TCPConnectionPool::Disconnect( const ConnectionInfo * ci )
     // ensure the connection thread isn't busy destroying itself
     MutexHolder mh( m_ConnectionsMutex );
 
-    if ( ci == m_ListenConnection )
+    if ( ( ci == m_ListenConnection ) || ( m_Connections.Find( ci ) != nullptr ) )
     {
         AtomicStoreRelease( &ci->m_ThreadQuitNotification, true );
-        return;
-    }
 
-    const ConnectionInfo * const * iter = m_Connections.Find( ci );
-    if ( iter != nullptr )
-    {
-        AtomicStoreRelease( &ci->m_ThreadQuitNotification, true );
+        #if defined( __LINUX__ )
+            // wake the event loop so it can close the connection
+            EventLoop * loop = m_EventLoops[ ci->m_EventLoopIndex ];
+            AtomicStoreRelease( &loop->m_CheckForDisconnects, true );
+            loop->Wake();
+        #endif
         return;
     }
 
@@ -541,6 +646,35 @@ bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * da
     return SendInternal( connection, buffers, 4, timeoutMS );
 }
 
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * data, size_t size, const SendBuffer * payloadBuffers, uint32_t numPayloadBuffers, uint32_t timeoutMS )
+{
+    Array< SendBuffer > buffers( 3 + numPayloadBuffers, false ); // size + data + payloadSize + payloadBuffers...
+
+    // size
+    uint32_t sizeData = (uint32_t)size;
+    buffers.Append( SendBuffer{ sizeof( sizeData ), &sizeData } );
+
+    // data
+    buffers.Append( SendBuffer{ (uint32_t)size, data } );
+
+    // payloadSize
+    uint32_t payloadSizeData = 0;
+    for ( uint32_t i = 0; i < numPayloadBuffers; ++i )
+    {
+        payloadSizeData += payloadBuffers[ i ].size;
+    }
+    buffers.Append( SendBuffer{ sizeof( payloadSizeData ), &payloadSizeData } );
+
+    // payloadBuffers
+    for ( uint32_t i = 0; i < numPayloadBuffers; ++i )
+    {
+        buffers.Append( payloadBuffers[ i ] );
+    }
+
+    return SendInternal( connection, buffers.Begin(), (uint32_t)buffers.GetSize(), timeoutMS );
+}
+
 // SendInternal
 //------------------------------------------------------------------------------
 bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const TCPConnectionPool::SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS )
@@ -555,11 +689,10 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
         return false;
     }
 
-    ASSERT( numBuffers <= 4 ); // Worst case = size + data + payloadSize + payload
     #if defined( __WINDOWS__ )
-        WSABUF sendBuffers[ 4 ];
+        WSABUF sendBuffers[ MAX_BUFFERS_PER_SEND ];
     #else
-        struct iovec sendBuffers[ 4 ];
+        struct iovec sendBuffers[ MAX_BUFFERS_PER_SEND ];
     #endif
 
     // Calculate total to send
@@ -571,88 +704,224 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
 
     Timer timer;
 
-#ifdef DEBUG
-    ASSERT( connection->m_InUse == false );
-    connection->m_InUse = true;
-#endif
-
-    ASSERT( connection->m_Socket != INVALID_SOCKET );
-
-    TCPDEBUG( "Send: %i (%x)\n", totalBytes, (uint32_t)( connection->m_Socket ) );
+    #if defined( __LINUX__ )
+        // Apply back pressure if too much data is waiting to be sent
+        if ( WaitForSendQueue( connection, timeoutMS ) == false )
+        {
+            return false;
+        }
+    #endif
 
     bool sendOK = true;
-
-    // Repeat until all bytes sent
-    uint32_t bytesSent = 0;
-    while ( bytesSent < totalBytes )
+    bool disconnect = false;
     {
-        // Fill buffers for any unsent data
-        uint32_t numSendBuffers( 0 );
-        uint32_t offset( 0 );
-        for ( uint32_t i = 0; i < numBuffers; ++i )
-        {
-            const uint32_t overlap = bytesSent > offset ? ( bytesSent - offset ) : 0;
-            if ( overlap < buffers[ i ].size )
+        #if defined( __LINUX__ )
+            // Data already waiting must be sent first
+            MutexHolder mh( connection->m_SendMutex );
+            if ( connection->m_SendQueueBytes > 0 )
             {
-                // add remaining data for this buffer
-                const uint32_t remainder = ( buffers[ i ].size - overlap );
-                #if defined( __WINDOWS__ )
-                    sendBuffers[ numSendBuffers ].len = remainder;
-                    sendBuffers[ numSendBuffers ].buf = const_cast< CHAR * >( (const char *)buffers[ i ].data + buffers[ i ].size - remainder );
-                #else
-                    sendBuffers[ numSendBuffers ].iov_len = remainder;
-                    sendBuffers[ numSendBuffers ].iov_base = const_cast< char * >( (const char *)buffers[ i ].data + buffers[ i ].size - remainder );
-                #endif
-                ++numSendBuffers;
+                QueueSend( connection, buffers, numBuffers, 0 );
+                return true;
             }
-            offset += buffers[ i ].size;
-        }
-        ASSERT( offset == totalBytes ); // sanity check
-        ASSERT( numSendBuffers > 0 ); // shouldn't be in loop if there was no data to send!
-
-        // Try send
-        #if defined( __WINDOWS__ )
-            uint32_t sent( 0 );
-            int result = WSASend( connection->m_Socket, sendBuffers, numSendBuffers, (LPDWORD)&sent, 0, nullptr, nullptr );
-            if ( result == SOCKET_ERROR )
-        #else
-            ssize_t sent = writev( connection->m_Socket, sendBuffers, numSendBuffers );
-            if ( sent <= 0 )
         #endif
+
+        #ifdef DEBUG
+            ASSERT( connection->m_InUse == false );
+            connection->m_InUse = true;
+        #endif
+
+        ASSERT( connection->m_Socket != INVALID_SOCKET );
+
+        TCPDEBUG( "Send: %i (%x)\n", totalBytes, (uint32_t)( connection->m_Socket ) );
+
+        // Repeat until all bytes sent
+        uint32_t bytesSent = 0;
+        while ( bytesSent < totalBytes )
         {
-            if ( WouldBlock() )
+            // Fill buffers for any unsent data (as many as can be sent at once)
+            uint32_t numSendBuffers( 0 );
+            uint32_t offset( 0 );
+            for ( uint32_t i = 0; ( i < numBuffers ) && ( numSendBuffers < MAX_BUFFERS_PER_SEND ); ++i )
             {
-                if ( AtomicLoadAcquire( &connection->m_ThreadQuitNotification ) || AtomicLoadRelaxed( &m_ShuttingDown ) )
+                const uint32_t overlap = bytesSent > offset ? ( bytesSent - offset ) : 0;
+                if ( overlap < buffers[ i ].size )
                 {
-                    sendOK = false;
-                    break;
+                    // add remaining data for this buffer
+                    const uint32_t remainder = ( buffers[ i ].size - overlap );
+                    #if defined( __WINDOWS__ )
+                        sendBuffers[ numSendBuffers ].len = remainder;
+                        sendBuffers[ numSendBuffers ].buf = const_cast< CHAR * >( (const char *)buffers[ i ].data + buffers[ i ].size - remainder );
+                    #else
+                        sendBuffers[ numSendBuffers ].iov_len = remainder;
+                        sendBuffers[ numSendBuffers ].iov_base = const_cast< char * >( (const char *)buffers[ i ].data + buffers[ i ].size - remainder );
+                    #endif
+                    ++numSendBuffers;
                 }
-
-                if ( timer.GetElapsedMS() > (float)timeoutMS )
+                offset += buffers[ i ].size;
+            }
+            ASSERT( ( offset == totalBytes ) || ( numSendBuffers == MAX_BUFFERS_PER_SEND ) ); // sanity check
+            ASSERT( numSendBuffers > 0 ); // shouldn't be in loop if there was no data to send!
+
+            // Try send
+            #if defined( __WINDOWS__ )
+                uint32_t sent( 0 );
+                int result = WSASend( connection->m_Socket, sendBuffers, numSendBuffers, (LPDWORD)&sent, 0, nullptr, nullptr );
+                if ( result == SOCKET_ERROR )
+            #else
+                ssize_t sent = writev( connection->m_Socket, sendBuffers, numSendBuffers );
+                if ( sent <= 0 )
+            #endif
+            {
+                if ( WouldBlock() )
                 {
-                    Disconnect( connection );
-                    sendOK = false;
-                    break;
+                    #if defined( __LINUX__ )
+                        // the event loop will send the rest when there is space in the send buffer
+                        QueueSend( connection, buffers, numBuffers, bytesSent );
+                        break;
+                    #else
+                        if ( AtomicLoadAcquire( &connection->m_ThreadQuitNotification ) || AtomicLoadRelaxed( &m_ShuttingDown ) )
+                        {
+                            sendOK = false;
+                            break;
+                        }
+
+                        if ( timer.GetElapsedMS() > (float)timeoutMS )
+                        {
+                            disconnect = true;
+                            sendOK = false;
+                            break;
+                        }
+
+                        Thread::Sleep( 1 );
+                        continue;
+                    #endif
                 }
+                // error
+                TCPDEBUG( "send() failed (A). Error: %s (Sent: %u, Socket: %x)\n", LAST_NETWORK_ERROR_STR, sent, (uint32_t)( connection->m_Socket ) );
+                disconnect = true;
+                sendOK = false;
+                break;
+            }
+            bytesSent += sent;
+        }
 
-                Thread::Sleep( 1 );
-                continue;
+        #ifdef DEBUG
+            connection->m_InUse = false;
+        #endif
+    }
+
+    // Disconnect takes m_ConnectionsMutex, which Broadcast holds while sending, so
+    // it must be called without holding m_SendMutex to avoid lock order inversion
+    if ( disconnect )
+    {
+        Disconnect( connection );
+    }
+    return sendOK;
+}
+
+#if defined( __LINUX__ )
+// WaitForSendQueue
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::WaitForSendQueue( const ConnectionInfo * connection, uint32_t timeoutMS )
+{
+    if ( s_IsEventLoopThread )
+    {
+        return true; // replies from OnReceive are queued regardless
+    }
+
+    for ( ;; )
+    {
+        bool stalled;
+        {
+            MutexHolder mh( connection->m_SendMutex );
+            if ( connection->m_SendQueueBytes <= MAX_QUEUED_SEND_BYTES )
+            {
+                return true;
             }
-            // error
-            TCPDEBUG( "send() failed (A). Error: %s (Sent: %u, Socket: %x)\n", LAST_NETWORK_ERROR_STR, sent, (uint32_t)( connection->m_Socket ) );
+            stalled = ( connection->m_SendQueueTimer.GetElapsedMS() > (float)timeoutMS );
+        }
+
+        // disconnect if the receiver has stopped accepting data
+        if ( stalled )
+        {
             Disconnect( connection );
-            sendOK = false;
-            break;
+            return false;
         }
-        bytesSent += sent;
+
+        if ( AtomicLoadAcquire( &connection->m_ThreadQuitNotification ) || AtomicLoadRelaxed( &m_ShuttingDown ) )
+        {
+            return false;
+        }
+
+        // wake periodically to check for disconnection
+        connection->m_SendQueueProgress.Wait( 10 );
     }
+}
 
-    #ifdef DEBUG
-        connection->m_InUse = false;
-    #endif
-    return sendOK;
+// QueueSend
+//------------------------------------------------------------------------------
+void TCPConnectionPool::QueueSend( const ConnectionInfo * connection, const SendBuffer * buffers, uint32_t numBuffers, uint32_t bytesSent )
+{
+    // NOTE: connection->m_SendMutex must be held
+
+    PROFILE_FUNCTION;
+
+    // copy the unsent data, as the caller's buffers are only valid during the send
+    uint32_t totalBytes = 0;
+    for ( uint32_t i = 0; i < numBuffers; ++i )
+    {
+        totalBytes += buffers[ i ].size;
+    }
+    ASSERT( bytesSent < totalBytes );
+    const uint32_t bytesToQueue = ( totalBytes - bytesSent );
+    char * data = (char *)ALLOC( bytesToQueue );
+    char * dest = data;
+    uint32_t offset = 0;
+    for ( uint32_t i = 0; i < numBuffers; ++i )
+    {
+        const uint32_t overlap = bytesSent > offset ? Math::Min( bytesSent - offset, buffers[ i ].size ) : 0;
+        memcpy( dest, (const char *)buffers[ i ].data + overlap, buffers[ i ].size - overlap );
+        dest += ( buffers[ i ].size - overlap );
+        offset += buffers[ i ].size;
+    }
+    ASSERT( dest == ( data + bytesToQueue ) );
+
+    const bool wasEmpty = ( connection->m_SendQueueBytes == 0 );
+    connection->m_SendQueue.Append( ConnectionInfo::QueuedSend{ data, bytesToQueue } );
+    connection->m_SendQueueBytes += bytesToQueue;
+    if ( wasEmpty == false )
+    {
+        return; // the event loop is already waiting to send
+    }
+    connection->m_SendQueueTimer.Start();
+
+    // have the event loop wait for the socket to be writable
+    // (connections not yet serviced by the loop are added with this, see EventLoopThreadFunction)
+    epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events = ( EPOLLIN | EPOLLOUT );
+    event.data.ptr = const_cast< ConnectionInfo * >( connection );
+    const EventLoop * loop = m_EventLoops[ connection->m_EventLoopIndex ];
+    epoll_ctl( loop->m_EpollFD, EPOLL_CTL_MOD, connection->m_Socket, &event );
 }
 
+// FreeSendQueue
+//------------------------------------------------------------------------------
+void TCPConnectionPool::FreeSendQueue( const ConnectionInfo * connection )
+{
+    // NOTE: connection->m_SendMutex must be held
+
+    for ( size_t i = connection->m_SendQueueFirst; i < connection->m_SendQueue.GetSize(); ++i )
+    {
+        FREE( connection->m_SendQueue[ i ].m_Data );
+    }
+    connection->m_SendQueue.Clear();
+    connection->m_SendQueueFirst = 0;
+    connection->m_SendQueueOffset = 0;
+    connection->m_SendQueueBytes = 0;
+}
+#endif
+
 // Broadcast
 //------------------------------------------------------------------------------
 bool TCPConnectionPool::Broadcast( const void * data, size_t size )
@@ -685,6 +954,7 @@ bool TCPConnectionPool::Broadcast( const void * data, size_t size )
     FREE( data );
 }
 
+#if !defined( __LINUX__ )
 // HandleRead
 //------------------------------------------------------------------------------
 bool TCPConnectionPool::HandleRead( ConnectionInfo * ci )
@@ -758,6 +1028,7 @@ bool TCPConnectionPool::HandleRead( ConnectionInfo * ci )
 
     return true;
 }
+#endif
 
 // GetLastNetworkError
 //------------------------------------------------------------------------------
@@ -890,9 +1161,9 @@ TCPSocket TCPConnectionPool::CreateSocket() const
     return newSocket;
 }
 
-// CreateListenThread
+// CreateListenConnection
 //------------------------------------------------------------------------------
-void TCPConnectionPool::CreateListenThread( TCPSocket socket, uint32_t host, uint16_t port )
+void TCPConnectionPool::CreateListenConnection( TCPSocket socket, uint32_t host, uint16_t port )
 {
     MutexHolder mh( m_ConnectionsMutex );
 
@@ -902,17 +1173,524 @@ void TCPConnectionPool::CreateListenThread( TCPSocket socket, uint32_t host, uin
     m_ListenConnection->m_RemotePort = port;
     m_ListenConnection->m_ThreadQuitNotification = false;
 
-    // Spawn thread to handle socket
-    Thread::ThreadHandle h = Thread::CreateThread( &ListenThreadWrapperFunction,
-                                         "TCPListen",
-                                         ( 32 * KILOBYTE ),
-                                         m_ListenConnection ); // user data argument
-    ASSERT( h != INVALID_THREAD_HANDLE );
-    Thread::DetachThread( h );
-    Thread::CloseHandle( h ); // we don't need this anymore
+    #if defined( __LINUX__ )
+        // Service socket from an event loop, accepting all pending connections when woken
+        SetNonBlocking( socket );
+        AddToEventLoop( m_ListenConnection, true );
+    #else
+        // Spawn thread to handle socket
+        Thread::ThreadHandle h = Thread::CreateThread( &ListenThreadWrapperFunction,
+                                             "TCPListen",
+                                             ( 32 * KILOBYTE ),
+                                             m_ListenConnection ); // user data argument
+        ASSERT( h != INVALID_THREAD_HANDLE );
+        Thread::DetachThread( h );
+        Thread::CloseHandle( h ); // we don't need this anymore
+    #endif
+}
+
+// CreateConnection
+//------------------------------------------------------------------------------
+ConnectionInfo * TCPConnectionPool::CreateConnection( TCPSocket socket, uint32_t host, uint16_t port, void * userData )
+{
+    MutexHolder mh( m_ConnectionsMutex );
+
+    #if defined( __LINUX__ )
+        // The event loops are stopped once shutdown completes
+        if ( AtomicLoadRelaxed( &m_ShuttingDown ) )
+        {
+            CloseSocket( socket );
+            return nullptr;
+        }
+    #endif
+
+    ConnectionInfo * ci = FNEW( ConnectionInfo( this ) );
+    ci->m_Socket = socket;
+    ci->m_RemoteAddress = host;
+    ci->m_RemotePort = port;
+    ci->m_ThreadQuitNotification = false;
+    ci->m_UserData = userData;
+
+    #ifdef TCPCONNECTION_DEBUG
+        AStackString<32> addr;
+        GetAddressAsString( ci->m_RemoteAddress, addr );
+        TCPDEBUG( "Connected to %s : %i (%x)\n", addr.Get(), port, (uint32_t)socket );
+    #endif
+
+    #if defined( __LINUX__ )
+        // Service socket from an event loop
+        AddToEventLoop( ci, false );
+    #else
+        // Spawn thread to handle socket
+        Thread::ThreadHandle h = Thread::CreateThread( &ConnectionThreadWrapperFunction,
+                                                       "TCPConnection",
+                                                       ( 64 * KILOBYTE ),
+                                                       ci ); // user data argument
+        ASSERT( h != INVALID_THREAD_HANDLE );
+        Thread::DetachThread( h );
+        Thread::CloseHandle( h ); // we don't need this anymore
+    #endif
+
+    m_Connections.Append( ci );
+
+    return ci;
+}
+
+// DestroyListenConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::DestroyListenConnection( ConnectionInfo * ci )
+{
+    // close the socket
+    CloseSocket( ci->m_Socket );
+    ci->m_Socket = INVALID_SOCKET;
+
+    {
+        // clear connection (might already be null
+        // if simultaneously closed on another thread
+        // but we'll hapily set it null redundantly
+        MutexHolder mh( m_ConnectionsMutex );
+        ASSERT( m_ListenConnection == ci );
+        m_ListenConnection = nullptr;
+        FDELETE ci;
+        m_ShutdownSemaphore.Signal(); // Wake main thread which may be waiting on shutdown
+    }
+}
+
+// DestroyConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::DestroyConnection( ConnectionInfo * ci )
+{
+    // close the socket
+    CloseSocket( ci->m_Socket );
+    ci->m_Socket = INVALID_SOCKET;
+
+    {
+        // try to remove from connection list
+        // could validly be removed by another
+        // thread already due to simultaneously
+        // closing a connection while it is dropped
+        MutexHolder mh( m_ConnectionsMutex );
+        ConnectionInfo ** iter = m_Connections.Find( ci );
+        ASSERT( iter );
+        m_Connections.Erase( iter );
+        FDELETE ci;
+        if ( AtomicLoadRelaxed( &m_ShuttingDown ) )
+        {
+            m_ShutdownSemaphore.Signal(); // Wake main thread which will be waiting on shutdown
+        }
+    }
+}
+
+#if defined( __LINUX__ )
+// StartEventLoops
+//------------------------------------------------------------------------------
+void TCPConnectionPool::StartEventLoops()
+{
+    // NOTE: m_ConnectionsMutex must be held
+    ASSERT( m_EventLoops.IsEmpty() );
+
+    for ( uint32_t i = 0; i < NUM_EVENT_LOOPS; ++i )
+    {
+        EventLoop * loop = FNEW( EventLoop( this ) );
+        loop->m_Thread = Thread::CreateThread( &EventLoopThreadWrapperFunction,
+                                               "TCPEventLoop",
+                                               ( 64 * KILOBYTE ),
+                                               loop ); // user data argument
+        ASSERT( loop->m_Thread != INVALID_THREAD_HANDLE );
+        m_EventLoops.Append( loop );
+    }
+}
+
+// StopEventLoops
+//------------------------------------------------------------------------------
+void TCPConnectionPool::StopEventLoops()
+{
+    // take ownership of the loops (we can't wait for them while holding the lock)
+    Array< EventLoop * > loops;
+    {
+        MutexHolder mh( m_ConnectionsMutex );
+        ASSERT( m_Connections.IsEmpty() && ( m_ListenConnection == nullptr ) );
+        loops.Swap( m_EventLoops );
+    }
+
+    // signal all loops to exit, then wait for them
+    for ( EventLoop * loop : loops )
+    {
+        AtomicStoreRelease( &loop->m_Exit, true );
+        loop->Wake();
+    }
+    for ( EventLoop * loop : loops )
+    {
+        Thread::WaitForThread( loop->m_Thread );
+        Thread::CloseHandle( loop->m_Thread );
+        FDELETE loop;
+    }
+}
+
+// AddToEventLoop
+//------------------------------------------------------------------------------
+void TCPConnectionPool::AddToEventLoop( ConnectionInfo * ci, bool isListenConnection )
+{
+    // NOTE: m_ConnectionsMutex must be held
+    if ( m_EventLoops.IsEmpty() )
+    {
+        StartEventLoops();
+    }
+
+    // The listen socket is always serviced by the first loop, with
+    // connections distributed evenly over all of them
+    uint32_t index = 0;
+    if ( isListenConnection == false )
+    {
+        index = m_NextEventLoop;
+        m_NextEventLoop = ( ( m_NextEventLoop + 1 ) % NUM_EVENT_LOOPS );
+    }
+    ci->m_EventLoopIndex = index;
+
+    // The loop thread will pick up the connection when woken
+    EventLoop * loop = m_EventLoops[ index ];
+    {
+        MutexHolder mh( loop->m_NewConnectionsMutex );
+        if ( isListenConnection )
+        {
+            loop->m_ListenConnection = ci;
+        }
+        loop->m_NewConnections.Append( ci );
+    }
+    loop->Wake();
+}
+
+// EventLoopThreadWrapperFunction
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TCPConnectionPool::EventLoopThreadWrapperFunction( void * data )
+{
+    TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( TCPConnectionPoolProfileHelper::THREAD_CONNECTION );
+    PROFILE_FUNCTION;
+
+    EventLoop * loop = (EventLoop *)data;
+    loop->m_Pool->EventLoopThreadFunction( *loop );
+    return 0;
+}
+
+// EventLoopThreadFunction
+//------------------------------------------------------------------------------
+void TCPConnectionPool::EventLoopThreadFunction( EventLoop & loop )
+{
+    s_IsEventLoopThread = true;
+
+    Array< ConnectionInfo * > newConnections( 8, true );
+    epoll_event events[ 64 ];
+
+    while ( AtomicLoadAcquire( &loop.m_Exit ) == false )
+    {
+        // start servicing any new connections
+        {
+            MutexHolder mh( loop.m_NewConnectionsMutex );
+            newConnections.Swap( loop.m_NewConnections );
+        }
+        for ( ConnectionInfo * ci : newConnections )
+        {
+            if ( ci != loop.m_ListenConnection )
+            {
+                OnConnected( ci ); // Do callback
+            }
+
+            // (data may have been queued to send before we started servicing it)
+            MutexHolder mh( ci->m_SendMutex );
+            epoll_event event;
+            memset( &event, 0, sizeof( event ) );
+            event.events = ( ci->m_SendQueueBytes > 0 ) ? ( EPOLLIN | EPOLLOUT ) : EPOLLIN;
+            event.data.ptr = ci;
+            VERIFY( epoll_ctl( loop.m_EpollFD, EPOLL_CTL_ADD, ci->m_Socket, &event ) == 0 );
+            loop.m_Connections.Append( ci );
+
+            // connection may have been closed before we started servicing it
+            if ( AtomicLoadAcquire( &ci->m_ThreadQuitNotification ) )
+            {
+                AtomicStoreRelaxed( &loop.m_CheckForDisconnects, true );
+            }
+        }
+        newConnections.Clear();
+
+        // wait for socket events (with a timeout to check for exit)
+        const int numEvents = epoll_wait( loop.m_EpollFD, events, 64, 100 );
+        for ( int i = 0; i < numEvents; ++i )
+        {
+            ConnectionInfo * ci = static_cast< ConnectionInfo * >( events[ i ].data.ptr );
+            if ( ci == nullptr )
+            {
+                // woken by another thread
+                eventfd_t value;
+                eventfd_read( loop.m_WakeFD, &value );
+                continue;
+            }
+
+            if ( AtomicLoadAcquire( &ci->m_ThreadQuitNotification ) )
+            {
+                continue; // don't bother reading any pending data if closing
+            }
+
+            bool ok = true;
+            if ( ci == loop.m_ListenConnection )
+            {
+                ok = HandleAccept( ci );
+            }
+            else
+            {
+                if ( events[ i ].events & EPOLLOUT )
+                {
+                    ok = HandleWriteNonBlocking( loop, ci );
+                }
+                if ( ok && ( events[ i ].events & ( EPOLLIN | EPOLLERR | EPOLLHUP ) ) )
+                {
+                    ok = HandleReadNonBlocking( ci );
+                }
+            }
+            if ( ok == false )
+            {
+                AtomicStoreRelease( &ci->m_ThreadQuitNotification, true );
+                AtomicStoreRelaxed( &loop.m_CheckForDisconnects, true );
+            }
+        }
+
+        // close connections which have been disconnected
+        if ( AtomicLoadAcquire( &loop.m_CheckForDisconnects ) )
+        {
+            AtomicStoreRelaxed( &loop.m_CheckForDisconnects, false );
+            for ( size_t i = loop.m_Connections.GetSize(); i > 0; --i )
+            {
+                ConnectionInfo * ci = loop.m_Connections[ i - 1 ];
+                if ( AtomicLoadAcquire( &ci->m_ThreadQuitNotification ) )
+                {
+                    loop.m_Connections.EraseIndex( i - 1 );
+                    CloseEventLoopConnection( loop, ci );
+                }
+            }
+        }
+    }
+
+    // thread exit
+    ASSERT( loop.m_Connections.IsEmpty() );
+    TCPDEBUG( "Event loop thread exited\n" );
+}
+
+// CloseEventLoopConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::CloseEventLoopConnection( EventLoop & loop, ConnectionInfo * ci )
+{
+    // stop monitoring the socket
+    VERIFY( epoll_ctl( loop.m_EpollFD, EPOLL_CTL_DEL, ci->m_Socket, nullptr ) == 0 );
+
+    if ( ci == loop.m_ListenConnection )
+    {
+        loop.m_ListenConnection = nullptr;
+        DestroyListenConnection( ci );
+        return;
+    }
+
+    // discard any partially received message
+    if ( ci->m_ReceiveBuffer )
+    {
+        FreeBuffer( ci->m_ReceiveBuffer );
+        ci->m_ReceiveBuffer = nullptr;
+    }
+
+    // discard any data waiting to be sent
+    {
+        MutexHolder mh( ci->m_SendMutex );
+        FreeSendQueue( ci );
+    }
+
+    OnDisconnected( ci ); // Do callback
+
+    DestroyConnection( ci );
+}
+
+// HandleAccept
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::HandleAccept( ConnectionInfo * ci )
+{
+    PROFILE_FUNCTION;
+
+    // accept all pending connections
+    for ( ;; )
+    {
+        struct sockaddr_in remoteAddrInfo;
+        int remoteAddrInfoSize = sizeof( remoteAddrInfo );
+
+        // get a socket for the new connection
+        TCPSocket newSocket = Accept( ci->m_Socket, (struct sockaddr *)&remoteAddrInfo, &remoteAddrInfoSize );
+        if ( newSocket == INVALID_SOCKET )
+        {
+            if ( WouldBlock() )
+            {
+                return true; // no more pending connections
+            }
+            if ( ( errno == ECONNABORTED ) || ( errno == EINTR ) )
+            {
+                continue; // connection was dropped before we accepted it
+            }
+
+            // handle errors or socket shutdown
+            TCPDEBUG( "accept() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+            return false;
+        }
+
+        #ifdef TCPCONNECTION_DEBUG
+            AStackString<32> addr;
+            GetAddressAsString( remoteAddrInfo.sin_addr.s_addr, addr );
+            TCPDEBUG( "Connection accepted from %s : %i (%x)\n", addr.Get(), ntohs( remoteAddrInfo.sin_port ), (uint32_t)newSocket );
+        #endif
+
+        // Configure socket
+        DisableSigPipe( newSocket );        // Prevent socket inheritence by child processes
+        DisableNagle( newSocket );          // Disable Nagle's algorithm
+        SetLargeBufferSizes( newSocket );   // Set send/recv buffer sizes
+        SetNonBlocking( newSocket );        // Set non-blocking
+
+        // keep the new connected socket
+        CreateConnection( newSocket,
+                          remoteAddrInfo.sin_addr.s_addr,
+                          ntohs( remoteAddrInfo.sin_port ) );
+    }
+}
+
+// HandleReadNonBlocking
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::HandleReadNonBlocking( ConnectionInfo * ci )
+{
+    PROFILE_FUNCTION;
+
+    // Receive as much of a message as is available. Partially received
+    // messages are continued when more data arrives.
+
+    // work out how many bytes there are
+    while ( ci->m_ReceiveSizeBytes < sizeof( ci->m_ReceiveSize ) )
+    {
+        const uint32_t bytesToRead = (uint32_t)sizeof( ci->m_ReceiveSize ) - ci->m_ReceiveSizeBytes;
+        const int numBytes = (int)recv( ci->m_Socket, ( (char *)&ci->m_ReceiveSize ) + ci->m_ReceiveSizeBytes, bytesToRead, 0 );
+        if ( numBytes <= 0 )
+        {
+            if ( ( numBytes < 0 ) && WouldBlock() )
+            {
+                return true; // wait for more data
+            }
+            TCPDEBUG( "recv() failed (A). Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, numBytes, (uint32_t)( ci->m_Socket ) );
+            return false;
+        }
+        ci->m_ReceiveSizeBytes += (uint32_t)numBytes;
+        if ( ci->m_ReceiveSizeBytes == sizeof( ci->m_ReceiveSize ) )
+        {
+            TCPDEBUG( "Handle read: %i (%x)\n", ci->m_ReceiveSize, (uint32_t)( ci->m_Socket ) );
+
+            // get output location
+            ci->m_ReceiveBuffer = AllocBuffer( ci->m_ReceiveSize );
+            ASSERT( ci->m_ReceiveBuffer );
+            ci->m_ReceiveDataBytes = 0;
+        }
+    }
+
+    // read data into the user supplied buffer
+    while ( ci->m_ReceiveDataBytes < ci->m_ReceiveSize )
+    {
+        const uint32_t bytesToRead = ( ci->m_ReceiveSize - ci->m_ReceiveDataBytes );
+        const int numBytes = (int)recv( ci->m_Socket, (char *)ci->m_ReceiveBuffer + ci->m_ReceiveDataBytes, bytesToRead, 0 );
+        if ( numBytes <= 0 )
+        {
+            if ( ( numBytes < 0 ) && WouldBlock() )
+            {
+                return true; // wait for more data
+            }
+            TCPDEBUG( "recv() failed (B). Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, numBytes, (uint32_t)( ci->m_Socket ) );
+            return false;
+        }
+        ci->m_ReceiveDataBytes += (uint32_t)numBytes;
+    }
+
+    // message is complete - reset for the next one
+    void * buffer = ci->m_ReceiveBuffer;
+    const uint32_t size = ci->m_ReceiveSize;
+    ci->m_ReceiveBuffer = nullptr;
+    ci->m_ReceiveSizeBytes = 0;
+    ci->m_ReceiveDataBytes = 0;
+
+    // tell user the data is in their buffer
+    // (any further messages will be signalled by epoll again)
+    bool keepMemory = false;
+    OnReceive( ci, buffer, size, keepMemory );
+    if ( !keepMemory )
+    {
+        FreeBuffer( buffer );
+    }
+
+    return true;
 }
 
-// ThreadWrapperFunction
+// HandleWriteNonBlocking
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::HandleWriteNonBlocking( EventLoop & loop, ConnectionInfo * ci )
+{
+    PROFILE_FUNCTION;
+
+    // Send as much queued data as the socket will accept
+    MutexHolder mh( ci->m_SendMutex );
+    while ( ci->m_SendQueueBytes > 0 )
+    {
+        struct iovec sendBuffers[ MAX_BUFFERS_PER_SEND ];
+        uint32_t numSendBuffers = 0;
+        for ( size_t i = ci->m_SendQueueFirst; ( i < ci->m_SendQueue.GetSize() ) && ( numSendBuffers < MAX_BUFFERS_PER_SEND ); ++i )
+        {
+            const uint32_t overlap = ( numSendBuffers == 0 ) ? ci->m_SendQueueOffset : 0;
+            sendBuffers[ numSendBuffers ].iov_len = ( ci->m_SendQueue[ i ].m_Size - overlap );
+            sendBuffers[ numSendBuffers ].iov_base = (char *)ci->m_SendQueue[ i ].m_Data + overlap;
+            ++numSendBuffers;
+        }
+
+        ssize_t sent = writev( ci->m_Socket, sendBuffers, numSendBuffers );
+        if ( sent <= 0 )
+        {
+            if ( ( sent < 0 ) && WouldBlock() )
+            {
+                return true; // wait for more space
+            }
+            TCPDEBUG( "send() failed (B). Error: %s (Sent: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, (int)sent, (uint32_t)( ci->m_Socket ) );
+            return false;
+        }
+
+        // free buffers which have been sent
+        ci->m_SendQueueBytes -= (uint64_t)sent;
+        uint64_t remaining = (uint64_t)sent;
+        while ( remaining > 0 )
+        {
+            ConnectionInfo::QueuedSend & queuedSend = ci->m_SendQueue[ ci->m_SendQueueFirst ];
+            const uint32_t unsent = ( queuedSend.m_Size - ci->m_SendQueueOffset );
+            if ( remaining < unsent )
+            {
+                ci->m_SendQueueOffset += (uint32_t)remaining;
+                break;
+            }
+            remaining -= unsent;
+            FREE( queuedSend.m_Data );
+            ++ci->m_SendQueueFirst;
+            ci->m_SendQueueOffset = 0;
+        }
+        ci->m_SendQueueTimer.Start();
+        ci->m_SendQueueProgress.Signal();
+    }
+
+    // everything has been sent, so stop waiting for the socket to be writable
+    ASSERT( ci->m_SendQueueFirst == ci->m_SendQueue.GetSize() );
+    ci->m_SendQueue.Clear();
+    ci->m_SendQueueFirst = 0;
+    epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events = EPOLLIN;
+    event.data.ptr = ci;
+    VERIFY( epoll_ctl( loop.m_EpollFD, EPOLL_CTL_MOD, ci->m_Socket, &event ) == 0 );
+    return true;
+}
+#else
+// ListenThreadWrapperFunction
 //------------------------------------------------------------------------------
 /*static*/ uint32_t TCPConnectionPool::ListenThreadWrapperFunction( void * data )
 {
@@ -988,65 +1766,19 @@ void TCPConnectionPool::ListenThreadFunction( ConnectionInfo * ci )
         SetNonBlocking( newSocket );        // Set non-blocking
 
         // keep the new connected socket
-        CreateConnectionThread( newSocket,
-                                remoteAddrInfo.sin_addr.s_addr,
-                                ntohs( remoteAddrInfo.sin_port ) );
+        CreateConnection( newSocket,
+                          remoteAddrInfo.sin_addr.s_addr,
+                          ntohs( remoteAddrInfo.sin_port ) );
 
         continue; // keep listening for more connections
     }
 
-    // close the socket
-    CloseSocket( ci->m_Socket );
-    ci->m_Socket = INVALID_SOCKET;
-
-    {
-        // clear connection (might already be null
-        // if simultaneously closed on another thread
-        // but we'll hapily set it null redundantly
-        MutexHolder mh( m_ConnectionsMutex );
-        ASSERT( m_ListenConnection == ci );
-        m_ListenConnection = nullptr;
-        FDELETE ci;
-        m_ShutdownSemaphore.Signal(); // Wake main thread which may be waiting on shutdown
-    }
+    DestroyListenConnection( ci );
 
     // thread exit
     TCPDEBUG( "Listen thread exited\n" );
 }
 
-// CreateConnectionThread
-//------------------------------------------------------------------------------
-ConnectionInfo * TCPConnectionPool::CreateConnectionThread( TCPSocket socket, uint32_t host, uint16_t port, void * userData )
-{
-    MutexHolder mh( m_ConnectionsMutex );
-
-    ConnectionInfo * ci = FNEW( ConnectionInfo( this ) );
-    ci->m_Socket = socket;
-    ci->m_RemoteAddress = host;
-    ci->m_RemotePort = port;
-    ci->m_ThreadQuitNotification = false;
-    ci->m_UserData = userData;
-
-    #ifdef TCPCONNECTION_DEBUG
-        AStackString<32> addr;
-        GetAddressAsString( ci->m_RemoteAddress, addr );
-        TCPDEBUG( "Connected to %s : %i (%x)\n", addr.Get(), port, (uint32_t)socket );
-    #endif
-
-    // Spawn thread to handle socket
-    Thread::ThreadHandle h = Thread::CreateThread( &ConnectionThreadWrapperFunction,
-                                                   "TCPConnection",
-                                                   ( 64 * KILOBYTE ),
-                                                   ci ); // user data argument
-    ASSERT( h != INVALID_THREAD_HANDLE );
-    Thread::DetachThread( h );
-    Thread::CloseHandle( h ); // we don't need this anymore
-
-    m_Connections.Append( ci );
-
-    return ci;
-}
-
 // ConnectionThreadWrapperFunction
 //------------------------------------------------------------------------------
 /*static*/ uint32_t TCPConnectionPool::ConnectionThreadWrapperFunction( void * data )
@@ -1121,29 +1853,12 @@ void TCPConnectionPool::ConnectionThreadFunction( ConnectionInfo * ci )
 
     OnDisconnected( ci ); // Do callback
 
-    // close the socket
-    CloseSocket( ci->m_Socket );
-    ci->m_Socket = INVALID_SOCKET;
-
-    {
-        // try to remove from connection list
-        // could validly be removed by another
-        // thread already due to simultaneously
-        // closing a connection while it is dropped
-        MutexHolder mh( m_ConnectionsMutex );
-        ConnectionInfo ** iter = m_Connections.Find( ci );
-        ASSERT( iter );
-        m_Connections.Erase( iter );
-        FDELETE ci;
-        if ( AtomicLoadRelaxed( &m_ShuttingDown ) )
-        {
-            m_ShutdownSemaphore.Signal(); // Wake main thread which will be waiting on shutdown
-        }
-    }
+    DestroyConnection( ci );
 
     // thread exit
     TCPDEBUG( "connection thread exited\n" );
 }
+#endif
 
 // AllowSocketReuse
 //------------------------------------------------------------------------------
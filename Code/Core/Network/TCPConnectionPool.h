@@ -12,6 +12,7 @@
 #include "Core/Process/Semaphore.h"
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
@@ -48,6 +49,31 @@ private:
     TCPConnectionPool *     m_TCPConnectionPool; // back pointer to parent pool
     mutable void *          m_UserData;
 
+#if defined( __LINUX__ )
+    // Event loop servicing this connection, and the state of any partially
+    // received message (the size is received first, followed by the data)
+    uint32_t                m_EventLoopIndex;
+    uint32_t                m_ReceiveSize;
+    uint32_t                m_ReceiveSizeBytes;
+    uint32_t                m_ReceiveDataBytes;
+    void *                  m_ReceiveBuffer;
+
+    // Data which couldn't be sent immediately, sent by the event loop when the
+    // socket is writable (later sends are queued behind it to keep them in order)
+    struct QueuedSend
+    {
+        void *              m_Data;
+        uint32_t            m_Size;
+    };
+    mutable Mutex               m_SendMutex;
+    mutable Array< QueuedSend > m_SendQueue;
+    mutable uint32_t            m_SendQueueFirst;   // buffers before this have been sent
+    mutable uint32_t            m_SendQueueOffset;  // bytes of the first buffer which have been sent
+    mutable uint64_t            m_SendQueueBytes;   // bytes waiting to be sent
+    mutable Timer               m_SendQueueTimer;   // time since queued data was last sent
+    mutable Semaphore           m_SendQueueProgress;// signalled as queued data is sent
+#endif
+
 #ifdef DEBUG
     mutable bool            m_InUse; // sanity check we aren't sending from multiple threads unsafely
 #endif
@@ -76,8 +102,15 @@ public:
     size_t GetNumConnections() const;
 
     // transmit data
+    struct SendBuffer
+    {
+        uint32_t        size;
+        const void *    data;
+    };
     bool Send( const ConnectionInfo * connection, const void * data, size_t size, uint32_t timeoutMS = 30000 );
     bool Send( const ConnectionInfo * connection, const void * data, size_t size, const void * payloadData, size_t payloadSize, uint32_t timeoutMS = 30000 );
+    // payload gathered from several buffers, sent without being copied together
+    bool Send( const ConnectionInfo * connection, const void * data, size_t size, const SendBuffer * payloadBuffers, uint32_t numPayloadBuffers, uint32_t timeoutMS = 30000 );
     bool Broadcast( const void * data, size_t size );
 
     static void GetAddressAsString( uint32_t addr, AString & address );
@@ -94,7 +127,9 @@ protected:
 
 private:
     // helper functions
+#if !defined( __LINUX__ )
     bool        HandleRead( ConnectionInfo * ci );
+#endif
 
     // platform specific abstraction
     int         GetLastNetworkError() const;
@@ -110,20 +145,40 @@ private:
                         int * addressSize ) const;
     TCPSocket   CreateSocket() const;
 
-    struct SendBuffer
-    {
-        uint32_t        size;
-        const void *    data;
-    };
+    enum : uint32_t { MAX_BUFFERS_PER_SEND = 16 }; // Buffers passed to each writev/WSASend
     bool        SendInternal( const ConnectionInfo * connection, const SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS );
+#if defined( __LINUX__ )
+    enum : uint64_t { MAX_QUEUED_SEND_BYTES = ( 64 * 1024 * 1024 ) }; // Senders wait for queued data to be sent beyond this
+    bool        WaitForSendQueue( const ConnectionInfo * connection, uint32_t timeoutMS );
+    void        QueueSend( const ConnectionInfo * connection, const SendBuffer * buffers, uint32_t numBuffers, uint32_t bytesSent );
+    void        FreeSendQueue( const ConnectionInfo * connection );
+#endif
 
-    // thread management
-    void                CreateListenThread( TCPSocket socket, uint32_t host, uint16_t port );
+    // connection management
+    void                CreateListenConnection( TCPSocket socket, uint32_t host, uint16_t port );
+    ConnectionInfo *    CreateConnection( TCPSocket socket, uint32_t host, uint16_t port, void * userData = nullptr );
+    void                DestroyListenConnection( ConnectionInfo * ci );
+    void                DestroyConnection( ConnectionInfo * ci );
+
+#if defined( __LINUX__ )
+    // event loops - connections are serviced by a fixed number of threads using epoll
+    class EventLoop;
+    void                StartEventLoops();
+    void                StopEventLoops();
+    void                AddToEventLoop( ConnectionInfo * ci, bool isListenConnection );
+    static uint32_t     EventLoopThreadWrapperFunction( void * data );
+    void                EventLoopThreadFunction( EventLoop & loop );
+    void                CloseEventLoopConnection( EventLoop & loop, ConnectionInfo * ci );
+    bool                HandleAccept( ConnectionInfo * ci );
+    bool                HandleReadNonBlocking( ConnectionInfo * ci );
+    bool                HandleWriteNonBlocking( EventLoop & loop, ConnectionInfo * ci );
+#else
+    // thread management - each connection is serviced by its own thread
     static uint32_t     ListenThreadWrapperFunction( void * data );
     void                ListenThreadFunction( ConnectionInfo * ci );
-    ConnectionInfo *    CreateConnectionThread( TCPSocket socket, uint32_t host, uint16_t port, void * userData = nullptr );
     static uint32_t     ConnectionThreadWrapperFunction( void * data );
     void                ConnectionThreadFunction( ConnectionInfo * ci );
+#endif
 
     // internal helpers
     void                AllowSocketReuse( TCPSocket socket ) const;
@@ -142,6 +197,12 @@ private:
     bool                        m_ShuttingDown;
     Semaphore                   m_ShutdownSemaphore;
 
+#if defined( __LINUX__ )
+    enum : uint32_t { NUM_EVENT_LOOPS = 4 };
+    Array< EventLoop * >        m_EventLoops;
+    uint32_t                    m_NextEventLoop;
+#endif
+
     // object to manage network subsystem lifetime
 protected:
     NetworkStartupHelper m_EnsureNetworkStarted;
@@ -0,0 +1,365 @@
+// TCPStream - A single TCP connection, used directly by its owner
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Includes
+//------------------------------------------------------------------------------
+#include "TCPStream.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Network/Network.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+// System
+#if defined( __WINDOWS__ )
+    #include "Core/Env/WindowsHeader.h"
+#elif defined( __APPLE__ ) || defined( __LINUX__ )
+    #include <arpa/inet.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <string.h>
+    #include <sys/ioctl.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+    #define INVALID_SOCKET ( -1 )
+    #define SOCKET_ERROR -1
+#else
+    #error Unknown platform
+#endif
+
+// Helpers
+//------------------------------------------------------------------------------
+namespace
+{
+    bool WouldBlock()
+    {
+        #if defined( __WINDOWS__ )
+            return ( WSAGetLastError() == WSAEWOULDBLOCK );
+        #else
+            return ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) || ( errno == EINPROGRESS ) || ( errno == EINTR ) );
+        #endif
+    }
+
+    void CloseSocket( TCPSocket socket )
+    {
+        #if defined( __WINDOWS__ )
+            closesocket( socket );
+        #else
+            close( socket );
+        #endif
+    }
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+TCPStream::TCPStream()
+    : m_Socket( INVALID_TCP_SOCKET )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+TCPStream::~TCPStream()
+{
+    Close();
+}
+
+// Connect
+//------------------------------------------------------------------------------
+bool TCPStream::Connect( const AString & host, uint16_t port, uint32_t timeoutMS )
+{
+    ASSERT( !host.IsEmpty() );
+
+    const uint32_t hostIP = Network::GetHostIPFromName( host, timeoutMS );
+    if ( hostIP == 0 )
+    {
+        return false;
+    }
+    return Connect( hostIP, port, timeoutMS );
+}
+
+// Connect
+//------------------------------------------------------------------------------
+bool TCPStream::Connect( uint32_t hostIP, uint16_t port, uint32_t timeoutMS )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( !IsOpen() );
+
+    m_Socket = CreateSocket();
+    if ( m_Socket == INVALID_TCP_SOCKET )
+    {
+        return false;
+    }
+    ConfigureSocket( m_Socket );
+
+    struct sockaddr_in destAddr;
+    memset( &destAddr, 0, sizeof( destAddr ) );
+    destAddr.sin_family = AF_INET;
+    destAddr.sin_port = htons( port );
+    destAddr.sin_addr.s_addr = hostIP;
+
+    // initiate connection (we expect it to be in progress)
+    if ( ( connect( m_Socket, (struct sockaddr *)&destAddr, sizeof( destAddr ) ) != 0 ) && !WouldBlock() )
+    {
+        Close();
+        return false;
+    }
+
+    // wait for the connection to complete
+    if ( Wait( true, timeoutMS ) == false )
+    {
+        Close();
+        return false;
+    }
+
+    // check the result
+    int32_t error = 0;
+    #if defined( __WINDOWS__ )
+        int size = sizeof( error );
+    #else
+        socklen_t size = sizeof( error );
+    #endif
+    if ( ( getsockopt( m_Socket, SOL_SOCKET, SO_ERROR, (char *)&error, &size ) == SOCKET_ERROR ) || ( error != 0 ) )
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+// Listen
+//------------------------------------------------------------------------------
+bool TCPStream::Listen( uint16_t port )
+{
+    ASSERT( !IsOpen() );
+
+    m_Socket = CreateSocket();
+    if ( m_Socket == INVALID_TCP_SOCKET )
+    {
+        return false;
+    }
+    ConfigureSocket( m_Socket );
+
+    static const int yes = 1;
+    setsockopt( m_Socket, SOL_SOCKET, SO_REUSEADDR, (const char *)&yes, sizeof( yes ) );
+
+    struct sockaddr_in addrInfo;
+    memset( &addrInfo, 0, sizeof( addrInfo ) );
+    addrInfo.sin_family = AF_INET;
+    addrInfo.sin_port = htons( port );
+    addrInfo.sin_addr.s_addr = INADDR_ANY;
+
+    if ( ( bind( m_Socket, (struct sockaddr *)&addrInfo, sizeof( addrInfo ) ) != 0 ) ||
+         ( listen( m_Socket, SOMAXCONN ) == SOCKET_ERROR ) )
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+// Accept
+//------------------------------------------------------------------------------
+bool TCPStream::Accept( TCPStream & outStream, uint32_t timeoutMS )
+{
+    ASSERT( IsOpen() );
+    ASSERT( !outStream.IsOpen() );
+
+    if ( Wait( false, timeoutMS ) == false )
+    {
+        return false;
+    }
+
+    #if defined( __LINUX__ )
+        const TCPSocket newSocket = accept4( m_Socket, nullptr, nullptr, SOCK_CLOEXEC );
+    #else
+        const TCPSocket newSocket = accept( m_Socket, nullptr, nullptr );
+    #endif
+    if ( newSocket == INVALID_TCP_SOCKET )
+    {
+        return false;
+    }
+    #if defined( __APPLE__ )
+        VERIFY( fcntl( newSocket, F_SETFD, FD_CLOEXEC ) == 0 );
+    #endif
+
+    ConfigureSocket( newSocket );
+    outStream.m_Socket = newSocket;
+    return true;
+}
+
+// Close
+//------------------------------------------------------------------------------
+void TCPStream::Close()
+{
+    if ( m_Socket != INVALID_TCP_SOCKET )
+    {
+        CloseSocket( m_Socket );
+        m_Socket = INVALID_TCP_SOCKET;
+    }
+}
+
+// Send
+//------------------------------------------------------------------------------
+bool TCPStream::Send( const void * data, size_t size, uint32_t timeoutMS )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( IsOpen() );
+
+    const char * pos = static_cast< const char * >( data );
+    const char * const end = ( pos + size );
+    while ( pos < end )
+    {
+        const int toSend = (int)Math::Min< size_t >( (size_t)( end - pos ), ( 1024 * 1024 * 1024 ) );
+        #if defined( __LINUX__ )
+            const int sent = (int)send( m_Socket, pos, (size_t)toSend, MSG_NOSIGNAL );
+        #else
+            const int sent = (int)send( m_Socket, pos, toSend, 0 );
+        #endif
+        if ( sent > 0 )
+        {
+            pos += sent;
+            continue;
+        }
+        if ( ( sent < 0 ) && WouldBlock() && Wait( true, timeoutMS ) )
+        {
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+// Receive
+//------------------------------------------------------------------------------
+bool TCPStream::Receive( void * buffer, size_t bufferSize, size_t & outReceived, uint32_t timeoutMS )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( IsOpen() );
+    ASSERT( bufferSize > 0 );
+
+    const int toReceive = (int)Math::Min< size_t >( bufferSize, ( 1024 * 1024 * 1024 ) );
+    for ( ;; )
+    {
+        const int received = (int)recv( m_Socket, static_cast< char * >( buffer ), toReceive, 0 );
+        if ( received > 0 )
+        {
+            outReceived = (size_t)received;
+            return true;
+        }
+        if ( ( received < 0 ) && WouldBlock() && Wait( false, timeoutMS ) )
+        {
+            continue;
+        }
+        return false; // closed, failed or timed out
+    }
+}
+
+// Wait
+//------------------------------------------------------------------------------
+bool TCPStream::Wait( bool forWrite, uint32_t timeoutMS ) const
+{
+    Timer timer;
+    for ( ;; )
+    {
+        fd_set set, err;
+        FD_ZERO( &set );
+        FD_ZERO( &err );
+        PRAGMA_DISABLE_PUSH_MSVC( 4548 ) // warning C4548: expression before comma has no effect; expected expression with side-effect
+        PRAGMA_DISABLE_PUSH_MSVC( 6319 ) // warning C6319: Use of the comma-operator in a tested expression...
+        PRAGMA_DISABLE_PUSH_CLANG_WINDOWS( "-Wcomma" ) // possible misuse of comma operator here [-Wcomma]
+        PRAGMA_DISABLE_PUSH_CLANG_WINDOWS( "-Wunused-value" ) // expression result unused [-Wunused-value]
+        FD_SET( m_Socket, &set );
+        FD_SET( m_Socket, &err );
+        PRAGMA_DISABLE_POP_CLANG_WINDOWS // -Wunused-value
+        PRAGMA_DISABLE_POP_CLANG_WINDOWS // -Wcomma
+        PRAGMA_DISABLE_POP_MSVC // 6319
+        PRAGMA_DISABLE_POP_MSVC // 4548
+
+        const float elapsedMS = timer.GetElapsedMS();
+        if ( elapsedMS >= (float)timeoutMS )
+        {
+            return false; // timed out
+        }
+        const uint32_t waitMS = ( timeoutMS - (uint32_t)elapsedMS );
+
+        timeval waitTimeout;
+        memset( &waitTimeout, 0, sizeof( timeval ) );
+        waitTimeout.tv_sec = (int32_t)( waitMS / 1000 );
+        waitTimeout.tv_usec = (int32_t)( ( waitMS % 1000 ) * 1000 );
+
+        const int selRet = select( (int)m_Socket + 1, // NOTE: ignored by Windows
+                                   forWrite ? nullptr : &set,
+                                   forWrite ? &set : nullptr,
+                                   &err,
+                                   &waitTimeout );
+        if ( selRet == SOCKET_ERROR )
+        {
+            if ( WouldBlock() )
+            {
+                continue; // interrupted
+            }
+            return false;
+        }
+        if ( selRet > 0 )
+        {
+            return ( FD_ISSET( m_Socket, &err ) == 0 );
+        }
+    }
+}
+
+// CreateSocket
+//------------------------------------------------------------------------------
+/*static*/ TCPSocket TCPStream::CreateSocket()
+{
+    #if defined( __LINUX__ )
+        // On Linux we can create the socket with inheritance disabled (SOCK_CLOEXEC)
+        const TCPSocket newSocket = socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+    #else
+        const TCPSocket newSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    #endif
+    if ( newSocket == INVALID_TCP_SOCKET )
+    {
+        return newSocket;
+    }
+    #if defined( __APPLE__ )
+        // See notes in TCPConnectionPool::CreateSocket
+        VERIFY( fcntl( newSocket, F_SETFD, FD_CLOEXEC ) == 0 );
+    #endif
+    return newSocket;
+}
+
+// ConfigureSocket
+//------------------------------------------------------------------------------
+/*static*/ void TCPStream::ConfigureSocket( TCPSocket socket )
+{
+    // Requests and responses are usually small, so don't delay them
+    static const int disableNagle = 1;
+    setsockopt( socket, IPPROTO_TCP, TCP_NODELAY, (const char *)&disableNagle, sizeof( disableNagle ) );
+
+    #if defined( __APPLE__ )
+        // Must be done on every socket on OSX (Linux disables SIGPIPE in NetworkStartupHelper)
+        int nosigpipe = 1;
+        VERIFY( setsockopt( socket, SOL_SOCKET, SO_NOSIGPIPE, (void *)&nosigpipe, sizeof( int ) ) == 0 );
+    #endif
+
+    // Timeouts are implemented with select
+    u_long nonBlocking = 1;
+    #if defined( __WINDOWS__ )
+        VERIFY( ioctlsocket( socket, (long)FIONBIO, &nonBlocking ) == 0 );
+    #else
+        VERIFY( ioctl( socket, FIONBIO, &nonBlocking ) == 0 );
+    #endif
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,57 @@
+// TCPStream - A single TCP connection, used directly by its owner
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "TCPConnectionPool.h" // For TCPSocket
+#include "NetworkStartupHelper.h"
+
+#include "Core/Env/Types.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+
+// TCPStream
+//  - Unlike the TCPConnectionPool, there is no message framing and no threads:
+//    data is sent and received by the owner as a plain stream of bytes, for
+//    talking to (or implementing) services using other protocols.
+//  - All operations block, up to the given timeout.
+//------------------------------------------------------------------------------
+class TCPStream
+{
+public:
+    explicit TCPStream();
+    ~TCPStream();
+
+    // Client
+    bool Connect( const AString & host, uint16_t port, uint32_t timeoutMS );
+    bool Connect( uint32_t hostIP, uint16_t port, uint32_t timeoutMS );
+
+    // Server
+    bool Listen( uint16_t port );
+    bool Accept( TCPStream & outStream, uint32_t timeoutMS );
+
+    void Close();
+    inline bool IsOpen() const { return ( m_Socket != INVALID_TCP_SOCKET ); }
+
+    // Send all of the data
+    bool Send( const void * data, size_t size, uint32_t timeoutMS );
+
+    // Receive at least one byte, up to the given size. Returns false if the
+    // connection was closed (or on error or timeout)
+    bool Receive( void * buffer, size_t bufferSize, size_t & outReceived, uint32_t timeoutMS );
+
+private:
+    static constexpr TCPSocket INVALID_TCP_SOCKET = (TCPSocket)-1;
+
+    bool Wait( bool forWrite, uint32_t timeoutMS ) const;
+    static TCPSocket CreateSocket();
+    static void ConfigureSocket( TCPSocket socket );
+
+    NetworkStartupHelper    m_EnsureNetworkStarted;
+    TCPSocket               m_Socket;
+};
+
+//------------------------------------------------------------------------------
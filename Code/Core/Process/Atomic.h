@@ -105,6 +105,21 @@ inline void AtomicStoreRelease( T * volatile * x, T * value )
         #error Unknown compiler
     #endif
 }
+// Replace *x with newValue if *x == comparand. Returns the original value
+// of *x (which equals comparand if the exchange succeeded)
+template < class T >
+inline T * AtomicCompareExchangePtr( T * volatile * x, T * newValue, T * comparand )
+{
+    #if defined( __GNUC__ ) || defined( __clang__ )
+        T * expected = comparand;
+        __atomic_compare_exchange_n( x, &expected, newValue, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+        return expected;
+    #elif defined( _MSC_VER )
+        return static_cast< T * >( InterlockedCompareExchangePointer( reinterpret_cast< void * volatile * >( x ), newValue, comparand ) );
+    #else
+        #error Unknown compiler
+    #endif
+}
 
 // 32bit
 //------------------------------------------------------------------------------
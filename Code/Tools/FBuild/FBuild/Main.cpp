@@ -210,6 +210,10 @@ int Main( int argc, char * argv[] )
     {
         result = fBuild.CacheOutputInfo();
     }
+    else if ( options.m_CacheTrainDictionary )
+    {
+        result = fBuild.CacheTrainDictionary();
+    }
     else if ( options.m_CacheTrim )
     {
         result = fBuild.CacheTrim();
@@ -0,0 +1,139 @@
+// Main
+//  - FBuildCoordinator: tracks worker capacity and load, so clients can find
+//    the workers most able to accept work (see FASTBUILD_COORDINATOR)
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/FBuildVersion.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CtrlCHandler.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Coordinator.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+
+// Core
+#include "Core/Network/NetworkStartupHelper.h"
+#include "Core/Process/Thread.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Tracing/Tracing.h"
+
+// system
+#include <stdio.h>
+
+// Return Codes
+//------------------------------------------------------------------------------
+enum ReturnCodes
+{
+    FBUILDCOORDINATOR_OK                = 0,
+    FBUILDCOORDINATOR_BAD_ARGS          = -1,
+    FBUILDCOORDINATOR_FAILED_TO_LISTEN  = -2,
+};
+
+// Functions
+//------------------------------------------------------------------------------
+int Main( int argc, char * argv[] );
+void DisplayHelp();
+
+// main
+//------------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    // This wrapper is purely for profiling scope
+    const int result = Main( argc, argv );
+    PROFILE_SYNCHRONIZE // make sure no tags are active and do one final sync
+    return result;
+}
+
+// Main
+//------------------------------------------------------------------------------
+int Main( int argc, char * argv[] )
+{
+    PROFILE_FUNCTION;
+
+    // handle cmd line args
+    uint16_t port = Protocol::COORDINATOR_PORT;
+    for ( int i = 1; i < argc; ++i ) // NOTE: Skip argv[0] exe name
+    {
+        const AStackString<> token( argv[ i ] );
+        if ( token.BeginsWith( "-port=" ) )
+        {
+            uint32_t p = 0;
+            PRAGMA_DISABLE_PUSH_MSVC( 4996 ) // This function or variable may be unsafe...
+            PRAGMA_DISABLE_PUSH_CLANG_WINDOWS( "-Wdeprecated-declarations" ) // 'sscanf' is deprecated: This function or variable may be unsafe...
+            if ( ( sscanf( token.Get() + 6, "%u", &p ) == 1 ) && ( p > 0 ) && ( p <= 0xFFFF ) ) // TODO:C consider sscanf_s
+            PRAGMA_DISABLE_POP_CLANG_WINDOWS // -Wdeprecated-declarations
+            PRAGMA_DISABLE_POP_MSVC // 4996
+            {
+                port = (uint16_t)p;
+                continue;
+            }
+        }
+        else if ( ( token == "-help" ) || ( token == "-?" ) )
+        {
+            DisplayHelp();
+            return FBUILDCOORDINATOR_OK;
+        }
+
+        OUTPUT( "FBuildCoordinator: Error: Unknown argument '%s'\n", token.Get() );
+        OUTPUT( "Try \"-help\"\n" );
+        return FBUILDCOORDINATOR_BAD_ARGS;
+    }
+
+    // don't buffer output
+    VERIFY( setvbuf( stdout, nullptr, _IONBF, 0 ) == 0 );
+    VERIFY( setvbuf( stderr, nullptr, _IONBF, 0 ) == 0 );
+
+    // Register Ctrl-C Handler
+    CtrlCHandler ctrlCHandler;
+
+    NetworkStartupHelper networkStartupHelper;
+
+    Coordinator coordinator;
+    if ( coordinator.Listen( port ) == false )
+    {
+        OUTPUT( "FBuildCoordinator: Error: Failed to listen on port %u\n", (uint32_t)port );
+        return FBUILDCOORDINATOR_FAILED_TO_LISTEN;
+    }
+    OUTPUT( "FBuildCoordinator " FBUILD_VERSION_STRING " - Listening on port %u\n", (uint32_t)port );
+
+    // run until Ctrl-C
+    size_t lastNumWorkers = 0;
+    while ( FBuild::GetStopBuild() == false )
+    {
+        const size_t numWorkers = coordinator.GetNumWorkers();
+        if ( numWorkers != lastNumWorkers )
+        {
+            OUTPUT( "Workers: %zu\n", numWorkers );
+            lastNumWorkers = numWorkers;
+        }
+
+        Thread::Sleep( 500 );
+    }
+
+    return FBUILDCOORDINATOR_OK;
+}
+
+// DisplayHelp
+//------------------------------------------------------------------------------
+void DisplayHelp()
+{
+    OUTPUT( "----------------------------------------------------------------------\n"
+            "FBuildCoordinator " FBUILD_VERSION_STRING " - "
+            "Copyright 2012-2021 Franta Fulin - https://www.fastbuild.org\n"
+            "----------------------------------------------------------------------\n"
+            "\n"
+            "Tracks the capacity and load of workers, so clients can find the\n"
+            "workers best able to accept work. Workers and clients use the\n"
+            "coordinator when FASTBUILD_COORDINATOR=<host>[:<port>] is set.\n"
+            "\n"
+            "Command Line Options:\n"
+            "----------------------------------------------------------------------\n"
+            " -help         Show this help.\n"
+            " -port=[port]  Port to listen on (default: %u).\n"
+            "----------------------------------------------------------------------\n",
+            (uint32_t)Protocol::COORDINATOR_PORT );
+}
+
+//------------------------------------------------------------------------------
@@ -12,14 +12,35 @@
 #include "Core/Containers/UniquePtr.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Time/Time.h"
 #include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
 
+// system
+#include <string.h>
+
+// Defines
+//------------------------------------------------------------------------------
+#define CACHE_MANIFEST_EXTENSION    ".manifest"
+#define CACHE_CHUNKS_DIR            "chunks"
+#define CACHE_DICTIONARIES_DIR      "dictionaries"
+#define CACHE_DICTIONARY_EXTENSION  ".lz4dict"
+#define CACHE_SUMMARY_FILE          "Summary"
+
+namespace
+{
+    const uint32_t  kManifestMagic      = 'F' | ( 'B' << 8 ) | ( 'C' << 16 ) | ( 'M' << 24 );
+    const uint32_t  kManifestVersion    = 1;
+}
+
 // CacheStats
 //------------------------------------------------------------------------------
 class CacheStats
@@ -29,38 +50,31 @@ public:
     uint64_t    m_NumBytes = 0;
 };
 
-// OldestFileTimeSorter
-//------------------------------------------------------------------------------
-class OldestFileTimeSorter
-{
-public:
-    bool operator () ( const FileIO::FileInfo & a, const FileIO::FileInfo & b ) const
-    {
-        return ( a.m_LastWriteTime < b.m_LastWriteTime );
-    }
-};
-
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 /*explicit*/ Cache::Cache() = default;
 
 // DESTRUCTOR
 //------------------------------------------------------------------------------
-/*virtual*/ Cache::~Cache() = default;
+/*virtual*/ Cache::~Cache()
+{
+    ASSERT( m_TrimThread == INVALID_THREAD_HANDLE ); // Shutdown should have been called
+}
 
 // Init
 //------------------------------------------------------------------------------
 /*virtual*/ bool Cache::Init( const AString & cachePath,
                               const AString & cachePathMountPoint,
-                              bool /*cacheRead*/,
-                              bool /*cacheWrite*/,
-                              bool /*cacheVerbose*/,
+                              bool cacheRead,
+                              bool cacheWrite,
+                              bool cacheVerbose,
                               const AString & /*pluginDLLConfig*/ )
 {
     PROFILE_FUNCTION;
 
     m_CachePath = cachePath;
     PathUtils::EnsureTrailingSlash( m_CachePath );
+    m_Verbose = cacheVerbose;
 
     // Check cache mount point if option is enabled
     #if defined( __WINDOWS__ )
@@ -78,6 +92,15 @@ public:
 
     if ( FileIO::EnsurePathExists( m_CachePath ) )
     {
+        m_Index.Init( m_CachePath );
+        LoadDictionaries();
+        if ( m_UseSummary && cacheRead )
+        {
+            LoadSummary();
+        }
+
+        // The size of the cache and its index are kept in check as it is used
+        m_CacheWrite = cacheWrite;
         return true;
     }
 
@@ -89,57 +112,105 @@ public:
 //------------------------------------------------------------------------------
 /*virtual*/ void Cache::Shutdown()
 {
-    // Nothing to do
+    PROFILE_FUNCTION;
+
+    // Wait for any background trimming to complete
+    {
+        MutexHolder mh( m_TrimMutex );
+        if ( m_TrimThread != INVALID_THREAD_HANDLE )
+        {
+            Thread::WaitForThread( m_TrimThread );
+            Thread::CloseHandle( m_TrimThread );
+            m_TrimThread = INVALID_THREAD_HANDLE;
+        }
+        m_CacheWrite = false;
+    }
+
+    m_Index.Flush();
+
+    if ( m_Verbose && m_Summary.IsValid() )
+    {
+        FLOG_OUTPUT( "Cache - Summary: %u lookups skipped\n", m_NumSummarySkips );
+    }
+
+    for ( const Compressor::Dictionary * dictionary : m_Dictionaries )
+    {
+        Compressor::ReleaseDictionary( dictionary );
+    }
+    m_Dictionaries.Clear();
 }
 
 // Publish
 //------------------------------------------------------------------------------
 /*virtual*/ bool Cache::Publish( const AString & cacheId, const void * data, size_t dataSize )
 {
-    AStackString<> fullPath;
-    GetFullPathForCacheEntry( cacheId, fullPath );
+    // Split data into chunks (unless it's small enough to store in the manifest)
+    const size_t numChunks = ( dataSize <= MAX_INLINE_SIZE ) ? 0 : ( ( dataSize + CHUNK_SIZE - 1 ) / CHUNK_SIZE );
+    ManifestHeader header;
+    header.m_Magic = kManifestMagic;
+    header.m_Version = kManifestVersion;
+    header.m_DataSize = dataSize;
+    header.m_NumChunks = (uint32_t)numChunks;
+    header.m_Padding = 0;
+    MemoryStream manifest( sizeof( ManifestHeader ) + ( numChunks * sizeof( ManifestChunk ) ) + ( ( numChunks == 0 ) ? dataSize : 0 ) );
+    manifest.WriteBuffer( &header, sizeof( header ) );
 
-    // make sure the cache output path exists
-    if ( !FileIO::EnsurePathExistsForFile( fullPath ) )
+    // Store chunks which don't already exist
+    Array< char > refs( numChunks * 32, true );
+    AStackString<> chunkId;
+    AStackString<> fullPath;
+    for ( size_t i = 0; i < numChunks; ++i )
     {
-        return false;
-    }
+        const char * chunkData = ( (const char *)data + ( i * CHUNK_SIZE ) );
+        ManifestChunk chunk;
+        chunk.m_Size = (uint32_t)Math::Min< size_t >( CHUNK_SIZE, dataSize - ( i * CHUNK_SIZE ) );
+        chunk.m_Hash = xxHash::Calc64( chunkData, chunk.m_Size );
+        chunk.m_Hash32 = xxHash::Calc32( chunkData, chunk.m_Size );
+        manifest.WriteBuffer( &chunk, sizeof( chunk ) );
 
-    // open output cache (tmp) file
-    AStackString<> fullPathTmp( fullPath );
-    fullPathTmp += ".tmp";
-    FileStream cacheTmpFile;
-    if ( !cacheTmpFile.Open( fullPathTmp.Get(), FileStream::WRITE_ONLY ) )
+        GetChunkId( chunk, chunkId );
+        GetFullPathForChunk( chunkId, fullPath );
+
+        // Refreshing the time of an existing chunk prevents it from being deleted
+        // by a trim before our reference to it has been added to the index
+        if ( FileIO::SetFileLastWriteTimeToNow( fullPath ) == false )
+        {
+            if ( WriteCacheFile( fullPath, chunkData, chunk.m_Size ) == false )
+            {
+                return false;
+            }
+        }
+        m_Index.Record( chunkId, chunk.m_Size, CacheIndex::FLAG_CHUNK );
+
+        refs.Append( chunkId.Get(), chunkId.GetEnd() );
+        refs.Append( '\0' );
+    }
+    if ( numChunks == 0 )
     {
-        return false;
+        manifest.WriteBuffer( data, dataSize );
     }
 
-    // write data
-    const bool cacheTmpWriteOk = ( cacheTmpFile.Write( data, dataSize ) == dataSize );
-    cacheTmpFile.Close();
-
-    if ( !cacheTmpWriteOk )
+    // Store manifest
+    AStackString<> manifestId;
+    GetManifestId( cacheId, manifestId );
+    GetFullPathForCacheEntry( manifestId, fullPath );
+    if ( WriteCacheFile( fullPath, manifest.GetData(), manifest.GetSize() ) == false )
     {
-        // failed to write to cache tmp file
-        FileIO::FileDelete( fullPathTmp.Get() ); // try to cleanup failure
         return false;
     }
 
-    // rename tmp file to real file
-    if ( FileIO::FileMove( fullPathTmp, fullPath ) == false )
-    {
-        // try to delete (possibly) existing file
-        FileIO::FileDelete( fullPath.Get() );
+    m_Index.Record( manifestId, manifest.GetSize(), 0, &refs );
+    StartBackgroundTrim();
 
-        // try rename again
-        if ( FileIO::FileMove( fullPathTmp, fullPath ) == false )
+    // Later lookups during this build should find the entry
+    if ( m_UseSummary )
+    {
+        MutexHolder mh( m_SummaryMutex );
+        if ( m_Summary.IsValid() )
         {
-            // problem renaming file
-            FileIO::FileDelete( fullPathTmp.Get() ); // try to cleanup tmp file
-            return false;
+            m_Summary.Add( cacheId.Get(), cacheId.GetLength() );
         }
     }
-
     return true;
 }
 
@@ -150,7 +221,52 @@ public:
     data = nullptr;
     dataSize = 0;
 
+    if ( IsAbsentFromSummary( cacheId ) )
+    {
+        return false;
+    }
+
+    AStackString<> manifestId;
+    GetManifestId( cacheId, manifestId );
     AStackString<> fullPath;
+    GetFullPathForCacheEntry( manifestId, fullPath );
+
+    Array< char > manifest( 0, true );
+    if ( ReadManifest( fullPath, manifest ) )
+    {
+        const ManifestHeader * header = reinterpret_cast< const ManifestHeader * >( manifest.Begin() );
+        UniquePtr< char > mem( (char *)ALLOC( Math::Max< size_t >( (size_t)header->m_DataSize, 1 ) ) );
+        Array< char > refs( header->m_NumChunks * 32, true );
+        if ( header->m_NumChunks == 0 )
+        {
+            memcpy( mem.Get(), header + 1, (size_t)header->m_DataSize );
+        }
+        else
+        {
+            // Gather the chunks (which may have been deleted, if the entry was
+            // only partially trimmed)
+            const ManifestChunk * chunks = reinterpret_cast< const ManifestChunk * >( header + 1 );
+            char * dst = mem.Get();
+            AStackString<> chunkId;
+            for ( uint32_t i = 0; i < header->m_NumChunks; ++i )
+            {
+                if ( ReadChunk( chunks[ i ], dst, chunkId ) == false )
+                {
+                    return false;
+                }
+                dst += chunks[ i ].m_Size;
+                refs.Append( chunkId.Get(), chunkId.GetEnd() );
+                refs.Append( '\0' );
+            }
+        }
+        dataSize = (size_t)header->m_DataSize;
+        data = mem.Release();
+        m_Index.Record( manifestId, manifest.GetSize(), 0, &refs ); // Track use for trimming
+        StartBackgroundTrim();
+        return true;
+    }
+
+    // Entries published by older versions hold the data directly
     GetFullPathForCacheEntry( cacheId, fullPath );
 
     FileStream cacheFile;
@@ -162,6 +278,8 @@ public:
         {
             dataSize = cacheFileSize;
             data = mem.Release();
+            m_Index.Record( cacheId, dataSize ); // Track use for trimming
+            StartBackgroundTrim();
             return true;
         }
     }
@@ -169,6 +287,39 @@ public:
     return false;
 }
 
+// QueryBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void Cache::QueryBatch( Array< BatchEntry > & entries )
+{
+    AStackString<> manifestId;
+    AStackString<> fullPath;
+    for ( BatchEntry & entry : entries )
+    {
+        if ( IsAbsentFromSummary( entry.m_CacheId ) )
+        {
+            entry.m_Found = false;
+            entry.m_DataSize = 0;
+            continue;
+        }
+
+        GetManifestId( entry.m_CacheId, manifestId );
+        GetFullPathForCacheEntry( manifestId, fullPath );
+        ManifestHeader header;
+        if ( ReadManifestHeader( fullPath, header ) )
+        {
+            entry.m_Found = true;
+            entry.m_DataSize = (size_t)header.m_DataSize;
+            continue;
+        }
+
+        // Entries published by older versions hold the data directly
+        GetFullPathForCacheEntry( entry.m_CacheId, fullPath );
+        FileIO::FileInfo info;
+        entry.m_Found = FileIO::GetFileInfo( fullPath, info );
+        entry.m_DataSize = entry.m_Found ? (size_t)info.m_Size : 0;
+    }
+}
+
 // FreeMemory
 //------------------------------------------------------------------------------
 /*virtual*/ void Cache::FreeMemory( void * data, size_t /*dataSize*/ )
@@ -184,17 +335,22 @@ public:
     const uint32_t NUM_DAYS( 30 );
     CacheStats perDay[ NUM_DAYS ];
 
-    // Get all the files
-    Array< FileIO::FileInfo > allFiles( 1000000 );
-    uint64_t totalSize = 0;
-    GetCacheFiles( showProgress, allFiles, totalSize );
+    // Get all the entries
+    CacheIndex::Entries entries;
+    GetEntries( showProgress, false, entries );
 
-    // Assign files into buckets
+    // Assign entries into buckets
     const uint64_t currentTime = Time::GetCurrentFileTime(); // Compare filetimes to now
-    for ( const FileIO::FileInfo & info : allFiles )
+    for ( size_t i = 0; i < entries.GetSize(); ++i )
     {
+        const CacheIndex::Entries::Entry & entry = entries[ i ];
+        if ( entry.m_LastAccess == 0 )
+        {
+            continue; // Removed
+        }
+
         // Determine age bucket
-        const uint64_t age = currentTime - info.m_LastWriteTime;
+        const uint64_t age = ( currentTime > entry.m_LastAccess ) ? ( currentTime - entry.m_LastAccess ) : 0;
         #if defined( __WINDOWS__ )
             const uint64_t oneDay = ( 24 * 60 * 60 * (uint64_t)10000000 );
         #else
@@ -206,13 +362,13 @@ public:
             ageInDays = 29;
         }
         perDay[ ageInDays ].m_NumFiles++;
-        perDay[ ageInDays ].m_NumBytes += info.m_Size;
+        perDay[ ageInDays ].m_NumBytes += entry.m_Size;
     }
 
     // Totals
     CacheStats total;
-    total.m_NumBytes = totalSize;
-    total.m_NumFiles = (uint32_t)allFiles.GetSize();
+    total.m_NumBytes = entries.GetTotalSize();
+    total.m_NumFiles = entries.GetNumValid();
 
     // Generate cache info string
     OUTPUT( "================================================================================\n" );
@@ -244,69 +400,342 @@ public:
 //------------------------------------------------------------------------------
 /*virtual*/ bool Cache::Trim( bool showProgress, uint32_t sizeMiB )
 {
-    // Get all the files
-    Array< FileIO::FileInfo > allFiles( 1000000 );
-    uint64_t totalSize = 0;
-    GetCacheFiles( showProgress, allFiles, totalSize );
-    OUTPUT( " - Before: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize(), (uint32_t)( totalSize / MEGABYTE ) );
-
-    // Sort by age
-    OldestFileTimeSorter sorter;
-    allFiles.Sort( sorter );
+    // Get all the entries
+    CacheIndex::Entries entries;
+    const bool indexWasComplete = GetEntries( showProgress, true, entries );
+    OUTPUT( " - Before: %u Files @ %u MiB\n", entries.GetNumValid(), (uint32_t)( entries.GetTotalSize() / MEGABYTE ) );
 
     // Do we need to delete anything?
     OUTPUT( "Trimming to %u MiB:\n", sizeMiB );
     const uint64_t limit = ( (uint64_t)sizeMiB * MEGABYTE );
-    uint32_t numDeleted = 0;
-    if ( limit < totalSize )
+    DeleteOldestEntries( showProgress, entries, limit );
+    SaveEntries( entries, indexWasComplete );
+
+    OUTPUT( " - After: %u Files @ %u MiB\n", entries.GetNumValid(), (uint32_t)( entries.GetTotalSize() / MEGABYTE ) );
+    return true;
+}
+
+// GetCompressionDictionary
+//------------------------------------------------------------------------------
+/*virtual*/ const Compressor::Dictionary * Cache::GetCompressionDictionary() const
+{
+    return m_Dictionaries.IsEmpty() ? nullptr : m_Dictionaries.Top();
+}
+
+// TrainDictionary
+//------------------------------------------------------------------------------
+/*virtual*/ bool Cache::TrainDictionary( bool showProgress )
+{
+    PROFILE_FUNCTION;
+
+    // Get all the entries
+    CacheIndex::Entries entries;
+    GetEntries( showProgress, false, entries );
+
+    // Sample entries from across the whole cache
+    Array< size_t > candidates( entries.GetSize(), false );
+    for ( size_t i = 0; i < entries.GetSize(); ++i )
+    {
+        const CacheIndex::Entries::Entry & entry = entries[ i ];
+        if ( ( entry.m_LastAccess != 0 ) && ( ( entry.m_Flags & CacheIndex::FLAG_CHUNK ) == 0 ) )
+        {
+            candidates.Append( i );
+        }
+    }
+    const size_t stride = Math::Max< size_t >( candidates.GetSize() / MAX_DICTIONARY_TRAINING_ENTRIES, 1 );
+    MemoryStream samples( MAX_DICTIONARY_TRAINING_SIZE );
+    Array< size_t > sampleEnds( MAX_DICTIONARY_TRAINING_ENTRIES, true );
+    AStackString<> cacheId;
+    for ( size_t i = 0; ( i < candidates.GetSize() ) && ( samples.GetSize() < MAX_DICTIONARY_TRAINING_SIZE ); i += stride )
     {
-        const Timer timer;
-        float lastProgressTime = 0.0f;
-        if ( showProgress )
+        const CacheIndex::Entries::Entry & entry = entries[ candidates[ i ] ];
+        cacheId.Assign( entries.GetId( entry ), entries.GetId( entry ) + entry.m_IdLength );
+        if ( cacheId.EndsWith( CACHE_MANIFEST_EXTENSION ) )
         {
-            FLog::OutputProgress( 0.0f, 0.0f, 0, 0, 0, 0 );
+            cacheId.SetLength( cacheId.GetLength() - (uint32_t)( sizeof( CACHE_MANIFEST_EXTENSION ) - 1 ) );
         }
-        const uint64_t originalTotalSize = totalSize;
 
-        // Iterate over files, deleting oldest first
-        for ( const FileIO::FileInfo & info : allFiles )
+        // Sample the start of each entry's uncompressed data
+        void * data;
+        size_t dataSize;
+        if ( Retrieve( cacheId, data, dataSize ) == false )
         {
-            // Try to delete (ok to fail if file is in use)
-            if ( FileIO::FileDelete( info.m_Name.Get() ) )
-            {
-                totalSize -= info.m_Size;
-                ++numDeleted;
+            continue;
+        }
+        Compressor c;
+        const bool decompressed = c.IsValidData( data, dataSize ) && c.Decompress( data );
+        FreeMemory( data, dataSize );
+        if ( decompressed == false )
+        {
+            continue; // Not a compressed entry, or compressed with an unavailable dictionary
+        }
+        samples.WriteBuffer( c.GetResult(), Math::Min< size_t >( c.GetResultSize(), MAX_DICTIONARY_SAMPLE_SIZE ) );
+        sampleEnds.Append( (size_t)samples.GetSize() );
+    }
+    if ( sampleEnds.IsEmpty() )
+    {
+        OUTPUT( "- No entries to train from\n" );
+        return false;
+    }
 
-                // Are we under the limit now?
-                if ( totalSize <= limit )
-                {
-                    break;
-                }
+    // Train
+    Array< char > dictionaryData;
+    Compressor::TrainDictionary( samples.GetData(), (size_t)samples.GetSize(), dictionaryData );
+    const Compressor::Dictionary * dictionary = Compressor::RegisterDictionary( dictionaryData.Begin(), dictionaryData.GetSize() );
+    if ( dictionary == nullptr )
+    {
+        OUTPUT( "- Failed to train dictionary\n" );
+        return false;
+    }
+    m_Dictionaries.Append( dictionary );
 
-                // Progress
-                if ( showProgress )
-                {
-                    // Throttled to avoid perf impact
-                    if ( ( timer.GetElapsed() - lastProgressTime ) > 0.5f )
-                    {
-                        const uint64_t toDeleteBytes = originalTotalSize - limit;
-                        const uint64_t deletedBytes = originalTotalSize - totalSize;
-                        const float perc = ( (float)deletedBytes / (float)toDeleteBytes ) * 100.0f;
-                        FLog::OutputProgress( timer.GetElapsed(), perc, 0, 0, 0, 0 );
-                        lastProgressTime = timer.GetElapsed();
-                    }
-                }
-            }
+    // Store dictionary, named so the most recent is found last
+    AStackString<> fullPath;
+    fullPath.Format( "%s" CACHE_DICTIONARIES_DIR "%c%016" PRIX64 "-%08X" CACHE_DICTIONARY_EXTENSION,
+                     m_CachePath.Get(), NATIVE_SLASH, Time::GetCurrentFileTime(), dictionary->GetId() );
+    if ( WriteCacheFile( fullPath, dictionaryData.Begin(), dictionaryData.GetSize() ) == false )
+    {
+        OUTPUT( "- Failed to store dictionary '%s'\n", fullPath.Get() );
+        return false;
+    }
+
+    // Remove the oldest dictionaries (entries compressed with them become unavailable)
+    Array< AString > files;
+    GetDictionaryFiles( files );
+    for ( size_t i = 0; ( i + MAX_DICTIONARIES ) < files.GetSize(); ++i )
+    {
+        FileIO::FileDelete( files[ i ].Get() );
+    }
+
+    // Measure the benefit on the samples
+    uint64_t sizeWithout = 0;
+    uint64_t sizeWith = 0;
+    size_t sampleBegin = 0;
+    for ( const size_t sampleEnd : sampleEnds )
+    {
+        const char * sample = ( (const char *)samples.GetData() + sampleBegin );
+        const size_t sampleSize = ( sampleEnd - sampleBegin );
+        Compressor without;
+        without.Compress( sample, sampleSize );
+        sizeWithout += without.GetResultSize();
+        Compressor with;
+        with.Compress( sample, sampleSize, -1, dictionary );
+        sizeWith += with.GetResultSize();
+        sampleBegin = sampleEnd;
+    }
+
+    OUTPUT( " - Samples: %u entries (%u KiB)\n", (uint32_t)sampleEnds.GetSize(), (uint32_t)( samples.GetSize() / KILOBYTE ) );
+    OUTPUT( " - Dictionary: %08X (%u KiB) '%s'\n", dictionary->GetId(), dictionary->GetDataSize() / KILOBYTE, fullPath.Get() );
+    OUTPUT( " - Compression ratio of samples: %.2f without dictionary, %.2f with dictionary\n",
+            (double)samples.GetSize() / (double)sizeWithout,
+            (double)samples.GetSize() / (double)sizeWith );
+    return true;
+}
+
+// GetTotalSize
+//------------------------------------------------------------------------------
+uint64_t Cache::GetTotalSize()
+{
+    CacheIndex::Entries entries;
+    GetEntries( false, false, entries );
+    return entries.GetTotalSize();
+}
+
+// TrimToSize
+//------------------------------------------------------------------------------
+uint64_t Cache::TrimToSize( uint64_t limit, uint32_t & outNumDeleted )
+{
+    CacheIndex::Entries entries;
+    const bool indexWasComplete = GetEntries( false, true, entries );
+    outNumDeleted = DeleteOldestEntries( false, entries, limit );
+    SaveEntries( entries, indexWasComplete );
+    return entries.GetTotalSize();
+}
+
+// Touch
+//------------------------------------------------------------------------------
+void Cache::Touch( const AString & cacheId ) const
+{
+    // Trimming deletes the oldest files first, so refreshing the time of
+    // an entry when it is used keeps the most recently used entries
+    AStackString<> manifestId;
+    GetManifestId( cacheId, manifestId );
+    AStackString<> fullPath;
+    GetFullPathForCacheEntry( manifestId, fullPath );
+    if ( FileIO::SetFileLastWriteTimeToNow( fullPath ) == false )
+    {
+        GetFullPathForCacheEntry( cacheId, fullPath ); // Published by an older version
+        FileIO::SetFileLastWriteTimeToNow( fullPath );
+    }
+}
+
+// StartBackgroundTrim
+//------------------------------------------------------------------------------
+void Cache::StartBackgroundTrim()
+{
+    // Started on use rather than in Init, so caches which are never written to
+    // don't trim and long-lived caches (used by workers) continue to be trimmed
+    MutexHolder mh( m_TrimMutex );
+    if ( ( m_CacheWrite == false ) ||
+         ( m_TrimStarted && ( m_TrimTimer.GetElapsed() < (float)BACKGROUND_TRIM_INTERVAL_SECONDS ) ) ||
+         AtomicLoadAcquire( &m_TrimThreadActive ) )
+    {
+        return;
+    }
+    m_TrimStarted = true;
+    m_TrimTimer.Start();
+
+    // Only trim if there is a size limit to enforce or an index to compact
+    if ( ( m_SizeLimit == 0 ) && ( m_Index.GetNumFiles() <= MAX_INDEX_FILES ) )
+    {
+        return;
+    }
+
+    // Tidy up after previous trim
+    if ( m_TrimThread != INVALID_THREAD_HANDLE )
+    {
+        Thread::WaitForThread( m_TrimThread );
+        Thread::CloseHandle( m_TrimThread );
+    }
+
+    AtomicStoreRelease( &m_TrimThreadActive, true );
+    m_TrimThread = Thread::CreateThread( TrimThreadFuncStatic, "CacheTrim", ( 64 * KILOBYTE ), this );
+    ASSERT( m_TrimThread != INVALID_THREAD_HANDLE );
+}
+
+// TrimThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Cache::TrimThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "CacheTrim" );
+
+    Cache * cache = static_cast< Cache * >( param );
+    cache->TrimThreadFunc();
+    AtomicStoreRelease( &cache->m_TrimThreadActive, false );
+    return 0;
+}
+
+// TrimThreadFunc
+//------------------------------------------------------------------------------
+void Cache::TrimThreadFunc()
+{
+    PROFILE_FUNCTION;
+
+    // Enforce the size limit (only one client needs to do this periodically).
+    // Building the index requires a full scan of the cache, which is left to -cachetrim.
+    if ( ( m_SizeLimit > 0 ) &&
+         m_Index.IsComplete() &&
+         m_Index.TryBeginPeriodicTrim( BACKGROUND_TRIM_INTERVAL_SECONDS ) )
+    {
+        // Trim below the limit so we don't need to trim again right away
+        const uint64_t target = ( m_SizeLimit - ( m_SizeLimit / 10 ) );
+        uint32_t numDeleted = 0;
+        const uint64_t newSize = TrimToSize( target, numDeleted );
+        if ( m_Verbose )
+        {
+            FLOG_OUTPUT( "Cache - Trimmed to %u MiB (%u entries evicted)\n", (uint32_t)( newSize / MEGABYTE ), numDeleted );
         }
+        return;
+    }
 
-        if ( showProgress )
+    // Merge index files written by previous builds, so the index stays quick to load
+    // (and its summary is refreshed)
+    const bool indexIsComplete = m_Index.IsComplete();
+    AStackString<> summaryFileName;
+    GetSummaryFileName( summaryFileName );
+    if ( ( m_Index.GetNumFiles() > MAX_INDEX_FILES ) ||
+         ( indexIsComplete && ( FileIO::FileExists( summaryFileName.Get() ) == false ) ) )
+    {
+        CacheIndex::Entries entries;
+        m_Index.Load( entries, true );
+        if ( indexIsComplete )
+        {
+            SaveEntries( entries, true );
+        }
+        else
         {
-            FLog::ClearProgress();
+            m_Index.Save( entries );
         }
     }
+}
 
-    OUTPUT( " - After: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize() - numDeleted, (uint32_t)( totalSize / MEGABYTE ) );
-    return true;
+// GetEntries
+//------------------------------------------------------------------------------
+bool Cache::GetEntries( bool showProgress, bool claim, CacheIndex::Entries & outEntries )
+{
+    PROFILE_FUNCTION;
+
+    const bool indexIsComplete = m_Index.IsComplete();
+    m_Index.Load( outEntries, claim );
+    if ( indexIsComplete )
+    {
+        return true;
+    }
+
+    // The index doesn't cover every entry, so scan the cache (the index may
+    // still have more recent access times for some entries)
+    Array< FileIO::FileInfo > allFiles( 1000000 );
+    uint64_t totalSize = 0;
+    GetCacheFiles( showProgress, allFiles, totalSize );
+    const size_t numEntryFiles = allFiles.GetSize();
+    AStackString<> chunksPath;
+    for ( uint32_t i = 0; i < 256; ++i )
+    {
+        chunksPath.Format( "%s" CACHE_CHUNKS_DIR "%c%02X%c", m_CachePath.Get(), NATIVE_SLASH, i, NATIVE_SLASH );
+        FileIO::GetFilesEx( chunksPath, nullptr, false, &allFiles );
+    }
+    Array< char > refs( 0, true );
+    Array< char > manifest( 0, true );
+    for ( size_t i = 0; i < allFiles.GetSize(); ++i )
+    {
+        const FileIO::FileInfo & info = allFiles[ i ];
+        const char * cacheId = info.m_Name.FindLast( NATIVE_SLASH );
+        cacheId = cacheId ? ( cacheId + 1 ) : info.m_Name.Get();
+        const uint32_t cacheIdLength = (uint32_t)( info.m_Name.GetEnd() - cacheId );
+        const uint64_t lastAccess = Math::Max( info.m_LastWriteTime, (uint64_t)1 );
+        if ( i >= numEntryFiles )
+        {
+            outEntries.Add( cacheId, cacheIdLength, info.m_Size, lastAccess, CacheIndex::FLAG_CHUNK );
+            continue;
+        }
+
+        // Find the chunks referenced by manifests
+        refs.Clear();
+        if ( info.m_Name.EndsWith( CACHE_MANIFEST_EXTENSION ) && ReadManifest( info.m_Name, manifest ) )
+        {
+            const ManifestHeader * header = reinterpret_cast< const ManifestHeader * >( manifest.Begin() );
+            const ManifestChunk * chunks = reinterpret_cast< const ManifestChunk * >( header + 1 );
+            AStackString<> chunkId;
+            for ( uint32_t j = 0; j < header->m_NumChunks; ++j )
+            {
+                GetChunkId( chunks[ j ], chunkId );
+                refs.Append( chunkId.Get(), chunkId.GetEnd() );
+                refs.Append( '\0' );
+            }
+        }
+        outEntries.Add( cacheId, cacheIdLength, info.m_Size, lastAccess, 0, refs.Begin(), (uint32_t)refs.GetSize() );
+    }
+    return false;
+}
+
+// SaveEntries
+//------------------------------------------------------------------------------
+void Cache::SaveEntries( CacheIndex::Entries & entries, bool indexWasComplete )
+{
+    AStackString<> indexFileName;
+    if ( m_Index.Save( entries, &indexFileName ) == false )
+    {
+        return;
+    }
+
+    if ( indexWasComplete == false )
+    {
+        // Entries were gathered by scanning the cache, so the index covers them all now
+        m_Index.SetComplete();
+    }
+
+    // The index covers every entry, so can be summarized
+    WriteSummary( entries, indexFileName );
 }
 
 // GetCacheFiles
@@ -365,20 +794,576 @@ void Cache::GetCacheFiles( bool showProgress,
     }
 }
 
-// GetFullPathForCacheEntry
+// DeleteOldestEntries
 //------------------------------------------------------------------------------
-void Cache::GetFullPathForCacheEntry( const AString & cacheId,
-                                      AString & outFullPath ) const
+uint32_t Cache::DeleteOldestEntries( bool showProgress,
+                                     CacheIndex::Entries & entries,
+                                     uint64_t limit ) const
 {
-    // format example: N:\\fbuild.cache\\AA\\BB\\<ABCD.......>
-    outFullPath.Format( "%s%c%c%c%c%c%c%s", m_CachePath.Get(),
-                                            cacheId[ 0 ],
-                                            cacheId[ 1 ],
-                                            NATIVE_SLASH,
-                                            cacheId[ 2 ],
-                                            cacheId[ 3 ],
-                                            NATIVE_SLASH,
-                                            cacheId.Get() );
+    PROFILE_FUNCTION;
+
+    // Count references to each chunk
+    Array< uint32_t > refCounts( entries.GetSize(), false );
+    refCounts.SetSize( entries.GetSize() );
+    memset( refCounts.Begin(), 0, entries.GetSize() * sizeof( uint32_t ) );
+    Array< size_t > chunkIndices( 16, true );
+    for ( size_t i = 0; i < entries.GetSize(); ++i )
+    {
+        if ( entries[ i ].m_LastAccess != 0 )
+        {
+            GetChunkIndices( entries, i, chunkIndices );
+            for ( const size_t chunkIndex : chunkIndices )
+            {
+                ++refCounts[ chunkIndex ];
+            }
+        }
+    }
+
+    // Delete chunks which are not referenced (by an interrupted publish for example)
+    for ( size_t i = 0; i < entries.GetSize(); ++i )
+    {
+        const CacheIndex::Entries::Entry & entry = entries[ i ];
+        if ( ( entry.m_LastAccess != 0 ) && ( entry.m_Flags & CacheIndex::FLAG_CHUNK ) && ( refCounts[ i ] == 0 ) )
+        {
+            ReleaseChunk( entries, i );
+        }
+    }
+
+    // Do we need to delete anything?
+    if ( entries.GetTotalSize() <= limit )
+    {
+        return 0;
+    }
+
+    // Assign entries to buckets by age, so the oldest can be found without sorting.
+    // Chunks are deleted along with the last entry referencing them.
+    const uint32_t NUM_BUCKETS( 4096 );
+    uint64_t oldest = (uint64_t)-1;
+    uint64_t newest = 0;
+    for ( size_t i = 0; i < entries.GetSize(); ++i )
+    {
+        const CacheIndex::Entries::Entry & entry = entries[ i ];
+        if ( ( entry.m_LastAccess != 0 ) && ( ( entry.m_Flags & CacheIndex::FLAG_CHUNK ) == 0 ) )
+        {
+            oldest = Math::Min( oldest, entry.m_LastAccess );
+            newest = Math::Max( newest, entry.m_LastAccess );
+        }
+    }
+    if ( oldest > newest )
+    {
+        return 0; // Only chunks remain, which are still in use
+    }
+    const uint64_t bucketRange = ( ( newest - oldest ) / NUM_BUCKETS ) + 1;
+
+    // Find the newest bucket we'll need to delete from, attributing the size of
+    // each chunk to the entries sharing it
+    Array< uint64_t > bucketSizes( NUM_BUCKETS, false );
+    bucketSizes.SetSize( NUM_BUCKETS );
+    memset( bucketSizes.Begin(), 0, NUM_BUCKETS * sizeof( uint64_t ) );
+    for ( size_t i = 0; i < entries.GetSize(); ++i )
+    {
+        const CacheIndex::Entries::Entry & entry = entries[ i ];
+        if ( ( entry.m_LastAccess != 0 ) && ( ( entry.m_Flags & CacheIndex::FLAG_CHUNK ) == 0 ) )
+        {
+            uint64_t size = entry.m_Size;
+            GetChunkIndices( entries, i, chunkIndices );
+            for ( const size_t chunkIndex : chunkIndices )
+            {
+                size += ( entries[ chunkIndex ].m_Size / refCounts[ chunkIndex ] );
+            }
+            bucketSizes[ (size_t)( ( entry.m_LastAccess - oldest ) / bucketRange ) ] += size;
+        }
+    }
+    const uint64_t toDeleteBytes = ( entries.GetTotalSize() - limit );
+    uint32_t lastBucket = 0;
+    for ( uint64_t bytes = 0; lastBucket < ( NUM_BUCKETS - 1 ); ++lastBucket )
+    {
+        bytes += bucketSizes[ lastBucket ];
+        if ( bytes >= toDeleteBytes )
+        {
+            break;
+        }
+    }
+
+    const Timer timer;
+    float lastProgressTime = 0.0f;
+    if ( showProgress )
+    {
+        FLog::OutputProgress( 0.0f, 0.0f, 0, 0, 0, 0 );
+    }
+
+    // Delete everything in the older buckets first, then from each newer bucket
+    // until we're under the limit (more than one if some entries are in use)
+    uint32_t numDeleted = 0;
+    AStackString<> fullPath;
+    for ( uint32_t pass = 0; pass < NUM_BUCKETS; ++pass )
+    {
+        const uint32_t firstBucket = ( pass == 0 ) ? 0 : ( lastBucket + pass );
+        const uint32_t endBucket = ( pass == 0 ) ? ( lastBucket + 1 ) : ( firstBucket + 1 );
+        if ( ( firstBucket >= NUM_BUCKETS ) || ( entries.GetTotalSize() <= limit ) )
+        {
+            break;
+        }
+
+        for ( size_t i = 0; i < entries.GetSize(); ++i )
+        {
+            const CacheIndex::Entries::Entry & entry = entries[ i ];
+            if ( ( entry.m_LastAccess == 0 ) || ( entry.m_Flags & CacheIndex::FLAG_CHUNK ) )
+            {
+                continue; // Already removed, or a chunk
+            }
+            const uint32_t bucket = (uint32_t)( ( entry.m_LastAccess - oldest ) / bucketRange );
+            if ( ( bucket < firstBucket ) || ( bucket >= endBucket ) )
+            {
+                continue;
+            }
+
+            // Try to delete (ok to fail if file is in use)
+            GetFullPathForCacheEntry( AStackString<>( entries.GetId( entry ) ), fullPath );
+            if ( FileIO::FileDelete( fullPath.Get() ) )
+            {
+                ReleaseChunks( entries, i, refCounts, chunkIndices );
+                entries.Remove( i );
+                ++numDeleted;
+            }
+            else if ( FileIO::FileExists( fullPath.Get() ) == false )
+            {
+                // Already deleted (by an older version for example)
+                ReleaseChunks( entries, i, refCounts, chunkIndices );
+                entries.Remove( i );
+            }
+
+            // Are we under the limit now?
+            if ( entries.GetTotalSize() <= limit )
+            {
+                break;
+            }
+
+            // Progress
+            if ( showProgress )
+            {
+                // Throttled to avoid perf impact
+                if ( ( timer.GetElapsed() - lastProgressTime ) > 0.5f )
+                {
+                    const uint64_t deletedBytes = ( entries.GetTotalSize() > limit ) ? ( toDeleteBytes - ( entries.GetTotalSize() - limit ) ) : toDeleteBytes;
+                    const float perc = ( (float)deletedBytes / (float)toDeleteBytes ) * 100.0f;
+                    FLog::OutputProgress( timer.GetElapsed(), perc, 0, 0, 0, 0 );
+                    lastProgressTime = timer.GetElapsed();
+                }
+            }
+        }
+    }
+
+    if ( showProgress )
+    {
+        FLog::ClearProgress();
+    }
+
+    return numDeleted;
+}
+
+// GetChunkIndices
+//------------------------------------------------------------------------------
+/*static*/ void Cache::GetChunkIndices( CacheIndex::Entries & entries, size_t index, Array< size_t > & outChunkIndices )
+{
+    outChunkIndices.Clear();
+
+    const CacheIndex::Entries::Entry & entry = entries[ index ];
+    const char * ref = entries.GetRefs( entry );
+    for ( uint32_t i = 0; i < entry.m_NumRefs; ++i )
+    {
+        const uint32_t refLength = (uint32_t)strlen( ref );
+        size_t chunkIndex;
+        if ( entries.Find( ref, refLength, chunkIndex ) )
+        {
+            outChunkIndices.Append( chunkIndex );
+        }
+        ref += ( refLength + 1 );
+    }
+}
+
+// ReleaseChunks
+//------------------------------------------------------------------------------
+void Cache::ReleaseChunks( CacheIndex::Entries & entries,
+                           size_t index,
+                           Array< uint32_t > & refCounts,
+                           Array< size_t > & chunkIndices ) const
+{
+    GetChunkIndices( entries, index, chunkIndices );
+    for ( const size_t chunkIndex : chunkIndices )
+    {
+        ASSERT( refCounts[ chunkIndex ] > 0 );
+        if ( --refCounts[ chunkIndex ] == 0 )
+        {
+            ReleaseChunk( entries, chunkIndex );
+        }
+    }
+}
+
+// ReleaseChunk
+//------------------------------------------------------------------------------
+void Cache::ReleaseChunk( CacheIndex::Entries & entries, size_t index ) const
+{
+    AStackString<> fullPath;
+    GetFullPathForChunk( AStackString<>( entries.GetId( entries[ index ] ) ), fullPath );
+
+    FileIO::FileInfo info;
+    if ( FileIO::GetFileInfo( fullPath, info ) )
+    {
+        // Recently stored chunks may be referenced by entries which are not in
+        // the index yet (still being published by another client)
+        #if defined( __WINDOWS__ )
+            const uint64_t gracePeriod = ( CHUNK_GRACE_PERIOD_SECONDS * (uint64_t)10000000 );
+        #else
+            const uint64_t gracePeriod = ( CHUNK_GRACE_PERIOD_SECONDS * (uint64_t)1000000000 );
+        #endif
+        if ( Time::GetCurrentFileTime() < ( info.m_LastWriteTime + gracePeriod ) )
+        {
+            return;
+        }
+        if ( FileIO::FileDelete( fullPath.Get() ) == false )
+        {
+            return; // In use
+        }
+    }
+    entries.Remove( index );
+}
+
+// GetFullPathForCacheEntry
+//------------------------------------------------------------------------------
+void Cache::GetFullPathForCacheEntry( const AString & cacheId,
+                                      AString & outFullPath ) const
+{
+    // format example: N:\\fbuild.cache\\AA\\BB\\<ABCD.......>
+    outFullPath.Format( "%s%c%c%c%c%c%c%s", m_CachePath.Get(),
+                                            cacheId[ 0 ],
+                                            cacheId[ 1 ],
+                                            NATIVE_SLASH,
+                                            cacheId[ 2 ],
+                                            cacheId[ 3 ],
+                                            NATIVE_SLASH,
+                                            cacheId.Get() );
+}
+
+// GetFullPathForChunk
+//------------------------------------------------------------------------------
+void Cache::GetFullPathForChunk( const AString & chunkId,
+                                 AString & outFullPath ) const
+{
+    // format example: N:\\fbuild.cache\\chunks\\AB\\<AB..........>
+    outFullPath.Format( "%s" CACHE_CHUNKS_DIR "%c%c%c%c%s", m_CachePath.Get(),
+                                                           NATIVE_SLASH,
+                                                           chunkId[ 0 ],
+                                                           chunkId[ 1 ],
+                                                           NATIVE_SLASH,
+                                                           chunkId.Get() );
+}
+
+// GetManifestId
+//------------------------------------------------------------------------------
+/*static*/ void Cache::GetManifestId( const AString & cacheId, AString & outManifestId )
+{
+    outManifestId = cacheId;
+    outManifestId += CACHE_MANIFEST_EXTENSION;
+}
+
+// GetChunkId
+//------------------------------------------------------------------------------
+/*static*/ void Cache::GetChunkId( const ManifestChunk & chunk, AString & outChunkId )
+{
+    outChunkId.Format( "%016" PRIX64 "%08X", chunk.m_Hash, chunk.m_Hash32 );
+}
+
+// ReadManifest
+//------------------------------------------------------------------------------
+/*static*/ bool Cache::ReadManifest( const AString & fullPath, Array< char > & outManifest )
+{
+    FileStream f;
+    if ( f.Open( fullPath.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+    const size_t fileSize = (size_t)f.GetFileSize();
+    if ( fileSize < sizeof( ManifestHeader ) )
+    {
+        return false;
+    }
+    outManifest.SetSize( fileSize );
+    if ( f.Read( outManifest.Begin(), fileSize ) != fileSize )
+    {
+        return false;
+    }
+
+    // Check the manifest is complete
+    const ManifestHeader * header = reinterpret_cast< const ManifestHeader * >( outManifest.Begin() );
+    if ( ( header->m_Magic != kManifestMagic ) || ( header->m_Version != kManifestVersion ) )
+    {
+        return false;
+    }
+    if ( header->m_NumChunks == 0 )
+    {
+        return ( fileSize == ( sizeof( ManifestHeader ) + header->m_DataSize ) );
+    }
+    if ( fileSize != ( sizeof( ManifestHeader ) + ( header->m_NumChunks * sizeof( ManifestChunk ) ) ) )
+    {
+        return false;
+    }
+    const ManifestChunk * chunks = reinterpret_cast< const ManifestChunk * >( header + 1 );
+    uint64_t dataSize = 0;
+    for ( uint32_t i = 0; i < header->m_NumChunks; ++i )
+    {
+        dataSize += chunks[ i ].m_Size;
+    }
+    return ( dataSize == header->m_DataSize );
+}
+
+// ReadManifestHeader
+//------------------------------------------------------------------------------
+/*static*/ bool Cache::ReadManifestHeader( const AString & fullPath, ManifestHeader & outHeader )
+{
+    FileStream f;
+    return ( f.Open( fullPath.Get(), FileStream::READ_ONLY ) &&
+             ( f.Read( &outHeader, sizeof( outHeader ) ) == sizeof( outHeader ) ) &&
+             ( outHeader.m_Magic == kManifestMagic ) &&
+             ( outHeader.m_Version == kManifestVersion ) );
+}
+
+// ReadChunk
+//------------------------------------------------------------------------------
+bool Cache::ReadChunk( const ManifestChunk & chunk, char * outData, AString & outChunkId ) const
+{
+    GetChunkId( chunk, outChunkId );
+    AStackString<> fullPath;
+    GetFullPathForChunk( outChunkId, fullPath );
+
+    FileStream f;
+    if ( f.Open( fullPath.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+    if ( f.GetFileSize() == chunk.m_Size )
+    {
+        if ( f.Read( outData, chunk.m_Size ) != chunk.m_Size )
+        {
+            return false;
+        }
+        if ( xxHash::Calc64( outData, chunk.m_Size ) == chunk.m_Hash )
+        {
+            return true;
+        }
+    }
+
+    // Damaged chunks are deleted so they will be stored again
+    f.Close();
+    FileIO::FileDelete( fullPath.Get() );
+    return false;
+}
+
+// LoadDictionaries
+//------------------------------------------------------------------------------
+void Cache::LoadDictionaries()
+{
+    PROFILE_FUNCTION;
+
+    // All dictionaries are registered so entries compressed with any of them can be
+    // decompressed, while the most recent is used to compress new entries
+    Array< AString > files;
+    GetDictionaryFiles( files );
+    Array< char > data( 0, true );
+    for ( const AString & file : files )
+    {
+        FileStream f;
+        if ( f.Open( file.Get(), FileStream::READ_ONLY ) == false )
+        {
+            continue;
+        }
+        const size_t fileSize = (size_t)f.GetFileSize();
+        if ( fileSize > Compressor::MAX_DICTIONARY_SIZE )
+        {
+            continue;
+        }
+        data.SetSize( fileSize );
+        if ( f.Read( data.Begin(), fileSize ) != fileSize )
+        {
+            continue;
+        }
+        const Compressor::Dictionary * dictionary = Compressor::RegisterDictionary( data.Begin(), fileSize );
+        if ( dictionary )
+        {
+            m_Dictionaries.Append( dictionary );
+        }
+    }
+}
+
+// GetDictionaryFiles
+//------------------------------------------------------------------------------
+void Cache::GetDictionaryFiles( Array< AString > & outFiles ) const
+{
+    AStackString<> path;
+    path.Format( "%s" CACHE_DICTIONARIES_DIR "%c", m_CachePath.Get(), NATIVE_SLASH );
+    FileIO::GetFiles( path, AStackString<>( "*" CACHE_DICTIONARY_EXTENSION ), false, &outFiles );
+    outFiles.Sort(); // Named by creation time
+}
+
+// LoadSummary
+//------------------------------------------------------------------------------
+void Cache::LoadSummary()
+{
+    PROFILE_FUNCTION;
+
+    // Read the summary, if one has been written
+    AStackString<> fileName;
+    GetSummaryFileName( fileName );
+    FileStream f;
+    if ( f.Open( fileName.Get(), FileStream::READ_ONLY ) )
+    {
+        const size_t fileSize = (size_t)f.GetFileSize();
+        UniquePtr< char > mem( (char *)ALLOC( Math::Max< size_t >( fileSize, 1 ) ) );
+        if ( ( f.Read( mem.Get(), fileSize ) == fileSize ) && m_Summary.Load( mem.Get(), fileSize ) )
+        {
+            // Add the entries recorded in the index since the summary was written.
+            // If the summarized index file has been replaced, the summary is out of date.
+            CacheIndex::Entries entries;
+            if ( m_Index.LoadExcluding( m_Summary.GetIndexFileName(), entries ) )
+            {
+                for ( size_t i = 0; i < entries.GetSize(); ++i )
+                {
+                    const CacheIndex::Entries::Entry & entry = entries[ i ];
+                    AddToSummary( m_Summary, entries.GetId( entry ), entry.m_IdLength, entry.m_Flags );
+                }
+                if ( m_Verbose )
+                {
+                    FLOG_OUTPUT( "Cache - Summary loaded (%u recent entries)\n", (uint32_t)entries.GetSize() );
+                }
+                return;
+            }
+        }
+    }
+
+    m_Summary.Clear();
+    if ( m_Verbose )
+    {
+        FLOG_OUTPUT( "Cache - Summary unavailable\n" );
+    }
+}
+
+// WriteSummary
+//------------------------------------------------------------------------------
+void Cache::WriteSummary( const CacheIndex::Entries & entries, const AString & indexFileName ) const
+{
+    PROFILE_FUNCTION;
+
+    CacheSummary summary;
+    summary.Init( entries.GetNumValid() );
+    summary.SetIndexFileName( indexFileName );
+    for ( size_t i = 0; i < entries.GetSize(); ++i )
+    {
+        const CacheIndex::Entries::Entry & entry = entries[ i ];
+        if ( entry.m_LastAccess != 0 )
+        {
+            AddToSummary( summary, entries.GetId( entry ), entry.m_IdLength, entry.m_Flags );
+        }
+    }
+
+    MemoryStream stream;
+    summary.Save( stream );
+    AStackString<> fileName;
+    GetSummaryFileName( fileName );
+    WriteCacheFile( fileName, stream.GetData(), (size_t)stream.GetSize() ); // Ok to fail (read-only cache for example)
+}
+
+// AddToSummary
+//------------------------------------------------------------------------------
+/*static*/ void Cache::AddToSummary( CacheSummary & summary, const char * id, uint32_t idLength, uint32_t flags )
+{
+    if ( flags & CacheIndex::FLAG_CHUNK )
+    {
+        return; // Chunks are not looked up directly
+    }
+
+    // Entries are looked up by cacheId, which names the manifest (or the data,
+    // for entries published by older versions)
+    const uint32_t extensionLength = (uint32_t)strlen( CACHE_MANIFEST_EXTENSION );
+    if ( ( idLength > extensionLength ) &&
+         ( memcmp( id + idLength - extensionLength, CACHE_MANIFEST_EXTENSION, extensionLength ) == 0 ) )
+    {
+        idLength -= extensionLength;
+    }
+    summary.Add( id, idLength );
+}
+
+// IsAbsentFromSummary
+//------------------------------------------------------------------------------
+bool Cache::IsAbsentFromSummary( const AString & cacheId )
+{
+    if ( m_UseSummary == false )
+    {
+        return false;
+    }
+
+    MutexHolder mh( m_SummaryMutex );
+    if ( ( m_Summary.IsValid() == false ) ||
+         m_Summary.MayContain( cacheId.Get(), cacheId.GetLength() ) )
+    {
+        return false;
+    }
+    ++m_NumSummarySkips;
+    return true;
+}
+
+// GetSummaryFileName
+//------------------------------------------------------------------------------
+void Cache::GetSummaryFileName( AString & outFileName ) const
+{
+    outFileName = m_Index.GetPath();
+    outFileName += CACHE_SUMMARY_FILE;
+}
+
+// WriteCacheFile
+//------------------------------------------------------------------------------
+/*static*/ bool Cache::WriteCacheFile( const AString & fullPath, const void * data, size_t dataSize )
+{
+    // make sure the cache output path exists
+    if ( !FileIO::EnsurePathExistsForFile( fullPath ) )
+    {
+        return false;
+    }
+
+    // open output cache (tmp) file
+    AStackString<> fullPathTmp( fullPath );
+    fullPathTmp += ".tmp";
+    FileStream cacheTmpFile;
+    if ( !cacheTmpFile.Open( fullPathTmp.Get(), FileStream::WRITE_ONLY ) )
+    {
+        return false;
+    }
+
+    // write data
+    const bool cacheTmpWriteOk = ( cacheTmpFile.Write( data, dataSize ) == dataSize );
+    cacheTmpFile.Close();
+
+    if ( !cacheTmpWriteOk )
+    {
+        // failed to write to cache tmp file
+        FileIO::FileDelete( fullPathTmp.Get() ); // try to cleanup failure
+        return false;
+    }
+
+    // rename tmp file to real file
+    if ( FileIO::FileMove( fullPathTmp, fullPath ) == false )
+    {
+        // try to delete (possibly) existing file
+        FileIO::FileDelete( fullPath.Get() );
+
+        // try rename again
+        if ( FileIO::FileMove( fullPathTmp, fullPath ) == false )
+        {
+            // problem renaming file
+            FileIO::FileDelete( fullPathTmp.Get() ); // try to cleanup tmp file
+            return false;
+        }
+    }
+    return true;
 }
 
 //------------------------------------------------------------------------------
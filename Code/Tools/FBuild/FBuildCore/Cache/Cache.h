@@ -5,10 +5,24 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "ICache.h"
+#include "CacheIndex.h"
+#include "CacheSummary.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Thread.h"
 #include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
 
 // Cache
+//  - Each entry is a manifest listing the chunks which hold its data (small
+//    data is held by the manifest itself).
+//  - Chunks are named by their content, so are shared by entries with the
+//    same data and are only written once. Chunks no longer referenced by any
+//    entry are deleted when trimming.
+//  - Compression dictionaries trained from the entries are stored in the cache
+//    and are available for as long as entries may reference them.
+//  - A summary of the entries is written with the index (once the index covers
+//    the whole cache), allowing lookups of absent entries to be skipped.
 //------------------------------------------------------------------------------
 class Cache : public ICache
 {
@@ -28,11 +42,94 @@ public:
     virtual void FreeMemory( void * data, size_t dataSize ) override;
     virtual bool OutputInfo( bool showProgress ) override;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual void QueryBatch( Array< BatchEntry > & entries ) override;
+    virtual const Compressor::Dictionary * GetCompressionDictionary() const override;
+    virtual bool TrainDictionary( bool showProgress ) override;
+
+    // Keep the cache under a size limit, trimming it in the background (0 = no limit)
+    void     SetSizeLimit( uint64_t sizeLimit ) { m_SizeLimit = sizeLimit; }
+
+    // Skip lookups of entries absent from the summary of the cache (must be set before Init)
+    void     SetUseSummary( bool useSummary ) { m_UseSummary = useSummary; }
+
+    // Used when managing a local cache (see TieredCache)
+    uint64_t GetTotalSize();
+    uint64_t TrimToSize( uint64_t limit, uint32_t & outNumDeleted );
+    void     Touch( const AString & cacheId ) const;
 private:
+    enum : uint32_t
+    {
+        BACKGROUND_TRIM_INTERVAL_SECONDS    = ( 10 * 60 ),          // Trim at most this often (by any client)
+        MAX_INDEX_FILES                     = 256,                  // Compact the index when it has more files
+        CHUNK_SIZE                          = ( 4 * 1024 * 1024 ),  // Data is split into chunks of this size
+        MAX_INLINE_SIZE                     = ( 4 * 1024 ),         // Smaller data is stored in the manifest
+        CHUNK_GRACE_PERIOD_SECONDS          = ( 24 * 60 * 60 ),     // Keep unreferenced chunks this long after use
+        MAX_DICTIONARIES                    = 8,                    // Keep this many of the most recent dictionaries
+        MAX_DICTIONARY_TRAINING_ENTRIES     = 1024,                 // Sample at most this many entries
+        MAX_DICTIONARY_TRAINING_SIZE        = ( 8 * 1024 * 1024 ),  // Total size of samples
+        MAX_DICTIONARY_SAMPLE_SIZE          = ( 32 * 1024 ),        // Size of sample from each entry
+    };
+
+    struct ManifestHeader
+    {
+        uint32_t    m_Magic;
+        uint32_t    m_Version;
+        uint64_t    m_DataSize;
+        uint32_t    m_NumChunks;        // 0 if data follows the header
+        uint32_t    m_Padding;
+    };
+    struct ManifestChunk
+    {
+        uint64_t    m_Hash;
+        uint32_t    m_Hash32;           // Extra hash bits, to make collisions implausible
+        uint32_t    m_Size;
+    };
+
+    void StartBackgroundTrim();
+    static uint32_t TrimThreadFuncStatic( void * param );
+    void TrimThreadFunc();
+    bool GetEntries( bool showProgress, bool claim, CacheIndex::Entries & outEntries );
+    void SaveEntries( CacheIndex::Entries & entries, bool indexWasComplete );
     void GetCacheFiles( bool showProgress, Array< FileIO::FileInfo > & outInfo, uint64_t & outTotalSize ) const;
+    uint32_t DeleteOldestEntries( bool showProgress, CacheIndex::Entries & entries, uint64_t limit ) const;
+    static void GetChunkIndices( CacheIndex::Entries & entries, size_t index, Array< size_t > & outChunkIndices );
+    void ReleaseChunks( CacheIndex::Entries & entries, size_t index, Array< uint32_t > & refCounts, Array< size_t > & chunkIndices ) const;
+    void ReleaseChunk( CacheIndex::Entries & entries, size_t index ) const;
     void GetFullPathForCacheEntry( const AString & cacheId, AString & outFullPath ) const;
+    void GetFullPathForChunk( const AString & chunkId, AString & outFullPath ) const;
+    static void GetManifestId( const AString & cacheId, AString & outManifestId );
+    static void GetChunkId( const ManifestChunk & chunk, AString & outChunkId );
+    static bool ReadManifest( const AString & fullPath, Array< char > & outManifest );
+    static bool ReadManifestHeader( const AString & fullPath, ManifestHeader & outHeader );
+    bool ReadChunk( const ManifestChunk & chunk, char * outData, AString & outChunkId ) const;
+    static bool WriteCacheFile( const AString & fullPath, const void * data, size_t dataSize );
+    void LoadDictionaries();
+    void GetDictionaryFiles( Array< AString > & outFiles ) const;
+    void LoadSummary();
+    void WriteSummary( const CacheIndex::Entries & entries, const AString & indexFileName ) const;
+    static void AddToSummary( CacheSummary & summary, const char * id, uint32_t idLength, uint32_t flags );
+    bool IsAbsentFromSummary( const AString & cacheId );
+    void GetSummaryFileName( AString & outFileName ) const;
+
+    AString                 m_CachePath;
+    CacheIndex              m_Index;
+    uint64_t                m_SizeLimit     = 0;
+    bool                    m_Verbose       = false;
+    bool                    m_CacheWrite    = false;
+    Array< const Compressor::Dictionary * > m_Dictionaries; // Oldest to most recent
+    bool                    m_UseSummary    = false;
+
+    // Protected by m_TrimMutex
+    Mutex                   m_TrimMutex;
+    Thread::ThreadHandle    m_TrimThread    = INVALID_THREAD_HANDLE;
+    volatile bool           m_TrimThreadActive = false;
+    bool                    m_TrimStarted   = false;    // Started at least once
+    Timer                   m_TrimTimer;                // Time since last started
 
-    AString m_CachePath;
+    // Protected by m_SummaryMutex
+    Mutex                   m_SummaryMutex;
+    CacheSummary            m_Summary;              // Valid if loaded
+    uint32_t                m_NumSummarySkips = 0;  // Lookups skipped due to the summary
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,665 @@
+// CacheIndex - Record of the entries in a Cache, to avoid scanning it
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheIndex.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Network/Network.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Process.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+
+// system
+#include <string.h>
+
+// Defines
+//------------------------------------------------------------------------------
+#define CACHE_INDEX_EXTENSION       ".idx"
+#define CACHE_INDEX_CLAIMED         ".claimed"
+#define CACHE_INDEX_COMPLETE        "Complete"
+#define CACHE_INDEX_LAST_TRIM       "LastTrim"
+
+namespace
+{
+    // File format: Header followed by records of:
+    //   uint64_t lastAccess, uint64_t size, uint32_t flags, uint16_t cacheIdLength, uint32_t refsSize,
+    //   char cacheId[ cacheIdLength ], char refs[ refsSize ] (null terminated chunk ids)
+    const uint32_t  kIndexFileMagic     = 'F' | ( 'B' << 8 ) | ( 'C' << 16 ) | ( 'I' << 24 );
+    const uint32_t  kIndexFileVersion   = 2;
+    const size_t    kRecordHeaderSize   = ( sizeof( uint64_t ) * 2 ) + ( sizeof( uint32_t ) * 2 ) + sizeof( uint16_t );
+
+    // Claims not released for this long were abandoned (process terminated during a trim)
+    const uint32_t  kClaimTimeoutSeconds = ( 60 * 60 );
+
+    uint64_t SecondsToFileTime( uint32_t seconds )
+    {
+        #if defined( __WINDOWS__ )
+            return ( (uint64_t)seconds * 10000000 );    // 100ns intervals
+        #else
+            return ( (uint64_t)seconds * 1000000000 );  // ns
+        #endif
+    }
+}
+
+// Entries::CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheIndex::Entries::Entries()
+    : m_Entries( 0, true )
+    , m_Ids( 0, true )
+    , m_Table( 0, true )
+    , m_NumValid( 0 )
+    , m_TotalSize( 0 )
+    , m_ClaimedFiles( 0, true )
+{
+}
+
+// Entries::DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheIndex::Entries::~Entries()
+{
+    ASSERT( m_ClaimedFiles.IsEmpty() ); // CacheIndex::Save should have been called
+}
+
+// Entries::Add
+//------------------------------------------------------------------------------
+void CacheIndex::Entries::Add( const char * cacheId,
+                               uint32_t cacheIdLength,
+                               uint64_t size,
+                               uint64_t lastAccess,
+                               uint32_t flags,
+                               const char * refs,
+                               uint32_t refsSize )
+{
+    ASSERT( lastAccess != 0 );
+    ASSERT( cacheIdLength <= 0xFFFF );
+    ASSERT( ( refsSize == 0 ) || ( refs[ refsSize - 1 ] == '\0' ) );
+
+    if ( ( ( m_Entries.GetSize() + 1 ) * 2 ) > m_Table.GetSize() )
+    {
+        GrowTable();
+    }
+
+    uint32_t * slot = FindSlot( cacheId, cacheIdLength );
+    if ( *slot == 0 )
+    {
+        // New entry
+        Entry & entry = m_Entries.EmplaceBack();
+        entry.m_LastAccess = lastAccess;
+        entry.m_Size = size;
+        entry.m_IdOffset = (uint32_t)m_Ids.GetSize();
+        entry.m_IdLength = (uint16_t)cacheIdLength;
+        m_Ids.Append( cacheId, cacheId + cacheIdLength );
+        m_Ids.Append( '\0' );
+        entry.m_Flags = flags;
+        SetRefs( entry, refs, refsSize );
+        *slot = (uint32_t)m_Entries.GetSize();
+        ++m_NumValid;
+        m_TotalSize += size;
+        return;
+    }
+
+    // Existing entry - keep the most recent information
+    Entry & entry = m_Entries[ *slot - 1 ];
+    if ( entry.m_LastAccess == 0 )
+    {
+        // Previously removed
+        ++m_NumValid;
+    }
+    else if ( lastAccess < entry.m_LastAccess )
+    {
+        return;
+    }
+    else
+    {
+        m_TotalSize -= entry.m_Size;
+    }
+    entry.m_LastAccess = lastAccess;
+    entry.m_Size = size;
+    entry.m_Flags = flags;
+    SetRefs( entry, refs, refsSize );
+    m_TotalSize += size;
+}
+
+// Entries::Remove
+//------------------------------------------------------------------------------
+void CacheIndex::Entries::Remove( size_t index )
+{
+    Entry & entry = m_Entries[ index ];
+    ASSERT( entry.m_LastAccess != 0 );
+    m_TotalSize -= entry.m_Size;
+    --m_NumValid;
+    entry.m_LastAccess = 0;
+}
+
+// Entries::Find
+//------------------------------------------------------------------------------
+bool CacheIndex::Entries::Find( const char * cacheId, uint32_t cacheIdLength, size_t & outIndex )
+{
+    if ( m_Table.IsEmpty() )
+    {
+        return false;
+    }
+    const uint32_t * slot = FindSlot( cacheId, cacheIdLength );
+    if ( ( *slot == 0 ) || ( m_Entries[ *slot - 1 ].m_LastAccess == 0 ) )
+    {
+        return false;
+    }
+    outIndex = ( *slot - 1 );
+    return true;
+}
+
+// Entries::GetRefsSize
+//------------------------------------------------------------------------------
+uint32_t CacheIndex::Entries::GetRefsSize( const Entry & entry ) const
+{
+    const char * const refs = GetRefs( entry );
+    const char * pos = refs;
+    for ( uint32_t i = 0; i < entry.m_NumRefs; ++i )
+    {
+        pos += ( strlen( pos ) + 1 );
+    }
+    return (uint32_t)( pos - refs );
+}
+
+// Entries::SetRefs
+//------------------------------------------------------------------------------
+void CacheIndex::Entries::SetRefs( Entry & entry, const char * refs, uint32_t refsSize )
+{
+    entry.m_RefsOffset = (uint32_t)m_Ids.GetSize();
+    entry.m_NumRefs = 0;
+    if ( refsSize > 0 )
+    {
+        m_Ids.Append( refs, refs + refsSize );
+        for ( uint32_t i = 0; i < refsSize; ++i )
+        {
+            entry.m_NumRefs += ( refs[ i ] == '\0' ) ? 1u : 0u;
+        }
+    }
+}
+
+// Entries::FindSlot
+//------------------------------------------------------------------------------
+uint32_t * CacheIndex::Entries::FindSlot( const char * cacheId, uint32_t cacheIdLength )
+{
+    const size_t mask = ( m_Table.GetSize() - 1 );
+    size_t index = ( (size_t)xxHash::Calc64( cacheId, cacheIdLength ) & mask );
+    for ( ;; )
+    {
+        uint32_t * slot = &m_Table[ index ];
+        if ( *slot == 0 )
+        {
+            return slot; // Not found
+        }
+        const Entry & entry = m_Entries[ *slot - 1 ];
+        if ( ( entry.m_IdLength == cacheIdLength ) &&
+             ( memcmp( GetId( entry ), cacheId, cacheIdLength ) == 0 ) )
+        {
+            return slot; // Found
+        }
+        index = ( ( index + 1 ) & mask );
+    }
+}
+
+// Entries::GrowTable
+//------------------------------------------------------------------------------
+void CacheIndex::Entries::GrowTable()
+{
+    const size_t newSize = m_Table.IsEmpty() ? 1024 : ( m_Table.GetSize() * 2 );
+    m_Table.SetCapacity( newSize );
+    m_Table.SetSize( newSize );
+    memset( m_Table.Begin(), 0, newSize * sizeof( uint32_t ) );
+
+    for ( size_t i = 0; i < m_Entries.GetSize(); ++i )
+    {
+        const Entry & entry = m_Entries[ i ];
+        uint32_t * slot = FindSlot( GetId( entry ), entry.m_IdLength );
+        ASSERT( *slot == 0 );
+        *slot = (uint32_t)( i + 1 );
+    }
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheIndex::CacheIndex()
+    : m_FileNameCounter( 0 )
+    , m_Records( 0, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheIndex::~CacheIndex()
+{
+    Flush();
+}
+
+// Init
+//------------------------------------------------------------------------------
+void CacheIndex::Init( const AString & cachePath )
+{
+    m_IndexPath = cachePath;
+    m_IndexPath += "index";
+    m_IndexPath += NATIVE_SLASH;
+    FileIO::EnsurePathExists( m_IndexPath );
+}
+
+// Record
+//------------------------------------------------------------------------------
+void CacheIndex::Record( const AString & cacheId, uint64_t size, uint32_t flags, const Array< char > * refs )
+{
+    Array< PendingRecord > toWrite;
+    {
+        MutexHolder mh( m_Mutex );
+        PendingRecord & record = m_Records.EmplaceBack();
+        record.m_CacheId = cacheId;
+        record.m_Size = size;
+        record.m_LastAccess = Time::GetCurrentFileTime();
+        record.m_Flags = flags;
+        if ( refs )
+        {
+            record.m_Refs = *refs;
+        }
+        if ( m_Records.GetSize() < MAX_UNFLUSHED_RECORDS )
+        {
+            return;
+        }
+        toWrite = Move( m_Records );
+    }
+
+    // Write outside of the lock
+    WriteRecords( toWrite );
+}
+
+// Flush
+//------------------------------------------------------------------------------
+void CacheIndex::Flush()
+{
+    Array< PendingRecord > toWrite;
+    {
+        MutexHolder mh( m_Mutex );
+        toWrite = Move( m_Records );
+    }
+    if ( ( toWrite.IsEmpty() == false ) && ( m_IndexPath.IsEmpty() == false ) )
+    {
+        WriteRecords( toWrite );
+    }
+}
+
+// IsComplete
+//------------------------------------------------------------------------------
+bool CacheIndex::IsComplete() const
+{
+    AStackString<> fileName( m_IndexPath );
+    fileName += CACHE_INDEX_COMPLETE;
+    return FileIO::FileExists( fileName.Get() );
+}
+
+// SetComplete
+//------------------------------------------------------------------------------
+void CacheIndex::SetComplete()
+{
+    AStackString<> fileName( m_IndexPath );
+    fileName += CACHE_INDEX_COMPLETE;
+    FileStream f;
+    if ( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
+    {
+        f.Close();
+    }
+}
+
+// Load
+//------------------------------------------------------------------------------
+void CacheIndex::Load( Entries & outEntries, bool claim )
+{
+    PROFILE_FUNCTION;
+
+    Array< AString > files( 0, true );
+    if ( claim )
+    {
+        ClaimFiles( files );
+        outEntries.m_ClaimedFiles.Append( files );
+    }
+    else
+    {
+        FileIO::GetFiles( m_IndexPath, AStackString<>( "*" CACHE_INDEX_EXTENSION ), false, &files );
+    }
+
+    for ( const AString & file : files )
+    {
+        ReadFile( file, outEntries ); // Ok to fail (deleted, or damaged)
+    }
+
+    // Include recorded entries which have not been written yet
+    MutexHolder mh( m_Mutex );
+    for ( const PendingRecord & record : m_Records )
+    {
+        outEntries.Add( record.m_CacheId.Get(),
+                        record.m_CacheId.GetLength(),
+                        record.m_Size,
+                        record.m_LastAccess,
+                        record.m_Flags,
+                        record.m_Refs.Begin(),
+                        (uint32_t)record.m_Refs.GetSize() );
+    }
+}
+
+// LoadExcluding
+//------------------------------------------------------------------------------
+bool CacheIndex::LoadExcluding( const AString & excludedFileName, Entries & outEntries ) const
+{
+    PROFILE_FUNCTION;
+
+    // Files being replaced by another client are still read, since their
+    // replacement may not have been written yet
+    Array< AString > files( 0, true );
+    FileIO::GetFiles( m_IndexPath, AStackString<>( "*" CACHE_INDEX_EXTENSION ), false, &files );
+    FileIO::GetFiles( m_IndexPath, AStackString<>( "*" CACHE_INDEX_EXTENSION CACHE_INDEX_CLAIMED ), false, &files );
+
+    bool foundExcludedFile = false;
+    AStackString<> fileName;
+    for ( const AString & file : files )
+    {
+        const char * slash = file.FindLast( NATIVE_SLASH );
+        fileName = slash ? ( slash + 1 ) : file.Get();
+        if ( fileName.EndsWith( CACHE_INDEX_CLAIMED ) )
+        {
+            fileName.SetLength( fileName.GetLength() - (uint32_t)strlen( CACHE_INDEX_CLAIMED ) );
+        }
+        if ( fileName == excludedFileName )
+        {
+            foundExcludedFile = true;
+            continue;
+        }
+        ReadFile( file, outEntries ); // Ok to fail (deleted, or damaged)
+    }
+    return foundExcludedFile;
+}
+
+// Save
+//------------------------------------------------------------------------------
+bool CacheIndex::Save( Entries & entries, AString * outFileName )
+{
+    PROFILE_FUNCTION;
+
+    Array< AString > claimedFiles( Move( entries.m_ClaimedFiles ) );
+
+    // Write all the remaining entries to a new file
+    MemoryStream stream( ( entries.GetNumValid() * 80 ) + 64 );
+    WriteHeader( stream );
+    for ( size_t i = 0; i < entries.GetSize(); ++i )
+    {
+        const Entries::Entry & entry = entries[ i ];
+        if ( entry.m_LastAccess != 0 )
+        {
+            WriteRecord( stream,
+                         entries.GetId( entry ),
+                         entry.m_IdLength,
+                         entry.m_Size,
+                         entry.m_LastAccess,
+                         entry.m_Flags,
+                         entries.GetRefs( entry ),
+                         entries.GetRefsSize( entry ) );
+        }
+    }
+    const bool ok = WriteFile( stream, outFileName );
+
+    for ( const AString & claimedFile : claimedFiles )
+    {
+        if ( ok )
+        {
+            FileIO::FileDelete( claimedFile.Get() );
+        }
+        else
+        {
+            // Return the claimed file to the index
+            AStackString<> fileName( claimedFile );
+            fileName.SetLength( fileName.GetLength() - (uint32_t)strlen( CACHE_INDEX_CLAIMED ) );
+            FileIO::FileMove( claimedFile, fileName );
+        }
+    }
+
+    return ok;
+}
+
+// GetNumFiles
+//------------------------------------------------------------------------------
+uint32_t CacheIndex::GetNumFiles() const
+{
+    Array< AString > files( 0, true );
+    FileIO::GetFiles( m_IndexPath, AStackString<>( "*" CACHE_INDEX_EXTENSION ), false, &files );
+    return (uint32_t)files.GetSize();
+}
+
+// TryBeginPeriodicTrim
+//------------------------------------------------------------------------------
+bool CacheIndex::TryBeginPeriodicTrim( uint32_t intervalSeconds )
+{
+    AStackString<> fileName( m_IndexPath );
+    fileName += CACHE_INDEX_LAST_TRIM;
+
+    const uint64_t lastTrim = FileIO::GetFileLastWriteTime( fileName );
+    const uint64_t now = Time::GetCurrentFileTime();
+    if ( ( lastTrim != 0 ) && ( now < ( lastTrim + SecondsToFileTime( intervalSeconds ) ) ) )
+    {
+        return false; // Trimmed recently (possibly by another client)
+    }
+
+    // Let other clients know we're handling it
+    FileStream f;
+    if ( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) == false )
+    {
+        return false;
+    }
+    f.Close();
+    return true;
+}
+
+// WriteHeader
+//------------------------------------------------------------------------------
+/*static*/ void CacheIndex::WriteHeader( MemoryStream & stream )
+{
+    stream.Write( kIndexFileMagic );
+    stream.Write( kIndexFileVersion );
+}
+
+// WriteRecord
+//------------------------------------------------------------------------------
+/*static*/ void CacheIndex::WriteRecord( MemoryStream & stream,
+                                        const char * cacheId,
+                                        uint32_t cacheIdLength,
+                                        uint64_t size,
+                                        uint64_t lastAccess,
+                                        uint32_t flags,
+                                        const char * refs,
+                                        uint32_t refsSize )
+{
+    ASSERT( cacheIdLength <= 0xFFFF );
+    stream.Write( lastAccess );
+    stream.Write( size );
+    stream.Write( flags );
+    stream.Write( (uint16_t)cacheIdLength );
+    stream.Write( refsSize );
+    stream.Write( cacheId, cacheIdLength );
+    if ( refsSize > 0 )
+    {
+        stream.Write( refs, refsSize );
+    }
+}
+
+// WriteRecords
+//------------------------------------------------------------------------------
+void CacheIndex::WriteRecords( const Array< PendingRecord > & records )
+{
+    PROFILE_FUNCTION;
+
+    MemoryStream stream( ( records.GetSize() * 80 ) + 64 );
+    WriteHeader( stream );
+    for ( const PendingRecord & record : records )
+    {
+        WriteRecord( stream,
+                     record.m_CacheId.Get(),
+                     record.m_CacheId.GetLength(),
+                     record.m_Size,
+                     record.m_LastAccess,
+                     record.m_Flags,
+                     record.m_Refs.Begin(),
+                     (uint32_t)record.m_Refs.GetSize() );
+    }
+    WriteFile( stream ); // Ok to fail (read-only cache for example)
+}
+
+// WriteFile
+//------------------------------------------------------------------------------
+bool CacheIndex::WriteFile( const MemoryStream & stream, AString * outFileName )
+{
+    AStackString<> fileName;
+    GetUniqueFileName( fileName );
+
+    // Write to a tmp file first, so incomplete files are never read
+    AStackString<> fileNameTmp( fileName );
+    fileNameTmp += ".tmp";
+    FileStream f;
+    if ( f.Open( fileNameTmp.Get(), FileStream::WRITE_ONLY ) == false )
+    {
+        return false;
+    }
+    const bool writeOk = ( f.Write( stream.GetData(), stream.GetSize() ) == stream.GetSize() );
+    f.Close();
+
+    if ( ( writeOk == false ) || ( FileIO::FileMove( fileNameTmp, fileName ) == false ) )
+    {
+        FileIO::FileDelete( fileNameTmp.Get() );
+        return false;
+    }
+    if ( outFileName )
+    {
+        const char * slash = fileName.FindLast( NATIVE_SLASH );
+        *outFileName = slash ? ( slash + 1 ) : fileName.Get();
+    }
+    return true;
+}
+
+// ReadFile
+//------------------------------------------------------------------------------
+/*static*/ bool CacheIndex::ReadFile( const AString & fileName, Entries & outEntries )
+{
+    FileStream f;
+    if ( f.Open( fileName.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+    const size_t fileSize = (size_t)f.GetFileSize();
+    UniquePtr< char > mem( (char *)ALLOC( fileSize + 1 ) );
+    if ( f.Read( mem.Get(), fileSize ) != fileSize )
+    {
+        return false;
+    }
+
+    // Header
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if ( fileSize < ( sizeof( magic ) + sizeof( version ) ) )
+    {
+        return false;
+    }
+    memcpy( &magic, mem.Get(), sizeof( magic ) );
+    memcpy( &version, mem.Get() + sizeof( magic ), sizeof( version ) );
+    if ( ( magic != kIndexFileMagic ) || ( version != kIndexFileVersion ) )
+    {
+        return false;
+    }
+
+    // Records
+    const char * pos = mem.Get() + sizeof( magic ) + sizeof( version );
+    const char * const end = mem.Get() + fileSize;
+    while ( ( pos + kRecordHeaderSize ) <= end )
+    {
+        uint64_t lastAccess;
+        uint64_t size;
+        uint32_t flags;
+        uint16_t cacheIdLength;
+        uint32_t refsSize;
+        memcpy( &lastAccess, pos, sizeof( lastAccess ) );
+        pos += sizeof( lastAccess );
+        memcpy( &size, pos, sizeof( size ) );
+        pos += sizeof( size );
+        memcpy( &flags, pos, sizeof( flags ) );
+        pos += sizeof( flags );
+        memcpy( &cacheIdLength, pos, sizeof( cacheIdLength ) );
+        pos += sizeof( cacheIdLength );
+        memcpy( &refsSize, pos, sizeof( refsSize ) );
+        pos += sizeof( refsSize );
+        if ( ( (size_t)( end - pos ) < ( (size_t)cacheIdLength + refsSize ) ) ||
+             ( lastAccess == 0 ) ||
+             ( ( refsSize > 0 ) && ( pos[ cacheIdLength + refsSize - 1 ] != '\0' ) ) )
+        {
+            return false; // Damaged
+        }
+        outEntries.Add( pos, cacheIdLength, size, lastAccess, flags, pos + cacheIdLength, refsSize );
+        pos += ( cacheIdLength + refsSize );
+    }
+    return true;
+}
+
+// ClaimFiles
+//------------------------------------------------------------------------------
+void CacheIndex::ClaimFiles( Array< AString > & outFiles ) const
+{
+    // Return abandoned claims to the index
+    Array< FileIO::FileInfo > claimedFiles( 0, true );
+    Array< AString > patterns( 1, false );
+    patterns.EmplaceBack( "*" CACHE_INDEX_CLAIMED );
+    FileIO::GetFilesEx( m_IndexPath, &patterns, false, &claimedFiles );
+    const uint64_t now = Time::GetCurrentFileTime();
+    for ( const FileIO::FileInfo & info : claimedFiles )
+    {
+        if ( now > ( info.m_LastWriteTime + SecondsToFileTime( kClaimTimeoutSeconds ) ) )
+        {
+            AStackString<> fileName( info.m_Name );
+            fileName.SetLength( fileName.GetLength() - (uint32_t)strlen( CACHE_INDEX_CLAIMED ) );
+            FileIO::FileMove( info.m_Name, fileName );
+        }
+    }
+
+    // Claim files by renaming them. If another client claims a file first,
+    // our rename will fail and the file will be handled by the other client.
+    Array< AString > files( 0, true );
+    FileIO::GetFiles( m_IndexPath, AStackString<>( "*" CACHE_INDEX_EXTENSION ), false, &files );
+    for ( const AString & file : files )
+    {
+        AStackString<> claimedFile( file );
+        claimedFile += CACHE_INDEX_CLAIMED;
+        if ( FileIO::FileMove( file, claimedFile ) )
+        {
+            FileIO::SetFileLastWriteTimeToNow( claimedFile ); // Used to detect abandoned claims
+            outFiles.Append( claimedFile );
+        }
+    }
+}
+
+// GetUniqueFileName
+//------------------------------------------------------------------------------
+void CacheIndex::GetUniqueFileName( AString & outFileName )
+{
+    // Files can be written by many clients at the same time
+    AStackString<> hostName;
+    Network::GetHostName( hostName );
+    outFileName.Format( "%s%016" PRIX64 "-%08X-%08X-%u" CACHE_INDEX_EXTENSION,
+                        m_IndexPath.Get(),
+                        Time::GetCurrentFileTime(),
+                        xxHash::Calc32( hostName ),
+                        Process::GetCurrentId(),
+                        AtomicIncU32( &m_FileNameCounter ) );
+}
+
+//------------------------------------------------------------------------------
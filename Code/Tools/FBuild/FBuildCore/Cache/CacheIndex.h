@@ -0,0 +1,166 @@
+// CacheIndex - Record of the entries in a Cache, to avoid scanning it
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class MemoryStream;
+
+// CacheIndex
+//  - Entries which are published or retrieved are recorded (key, size and time
+//    of last access) and periodically appended to the index as a new file, so
+//    that clients never modify the same file.
+//  - Loading the index merges all of its files. A client replacing the index
+//    (when trimming) first claims each file by renaming it, so concurrent trims
+//    never lose records.
+//  - The index only covers entries published by older versions (or while the
+//    index was unavailable) once it has been built by scanning the cache.
+//  - Entries can reference chunks (also entries) which they share with other
+//    entries, allowing unreferenced chunks to be found when trimming.
+//------------------------------------------------------------------------------
+class CacheIndex
+{
+public:
+    // The merged contents of the index
+    class Entries
+    {
+    public:
+        explicit Entries();
+        ~Entries();
+
+        class Entry
+        {
+        public:
+            uint64_t    m_LastAccess;   // FileTime of last publish or retrieval (0 if removed)
+            uint64_t    m_Size;
+            uint32_t    m_IdOffset;     // Location of cacheId in m_Ids
+            uint16_t    m_IdLength;
+            uint16_t    m_NumRefs;      // Number of chunks referenced
+            uint32_t    m_RefsOffset;   // Location of referenced chunk ids in m_Ids
+            uint32_t    m_Flags;
+        };
+
+        // Add an entry, merging it with an existing one for the same cacheId.
+        // References are a sequence of null terminated chunk ids.
+        void Add( const char * cacheId,
+                  uint32_t cacheIdLength,
+                  uint64_t size,
+                  uint64_t lastAccess,
+                  uint32_t flags = 0,
+                  const char * refs = nullptr,
+                  uint32_t refsSize = 0 );
+        void Remove( size_t index );
+        bool Find( const char * cacheId, uint32_t cacheIdLength, size_t & outIndex );
+
+        inline size_t           GetSize() const                     { return m_Entries.GetSize(); }
+        inline const Entry &    operator [] ( size_t index ) const  { return m_Entries[ index ]; }
+        inline const char *     GetId( const Entry & entry ) const  { return m_Ids.Begin() + entry.m_IdOffset; }
+        inline const char *     GetRefs( const Entry & entry ) const { return m_Ids.Begin() + entry.m_RefsOffset; }
+        inline uint32_t         GetNumValid() const                 { return m_NumValid; }
+        inline uint64_t         GetTotalSize() const                { return m_TotalSize; }
+
+    private:
+        friend class CacheIndex;
+
+        Entries( const Entries & ) = delete;
+        Entries & operator = ( const Entries & ) = delete;
+
+        uint32_t GetRefsSize( const Entry & entry ) const;
+        void SetRefs( Entry & entry, const char * refs, uint32_t refsSize );
+        uint32_t * FindSlot( const char * cacheId, uint32_t cacheIdLength );
+        void GrowTable();
+
+        Array< Entry >      m_Entries;
+        Array< char >       m_Ids;
+        Array< uint32_t >   m_Table;        // Open addressed hash table of indices into m_Entries (+1)
+        uint32_t            m_NumValid;
+        uint64_t            m_TotalSize;
+        Array< AString >    m_ClaimedFiles; // Index files to be replaced by Save
+    };
+
+    // Entry flags
+    enum : uint32_t
+    {
+        FLAG_CHUNK  = 0x1,  // Content shared by other entries
+    };
+
+    explicit CacheIndex();
+    ~CacheIndex();
+
+    void Init( const AString & cachePath );
+    inline const AString & GetPath() const { return m_IndexPath; }
+
+    // Record an entry which has been published or retrieved (thread safe)
+    void Record( const AString & cacheId, uint64_t size, uint32_t flags = 0, const Array< char > * refs = nullptr );
+
+    // Append recorded entries to the index
+    void Flush();
+
+    // Has the index been built by scanning the cache?
+    bool IsComplete() const;
+    void SetComplete();
+
+    // Load the whole index, including recorded entries which have not been flushed.
+    // If claim is true, the loaded files are removed from the index until Save is called.
+    void Load( Entries & outEntries, bool claim );
+
+    // Load the files making up the index, except for the given file (name only).
+    // Returns false if that file is not part of the index.
+    bool LoadExcluding( const AString & excludedFileName, Entries & outEntries ) const;
+
+    // Replace the files claimed by Load with the given entries, optionally
+    // returning the name (only) of the file written
+    bool Save( Entries & entries, AString * outFileName = nullptr );
+
+    // Number of files making up the index
+    uint32_t GetNumFiles() const;
+
+    // Throttle background trimming so only one client trims the cache in a given period
+    bool TryBeginPeriodicTrim( uint32_t intervalSeconds );
+
+private:
+    // An entry which has been recorded but not flushed
+    class PendingRecord
+    {
+    public:
+        AString     m_CacheId;
+        uint64_t    m_Size;
+        uint64_t    m_LastAccess;
+        uint32_t    m_Flags;
+        Array< char > m_Refs;
+    };
+
+    enum : uint32_t { MAX_UNFLUSHED_RECORDS = 4096 };
+
+    static void WriteHeader( MemoryStream & stream );
+    static void WriteRecord( MemoryStream & stream,
+                             const char * cacheId,
+                             uint32_t cacheIdLength,
+                             uint64_t size,
+                             uint64_t lastAccess,
+                             uint32_t flags,
+                             const char * refs,
+                             uint32_t refsSize );
+    void WriteRecords( const Array< PendingRecord > & records );
+    bool WriteFile( const MemoryStream & stream, AString * outFileName = nullptr );
+    static bool ReadFile( const AString & fileName, Entries & outEntries );
+    void ClaimFiles( Array< AString > & outFiles ) const;
+    void GetUniqueFileName( AString & outFileName );
+
+    AString             m_IndexPath;
+    volatile uint32_t   m_FileNameCounter;
+
+    // Protected by m_Mutex
+    mutable Mutex       m_Mutex;
+    Array< PendingRecord > m_Records;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,139 @@
+// CacheMissMemo - Record of cache lookups which missed during a build
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheMissMemo.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Strings/AString.h"
+
+// system
+#include <string.h>
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheMissMemo::CacheMissMemo()
+    : m_Table( 0, true )
+    , m_NumUsed( 0 )
+    , m_NumSkipped( 0 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheMissMemo::~CacheMissMemo() = default;
+
+// IsKnownMiss
+//------------------------------------------------------------------------------
+bool CacheMissMemo::IsKnownMiss( const AString & cacheId )
+{
+    const uint64_t key = GetKey( cacheId );
+
+    MutexHolder mh( m_Mutex );
+    if ( m_Table.IsEmpty() || ( *FindSlot( key ) != key ) )
+    {
+        return false;
+    }
+    ++m_NumSkipped;
+    return true;
+}
+
+// RecordMiss
+//------------------------------------------------------------------------------
+void CacheMissMemo::RecordMiss( const AString & cacheId )
+{
+    const uint64_t key = GetKey( cacheId );
+
+    MutexHolder mh( m_Mutex );
+    if ( ( m_NumUsed * 2 ) >= m_Table.GetSize() )
+    {
+        GrowTable();
+    }
+    uint64_t * slot = FindSlot( key );
+    if ( *slot == SLOT_EMPTY )
+    {
+        ++m_NumUsed;
+    }
+    *slot = key;
+}
+
+// RecordPublish
+//------------------------------------------------------------------------------
+void CacheMissMemo::RecordPublish( const AString & cacheId )
+{
+    const uint64_t key = GetKey( cacheId );
+
+    MutexHolder mh( m_Mutex );
+    if ( m_Table.IsEmpty() )
+    {
+        return;
+    }
+    uint64_t * slot = FindSlot( key );
+    if ( *slot == key )
+    {
+        *slot = SLOT_PUBLISHED; // Keep the slot used, so later keys are still found
+    }
+}
+
+// GetNumSkipped
+//------------------------------------------------------------------------------
+uint32_t CacheMissMemo::GetNumSkipped() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_NumSkipped;
+}
+
+// GetKey
+//------------------------------------------------------------------------------
+/*static*/ uint64_t CacheMissMemo::GetKey( const AString & cacheId )
+{
+    return ( xxHash::Calc64( cacheId.Get(), cacheId.GetLength() ) | KEY_FLAG );
+}
+
+// FindSlot
+//------------------------------------------------------------------------------
+uint64_t * CacheMissMemo::FindSlot( uint64_t key )
+{
+    // Returns the slot holding the key or, if not found, an empty slot
+    const size_t mask = ( m_Table.GetSize() - 1 );
+    size_t index = ( (size_t)( key >> 2 ) & mask );
+    for ( ;; )
+    {
+        uint64_t * slot = &m_Table[ index ];
+        if ( ( *slot == key ) || ( *slot == SLOT_EMPTY ) )
+        {
+            return slot;
+        }
+        index = ( ( index + 1 ) & mask );
+    }
+}
+
+// GrowTable
+//------------------------------------------------------------------------------
+void CacheMissMemo::GrowTable()
+{
+    Array< uint64_t > oldTable( Move( m_Table ) );
+
+    const size_t newSize = oldTable.IsEmpty() ? 1024 : ( oldTable.GetSize() * 2 );
+    m_Table.SetCapacity( newSize );
+    m_Table.SetSize( newSize );
+    memset( m_Table.Begin(), 0, newSize * sizeof( uint64_t ) );
+
+    // Re-insert the keys (published slots are no longer needed)
+    m_NumUsed = 0;
+    for ( const uint64_t key : oldTable )
+    {
+        if ( key & KEY_FLAG )
+        {
+            uint64_t * slot = FindSlot( key );
+            ASSERT( *slot == SLOT_EMPTY );
+            *slot = key;
+            ++m_NumUsed;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
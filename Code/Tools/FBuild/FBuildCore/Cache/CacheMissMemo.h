@@ -0,0 +1,55 @@
+// CacheMissMemo - Record of cache lookups which missed during a build
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+
+// CacheMissMemo
+//  - A job can look up the same entry more than once (a prefetched or LightCache
+//    miss is looked up again once preprocessed) and identical jobs share entries.
+//  - Entries which were missing earlier in the build are not looked up again,
+//    unless they have been published since.
+//------------------------------------------------------------------------------
+class CacheMissMemo
+{
+public:
+    explicit CacheMissMemo();
+    ~CacheMissMemo();
+
+    // Was the entry missing from an earlier lookup? (thread safe)
+    bool IsKnownMiss( const AString & cacheId );
+
+    // Record the result of a lookup or a publish (thread safe)
+    void RecordMiss( const AString & cacheId );
+    void RecordPublish( const AString & cacheId );
+
+    uint32_t GetNumSkipped() const;
+
+private:
+    enum : uint64_t
+    {
+        SLOT_EMPTY      = 0,
+        SLOT_PUBLISHED  = 1,    // Missed, but published since
+        KEY_FLAG        = 2,    // Set in every key, so keys never match the above
+    };
+
+    static uint64_t GetKey( const AString & cacheId );
+    uint64_t * FindSlot( uint64_t key );
+    void GrowTable();
+
+    mutable Mutex       m_Mutex;
+    Array< uint64_t >   m_Table;        // Open addressed hash table of keys
+    uint32_t            m_NumUsed;      // Slots which are not empty
+    uint32_t            m_NumSkipped;
+};
+
+//------------------------------------------------------------------------------
@@ -11,6 +11,8 @@
 // Core
 #include "Core/Env/ErrorFormat.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Profile/Profile.h"
 #include "Core/Tracing/Tracing.h"
 
 // system
@@ -20,16 +22,25 @@
 #if defined( __LINUX__ ) || defined( __APPLE__ )
     #include <dlfcn.h>
 #endif
+#include <string.h>
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 /*explicit*/ CachePlugin::CachePlugin( const AString & dllName )
     : m_DLL( nullptr )
+    , m_Valid( false )
     , m_InitFunc( nullptr )
+    , m_InitExFunc( nullptr )
     , m_ShutdownFunc( nullptr )
     , m_PublishFunc( nullptr )
     , m_RetrieveFunc( nullptr )
     , m_FreeMemoryFunc( nullptr )
+    , m_OutputInfoFunc( nullptr )
+    , m_TrimFunc( nullptr )
+    , m_InterfaceVersion( 1 )
+    , m_QueryFunc( nullptr )
+    , m_RetrieveIntoFunc( nullptr )
+    , m_RetrieveAsyncFunc( nullptr )
 {
     #if defined( __WINDOWS__ )
         m_DLL = ::LoadLibrary( dllName.Get() );
@@ -50,14 +61,27 @@
     // Failure to find a required function will mark us as invalid
     m_Valid = true;
 
+    // Plugins using a newer interface don't need to provide some older functions
+    const CacheGetInterfaceVersionFunc versionFunc = (CacheGetInterfaceVersionFunc)GetFunction( "CacheGetInterfaceVersion", nullptr, true ); // Optional
+    m_InterfaceVersion = versionFunc ? (*versionFunc)() : 1;
+    const bool v2 = ( m_InterfaceVersion >= 2 );
+
     m_InitFunc      = (CacheInitFunc)       GetFunction( "CacheInit",       "?CacheInit@@YA_NPEBD@Z", true ); // Optional
     m_InitExFunc    = (CacheInitExFunc)     GetFunction( "CacheInitEx",     nullptr, true ); // Optional
     m_ShutdownFunc  = (CacheShutdownFunc)   GetFunction( "CacheShutdown",   "?CacheShutdown@@YAXXZ", true ); // Optional
     m_PublishFunc   = (CachePublishFunc)    GetFunction( "CachePublish",    "?CachePublish@@YA_NPEBDPEBX_K@Z" );
-    m_RetrieveFunc  = (CacheRetrieveFunc)   GetFunction( "CacheRetrieve",   "?CacheRetrieve@@YA_NPEBDAEAPEAXAEA_K@Z" );
-    m_FreeMemoryFunc= (CacheFreeMemoryFunc) GetFunction( "CacheFreeMemory", "?CacheFreeMemory@@YAXPEAX_K@Z" );
+    m_RetrieveFunc  = (CacheRetrieveFunc)   GetFunction( "CacheRetrieve",   "?CacheRetrieve@@YA_NPEBDAEAPEAXAEA_K@Z", v2 ); // Optional for v2
+    m_FreeMemoryFunc= (CacheFreeMemoryFunc) GetFunction( "CacheFreeMemory", "?CacheFreeMemory@@YAXPEAX_K@Z", v2 ); // Optional for v2
     m_OutputInfoFunc= (CacheOutputInfoFunc) GetFunction( "CacheOutputInfo", "?CacheOutputInfo@@YA_N_N@Z", true ); // Optional
     m_TrimFunc      = (CacheTrimFunc)       GetFunction( "CacheTrim",       "?CacheTrim@@YA_N_NI@Z", true ); // Optional
+
+    // Interface version 2
+    if ( v2 )
+    {
+        m_QueryFunc         = (CacheQueryFunc)          GetFunction( "CacheQuery" );
+        m_RetrieveIntoFunc  = (CacheRetrieveIntoFunc)   GetFunction( "CacheRetrieveInto" );
+        m_RetrieveAsyncFunc = (CacheRetrieveAsyncFunc)  GetFunction( "CacheRetrieveAsync", nullptr, true ); // Optional
+    }
 }
 
 // DESTRUCTOR
@@ -186,6 +210,12 @@ void * CachePlugin::GetFunction( const char * name, const char * mangledName, bo
         return false;
     }
 
+    // Retrieve into our own memory if supported
+    if ( m_RetrieveIntoFunc )
+    {
+        return RetrieveInto( cacheId, RETRIEVE_BUFFER_SIZE_HINT, data, dataSize );
+    }
+
     if ( m_RetrieveFunc )
     {
         unsigned long long size;
@@ -205,6 +235,13 @@ void * CachePlugin::GetFunction( const char * name, const char * mangledName, bo
         return;
     }
 
+    // Memory retrieved into by the plugin is owned by us
+    if ( m_RetrieveIntoFunc )
+    {
+        FREE( data );
+        return;
+    }
+
     ASSERT( m_FreeMemoryFunc ); // should never get here without being valid
     (*m_FreeMemoryFunc)( data, dataSize );
 }
@@ -247,4 +284,179 @@ void * CachePlugin::GetFunction( const char * name, const char * mangledName, bo
     return false;
 }
 
+// QueryBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void CachePlugin::QueryBatch( Array< BatchEntry > & entries )
+{
+    if ( m_QueryFunc == nullptr )
+    {
+        ICache::QueryBatch( entries ); // Older plugins are queried one entry at a time
+        return;
+    }
+
+    PROFILE_FUNCTION;
+
+    const size_t numEntries = entries.GetSize();
+    Array< const char * > cacheIds( numEntries );
+    for ( const BatchEntry & entry : entries )
+    {
+        cacheIds.Append( entry.m_CacheId.Get() );
+    }
+    Array< unsigned long long > dataSizes;
+    dataSizes.SetSize( numEntries );
+    memset( dataSizes.Begin(), 0, numEntries * sizeof( unsigned long long ) );
+
+    const bool ok = m_Valid && ( numEntries > 0 ) && (*m_QueryFunc)( cacheIds.Begin(), (unsigned int)numEntries, dataSizes.Begin() );
+    for ( size_t i = 0; i < numEntries; ++i )
+    {
+        entries[ i ].m_DataSize = ok ? (size_t)dataSizes[ i ] : 0;
+        entries[ i ].m_Found = ( entries[ i ].m_DataSize > 0 );
+    }
+}
+
+// RetrieveBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void CachePlugin::RetrieveBatch( Array< BatchEntry > & entries )
+{
+    if ( m_RetrieveIntoFunc == nullptr )
+    {
+        ICache::RetrieveBatch( entries ); // Older plugins are accessed one entry at a time
+        return;
+    }
+
+    PROFILE_FUNCTION;
+
+    // Find out which entries exist and how big they are, so exactly sized
+    // memory can be provided to the plugin
+    QueryBatch( entries );
+
+    Semaphore done;
+    Array< AsyncRequest > requests;
+    requests.SetSize( entries.GetSize() );
+
+    // Start all retrievals before waiting for any of them
+    uint32_t numStarted = 0;
+    for ( size_t i = 0; i < entries.GetSize(); ++i )
+    {
+        BatchEntry & entry = entries[ i ];
+        AsyncRequest & request = requests[ i ];
+        request.m_Done = nullptr;
+        if ( entry.m_Found == false )
+        {
+            continue;
+        }
+
+        if ( m_RetrieveAsyncFunc )
+        {
+            entry.m_Data = ALLOC( entry.m_DataSize );
+            request.m_Done = &done;
+            request.m_Result = CACHE_RETRIEVE_ERROR;
+            request.m_DataSize = 0;
+            if ( (*m_RetrieveAsyncFunc)( entry.m_CacheId.Get(), entry.m_Data, entry.m_DataSize, &OnRetrieveComplete, &request ) )
+            {
+                ++numStarted;
+                continue;
+            }
+            FREE( entry.m_Data );
+            entry.m_Data = nullptr;
+            request.m_Done = nullptr;
+        }
+
+        // Plugin doesn't support (or couldn't start) async retrieval
+        entry.m_Found = RetrieveInto( entry.m_CacheId, entry.m_DataSize, entry.m_Data, entry.m_DataSize );
+    }
+
+    // Wait for all asynchronous retrievals to complete
+    for ( uint32_t i = 0; i < numStarted; ++i )
+    {
+        done.Wait();
+    }
+
+    for ( size_t i = 0; i < entries.GetSize(); ++i )
+    {
+        const AsyncRequest & request = requests[ i ];
+        if ( request.m_Done == nullptr )
+        {
+            continue; // Not an async request
+        }
+
+        BatchEntry & entry = entries[ i ];
+        if ( request.m_Result == CACHE_RETRIEVE_OK )
+        {
+            ASSERT( request.m_DataSize <= entry.m_DataSize );
+            entry.m_DataSize = (size_t)request.m_DataSize;
+            continue;
+        }
+
+        FREE( entry.m_Data );
+        entry.m_Data = nullptr;
+        entry.m_Found = false;
+
+        // Entry could have been replaced since it was queried
+        if ( request.m_Result == CACHE_RETRIEVE_BUFFER_TOO_SMALL )
+        {
+            entry.m_Found = RetrieveInto( entry.m_CacheId, (size_t)request.m_DataSize, entry.m_Data, entry.m_DataSize );
+        }
+    }
+
+    // Ensure consistent results for misses
+    for ( BatchEntry & entry : entries )
+    {
+        if ( entry.m_Found == false )
+        {
+            entry.m_Data = nullptr;
+            entry.m_DataSize = 0;
+        }
+    }
+}
+
+// RetrieveInto
+//------------------------------------------------------------------------------
+bool CachePlugin::RetrieveInto( const AString & cacheId, size_t bufferSize, void * & outData, size_t & outDataSize )
+{
+    outData = nullptr;
+    outDataSize = 0;
+
+    if ( m_Valid == false )
+    {
+        return false;
+    }
+
+    // If the buffer is too small, try again with the required size. Only retry once,
+    // so an entry which is constantly being replaced can't make us loop forever
+    for ( uint32_t attempt = 0; attempt < 2; ++attempt )
+    {
+        void * buffer = ALLOC( bufferSize );
+        unsigned long long dataSize = 0;
+        const int result = (*m_RetrieveIntoFunc)( cacheId.Get(), buffer, bufferSize, dataSize );
+        if ( result == CACHE_RETRIEVE_OK )
+        {
+            ASSERT( dataSize <= bufferSize );
+            outData = buffer;
+            outDataSize = (size_t)dataSize;
+            return true;
+        }
+        FREE( buffer );
+
+        if ( ( result != CACHE_RETRIEVE_BUFFER_TOO_SMALL ) || ( dataSize <= bufferSize ) )
+        {
+            break;
+        }
+        bufferSize = (size_t)dataSize;
+    }
+
+    return false;
+}
+
+// OnRetrieveComplete
+//------------------------------------------------------------------------------
+/*static*/ void STDCALL CachePlugin::OnRetrieveComplete( void * userData, int result, unsigned long long dataSize )
+{
+    // Can be called from any thread
+    AsyncRequest * request = static_cast< AsyncRequest * >( userData );
+    request->m_Result = result;
+    request->m_DataSize = dataSize;
+    request->m_Done->Signal();
+}
+
 //------------------------------------------------------------------------------
@@ -10,6 +10,7 @@
 // Forward Declarations
 //------------------------------------------------------------------------------
 class AString;
+class Semaphore;
 
 // Cache
 //------------------------------------------------------------------------------
@@ -31,10 +32,29 @@ public:
     virtual void FreeMemory( void * data, size_t dataSize ) override;
     virtual bool OutputInfo( bool showProgress ) override;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual void QueryBatch( Array< BatchEntry > & entries ) override;
+    virtual void RetrieveBatch( Array< BatchEntry > & entries ) override;
+
+    inline uint32_t GetInterfaceVersion() const { return m_InterfaceVersion; }
+
 private:
     void * GetFunction( const char * friendlyName, const char * mangledName = nullptr, bool optional = false );
+    bool RetrieveInto( const AString & cacheId, size_t bufferSize, void * & outData, size_t & outDataSize );
 
     static void CacheOutputWrapper( const char * message );
+    static void STDCALL OnRetrieveComplete( void * userData, int result, unsigned long long dataSize );
+
+    // An asynchronous retrieval in progress (see RetrieveBatch)
+    class AsyncRequest
+    {
+    public:
+        Semaphore *         m_Done;
+        int                 m_Result;
+        unsigned long long  m_DataSize;
+    };
+
+    // Size of memory initially provided to CacheRetrieveInto when the size of the entry is not known
+    enum : size_t { RETRIEVE_BUFFER_SIZE_HINT = ( 1024 * 1024 ) };
 
     void *              m_DLL;
     bool                m_Valid;
@@ -46,6 +66,12 @@ private:
     CacheFreeMemoryFunc m_FreeMemoryFunc;
     CacheOutputInfoFunc m_OutputInfoFunc;
     CacheTrimFunc       m_TrimFunc;
+
+    // Interface version 2
+    uint32_t                m_InterfaceVersion;
+    CacheQueryFunc          m_QueryFunc;
+    CacheRetrieveIntoFunc   m_RetrieveIntoFunc;
+    CacheRetrieveAsyncFunc  m_RetrieveAsyncFunc;
 };
 
 //------------------------------------------------------------------------------
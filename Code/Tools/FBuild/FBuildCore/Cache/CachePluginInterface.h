@@ -93,6 +93,81 @@ using CacheOutputInfoFunc = bool (STDCALL *)( bool showProgress );
 //     sizeMiB      - desired size in MiB
 using CacheTrimFunc = bool (STDCALL *)( bool showProgress, unsigned int sizeMiB );
 
+// Interface Version 2
+//------------------------------------------------------------------------------
+// The functions below allow a plugin to receive batched and asynchronous requests
+// and to retrieve data directly into memory provided by FASTBuild, avoiding an
+// allocation and copy per retrieval.
+//
+// A plugin opts in by exporting CacheGetInterfaceVersion and returning 2 (or
+// higher). CacheQuery and CacheRetrieveInto are then required, CacheRetrieveAsync
+// is optional, and CacheRetrieve and CacheFreeMemory are no longer used (and
+// may be omitted).
+#define CACHE_PLUGIN_INTERFACE_VERSION 2
+
+// Result of a retrieval into memory provided by FASTBuild
+enum CacheRetrieveResult : int
+{
+    CACHE_RETRIEVE_OK               = 0,    // Data was retrieved
+    CACHE_RETRIEVE_NOT_FOUND        = 1,    // Entry is not in the cache
+    CACHE_RETRIEVE_BUFFER_TOO_SMALL = 2,    // Buffer is too small (required size is returned)
+    CACHE_RETRIEVE_ERROR            = 3,    // Entry could not be retrieved
+};
+
+// CacheGetInterfaceVersion (Optional)
+//------------------------------------------------------------------------------
+// Out: unsigned int - (return) CACHE_PLUGIN_INTERFACE_VERSION the plugin was built against
+using CacheGetInterfaceVersionFunc = unsigned int (STDCALL *)();
+
+// CacheQuery (Required for v2)
+//------------------------------------------------------------------------------
+// Check if a batch of items exist in the cache.
+//
+// In:  cacheIds    - array of numIds entry names
+//      numIds      - number of entries to check
+// Out: dataSizes   - for each entry, the size in bytes of the stored data or 0 if not in cache
+//      bool        - (return) false if the query could not be performed
+using CacheQueryFunc = bool (STDCALL *)( const char * const * cacheIds, unsigned int numIds, unsigned long long * dataSizes );
+
+// CacheRetrieveInto (Required for v2)
+//------------------------------------------------------------------------------
+// Retrieve a previously stored item into memory provided by FASTBuild.
+//
+// In:  cacheId     - string name of cache entry
+//      buffer      - memory to write the data to
+//      bufferSize  - size in bytes of buffer
+// Out: dataSize    - size in bytes of the item (on CACHE_RETRIEVE_OK or CACHE_RETRIEVE_BUFFER_TOO_SMALL)
+//      int         - (return) a CacheRetrieveResult
+using CacheRetrieveIntoFunc = int (STDCALL *)( const char * cacheId, void * buffer, unsigned long long bufferSize, unsigned long long & dataSize );
+
+// CacheRetrieveCompleteFunc
+//------------------------------------------------------------------------------
+// A function the plugin must call once when an asynchronous retrieval completes.
+// It can be called from any thread, including from within CacheRetrieveAsync.
+// The plugin should not implement this function.
+//
+// In:  userData    - value passed to CacheRetrieveAsync
+//      result      - a CacheRetrieveResult
+//      dataSize    - size in bytes of the item (on CACHE_RETRIEVE_OK or CACHE_RETRIEVE_BUFFER_TOO_SMALL)
+using CacheRetrieveCompleteFunc = void (STDCALL *)( void * userData, int result, unsigned long long dataSize );
+
+// CacheRetrieveAsync (Optional for v2)
+//------------------------------------------------------------------------------
+// Start retrieving a previously stored item into memory provided by FASTBuild.
+// FASTBuild may start many retrievals before waiting for any to complete.
+//
+// In:  cacheId     - string name of cache entry
+//      buffer      - memory to write the data to (valid until onComplete is called)
+//      bufferSize  - size in bytes of buffer
+//      onComplete  - function to call when the retrieval completes
+//      userData    - value to pass to onComplete
+// Out: bool        - (return) false if the retrieval could not be started (onComplete will not be called)
+using CacheRetrieveAsyncFunc = bool (STDCALL *)( const char * cacheId,
+                                                 void * buffer,
+                                                 unsigned long long bufferSize,
+                                                 CacheRetrieveCompleteFunc onComplete,
+                                                 void * userData );
+
 } //extern "C"
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,248 @@
+// CachePrefetcher - Look up cache entries for jobs before they are scheduled
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CachePrefetcher.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/CacheMissMemo.h"
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FBuildStats.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
+
+// Core
+#include "Core/Math/Conversions.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Time/Timer.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CachePrefetcher::CachePrefetcher( JobQueue & jobQueue, uint32_t numThreads )
+    : m_JobQueue( jobQueue )
+    , m_ThreadExit( false )
+    , m_Threads( numThreads, false )
+    , m_Pending( 1024, true )
+    , m_NumInFlight( 0 )
+    , m_NumLookups( 0 )
+    , m_NumHits( 0 )
+    , m_NumSkipped( 0 )
+    , m_NumBatches( 0 )
+    , m_PrefetchTimeMS( 0 )
+{
+    ASSERT( numThreads > 0 );
+
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        Thread::ThreadHandle h = Thread::CreateThread( ThreadFuncStatic,
+                                                       "CachePrefetcher",
+                                                       ( 256 * KILOBYTE ),
+                                                       this );
+        ASSERT( h != INVALID_THREAD_HANDLE );
+        m_Threads.Append( h );
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CachePrefetcher::~CachePrefetcher()
+{
+    PROFILE_FUNCTION;
+
+    // Threads hand any remaining jobs back to the JobQueue before they exit
+    AtomicStoreRelaxed( &m_ThreadExit, true );
+    m_WorkSemaphore.Signal( (uint32_t)m_Threads.GetSize() );
+    for ( Thread::ThreadHandle h : m_Threads )
+    {
+        Thread::WaitForThread( h );
+        Thread::CloseHandle( h );
+    }
+
+    ASSERT( m_Pending.IsEmpty() );
+}
+
+// Enqueue
+//------------------------------------------------------------------------------
+void CachePrefetcher::Enqueue( const Array< Job * > & jobs )
+{
+    if ( jobs.IsEmpty() )
+    {
+        return;
+    }
+
+    {
+        MutexHolder mh( m_Mutex );
+        m_Pending.Append( jobs );
+    }
+
+    m_WorkSemaphore.Signal( (uint32_t)jobs.GetSize() );
+}
+
+// GetNumPending
+//------------------------------------------------------------------------------
+uint32_t CachePrefetcher::GetNumPending() const
+{
+    MutexHolder mh( m_Mutex );
+    return (uint32_t)m_Pending.GetSize() + m_NumInFlight;
+}
+
+// GetStats
+//------------------------------------------------------------------------------
+void CachePrefetcher::GetStats( FBuildStats & stats )
+{
+    MutexHolder mh( m_Mutex );
+    stats.m_CachePrefetchLookups    += m_NumLookups;
+    stats.m_CachePrefetchHits       += m_NumHits;
+    stats.m_CachePrefetchSkipped    += m_NumSkipped;
+    stats.m_CachePrefetchBatches    += m_NumBatches;
+    stats.m_CachePrefetchTimeMS     += m_PrefetchTimeMS;
+    m_NumLookups = 0;
+    m_NumHits = 0;
+    m_NumSkipped = 0;
+    m_NumBatches = 0;
+    m_PrefetchTimeMS = 0;
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CachePrefetcher::ThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "CachePrefetcher" );
+
+    static_cast< CachePrefetcher * >( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void CachePrefetcher::ThreadFunc()
+{
+    Array< Job * > jobs( MAX_BATCH_SIZE );
+    Array< Job * > batchJobs( MAX_BATCH_SIZE );
+    Array< ICache::BatchEntry > batchEntries( MAX_BATCH_SIZE );
+
+    for ( ;; )
+    {
+        m_WorkSemaphore.Wait();
+
+        // Take a share of the pending jobs, leaving some for the other threads
+        {
+            MutexHolder mh( m_Mutex );
+            if ( m_Pending.IsEmpty() )
+            {
+                if ( AtomicLoadRelaxed( &m_ThreadExit ) )
+                {
+                    return;
+                }
+                continue;
+            }
+            const size_t numThreads = m_Threads.GetSize();
+            const size_t share = ( m_Pending.GetSize() + numThreads - 1 ) / numThreads;
+            const size_t numToTake = Math::Min( share, (size_t)MAX_BATCH_SIZE );
+            const size_t firstToTake = ( m_Pending.GetSize() - numToTake );
+            jobs.Append( m_Pending.Begin() + firstToTake, m_Pending.End() );
+            m_Pending.SetSize( firstToTake );
+            m_NumInFlight += (uint32_t)numToTake;
+        }
+
+        // NOTE: Several jobs may have been taken for a single signal. Left over
+        // signals cause threads to find an empty queue, which is harmless.
+
+        ProcessBatch( jobs, batchJobs, batchEntries );
+
+        // Complete hits or make misses available for building
+        for ( Job * job : jobs )
+        {
+            m_JobQueue.FinishedPrefetchingJob( job );
+        }
+        jobs.Clear();
+    }
+}
+
+// ProcessBatch
+//------------------------------------------------------------------------------
+void CachePrefetcher::ProcessBatch( Array< Job * > & jobs, Array< Job * > & batchJobs, Array< ICache::BatchEntry > & batchEntries )
+{
+    PROFILE_FUNCTION;
+
+    Timer t;
+
+    // Don't start new lookups if the build is being stopped
+    const bool skip = AtomicLoadRelaxed( &m_ThreadExit ) || FBuild::GetStopBuild();
+
+    // Calculate the cache keys
+    CacheMissMemo * memo = FBuild::Get().GetCacheMissMemo();
+    uint32_t numKnownMisses = 0;
+    if ( skip == false )
+    {
+        for ( Job * job : jobs )
+        {
+            BuildProfilerScope profileScope( job, WorkerThread::GetThreadIndex(), "CachePrefetch" );
+            ObjectNode * node = job->GetNode()->CastTo< ObjectNode >();
+            if ( node->PrepareCachePrefetch( job ) )
+            {
+                // Lookups which missed earlier in the build are not repeated
+                if ( memo && memo->IsKnownMiss( job->GetCacheName() ) )
+                {
+                    node->CompleteCachePrefetch( job, false, nullptr, 0, t );
+                    ++numKnownMisses;
+                    continue;
+                }
+                batchJobs.Append( job );
+                batchEntries.EmplaceBack().m_CacheId = job->GetCacheName();
+            }
+        }
+    }
+
+    // Retrieve all entries together
+    if ( batchEntries.IsEmpty() == false )
+    {
+        const float startMS = t.GetElapsedMS();
+        FBuild::Get().GetCache()->RetrieveBatch( batchEntries );
+
+        // Divide the time between the entries, as they were retrieved together
+        const float timePerEntryMS = ( ( t.GetElapsedMS() - startMS ) / (float)batchEntries.GetSize() );
+        CacheTimings & cacheTimings = FBuild::Get().GetStatsMutable().m_CacheTimings;
+        for ( const ICache::BatchEntry & entry : batchEntries )
+        {
+            cacheTimings.Record( entry.m_Found ? CacheTimings::TRANSFER : CacheTimings::LOOKUP, timePerEntryMS, entry.m_DataSize );
+        }
+    }
+
+    // Extract retrieved entries
+    for ( size_t i = 0; i < batchJobs.GetSize(); ++i )
+    {
+        Job * job = batchJobs[ i ];
+        ICache::BatchEntry & entry = batchEntries[ i ];
+        BuildProfilerScope profileScope( job, WorkerThread::GetThreadIndex(), "CachePrefetch" );
+        if ( ( entry.m_Found == false ) && memo )
+        {
+            memo->RecordMiss( entry.m_CacheId );
+        }
+        job->GetNode()->CastTo< ObjectNode >()->CompleteCachePrefetch( job, entry.m_Found, entry.m_Data, entry.m_DataSize, t );
+    }
+
+    // Update stats
+    {
+        MutexHolder mh( m_Mutex );
+        m_NumInFlight -= (uint32_t)jobs.GetSize();
+        m_NumLookups += (uint32_t)batchJobs.GetSize() + numKnownMisses;
+        m_NumSkipped += (uint32_t)( jobs.GetSize() - batchJobs.GetSize() ) - numKnownMisses;
+        for ( const Job * job : batchJobs )
+        {
+            m_NumHits += ( job->GetCachePrefetchResult() == Job::CACHE_PREFETCH_HIT ) ? 1u : 0u;
+        }
+        m_NumBatches += batchEntries.IsEmpty() ? 0u : 1u;
+        m_PrefetchTimeMS += (uint32_t)t.GetElapsedMS();
+    }
+
+    batchJobs.Clear();
+    batchEntries.Clear();
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,69 @@
+// CachePrefetcher - Look up cache entries for jobs before they are scheduled
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+struct FBuildStats;
+class Job;
+class JobQueue;
+
+// CachePrefetcher
+//  - Jobs whose cache key can be calculated without preprocessing (LightCache)
+//    are diverted here when they become ready to build.
+//  - Prefetch threads calculate the keys for a batch of jobs and retrieve the
+//    entries from the cache together, allowing the cache to overlap requests.
+//    Hits are completed directly, without occupying a build thread.
+//  - Misses are handed to the JobQueue with the key already calculated.
+//------------------------------------------------------------------------------
+class CachePrefetcher
+{
+public:
+    explicit CachePrefetcher( JobQueue & jobQueue, uint32_t numThreads );
+    ~CachePrefetcher();
+
+    // Queue a batch of jobs for prefetching. Must be called from the main thread.
+    void Enqueue( const Array< Job * > & jobs );
+
+    // Number of jobs waiting for or being prefetched
+    uint32_t GetNumPending() const;
+
+    // Accumulate prefetch stats. Must be called from the main thread.
+    void GetStats( FBuildStats & stats );
+
+private:
+    enum : uint32_t { MAX_BATCH_SIZE = 32 };
+
+    static uint32_t ThreadFuncStatic( void * param );
+    void ThreadFunc();
+    void ProcessBatch( Array< Job * > & jobs, Array< Job * > & batchJobs, Array< ICache::BatchEntry > & batchEntries );
+
+    JobQueue &                  m_JobQueue;
+    volatile bool               m_ThreadExit;
+    Array< Thread::ThreadHandle > m_Threads;
+    Semaphore                   m_WorkSemaphore;        // Signalled when a job is queued (or to exit)
+
+    // Protected by m_Mutex
+    mutable Mutex               m_Mutex;
+    Array< Job * >              m_Pending;
+    uint32_t                    m_NumInFlight;
+    uint32_t                    m_NumLookups;           // Jobs for which a cache key was calculated
+    uint32_t                    m_NumHits;
+    uint32_t                    m_NumSkipped;           // Jobs which could not be prefetched
+    uint32_t                    m_NumBatches;           // Batched requests made to the cache
+    uint32_t                    m_PrefetchTimeMS;       // Time spent on prefetch threads
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,261 @@
+// CachePublisher - Compress and publish cache entries on background threads
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CachePublisher.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Graph/Node.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FBuildStats.h"
+
+// Core
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Time/Timer.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CachePublisher::CachePublisher( ICache * cache,
+                                uint32_t numThreads,
+                                int32_t compressionLevel,
+                                bool verbose,
+                                uint64_t maxPendingBytes )
+    : m_Cache( cache )
+    , m_CompressionLevel( compressionLevel )
+    , m_Verbose( verbose )
+    , m_ThreadExit( false )
+    , m_MaxPendingBytes( maxPendingBytes )
+    , m_Threads( numThreads, false )
+    , m_Pending( 256, true )
+    , m_Completed( 1024, true )
+    , m_PendingBytes( 0 )
+    , m_NumInFlight( 0 )
+    , m_MaxQueueDepth( 0 )
+    , m_PublishedBytes( 0 )
+    , m_PublishTimeMS( 0 )
+    , m_StallTimeMS( 0 )
+{
+    ASSERT( cache );
+    ASSERT( numThreads > 0 );
+
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        Thread::ThreadHandle h = Thread::CreateThread( ThreadFuncStatic,
+                                                       "CachePublisher",
+                                                       ( 64 * KILOBYTE ),
+                                                       this );
+        ASSERT( h != INVALID_THREAD_HANDLE );
+        m_Threads.Append( h );
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CachePublisher::~CachePublisher()
+{
+    PROFILE_FUNCTION;
+
+    // Threads drain any remaining items before they exit
+    AtomicStoreRelaxed( &m_ThreadExit, true );
+    m_WorkSemaphore.Signal( (uint32_t)m_Threads.GetSize() );
+    for ( Thread::ThreadHandle h : m_Threads )
+    {
+        Thread::WaitForThread( h );
+        Thread::CloseHandle( h );
+    }
+
+    ASSERT( m_Pending.IsEmpty() );
+}
+
+// Enqueue
+//------------------------------------------------------------------------------
+void CachePublisher::Enqueue( Node * node, const AString & cacheId, void * data, size_t dataSize )
+{
+    PROFILE_FUNCTION;
+
+    Timer t;
+
+    m_Mutex.Lock();
+
+    // Apply back-pressure if too much data is waiting, but always accept at
+    // least one item so oversized entries can't wait forever
+    bool stalled = false;
+    while ( ( m_PendingBytes > 0 ) && ( ( m_PendingBytes + dataSize ) > m_MaxPendingBytes ) )
+    {
+        stalled = true;
+        m_Mutex.Unlock();
+        m_ItemDoneSemaphore.Wait( 100 );
+        m_Mutex.Lock();
+    }
+    if ( stalled )
+    {
+        m_StallTimeMS += (uint32_t)t.GetElapsedMS();
+    }
+
+    PendingItem & item = m_Pending.EmplaceBack();
+    item.m_Node = node;
+    item.m_CacheId = cacheId;
+    item.m_Data = data;
+    item.m_DataSize = dataSize;
+    m_PendingBytes += dataSize;
+    m_MaxQueueDepth = Math::Max( m_MaxQueueDepth, (uint32_t)m_Pending.GetSize() );
+
+    m_Mutex.Unlock();
+
+    m_WorkSemaphore.Signal();
+}
+
+// Flush
+//------------------------------------------------------------------------------
+void CachePublisher::Flush( FBuildStats & stats )
+{
+    PROFILE_FUNCTION;
+
+    Timer t;
+
+    // Wait for queue to drain
+    for ( ;; )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            if ( m_Pending.IsEmpty() && ( m_NumInFlight == 0 ) )
+            {
+                break;
+            }
+        }
+        m_ItemDoneSemaphore.Wait( 100 );
+    }
+
+    // Apply results to nodes now that they can't be modified concurrently
+    MutexHolder mh( m_Mutex );
+    for ( const CompletedItem & item : m_Completed )
+    {
+        if ( item.m_Success )
+        {
+            item.m_Node->SetStatFlag( Node::STATS_CACHE_STORE );
+            ++stats.m_CachePublishCount;
+        }
+        else
+        {
+            ++stats.m_CachePublishFailures;
+        }
+        item.m_Node->AddCachingTime( item.m_CachingTimeMS );
+    }
+    m_Completed.Clear();
+
+    stats.m_CachePublishBytes           += m_PublishedBytes;
+    stats.m_CachePublishTimeMS          += m_PublishTimeMS;
+    stats.m_CachePublishStallTimeMS     += m_StallTimeMS;
+    stats.m_CachePublishFlushTimeMS     += (uint32_t)t.GetElapsedMS();
+    stats.m_CachePublishMaxQueueDepth   = Math::Max( stats.m_CachePublishMaxQueueDepth, m_MaxQueueDepth );
+    m_PublishedBytes = 0;
+    m_PublishTimeMS = 0;
+    m_StallTimeMS = 0;
+    m_MaxQueueDepth = 0;
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CachePublisher::ThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "CachePublisher" );
+
+    static_cast< CachePublisher * >( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void CachePublisher::ThreadFunc()
+{
+    for ( ;; )
+    {
+        m_WorkSemaphore.Wait();
+
+        PendingItem item;
+        {
+            MutexHolder mh( m_Mutex );
+            if ( m_Pending.IsEmpty() )
+            {
+                if ( AtomicLoadRelaxed( &m_ThreadExit ) )
+                {
+                    return;
+                }
+                continue;
+            }
+            item = m_Pending[ 0 ];
+            m_Pending.PopFront();
+            ++m_NumInFlight;
+        }
+
+        PublishItem( item.m_Node, item.m_CacheId, item.m_Data, item.m_DataSize );
+        FREE( item.m_Data );
+
+        {
+            MutexHolder mh( m_Mutex );
+            m_PendingBytes -= item.m_DataSize;
+            --m_NumInFlight;
+        }
+        m_ItemDoneSemaphore.Signal();
+    }
+}
+
+// PublishItem
+//------------------------------------------------------------------------------
+void CachePublisher::PublishItem( Node * node, const AString & cacheId, const void * data, size_t dataSize )
+{
+    PROFILE_FUNCTION;
+
+    Timer t;
+
+    Compressor c;
+    c.CompressChunked( data, dataSize, m_CompressionLevel, m_Cache->GetCompressionDictionary() );
+    const size_t compressedSize = c.GetResultSize();
+    const float compressTimeMS = t.GetElapsedMS();
+    const uint32_t compressTime( (uint32_t)compressTimeMS );
+
+    const bool success = m_Cache->Publish( cacheId, c.GetResult(), compressedSize );
+    const float cachingTimeMS = t.GetElapsedMS();
+    const uint32_t cachingTime( (uint32_t)cachingTimeMS );
+
+    CacheTimings & cacheTimings = FBuild::Get().GetStatsMutable().m_CacheTimings;
+    cacheTimings.Record( CacheTimings::COMPRESS, compressTimeMS, dataSize );
+    cacheTimings.Record( CacheTimings::PUBLISH, cachingTimeMS - compressTimeMS, compressedSize );
+
+    // Output
+    if ( m_Verbose )
+    {
+        if ( success )
+        {
+            FLOG_OUTPUT( "Obj: %s\n"
+                         " - Cache Store: %u ms (Store: %u ms - Compress: %u ms) (Compressed: %zu - Uncompressed: %zu) '%s'\n",
+                         node->GetName().Get(), cachingTime, ( cachingTime - compressTime ), compressTime, compressedSize, dataSize, cacheId.Get() );
+        }
+        else
+        {
+            FLOG_OUTPUT( "Obj: %s\n"
+                         " - Cache Store Fail: %u ms '%s'\n",
+                         node->GetName().Get(), cachingTime, cacheId.Get() );
+        }
+    }
+
+    MutexHolder mh( m_Mutex );
+    CompletedItem & item = m_Completed.EmplaceBack();
+    item.m_Node = node;
+    item.m_CachingTimeMS = cachingTime;
+    item.m_Success = success;
+    if ( success )
+    {
+        m_PublishedBytes += compressedSize;
+    }
+    m_PublishTimeMS += cachingTime;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+// CachePublisher - Compress and publish cache entries on background threads
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+struct FBuildStats;
+class ICache;
+class Node;
+
+// CachePublisher
+//------------------------------------------------------------------------------
+class CachePublisher
+{
+public:
+    enum : uint64_t { DEFAULT_MAX_PENDING_BYTES = ( 256 * 1024 * 1024 ) };
+
+    explicit CachePublisher( ICache * cache,
+                             uint32_t numThreads,
+                             int32_t compressionLevel,
+                             bool verbose,
+                             uint64_t maxPendingBytes = DEFAULT_MAX_PENDING_BYTES );
+    ~CachePublisher();
+
+    // Queue uncompressed MultiBuffer data for publication. Takes ownership of
+    // the memory (which must be allocated with ALLOC). Blocks the calling thread
+    // if too much data is already waiting to be published.
+    void Enqueue( Node * node, const AString & cacheId, void * data, size_t dataSize );
+
+    // Wait for all queued entries to be published and apply results to the
+    // nodes and build stats. Must be called from the main thread.
+    void Flush( FBuildStats & stats );
+
+private:
+    static uint32_t ThreadFuncStatic( void * param );
+    void ThreadFunc();
+    void PublishItem( Node * node, const AString & cacheId, const void * data, size_t dataSize );
+
+    // An entry waiting to be published
+    class PendingItem
+    {
+    public:
+        Node *      m_Node;
+        AString     m_CacheId;
+        void *      m_Data;
+        size_t      m_DataSize;
+    };
+
+    // The outcome of a publish, applied to the node by the main thread
+    class CompletedItem
+    {
+    public:
+        Node *      m_Node;
+        uint32_t    m_CachingTimeMS;
+        bool        m_Success;
+    };
+
+    ICache *                    m_Cache;
+    int32_t                     m_CompressionLevel;
+    bool                        m_Verbose;
+    volatile bool               m_ThreadExit;
+    uint64_t                    m_MaxPendingBytes;
+    Array< Thread::ThreadHandle > m_Threads;
+    Semaphore                   m_WorkSemaphore;        // Signalled when an item is queued (or to exit)
+    Semaphore                   m_ItemDoneSemaphore;    // Signalled when an item is published
+
+    // Protected by m_Mutex
+    Mutex                       m_Mutex;
+    Array< PendingItem >        m_Pending;
+    Array< CompletedItem >      m_Completed;
+    uint64_t                    m_PendingBytes;         // Includes items in flight
+    uint32_t                    m_NumInFlight;
+    uint32_t                    m_MaxQueueDepth;
+    uint64_t                    m_PublishedBytes;       // Compressed bytes successfully published
+    uint32_t                    m_PublishTimeMS;        // Time spent compressing and publishing
+    uint32_t                    m_StallTimeMS;          // Time callers were blocked by back-pressure
+};
+
+//------------------------------------------------------------------------------
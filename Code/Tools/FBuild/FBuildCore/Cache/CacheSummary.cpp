@@ -0,0 +1,158 @@
+// CacheSummary - Compact record of the entries in a Cache
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheSummary.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/xxHash.h"
+
+// system
+#include <string.h>
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // File format: magic, version, uint32_t indexFileNameLength, char indexFileName[ indexFileNameLength ],
+    //              uint32_t numWords, uint64_t words[ numWords ]
+    const uint32_t  kSummaryFileMagic   = 'F' | ( 'B' << 8 ) | ( 'C' << 16 ) | ( 'S' << 24 );
+    const uint32_t  kSummaryFileVersion = 1;
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheSummary::CacheSummary()
+    : m_Bits( 0, true )
+    , m_BitMask( 0 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheSummary::~CacheSummary() = default;
+
+// Init
+//------------------------------------------------------------------------------
+void CacheSummary::Init( uint32_t expectedNumKeys )
+{
+    // Use a power of 2 number of bits, so positions can be masked
+    uint64_t numBits = MIN_NUM_BITS;
+    while ( ( numBits < ( (uint64_t)expectedNumKeys * BITS_PER_KEY ) ) && ( numBits < MAX_NUM_BITS ) )
+    {
+        numBits *= 2;
+    }
+
+    m_Bits.Clear();
+    m_Bits.SetSize( (size_t)( numBits / 64 ) );
+    memset( m_Bits.Begin(), 0, m_Bits.GetSize() * sizeof( uint64_t ) );
+    m_BitMask = ( numBits - 1 );
+    m_IndexFileName.Clear();
+}
+
+// Clear
+//------------------------------------------------------------------------------
+void CacheSummary::Clear()
+{
+    m_Bits.Clear();
+    m_BitMask = 0;
+    m_IndexFileName.Clear();
+}
+
+// Add
+//------------------------------------------------------------------------------
+void CacheSummary::Add( const char * cacheId, uint32_t cacheIdLength )
+{
+    ASSERT( IsValid() );
+
+    // Derive the positions from a single hash (double hashing)
+    const uint64_t hash = xxHash::Calc64( cacheId, cacheIdLength );
+    const uint64_t h1 = ( hash & 0xFFFFFFFF );
+    const uint64_t h2 = ( ( hash >> 32 ) | 1 );
+    for ( uint64_t i = 0; i < NUM_HASHES; ++i )
+    {
+        const uint64_t bit = ( ( h1 + ( i * h2 ) ) & m_BitMask );
+        m_Bits[ (size_t)( bit / 64 ) ] |= ( (uint64_t)1 << ( bit % 64 ) );
+    }
+}
+
+// MayContain
+//------------------------------------------------------------------------------
+bool CacheSummary::MayContain( const char * cacheId, uint32_t cacheIdLength ) const
+{
+    ASSERT( IsValid() );
+
+    const uint64_t hash = xxHash::Calc64( cacheId, cacheIdLength );
+    const uint64_t h1 = ( hash & 0xFFFFFFFF );
+    const uint64_t h2 = ( ( hash >> 32 ) | 1 );
+    for ( uint64_t i = 0; i < NUM_HASHES; ++i )
+    {
+        const uint64_t bit = ( ( h1 + ( i * h2 ) ) & m_BitMask );
+        if ( ( m_Bits[ (size_t)( bit / 64 ) ] & ( (uint64_t)1 << ( bit % 64 ) ) ) == 0 )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Save
+//------------------------------------------------------------------------------
+void CacheSummary::Save( MemoryStream & stream ) const
+{
+    ASSERT( IsValid() );
+
+    stream.Write( kSummaryFileMagic );
+    stream.Write( kSummaryFileVersion );
+    stream.Write( (uint32_t)m_IndexFileName.GetLength() );
+    stream.Write( m_IndexFileName.Get(), m_IndexFileName.GetLength() );
+    stream.Write( (uint32_t)m_Bits.GetSize() );
+    stream.Write( m_Bits.Begin(), m_Bits.GetSize() * sizeof( uint64_t ) );
+}
+
+// Load
+//------------------------------------------------------------------------------
+bool CacheSummary::Load( const void * data, size_t dataSize )
+{
+    const char * pos = static_cast< const char * >( data );
+    const char * const end = ( pos + dataSize );
+
+    // Header
+    uint32_t header[ 3 ]; // magic, version, indexFileNameLength
+    if ( (size_t)( end - pos ) < sizeof( header ) )
+    {
+        return false;
+    }
+    memcpy( header, pos, sizeof( header ) );
+    pos += sizeof( header );
+    if ( ( header[ 0 ] != kSummaryFileMagic ) ||
+         ( header[ 1 ] != kSummaryFileVersion ) ||
+         ( (size_t)( end - pos ) < ( header[ 2 ] + sizeof( uint32_t ) ) ) )
+    {
+        return false;
+    }
+    AString indexFileName;
+    indexFileName.Assign( pos, pos + header[ 2 ] );
+    pos += header[ 2 ];
+
+    // Bits (a power of 2 number of words)
+    uint32_t numWords;
+    memcpy( &numWords, pos, sizeof( numWords ) );
+    pos += sizeof( numWords );
+    if ( ( numWords == 0 ) ||
+         ( ( numWords & ( numWords - 1 ) ) != 0 ) ||
+         ( (size_t)( end - pos ) != ( (size_t)numWords * sizeof( uint64_t ) ) ) )
+    {
+        return false;
+    }
+    m_Bits.SetSize( numWords );
+    memcpy( m_Bits.Begin(), pos, numWords * sizeof( uint64_t ) );
+    m_BitMask = ( ( (uint64_t)numWords * 64 ) - 1 );
+    m_IndexFileName = indexFileName;
+    return true;
+}
+
+//------------------------------------------------------------------------------
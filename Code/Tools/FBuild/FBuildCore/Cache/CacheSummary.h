@@ -0,0 +1,59 @@
+// CacheSummary - Compact record of the entries in a Cache
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class MemoryStream;
+
+// CacheSummary
+//  - A bloom filter of the keys of the entries in a cache. Keys which were added
+//    are always reported as possibly present, while keys which were not are
+//    almost always (~99%) reported as absent.
+//  - A summary is written with each index file holding the whole index, and
+//    records the name of that file. Entries in other (later) index files must be
+//    added by the reader.
+//------------------------------------------------------------------------------
+class CacheSummary
+{
+public:
+    explicit CacheSummary();
+    ~CacheSummary();
+
+    // Prepare an empty summary, sized for the expected number of keys
+    void Init( uint32_t expectedNumKeys );
+    void Clear();
+    inline bool IsValid() const { return ( m_Bits.IsEmpty() == false ); }
+
+    void Add( const char * cacheId, uint32_t cacheIdLength );
+    bool MayContain( const char * cacheId, uint32_t cacheIdLength ) const;
+
+    // Index file whose entries (and those of the files it replaced) were added
+    inline const AString &  GetIndexFileName() const                        { return m_IndexFileName; }
+    inline void             SetIndexFileName( const AString & fileName )    { m_IndexFileName = fileName; }
+
+    void Save( MemoryStream & stream ) const;
+    bool Load( const void * data, size_t dataSize );
+
+private:
+    enum : uint32_t
+    {
+        BITS_PER_KEY    = 10,
+        NUM_HASHES      = 7,
+        MIN_NUM_BITS    = ( 64 * 1024 ),
+        MAX_NUM_BITS    = 0x80000000,
+    };
+
+    Array< uint64_t >   m_Bits;
+    uint64_t            m_BitMask;
+    AString             m_IndexFileName;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,178 @@
+// CacheTimings - Timings of cache operations
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheTimings.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Strings/AString.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheTimings::CacheTimings() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheTimings::~CacheTimings() = default;
+
+// Record
+//------------------------------------------------------------------------------
+void CacheTimings::Record( Operation op, float timeMS, uint64_t bytes )
+{
+    ASSERT( op < NUM_OPERATIONS );
+
+    const uint64_t timeUS = ( timeMS > 0.0f ) ? (uint64_t)( (double)timeMS * 1000.0 ) : 0;
+
+    // Find bucket (first bucket covers < 64us, each later bucket doubles)
+    uint32_t bucket = 0;
+    while ( ( bucket < ( NUM_BUCKETS - 1 ) ) && ( timeUS >= GetBucketLimitUS( bucket ) ) )
+    {
+        ++bucket;
+    }
+
+    MutexHolder mh( m_Mutex );
+    OperationStats & stats = m_Stats[ op ];
+    stats.m_Count++;
+    stats.m_TotalTimeUS += timeUS;
+    stats.m_MaxTimeUS = Math::Max( stats.m_MaxTimeUS, timeUS );
+    stats.m_Bytes += bytes;
+    stats.m_Buckets[ bucket ]++;
+}
+
+// GetStats
+//------------------------------------------------------------------------------
+void CacheTimings::GetStats( Operation op, OperationStats & outStats ) const
+{
+    ASSERT( op < NUM_OPERATIONS );
+
+    MutexHolder mh( m_Mutex );
+    outStats = m_Stats[ op ];
+}
+
+// HasStats
+//------------------------------------------------------------------------------
+bool CacheTimings::HasStats() const
+{
+    MutexHolder mh( m_Mutex );
+    for ( const OperationStats & stats : m_Stats )
+    {
+        if ( stats.m_Count > 0 )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// GetOperationName
+//------------------------------------------------------------------------------
+/*static*/ const char * CacheTimings::GetOperationName( Operation op )
+{
+    switch ( op )
+    {
+        case LOOKUP:        return "Lookup";
+        case TRANSFER:      return "Transfer";
+        case DECOMPRESS:    return "Decompress";
+        case WRITE:         return "Write";
+        case COMPRESS:      return "Compress";
+        case PUBLISH:       return "Publish";
+        case NUM_OPERATIONS: break;
+    }
+    ASSERT( false );
+    return "";
+}
+
+// GetBucketLimitUS
+//------------------------------------------------------------------------------
+/*static*/ uint64_t CacheTimings::GetBucketLimitUS( uint32_t bucket )
+{
+    ASSERT( bucket < NUM_BUCKETS );
+    return ( bucket < ( NUM_BUCKETS - 1 ) ) ? ( (uint64_t)64 << bucket ) : (uint64_t)-1;
+}
+
+// GetBucketName
+//------------------------------------------------------------------------------
+/*static*/ void CacheTimings::GetBucketName( uint32_t bucket, AString & outName )
+{
+    // Last bucket is unbounded, so is named by its lower bound
+    const bool last = ( bucket == ( NUM_BUCKETS - 1 ) );
+    const uint64_t limitUS = last ? GetBucketLimitUS( bucket - 1 ) : GetBucketLimitUS( bucket );
+    const char * prefix = last ? ">=" : "<";
+    if ( limitUS < 1000 )
+    {
+        outName.Format( "%s %uus", prefix, (uint32_t)limitUS );
+    }
+    else if ( limitUS < 1000000 )
+    {
+        outName.Format( "%s %.1fms", prefix, (double)limitUS / 1000.0 );
+    }
+    else
+    {
+        outName.Format( "%s %.1fs", prefix, (double)limitUS / 1000000.0 );
+    }
+}
+
+// GetPercentileMS
+//------------------------------------------------------------------------------
+/*static*/ float CacheTimings::GetPercentileMS( const OperationStats & stats, uint32_t percentile )
+{
+    ASSERT( percentile <= 100 );
+
+    if ( stats.m_Count == 0 )
+    {
+        return 0.0f;
+    }
+
+    // Find the bucket containing the percentile and report its upper bound
+    // (which can't exceed the slowest operation)
+    const uint64_t target = Math::Max< uint64_t >( ( (uint64_t)stats.m_Count * percentile + 99 ) / 100, 1 );
+    uint64_t total = 0;
+    for ( uint32_t i = 0; i < NUM_BUCKETS; ++i )
+    {
+        total += stats.m_Buckets[ i ];
+        if ( total >= target )
+        {
+            const uint64_t limitUS = Math::Min( GetBucketLimitUS( i ), stats.m_MaxTimeUS );
+            return (float)( (double)limitUS / 1000.0 );
+        }
+    }
+    return (float)( (double)stats.m_MaxTimeUS / 1000.0 );
+}
+
+// OutputToMonitor
+//------------------------------------------------------------------------------
+void CacheTimings::OutputToMonitor() const
+{
+    if ( FLog::IsMonitorEnabled() == false )
+    {
+        return;
+    }
+
+    // CACHE_STATS <operation> <count> <totalMS> <bytes> <p50MS> <p90MS> <p99MS> <maxMS>
+    for ( uint32_t i = 0; i < NUM_OPERATIONS; ++i )
+    {
+        OperationStats stats;
+        GetStats( (Operation)i, stats );
+        if ( stats.m_Count == 0 )
+        {
+            continue;
+        }
+        FLOG_MONITOR( "CACHE_STATS %s %u %.3f %" PRIu64 " %.3f %.3f %.3f %.3f\n",
+                      GetOperationName( (Operation)i ),
+                      stats.m_Count,
+                      (double)stats.m_TotalTimeUS / 1000.0,
+                      stats.m_Bytes,
+                      (double)GetPercentileMS( stats, 50 ),
+                      (double)GetPercentileMS( stats, 90 ),
+                      (double)GetPercentileMS( stats, 99 ),
+                      (double)stats.m_MaxTimeUS / 1000.0 );
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,74 @@
+// CacheTimings - Timings of cache operations
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+
+// CacheTimings
+//  - Records the duration (and size) of each cache operation in a histogram,
+//    showing where cache time goes (a slow cache vs slow compression for example).
+//  - Lookups which miss and lookups which hit (and transfer the entry) are
+//    recorded separately. Batched lookups are divided evenly between entries.
+//------------------------------------------------------------------------------
+class CacheTimings
+{
+public:
+    enum Operation : uint32_t
+    {
+        LOOKUP,         // Retrieve which missed
+        TRANSFER,       // Retrieve which hit
+        DECOMPRESS,
+        WRITE,          // Writing retrieved files
+        COMPRESS,
+        PUBLISH,
+
+        NUM_OPERATIONS
+    };
+
+    // Durations are bucketed by powers of 2: < 64us, < 128us ... >= ~16s
+    enum : uint32_t { NUM_BUCKETS = 20 };
+
+    struct OperationStats
+    {
+        uint32_t    m_Count = 0;
+        uint64_t    m_TotalTimeUS = 0;
+        uint64_t    m_MaxTimeUS = 0;
+        uint64_t    m_Bytes = 0;
+        uint32_t    m_Buckets[ NUM_BUCKETS ] = {};
+    };
+
+    explicit CacheTimings();
+    ~CacheTimings();
+
+    // Record an operation (thread safe)
+    void Record( Operation op, float timeMS, uint64_t bytes = 0 );
+
+    // Get a consistent copy of the stats for an operation (thread safe)
+    void GetStats( Operation op, OperationStats & outStats ) const;
+
+    bool HasStats() const;
+
+    static const char * GetOperationName( Operation op );
+    static uint64_t     GetBucketLimitUS( uint32_t bucket ); // Upper bound of bucket (exclusive)
+    static void         GetBucketName( uint32_t bucket, AString & outName );
+
+    // Estimate a percentile (0-100) from the histogram (upper bound of bucket)
+    static float        GetPercentileMS( const OperationStats & stats, uint32_t percentile );
+
+    // Write the stats to the monitor log
+    void                OutputToMonitor() const;
+
+private:
+    mutable Mutex   m_Mutex;
+    OperationStats  m_Stats[ NUM_OPERATIONS ];
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,648 @@
+// HTTPCache - Cache stored on an HTTP server
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "HTTPCache.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Network/TCPStream.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Tracing/Tracing.h"
+
+// system
+#include <stdlib.h>
+#include <string.h>
+
+// HTTPCache::Connection
+//------------------------------------------------------------------------------
+class HTTPCache::Connection
+{
+public:
+    // Read a line of the response header (without the line ending)
+    bool ReadLine( AString & outLine );
+
+    // Read part of the response body. Data is discarded if buffer is null.
+    bool Read( void * buffer, size_t size );
+
+    TCPStream   m_Stream;
+    size_t      m_BufferStart = 0;
+    size_t      m_BufferEnd = 0;
+    char        m_Buffer[ 16 * 1024 ];
+};
+
+// ReadLine
+//------------------------------------------------------------------------------
+bool HTTPCache::Connection::ReadLine( AString & outLine )
+{
+    for ( ;; )
+    {
+        // Complete line available?
+        const char * const start = ( m_Buffer + m_BufferStart );
+        const char * const end = ( m_Buffer + m_BufferEnd );
+        const char * const newLine = static_cast< const char * >( memchr( start, '\n', (size_t)( end - start ) ) );
+        if ( newLine )
+        {
+            const char * lineEnd = newLine;
+            if ( ( lineEnd > start ) && ( lineEnd[ -1 ] == '\r' ) )
+            {
+                --lineEnd;
+            }
+            outLine.Assign( start, lineEnd );
+            m_BufferStart = (size_t)( newLine + 1 - m_Buffer );
+            return true;
+        }
+
+        // Make room for more data
+        if ( m_BufferStart > 0 )
+        {
+            memmove( m_Buffer, start, (size_t)( end - start ) );
+            m_BufferEnd -= m_BufferStart;
+            m_BufferStart = 0;
+        }
+        if ( m_BufferEnd == sizeof( m_Buffer ) )
+        {
+            return false; // Line too long
+        }
+
+        size_t received = 0;
+        if ( m_Stream.Receive( m_Buffer + m_BufferEnd, sizeof( m_Buffer ) - m_BufferEnd, received, TRANSFER_TIMEOUT_MS ) == false )
+        {
+            return false;
+        }
+        m_BufferEnd += received;
+    }
+}
+
+// Read
+//------------------------------------------------------------------------------
+bool HTTPCache::Connection::Read( void * buffer, size_t size )
+{
+    char * dst = static_cast< char * >( buffer );
+
+    // Use buffered data first
+    const size_t buffered = Math::Min( size, ( m_BufferEnd - m_BufferStart ) );
+    if ( dst )
+    {
+        memcpy( dst, m_Buffer + m_BufferStart, buffered );
+        dst += buffered;
+    }
+    m_BufferStart += buffered;
+    size -= buffered;
+
+    // Receive the remainder directly
+    while ( size > 0 )
+    {
+        char discard[ 4096 ];
+        size_t received = 0;
+        if ( m_Stream.Receive( dst ? dst : discard, dst ? size : Math::Min( size, sizeof( discard ) ), received, TRANSFER_TIMEOUT_MS ) == false )
+        {
+            return false;
+        }
+        if ( dst )
+        {
+            dst += received;
+        }
+        size -= received;
+    }
+    return true;
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+HTTPCache::HTTPCache()
+    : m_Port( 80 )
+    , m_Verbose( false )
+    , m_IdleConnections( MAX_IDLE_CONNECTIONS, false )
+    , m_Batches( 8, true )
+    , m_ThreadExit( false )
+    , m_Threads( NUM_REQUEST_THREADS, false )
+    , m_NumRequests( 0 )
+    , m_NumConnections( 0 )
+    , m_NumRetries( 0 )
+    , m_NumFailures( 0 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+HTTPCache::~HTTPCache()
+{
+    ASSERT( m_Threads.IsEmpty() ); // Shutdown not called?
+    for ( Connection * connection : m_IdleConnections )
+    {
+        FDELETE connection;
+    }
+}
+
+// IsHTTPCachePath
+//------------------------------------------------------------------------------
+/*static*/ bool HTTPCache::IsHTTPCachePath( const AString & cachePath )
+{
+    return cachePath.BeginsWithI( "http://" );
+}
+
+// Init
+//------------------------------------------------------------------------------
+/*virtual*/ bool HTTPCache::Init( const AString & cachePath,
+                                  const AString & /*cachePathMountPoint*/,
+                                  bool /*cacheRead*/,
+                                  bool /*cacheWrite*/,
+                                  bool cacheVerbose,
+                                  const AString & /*pluginDLLConfig*/ )
+{
+    PROFILE_FUNCTION;
+
+    m_Verbose = cacheVerbose;
+
+    if ( ParseURL( cachePath ) == false )
+    {
+        FLOG_WARN( "Cache url is invalid - Caching disabled (Path '%s')", cachePath.Get() );
+        return false;
+    }
+
+    // Check the server is reachable (keeping the connection for later use)
+    bool reused = false;
+    Connection * connection = AcquireConnection( reused );
+    if ( connection == nullptr )
+    {
+        FLOG_WARN( "Cache server inaccessible - Caching disabled (Path '%s')", cachePath.Get() );
+        return false;
+    }
+    ReleaseConnection( connection, true );
+
+    // Create threads to issue batched requests
+    for ( uint32_t i = 0; i < NUM_REQUEST_THREADS; ++i )
+    {
+        Thread::ThreadHandle h = Thread::CreateThread( ThreadFuncStatic, "HTTPCache", ( 64 * KILOBYTE ), this );
+        ASSERT( h != INVALID_THREAD_HANDLE );
+        m_Threads.Append( h );
+    }
+
+    return true;
+}
+
+// Shutdown
+//------------------------------------------------------------------------------
+/*virtual*/ void HTTPCache::Shutdown()
+{
+    PROFILE_FUNCTION;
+
+    AtomicStoreRelaxed( &m_ThreadExit, true );
+    m_WorkSemaphore.Signal( (uint32_t)m_Threads.GetSize() );
+    for ( Thread::ThreadHandle h : m_Threads )
+    {
+        Thread::WaitForThread( h );
+        Thread::CloseHandle( h );
+    }
+    m_Threads.Clear();
+
+    if ( m_Verbose )
+    {
+        FLOG_OUTPUT( "HTTPCache:\n"
+                     " - Requests    : %u (Failed: %u - Retried: %u)\n"
+                     " - Connections : %u\n",
+                     m_NumRequests, m_NumFailures, m_NumRetries,
+                     m_NumConnections );
+    }
+}
+
+// Publish
+//------------------------------------------------------------------------------
+/*virtual*/ bool HTTPCache::Publish( const AString & cacheId, const void * data, size_t dataSize )
+{
+    PROFILE_FUNCTION;
+
+    uint32_t status = 0;
+    if ( Request( "PUT", cacheId, data, dataSize, status, nullptr, nullptr ) == false )
+    {
+        return false;
+    }
+    return ( ( status >= 200 ) && ( status < 300 ) );
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+/*virtual*/ bool HTTPCache::Retrieve( const AString & cacheId, void * & data, size_t & dataSize )
+{
+    PROFILE_FUNCTION;
+
+    uint32_t status = 0;
+    if ( Request( "GET", cacheId, nullptr, 0, status, &data, &dataSize ) == false )
+    {
+        return false;
+    }
+    return ( status == 200 );
+}
+
+// FreeMemory
+//------------------------------------------------------------------------------
+/*virtual*/ void HTTPCache::FreeMemory( void * data, size_t /*dataSize*/ )
+{
+    FREE( data );
+}
+
+// OutputInfo
+//------------------------------------------------------------------------------
+/*virtual*/ bool HTTPCache::OutputInfo( bool /*showProgress*/ )
+{
+    OUTPUT( "HTTPCache does not support OutputInfo.\n" );
+    return false;
+}
+
+// Trim
+//------------------------------------------------------------------------------
+/*virtual*/ bool HTTPCache::Trim( bool /*showProgress*/, uint32_t /*sizeMiB*/ )
+{
+    OUTPUT( "HTTPCache does not support Trim. The server manages its own storage.\n" );
+    return false;
+}
+
+// QueryBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void HTTPCache::QueryBatch( Array< BatchEntry > & entries )
+{
+    PROFILE_FUNCTION;
+
+    Batch batch;
+    batch.m_Entries = &entries;
+    batch.m_Retrieve = false;
+    ProcessBatch( batch );
+}
+
+// RetrieveBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void HTTPCache::RetrieveBatch( Array< BatchEntry > & entries )
+{
+    PROFILE_FUNCTION;
+
+    Batch batch;
+    batch.m_Entries = &entries;
+    batch.m_Retrieve = true;
+    ProcessBatch( batch );
+}
+
+// ParseURL
+//------------------------------------------------------------------------------
+bool HTTPCache::ParseURL( const AString & url )
+{
+    if ( IsHTTPCachePath( url ) == false )
+    {
+        return false;
+    }
+
+    // http://host[:port][/path]
+    const char * const hostStart = ( url.Get() + 7 );
+    const char * pathStart = url.Find( '/', hostStart );
+    if ( pathStart == nullptr )
+    {
+        pathStart = url.GetEnd();
+    }
+    const char * hostEnd = url.Find( ':', hostStart, pathStart );
+    if ( hostEnd )
+    {
+        const char * const portStart = ( hostEnd + 1 );
+        char * portEnd = nullptr;
+        const unsigned long port = strtoul( portStart, &portEnd, 10 );
+        if ( ( portEnd != pathStart ) || ( port == 0 ) || ( port > 65535 ) )
+        {
+            return false;
+        }
+        m_Port = (uint16_t)port;
+    }
+    else
+    {
+        hostEnd = pathStart;
+    }
+    if ( hostEnd == hostStart )
+    {
+        return false;
+    }
+    m_Host.Assign( hostStart, hostEnd );
+    m_HostHeader.Assign( hostStart, pathStart );
+
+    m_BasePath = pathStart;
+    if ( m_BasePath.EndsWith( '/' ) )
+    {
+        m_BasePath.Trim( 0, 1 );
+    }
+    return true;
+}
+
+// Request
+//------------------------------------------------------------------------------
+bool HTTPCache::Request( const char * method,
+                         const AString & cacheId,
+                         const void * body,
+                         size_t bodySize,
+                         uint32_t & outStatus,
+                         void ** outData,
+                         size_t * outDataSize )
+{
+    PROFILE_FUNCTION;
+
+    for ( ;; )
+    {
+        bool reused = false;
+        Connection * connection = AcquireConnection( reused );
+        if ( connection == nullptr )
+        {
+            break;
+        }
+
+        bool keepAlive = false;
+        const bool ok = RequestOnConnection( *connection, method, cacheId, body, bodySize, outStatus, outData, outDataSize, keepAlive );
+        ReleaseConnection( connection, ok && keepAlive );
+        if ( ok )
+        {
+            MutexHolder mh( m_StatsMutex );
+            ++m_NumRequests;
+            return true;
+        }
+
+        // The server may have closed an idle connection, so try again on a new one
+        if ( reused == false )
+        {
+            break;
+        }
+        MutexHolder mh( m_StatsMutex );
+        ++m_NumRetries;
+    }
+
+    MutexHolder mh( m_StatsMutex );
+    ++m_NumRequests;
+    ++m_NumFailures;
+    return false;
+}
+
+// RequestOnConnection
+//------------------------------------------------------------------------------
+bool HTTPCache::RequestOnConnection( Connection & connection,
+                                     const char * method,
+                                     const AString & cacheId,
+                                     const void * body,
+                                     size_t bodySize,
+                                     uint32_t & outStatus,
+                                     void ** outData,
+                                     size_t * outDataSize,
+                                     bool & outKeepAlive )
+{
+    // Send request
+    {
+        AStackString< 512 > header;
+        header.Format( "%s %s/%s HTTP/1.1\r\n"
+                       "Host: %s\r\n"
+                       "Content-Length: %" PRIu64 "\r\n"
+                       "\r\n",
+                       method, m_BasePath.Get(), cacheId.Get(),
+                       m_HostHeader.Get(),
+                       (uint64_t)bodySize );
+        if ( connection.m_Stream.Send( header.Get(), header.GetLength(), TRANSFER_TIMEOUT_MS ) == false )
+        {
+            return false;
+        }
+        if ( bodySize && ( connection.m_Stream.Send( body, bodySize, TRANSFER_TIMEOUT_MS ) == false ) )
+        {
+            return false;
+        }
+    }
+
+    // Status line: HTTP/1.1 200 OK
+    AStackString< 512 > line;
+    if ( ( connection.ReadLine( line ) == false ) || ( line.BeginsWith( "HTTP/1." ) == false ) )
+    {
+        return false;
+    }
+    const char * const statusStart = line.Find( ' ' );
+    if ( statusStart == nullptr )
+    {
+        return false;
+    }
+    outStatus = (uint32_t)strtoul( statusStart + 1, nullptr, 10 );
+    outKeepAlive = ( line.BeginsWith( "HTTP/1.1" ) ); // HTTP/1.0 closes by default
+
+    // Headers
+    bool hasContentLength = false;
+    uint64_t contentLength = 0;
+    for ( ;; )
+    {
+        if ( connection.ReadLine( line ) == false )
+        {
+            return false;
+        }
+        if ( line.IsEmpty() )
+        {
+            break; // end of headers
+        }
+        if ( line.BeginsWithI( "Content-Length:" ) )
+        {
+            contentLength = strtoull( line.Get() + 15, nullptr, 10 );
+            hasContentLength = true;
+        }
+        else if ( line.BeginsWithI( "Connection:" ) )
+        {
+            outKeepAlive = ( line.FindI( "close" ) == nullptr );
+        }
+        else if ( line.BeginsWithI( "Transfer-Encoding:" ) )
+        {
+            return false; // Chunked responses are not supported
+        }
+    }
+
+    // Body
+    const bool hasBody = ( ( AString::StrNCmp( method, "HEAD", 4 ) != 0 ) &&
+                           ( outStatus != 204 ) && ( outStatus != 304 ) && ( outStatus >= 200 ) );
+    if ( hasBody == false )
+    {
+        return true;
+    }
+    if ( hasContentLength == false )
+    {
+        return false; // Body delimited by closing the connection is not supported
+    }
+    if ( outData && ( outStatus == 200 ) )
+    {
+        void * data = ALLOC( (size_t)contentLength );
+        if ( connection.Read( data, (size_t)contentLength ) == false )
+        {
+            FREE( data );
+            return false;
+        }
+        *outData = data;
+        *outDataSize = (size_t)contentLength;
+        return true;
+    }
+    return connection.Read( nullptr, (size_t)contentLength );
+}
+
+// AcquireConnection
+//------------------------------------------------------------------------------
+HTTPCache::Connection * HTTPCache::AcquireConnection( bool & outReused )
+{
+    // Re-use an idle connection if possible
+    {
+        MutexHolder mh( m_ConnectionsMutex );
+        if ( m_IdleConnections.IsEmpty() == false )
+        {
+            Connection * connection = m_IdleConnections.Top();
+            m_IdleConnections.Pop();
+            outReused = true;
+            return connection;
+        }
+    }
+
+    // Open a new one
+    Connection * connection = FNEW( Connection );
+    if ( connection->m_Stream.Connect( m_Host, m_Port, CONNECT_TIMEOUT_MS ) == false )
+    {
+        FDELETE connection;
+        return nullptr;
+    }
+    outReused = false;
+
+    MutexHolder mh( m_StatsMutex );
+    ++m_NumConnections;
+    return connection;
+}
+
+// ReleaseConnection
+//------------------------------------------------------------------------------
+void HTTPCache::ReleaseConnection( Connection * connection, bool keepAlive )
+{
+    if ( keepAlive )
+    {
+        // Any unread data would be mistaken for the next response
+        ASSERT( connection->m_BufferStart == connection->m_BufferEnd );
+        connection->m_BufferStart = 0;
+        connection->m_BufferEnd = 0;
+
+        MutexHolder mh( m_ConnectionsMutex );
+        if ( m_IdleConnections.GetSize() < MAX_IDLE_CONNECTIONS )
+        {
+            m_IdleConnections.Append( connection );
+            return;
+        }
+    }
+    FDELETE connection;
+}
+
+// ProcessBatch
+//------------------------------------------------------------------------------
+void HTTPCache::ProcessBatch( Batch & batch )
+{
+    const size_t numEntries = batch.m_Entries->GetSize();
+    if ( numEntries == 0 )
+    {
+        return;
+    }
+    batch.m_NextIndex = 0;
+    batch.m_NumRemaining = numEntries;
+
+    // Make the batch available to the request threads
+    {
+        MutexHolder mh( m_BatchMutex );
+        m_Batches.Append( &batch );
+    }
+    const size_t numHelpers = Math::Min( m_Threads.GetSize(), ( numEntries - 1 ) );
+    if ( numHelpers > 0 )
+    {
+        m_WorkSemaphore.Signal( (uint32_t)numHelpers );
+    }
+
+    // Help out, then wait for any requests still in flight
+    while ( ProcessNextEntry( &batch ) )
+    {
+    }
+    batch.m_Done.Wait();
+
+    MutexHolder mh( m_BatchMutex );
+    VERIFY( m_Batches.FindAndErase( &batch ) );
+}
+
+// ProcessNextEntry
+//------------------------------------------------------------------------------
+bool HTTPCache::ProcessNextEntry( Batch * onlyBatch )
+{
+    // Claim an entry. The batch remains valid until all claimed entries are completed.
+    Batch * batch = nullptr;
+    size_t index = 0;
+    {
+        MutexHolder mh( m_BatchMutex );
+        for ( Batch * b : m_Batches )
+        {
+            if ( ( onlyBatch && ( b != onlyBatch ) ) ||
+                 ( b->m_NextIndex == b->m_Entries->GetSize() ) )
+            {
+                continue;
+            }
+            batch = b;
+            index = b->m_NextIndex++;
+            break;
+        }
+    }
+    if ( batch == nullptr )
+    {
+        return false;
+    }
+
+    ProcessEntry( *batch, ( *batch->m_Entries )[ index ] );
+
+    // Signal while holding the lock, so the batch can't be destroyed before we're done with it
+    MutexHolder mh( m_BatchMutex );
+    if ( --batch->m_NumRemaining == 0 )
+    {
+        batch->m_Done.Signal();
+    }
+    return true;
+}
+
+// ProcessEntry
+//------------------------------------------------------------------------------
+void HTTPCache::ProcessEntry( Batch & batch, BatchEntry & entry )
+{
+    if ( batch.m_Retrieve )
+    {
+        entry.m_Found = Retrieve( entry.m_CacheId, entry.m_Data, entry.m_DataSize );
+        return;
+    }
+
+    uint32_t status = 0;
+    entry.m_Found = ( Request( "HEAD", entry.m_CacheId, nullptr, 0, status, nullptr, nullptr ) && ( status == 200 ) );
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t HTTPCache::ThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "HTTPCache" );
+
+    static_cast< HTTPCache * >( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void HTTPCache::ThreadFunc()
+{
+    for ( ;; )
+    {
+        m_WorkSemaphore.Wait();
+        if ( AtomicLoadRelaxed( &m_ThreadExit ) )
+        {
+            break;
+        }
+
+        while ( ProcessNextEntry( nullptr ) )
+        {
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,129 @@
+// HTTPCache - Cache stored on an HTTP server
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ICache.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class TCPStream;
+
+// HTTPCache
+//  - Used when the .CachePath is an "http://host[:port][/path]" url.
+//  - Entries are stored as resources named by their cache id:
+//      GET  <path>/<cacheId>  - retrieve (200 = hit, 404 = miss)
+//      HEAD <path>/<cacheId>  - query
+//      PUT  <path>/<cacheId>  - publish
+//  - Connections are kept alive and re-used between requests.
+//  - Batched requests are issued concurrently from a pool of request threads.
+//------------------------------------------------------------------------------
+class HTTPCache : public ICache
+{
+public:
+    explicit HTTPCache();
+    virtual ~HTTPCache() override;
+
+    virtual bool Init( const AString & cachePath,
+                       const AString & cachePathMountPoint,
+                       bool cacheRead,
+                       bool cacheWrite,
+                       bool cacheVerbose,
+                       const AString & pluginDLLConfig ) override;
+    virtual void Shutdown() override;
+    virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override;
+    virtual bool Retrieve( const AString & cacheId, void * & data, size_t & dataSize ) override;
+    virtual void FreeMemory( void * data, size_t dataSize ) override;
+    virtual bool OutputInfo( bool showProgress ) override;
+    virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual void QueryBatch( Array< BatchEntry > & entries ) override;
+    virtual void RetrieveBatch( Array< BatchEntry > & entries ) override;
+
+    static bool IsHTTPCachePath( const AString & cachePath );
+
+private:
+    enum : uint32_t
+    {
+        NUM_REQUEST_THREADS     = 7,    // In addition to the thread issuing a batch
+        MAX_IDLE_CONNECTIONS    = 16,
+        CONNECT_TIMEOUT_MS      = 2000,
+        TRANSFER_TIMEOUT_MS     = 30000,
+    };
+
+    // A keep-alive connection to the server
+    class Connection;
+
+    // A batch being processed by the request threads
+    class Batch
+    {
+    public:
+        Array< BatchEntry > *   m_Entries;
+        bool                    m_Retrieve;     // RetrieveBatch (or QueryBatch)
+        size_t                  m_NextIndex;    // Next entry to be claimed
+        size_t                  m_NumRemaining; // Entries not yet completed
+        Semaphore               m_Done;
+    };
+
+    bool ParseURL( const AString & url );
+
+    // Issue a request, re-trying once if a re-used connection was closed by the server
+    bool Request( const char * method,
+                  const AString & cacheId,
+                  const void * body,
+                  size_t bodySize,
+                  uint32_t & outStatus,
+                  void ** outData,
+                  size_t * outDataSize );
+    bool RequestOnConnection( Connection & connection,
+                              const char * method,
+                              const AString & cacheId,
+                              const void * body,
+                              size_t bodySize,
+                              uint32_t & outStatus,
+                              void ** outData,
+                              size_t * outDataSize,
+                              bool & outKeepAlive );
+
+    Connection *    AcquireConnection( bool & outReused );
+    void            ReleaseConnection( Connection * connection, bool keepAlive );
+
+    void ProcessBatch( Batch & batch );
+    bool ProcessNextEntry( Batch * onlyBatch );
+    void ProcessEntry( Batch & batch, BatchEntry & entry );
+    static uint32_t ThreadFuncStatic( void * param );
+    void ThreadFunc();
+
+    AString                 m_Host;
+    uint16_t                m_Port;
+    AString                 m_BasePath;     // Path prefix for entries (no trailing slash)
+    AString                 m_HostHeader;
+    bool                    m_Verbose;
+
+    // Idle connections, available for re-use
+    Mutex                   m_ConnectionsMutex;
+    Array< Connection * >   m_IdleConnections;
+
+    // Request threads
+    Mutex                   m_BatchMutex;
+    Array< Batch * >        m_Batches;
+    Semaphore               m_WorkSemaphore;
+    volatile bool           m_ThreadExit;
+    Array< Thread::ThreadHandle > m_Threads;
+
+    // Stats
+    Mutex                   m_StatsMutex;
+    uint32_t                m_NumRequests;
+    uint32_t                m_NumConnections;
+    uint32_t                m_NumRetries;
+    uint32_t                m_NumFailures;
+};
+
+//------------------------------------------------------------------------------
@@ -6,6 +6,49 @@
 #include "ICache.h"
 
 #include <Core/Strings/AString.h>
+#include <Core/Tracing/Tracing.h>
+
+// QueryBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void ICache::QueryBatch( Array< BatchEntry > & entries )
+{
+    for ( BatchEntry & entry : entries )
+    {
+        void * data;
+        entry.m_Found = Retrieve( entry.m_CacheId, data, entry.m_DataSize );
+        if ( entry.m_Found )
+        {
+            FreeMemory( data, entry.m_DataSize );
+        }
+        else
+        {
+            entry.m_DataSize = 0;
+        }
+    }
+}
+
+// RetrieveBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void ICache::RetrieveBatch( Array< BatchEntry > & entries )
+{
+    for ( BatchEntry & entry : entries )
+    {
+        entry.m_Found = Retrieve( entry.m_CacheId, entry.m_Data, entry.m_DataSize );
+        if ( entry.m_Found == false )
+        {
+            entry.m_Data = nullptr;
+            entry.m_DataSize = 0;
+        }
+    }
+}
+
+// TrainDictionary
+//------------------------------------------------------------------------------
+/*virtual*/ bool ICache::TrainDictionary( bool /*showProgress*/ )
+{
+    OUTPUT( "- Compression dictionaries are not supported by this cache\n" );
+    return false;
+}
 
 // GetCacheId
 //------------------------------------------------------------------------------
@@ -16,7 +59,7 @@
                                     AString & outCacheId )
 {
     // cache version - bump if cache format is changed
-    static const char cacheVersion( 'B' );
+    static const char cacheVersion( 'C' );
 
     // format example: 2377DE32AB045A2D_FED872A1_AB62FEAA23498AAC-32A2B04375A2D7DE.7
     outCacheId.Format( "%016" PRIX64 "_%08X_%016" PRIX64 "-%016" PRIX64 ".%c",
@@ -27,4 +70,58 @@
                        cacheVersion );
 }
 
+// ParseCacheId
+//------------------------------------------------------------------------------
+/*static*/ bool ICache::ParseCacheId( const AString & cacheId,
+                                      uint64_t & outPreprocessedSourceKey,
+                                      uint32_t & outCommandLineKey,
+                                      uint64_t & outToolChainKey,
+                                      uint64_t & outPCHKey )
+{
+    // Parse fixed width hex fields, checking separators between them
+    const char * pos = cacheId.Get();
+    const char * const end = cacheId.GetEnd();
+    auto parseHex = [ & ]( uint32_t numDigits, char separator, uint64_t & outValue ) -> bool
+    {
+        if ( ( end - pos ) < (ptrdiff_t)( numDigits + 1 ) )
+        {
+            return false;
+        }
+        uint64_t value = 0;
+        for ( uint32_t i = 0; i < numDigits; ++i )
+        {
+            const char c = *pos++;
+            if ( ( c >= '0' ) && ( c <= '9' ) )
+            {
+                value = ( value << 4 ) | (uint64_t)( c - '0' );
+            }
+            else if ( ( c >= 'A' ) && ( c <= 'F' ) )
+            {
+                value = ( value << 4 ) | (uint64_t)( c - 'A' + 10 );
+            }
+            else
+            {
+                return false;
+            }
+        }
+        outValue = value;
+        return ( *pos++ == separator );
+    };
+
+    uint64_t commandLineKey;
+    if ( !parseHex( 16, '_', outPreprocessedSourceKey ) ||
+         !parseHex( 8, '_', commandLineKey ) ||
+         !parseHex( 16, '-', outToolChainKey ) ||
+         !parseHex( 16, '.', outPCHKey ) )
+    {
+        return false;
+    }
+    outCommandLineKey = (uint32_t)commandLineKey;
+
+    // Only accept ids in exactly the form (and version) we'd generate
+    AString expectedCacheId;
+    GetCacheId( outPreprocessedSourceKey, outCommandLineKey, outToolChainKey, outPCHKey, expectedCacheId );
+    return ( cacheId == expectedCacheId );
+}
+
 //------------------------------------------------------------------------------
@@ -4,11 +4,10 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include <Core/Containers/Array.h>
 #include <Core/Env/Types.h>
-
-// Forward Declarations
-//------------------------------------------------------------------------------
-class AString;
+#include <Core/Strings/AString.h>
+#include <Tools/FBuild/FBuildCore/Helpers/Compressor.h>
 
 // Cache
 //------------------------------------------------------------------------------
@@ -31,12 +30,37 @@ public:
     virtual bool OutputInfo( bool showProgress ) = 0;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) = 0;
 
+    // An entry in a batched request
+    class BatchEntry
+    {
+    public:
+        AString     m_CacheId;
+        void *      m_Data      = nullptr;  // RetrieveBatch only (free with FreeMemory)
+        size_t      m_DataSize  = 0;
+        bool        m_Found     = false;
+    };
+
+    // Batched interface, allowing implementations to overlap requests. The
+    // default implementations process each entry individually.
+    virtual void QueryBatch( Array< BatchEntry > & entries );
+    virtual void RetrieveBatch( Array< BatchEntry > & entries );
+
+    // Compression dictionaries, stored with the cache. The default implementations
+    // don't support dictionaries.
+    virtual const Compressor::Dictionary * GetCompressionDictionary() const { return nullptr; }
+    virtual bool TrainDictionary( bool showProgress );
+
     // Helper functions
     static void GetCacheId( const uint64_t preprocessedSourceKey,
                             const uint32_t commandLineKey,
                             const uint64_t toolChainKey,
                             const uint64_t pchKey,
                             AString & outCacheId );
+    static bool ParseCacheId( const AString & cacheId,
+                              uint64_t & outPreprocessedSourceKey,
+                              uint32_t & outCommandLineKey,
+                              uint64_t & outToolChainKey,
+                              uint64_t & outPCHKey );
 };
 
 //------------------------------------------------------------------------------
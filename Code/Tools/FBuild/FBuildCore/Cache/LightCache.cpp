@@ -17,7 +17,8 @@
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Math/xxHash.h"
-#include "Core/Process/Mutex.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 
@@ -54,6 +55,8 @@ public:
 
     uint64_t                        m_FileNameHash;
     AString                         m_FileName;
+    IncludedFile *                  m_Next;         // Next item in IncludedFileHashSet bucket
+    volatile bool                   m_Parsed;       // Set once all other members are final
     bool                            m_Exists;
     uint64_t                        m_ContentHash;
     Array< Include >                m_Includes;
@@ -66,137 +69,101 @@ public:
 };
 
 // IncludedFileHashSet
+//  - Lock-free, insert-only set of all files seen by all LightCache instances
+//  - Items are chained per bucket and published with compare-and-swap, so
+//    lookups never block and published items never move
 //------------------------------------------------------------------------------
-#define LIGHTCACHE_DEFAULT_BUCKET_SIZE 1024
+#define LIGHTCACHE_NUM_BUCKET_BITS 16
+#define LIGHTCACHE_NUM_BUCKETS ( 1ULL << LIGHTCACHE_NUM_BUCKET_BITS )
+#define LIGHTCACHE_HASH_TO_BUCKET(hash) ( ( hash ) & ( LIGHTCACHE_NUM_BUCKETS - 1ULL ) )
 class IncludedFileHashSet
 {
 public:
-    IncludedFileHashSet( const IncludedFileHashSet & ) = delete;
-    IncludedFileHashSet & operator=( const IncludedFileHashSet & ) = delete;
     IncludedFileHashSet()
     {
-        m_Buckets.SetSize( LIGHTCACHE_DEFAULT_BUCKET_SIZE );
-        for ( IncludedFile * & elt : m_Buckets )
+        for ( IncludedFile * volatile & bucket : m_Buckets )
         {
-            elt = nullptr;
+            bucket = nullptr;
         }
     }
+    IncludedFileHashSet( const IncludedFileHashSet & ) = delete;
+    IncludedFileHashSet & operator=( const IncludedFileHashSet & ) = delete;
 
     ~IncludedFileHashSet()
     {
         Destruct();
     }
 
-    const IncludedFile * Find( const AString & fileName, uint64_t fileNameHash )
+    const IncludedFile * Find( const AString & fileName, uint64_t fileNameHash ) const
     {
-        const IncludedFile * const * location = InternalFind( fileName, fileNameHash );
-        if ( location && *location )
-        {
-            return *location;
-        }
-        return nullptr;
+        const IncludedFile * head = AtomicLoadAcquire( &m_Buckets[ LIGHTCACHE_HASH_TO_BUCKET( fileNameHash ) ] );
+        return FindInChain( head, nullptr, fileName, fileNameHash );
     }
 
-    // If two threads find the same include simultaneously, we delete the new
-    // one and return the old one.
-    const IncludedFile * Insert( IncludedFile * item )
+    // Publish the item, unless another thread has already published the same
+    // file. In that case the existing item is returned and the caller retains
+    // ownership of the item passed in.
+    IncludedFile * Insert( IncludedFile * item )
     {
-        if ( ( m_Buckets.GetSize() / 2 ) <= m_Elts )
+        IncludedFile * volatile * bucket = &m_Buckets[ LIGHTCACHE_HASH_TO_BUCKET( item->m_FileNameHash ) ];
+        IncludedFile * head = AtomicLoadAcquire( bucket );
+        const IncludedFile * searchEnd = nullptr;
+        for ( ;; )
         {
-            const size_t newSize = ( m_Buckets.GetSize() < LIGHTCACHE_DEFAULT_BUCKET_SIZE )
-                                 ? LIGHTCACHE_DEFAULT_BUCKET_SIZE
-                                 : ( m_Buckets.GetSize() * 2 );
-            Grow( newSize );
-        }
-        IncludedFile ** location = InternalFind( item->m_FileName, item->m_FileNameHash );
-        ASSERT( location != nullptr );
+            // Check items published since we last looked
+            IncludedFile * existing = FindInChain( head, searchEnd, item->m_FileName, item->m_FileNameHash );
+            if ( existing )
+            {
+                return existing;
+            }
 
-        if ( *location != nullptr )
-        {
-            // A race between multiple threads got us a duplicate item.
-            // delete the new one
-            FDELETE item;
-            return *location;
-        }
+            item->m_Next = head;
+            IncludedFile * previousHead = AtomicCompareExchangePtr( bucket, item, head );
+            if ( previousHead == head )
+            {
+                return item; // Published
+            }
 
-        ++m_Elts;
-        *location = item;
-        return *location;
-    }
-    void Destruct()
-    {
-        for ( IncludedFile * file : m_Buckets )
-        {
-            FDELETE file;
+            // Another thread published into this bucket first - only the
+            // newly added items need to be checked
+            searchEnd = head;
+            head = previousHead;
         }
-        m_Buckets.Destruct();
-        m_Elts = 0;
     }
 
-private:
-    IncludedFile ** InternalFind( const AString & fileName, uint64_t fileNameHash )
+    // Not thread-safe - must only be called when no LightCache is in use
+    void Destruct()
     {
-        if ( m_Buckets.IsEmpty() )
+        for ( IncludedFile * volatile & bucket : m_Buckets )
         {
-            return nullptr;
-        }
-        size_t probeCount = 1;
-        const size_t startIdx = fileNameHash & ( m_Buckets.GetSize() - 1 );
-        IncludedFile ** bucket = &m_Buckets[ startIdx ];
-        while ( *bucket != nullptr )
-        {
-            if ( ( (*bucket)->m_FileNameHash == fileNameHash ) && ( **bucket == fileName ) )
+            IncludedFile * file = bucket;
+            while ( file )
             {
-                return bucket;
+                IncludedFile * next = file->m_Next;
+                FDELETE file;
+                file = next;
             }
-            bucket = Next( m_Buckets, startIdx, probeCount );
+            bucket = nullptr;
         }
-        ASSERT( *bucket == nullptr );
-        return bucket;
     }
 
-    static IncludedFile ** Next( Array< IncludedFile * > &buckets,
-                                 size_t startIdx,
-                                 size_t & probeCount )
-    {
-        size_t curIdx = startIdx + ( probeCount * probeCount ); //quadratic probing
-        curIdx &= ( buckets.GetSize() - 1 );
-        ++probeCount;
-        return &buckets[ curIdx ];
-    }
-    void Grow( size_t elts )
+private:
+    static IncludedFile * FindInChain( const IncludedFile * head,
+                                       const IncludedFile * end,
+                                       const AString & fileName,
+                                       uint64_t fileNameHash )
     {
-        Array< IncludedFile * > dest( elts, true );
-        dest.SetSize( elts );
-        for ( IncludedFile * & elt : dest )
+        for ( const IncludedFile * file = head; file != end; file = file->m_Next )
         {
-            elt = nullptr;
-        }
-
-        // populate dest with the elements in m_Buckets.  Rely on uniqueness
-        // in source to avoid comparing in dest
-        for ( IncludedFile * elt : m_Buckets )
-        {
-            if ( elt == nullptr )
-            {
-                continue;
-            }
-            size_t probeCount = 1;
-            const size_t startIdx = elt->m_FileNameHash & ( dest.GetSize() - 1 );
-            IncludedFile ** bucket = &dest[ startIdx ];
-            while ( *bucket != nullptr )
+            if ( ( file->m_FileNameHash == fileNameHash ) && ( *file == fileName ) )
             {
-                bucket = Next( dest, startIdx, probeCount );
+                return const_cast< IncludedFile * >( file );
             }
-            ASSERT( *bucket == nullptr );
-            *bucket = elt;
         }
-        m_Buckets.Swap( dest );
+        return nullptr;
     }
 
-    // m_Buckets must always be a size that is a power of 2
-    Array< IncludedFile * > m_Buckets{ LIGHTCACHE_DEFAULT_BUCKET_SIZE, true };
-    size_t m_Elts = 0;
+    IncludedFile * volatile m_Buckets[ LIGHTCACHE_NUM_BUCKETS ];
 };
 
 // IncludeDefine
@@ -225,30 +192,9 @@ IncludedFile::~IncludedFile()
     }
 }
 
-// IncludedFileBucket
-//------------------------------------------------------------------------------
-class IncludedFileBucket
-{
-public:
-    IncludedFileBucket() = default;
-    IncludedFileBucket( const IncludedFileBucket & ) = delete;
-    IncludedFileBucket & operator = ( const IncludedFileBucket & ) = delete;
-
-    void Destruct()
-    {
-        m_HashSet.Destruct();
-    }
-    Mutex                   m_Mutex;
-    IncludedFileHashSet     m_HashSet;
-};
-// using a power of two number of buckets.  64 top level buckets should be a
-// reasonable tradeoff between size and contention
-#define LIGHTCACHE_NUM_BUCKET_BITS 6
-#define LIGHTCACHE_NUM_BUCKETS ( 1ULL << LIGHTCACHE_NUM_BUCKET_BITS )
-#define LIGHTCACHE_BUCKET_MASK_BASE ( LIGHTCACHE_NUM_BUCKETS - 1ULL )
-// use upper bits for bucket selection, as lower bits get used in the hash set
-#define LIGHTCACHE_HASH_TO_BUCKET(hash) ( (( hash ) >> ( 64ULL - LIGHTCACHE_NUM_BUCKET_BITS )) & LIGHTCACHE_BUCKET_MASK_BASE )
-static IncludedFileBucket g_AllIncludedFiles[ LIGHTCACHE_NUM_BUCKETS ];
+static IncludedFileHashSet g_AllIncludedFiles;
+static volatile uint32_t g_NumFilesParsed( 0 );
+static volatile uint32_t g_NumParseWaits( 0 );
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
@@ -269,6 +215,16 @@ bool LightCache::Hash( ObjectNode * node,
                        const AString & compilerArgs,
                        uint64_t & outSourceHash,
                        Array< AString > & outIncludes )
+{
+    return Hash( node->GetSourceFile()->GetName(), compilerArgs, outSourceHash, outIncludes );
+}
+
+// Hash
+//------------------------------------------------------------------------------
+bool LightCache::Hash( const AString & rootFileName,
+                       const AString & compilerArgs,
+                       uint64_t & outSourceHash,
+                       Array< AString > & outIncludes )
 {
     PROFILE_FUNCTION;
 
@@ -286,7 +242,6 @@ bool LightCache::Hash( ObjectNode * node,
         includePath += NATIVE_SLASH;
     }
 
-    const AString & rootFileName = node->GetSourceFile()->GetName();
     ProcessInclude( rootFileName, IncludeType::QUOTE );
 
     // Handle missing root file
@@ -323,10 +278,23 @@ bool LightCache::Hash( ObjectNode * node,
 //------------------------------------------------------------------------------
 /*static*/ void LightCache::ClearCachedFiles()
 {
-    for ( IncludedFileBucket & bucket : g_AllIncludedFiles )
-    {
-        bucket.Destruct();
-    }
+    g_AllIncludedFiles.Destruct();
+    AtomicStoreRelaxed( &g_NumFilesParsed, 0 );
+    AtomicStoreRelaxed( &g_NumParseWaits, 0 );
+}
+
+// GetNumFilesParsed
+//------------------------------------------------------------------------------
+/*static*/ uint32_t LightCache::GetNumFilesParsed()
+{
+    return AtomicLoadRelaxed( &g_NumFilesParsed );
+}
+
+// GetNumParseWaits
+//------------------------------------------------------------------------------
+/*static*/ uint32_t LightCache::GetNumParseWaits()
+{
+    return AtomicLoadRelaxed( &g_NumParseWaits );
 }
 
 // Parse
@@ -842,53 +810,60 @@ const IncludedFile * LightCache::ProcessIncludeFromIncludePath( const AString &
 const IncludedFile * LightCache::FileExists( const AString & fileName )
 {
     const uint64_t fileNameHash = xxHash::Calc64( fileName );
-    const uint64_t bucketIndex = LIGHTCACHE_HASH_TO_BUCKET( fileNameHash );
-    IncludedFileBucket & bucket = g_AllIncludedFiles[ bucketIndex ];
+
     // Retrieve from shared cache
+    const IncludedFile * file = g_AllIncludedFiles.Find( fileName, fileNameHash );
+    if ( file == nullptr )
     {
-        MutexHolder mh( bucket.m_Mutex );
-        const IncludedFile * location = bucket.m_HashSet.Find( fileName, fileNameHash );
-        if ( location )
+        // A newly seen file
+        IncludedFile * newFile = FNEW( IncludedFile() );
+        newFile->m_FileNameHash = fileNameHash;
+        newFile->m_FileName = fileName;
+        newFile->m_Next = nullptr;
+        newFile->m_Parsed = false;
+        newFile->m_Exists = false;
+        newFile->m_ContentHash = 0;
+
+        // Claim the file before parsing it, so other threads looking for the
+        // same file wait for our result instead of parsing it again
+        IncludedFile * claimedFile = g_AllIncludedFiles.Insert( newFile );
+        if ( claimedFile == newFile )
+        {
+            AtomicIncU32( &g_NumFilesParsed );
+
+            // Try to open the new file
+            FileStream f;
+            if ( f.Open( fileName.Get() ) )
+            {
+                // File exists - parse it
+                newFile->m_Exists = true;
+                Parse( newFile, f );
+            }
+
+            // Make result visible to other threads
+            AtomicStoreRelease( &newFile->m_Parsed, true );
+        }
+        else
         {
-            m_IncludeDefines.Append( location->m_IncludeDefines );
-            
-            return location; // File previously handled so we can re-use the result
+            // Another thread claimed the file first
+            FDELETE newFile;
         }
+        file = claimedFile;
     }
 
-    // A newly seen file
-    IncludedFile * newFile = FNEW( IncludedFile() );
-    const IncludedFile * retval = nullptr;
-    newFile->m_FileNameHash = fileNameHash;
-    newFile->m_FileName = fileName;
-    newFile->m_Exists = false;
-    newFile->m_ContentHash = 0;
-
-    // Try to open the new file
-    FileStream f;
-    if ( f.Open( fileName.Get() ) == false )
+    // File might still be being parsed by another thread
+    if ( AtomicLoadAcquire( &file->m_Parsed ) == false )
     {
+        AtomicIncU32( &g_NumParseWaits );
+        while ( AtomicLoadAcquire( &file->m_Parsed ) == false )
         {
-            // Store to shared cache
-            MutexHolder mh( bucket.m_Mutex );
-            retval = bucket.m_HashSet.Insert( newFile );
+            Thread::Sleep( 0 );
         }
-        return retval;
-    }
-
-    // File exists - parse it
-    newFile->m_Exists = true;
-    Parse( newFile, f );
-
-    {
-        // Store to shared cache
-        MutexHolder mh( bucket.m_Mutex );
-        retval = bucket.m_HashSet.Insert( newFile );
     }
 
-    m_IncludeDefines.Append( retval->m_IncludeDefines );
+    m_IncludeDefines.Append( file->m_IncludeDefines );
 
-    return retval;
+    return file;
 }
 
 // AddError
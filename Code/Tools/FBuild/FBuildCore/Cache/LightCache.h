@@ -32,12 +32,20 @@ public:
                const AString & compilerArgs,     // Args to extract include paths from
                uint64_t & outSourceHash,         // Resulting hash of source code
                Array< AString > & outIncludes ); // Discovered dependencies
+    bool Hash( const AString & rootFileName,     // File to be compiled
+               const AString & compilerArgs,
+               uint64_t & outSourceHash,
+               Array< AString > & outIncludes );
 
     // Get text description of problem(s) if Hash() fails
     const AString & GetErrors() const { return m_Errors; }
 
     static void ClearCachedFiles();
 
+    // Stats for files seen by all instances (since ClearCachedFiles)
+    static uint32_t GetNumFilesParsed();    // Each file is opened and parsed once
+    static uint32_t GetNumParseWaits();     // Lookups which waited for another thread to parse a file
+
 protected:
     void                    Parse( IncludedFile * file, FileStream & f );
     bool                    ParseDirective( IncludedFile & file, const char * & pos );
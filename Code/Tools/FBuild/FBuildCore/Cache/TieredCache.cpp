@@ -0,0 +1,554 @@
+// TieredCache - Local cache in front of a shared cache
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "TieredCache.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Tracing/Tracing.h"
+
+// system
+#include <string.h>
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+TieredCache::TieredCache( const AString & localCachePath, uint32_t localCacheSizeMiB, ICache * sharedCache )
+    : m_LocalCachePath( localCachePath )
+    , m_LocalCacheSizeLimit( (uint64_t)localCacheSizeMiB * MEGABYTE )
+    , m_LocalCacheAvailable( false )
+    , m_SharedCache( sharedCache )
+    , m_Verbose( false )
+    , m_Thread( INVALID_THREAD_HANDLE )
+    , m_ThreadExit( false )
+    , m_PendingWrites( 256, true )
+    , m_PendingBytes( 0 )
+    , m_SharedAllocations( 64, true )
+    , m_LocalCacheSize( 0 )
+    , m_LocalCacheSizeKnown( false )
+    , m_LocalTrimRequested( false )
+    , m_NumLocalHits( 0 )
+    , m_NumSharedHits( 0 )
+    , m_NumPromotions( 0 )
+    , m_NumPromotionsSkipped( 0 )
+    , m_NumSharedPublishes( 0 )
+    , m_NumSharedPublishFailures( 0 )
+    , m_NumEvictions( 0 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+TieredCache::~TieredCache()
+{
+    ASSERT( m_Thread == INVALID_THREAD_HANDLE ); // Shutdown not called?
+    ASSERT( m_SharedAllocations.IsEmpty() ); // Memory not returned via FreeMemory?
+    FDELETE m_SharedCache;
+}
+
+// Init
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Init( const AString & cachePath,
+                                    const AString & cachePathMountPoint,
+                                    bool cacheRead,
+                                    bool cacheWrite,
+                                    bool cacheVerbose,
+                                    const AString & pluginDLLConfig )
+{
+    PROFILE_FUNCTION;
+
+    m_Verbose = cacheVerbose;
+
+    // If the shared cache is unavailable, we can still use the local cache
+    if ( m_SharedCache )
+    {
+        if ( m_SharedCache->Init( cachePath, cachePathMountPoint, cacheRead, cacheWrite, cacheVerbose, pluginDLLConfig ) == false )
+        {
+            FDELETE m_SharedCache;
+            m_SharedCache = nullptr;
+        }
+    }
+
+    m_LocalCacheAvailable = m_LocalCache.Init( m_LocalCachePath, AString::GetEmpty(), cacheRead, cacheWrite, cacheVerbose, AString::GetEmpty() );
+
+    if ( ( m_LocalCacheAvailable == false ) && ( m_SharedCache == nullptr ) )
+    {
+        return false;
+    }
+
+    m_Thread = Thread::CreateThread( ThreadFuncStatic, "TieredCache", ( 64 * KILOBYTE ), this );
+    ASSERT( m_Thread != INVALID_THREAD_HANDLE );
+    return true;
+}
+
+// Shutdown
+//------------------------------------------------------------------------------
+/*virtual*/ void TieredCache::Shutdown()
+{
+    PROFILE_FUNCTION;
+
+    // Complete any outstanding writes
+    if ( m_Thread != INVALID_THREAD_HANDLE )
+    {
+        AtomicStoreRelaxed( &m_ThreadExit, true );
+        m_WorkSemaphore.Signal();
+        Thread::WaitForThread( m_Thread );
+        Thread::CloseHandle( m_Thread );
+        m_Thread = INVALID_THREAD_HANDLE;
+    }
+
+    if ( m_Verbose )
+    {
+        FLOG_OUTPUT( "TieredCache:\n"
+                     " - Local Hits      : %u\n"
+                     " - Shared Hits     : %u (Promoted: %u - Skipped: %u)\n"
+                     " - Shared Stores   : %u (Failed: %u)\n"
+                     " - Local Evictions : %u\n",
+                     m_NumLocalHits,
+                     m_NumSharedHits, m_NumPromotions, m_NumPromotionsSkipped,
+                     m_NumSharedPublishes, m_NumSharedPublishFailures,
+                     m_NumEvictions );
+    }
+
+    m_LocalCache.Shutdown();
+    if ( m_SharedCache )
+    {
+        m_SharedCache->Shutdown();
+    }
+}
+
+// Publish
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Publish( const AString & cacheId, const void * data, size_t dataSize )
+{
+    PROFILE_FUNCTION;
+
+    bool published = false;
+
+    // Store locally right away
+    if ( m_LocalCacheAvailable && m_LocalCache.Publish( cacheId, data, dataSize ) )
+    {
+        OnLocalWrite( dataSize );
+        published = true;
+    }
+
+    // Store to the shared cache in the background
+    if ( m_SharedCache && QueueWrite( true, cacheId, data, dataSize, true ) )
+    {
+        published = true;
+    }
+
+    return published;
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Retrieve( const AString & cacheId, void * & data, size_t & dataSize )
+{
+    PROFILE_FUNCTION;
+
+    // Local cache
+    if ( m_LocalCacheAvailable && m_LocalCache.Retrieve( cacheId, data, dataSize ) )
+    {
+        m_LocalCache.Touch( cacheId ); // Keep recently used entries when trimming
+
+        MutexHolder mh( m_Mutex );
+        ++m_NumLocalHits;
+        return true;
+    }
+
+    // Shared cache
+    if ( ( m_SharedCache == nullptr ) ||
+         ( m_SharedCache->Retrieve( cacheId, data, dataSize ) == false ) )
+    {
+        return false;
+    }
+
+    {
+        MutexHolder mh( m_Mutex );
+        ++m_NumSharedHits;
+        m_SharedAllocations.Append( data ); // Must be freed by the shared cache
+    }
+
+    // Promote to the local cache in the background so next time we won't need
+    // to access the shared cache
+    if ( m_LocalCacheAvailable )
+    {
+        QueueWrite( false, cacheId, data, dataSize, false );
+    }
+
+    return true;
+}
+
+// QueryBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void TieredCache::QueryBatch( Array< BatchEntry > & entries )
+{
+    PROFILE_FUNCTION;
+
+    // Local cache
+    if ( m_LocalCacheAvailable )
+    {
+        m_LocalCache.QueryBatch( entries );
+    }
+
+    if ( m_SharedCache == nullptr )
+    {
+        return;
+    }
+
+    // Shared cache (only for entries not in the local cache)
+    Array< BatchEntry > sharedEntries( entries.GetSize() );
+    Array< size_t > sharedIndices( entries.GetSize() );
+    for ( size_t i = 0; i < entries.GetSize(); ++i )
+    {
+        if ( m_LocalCacheAvailable && entries[ i ].m_Found )
+        {
+            continue;
+        }
+        sharedEntries.EmplaceBack().m_CacheId = entries[ i ].m_CacheId;
+        sharedIndices.Append( i );
+    }
+    if ( sharedEntries.IsEmpty() )
+    {
+        return;
+    }
+    m_SharedCache->QueryBatch( sharedEntries );
+    for ( size_t i = 0; i < sharedEntries.GetSize(); ++i )
+    {
+        BatchEntry & entry = entries[ sharedIndices[ i ] ];
+        entry.m_Found = sharedEntries[ i ].m_Found;
+        entry.m_DataSize = sharedEntries[ i ].m_DataSize;
+    }
+}
+
+// RetrieveBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void TieredCache::RetrieveBatch( Array< BatchEntry > & entries )
+{
+    PROFILE_FUNCTION;
+
+    // Local cache
+    Array< BatchEntry > sharedEntries( entries.GetSize() );
+    Array< size_t > sharedIndices( entries.GetSize() );
+    for ( size_t i = 0; i < entries.GetSize(); ++i )
+    {
+        BatchEntry & entry = entries[ i ];
+        entry.m_Found = m_LocalCacheAvailable && m_LocalCache.Retrieve( entry.m_CacheId, entry.m_Data, entry.m_DataSize );
+        if ( entry.m_Found )
+        {
+            m_LocalCache.Touch( entry.m_CacheId ); // Keep recently used entries when trimming
+
+            MutexHolder mh( m_Mutex );
+            ++m_NumLocalHits;
+            continue;
+        }
+        sharedEntries.EmplaceBack().m_CacheId = entry.m_CacheId;
+        sharedIndices.Append( i );
+    }
+    if ( ( m_SharedCache == nullptr ) || sharedEntries.IsEmpty() )
+    {
+        return;
+    }
+
+    // Shared cache (all misses in a single batch)
+    m_SharedCache->RetrieveBatch( sharedEntries );
+    for ( size_t i = 0; i < sharedEntries.GetSize(); ++i )
+    {
+        const BatchEntry & sharedEntry = sharedEntries[ i ];
+        if ( sharedEntry.m_Found == false )
+        {
+            continue;
+        }
+
+        BatchEntry & entry = entries[ sharedIndices[ i ] ];
+        entry.m_Found = true;
+        entry.m_Data = sharedEntry.m_Data;
+        entry.m_DataSize = sharedEntry.m_DataSize;
+
+        {
+            MutexHolder mh( m_Mutex );
+            ++m_NumSharedHits;
+            m_SharedAllocations.Append( entry.m_Data ); // Must be freed by the shared cache
+        }
+
+        // Promote to the local cache in the background
+        if ( m_LocalCacheAvailable )
+        {
+            QueueWrite( false, entry.m_CacheId, entry.m_Data, entry.m_DataSize, false );
+        }
+    }
+}
+
+// FreeMemory
+//------------------------------------------------------------------------------
+/*virtual*/ void TieredCache::FreeMemory( void * data, size_t dataSize )
+{
+    bool fromSharedCache;
+    {
+        MutexHolder mh( m_Mutex );
+        fromSharedCache = m_SharedAllocations.FindAndErase( data );
+    }
+
+    if ( fromSharedCache )
+    {
+        m_SharedCache->FreeMemory( data, dataSize );
+        return;
+    }
+
+    m_LocalCache.FreeMemory( data, dataSize );
+}
+
+// OutputInfo
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::OutputInfo( bool showProgress )
+{
+    bool result = true;
+    if ( m_LocalCacheAvailable )
+    {
+        OUTPUT( "Local Cache: '%s'\n", m_LocalCachePath.Get() );
+        result = m_LocalCache.OutputInfo( showProgress );
+    }
+    if ( m_SharedCache )
+    {
+        OUTPUT( "Shared Cache:\n" );
+        result = m_SharedCache->OutputInfo( showProgress ) && result;
+    }
+    return result;
+}
+
+// GetCompressionDictionary
+//------------------------------------------------------------------------------
+/*virtual*/ const Compressor::Dictionary * TieredCache::GetCompressionDictionary() const
+{
+    // Dictionaries are trained from and stored with the shared cache
+    if ( m_SharedCache )
+    {
+        return m_SharedCache->GetCompressionDictionary();
+    }
+    return m_LocalCacheAvailable ? m_LocalCache.GetCompressionDictionary() : nullptr;
+}
+
+// TrainDictionary
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::TrainDictionary( bool showProgress )
+{
+    if ( m_SharedCache )
+    {
+        OUTPUT( "Shared Cache:\n" );
+        return m_SharedCache->TrainDictionary( showProgress );
+    }
+    if ( m_LocalCacheAvailable )
+    {
+        OUTPUT( "Local Cache: '%s'\n", m_LocalCachePath.Get() );
+        return m_LocalCache.TrainDictionary( showProgress );
+    }
+    return false;
+}
+
+// Trim
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Trim( bool showProgress, uint32_t sizeMiB )
+{
+    bool result = true;
+    if ( m_LocalCacheAvailable )
+    {
+        // Local cache is never allowed to exceed its configured size
+        const uint32_t localSizeMiB = (uint32_t)Math::Min( (uint64_t)sizeMiB, ( m_LocalCacheSizeLimit / MEGABYTE ) );
+        OUTPUT( "Local Cache: '%s'\n", m_LocalCachePath.Get() );
+        result = m_LocalCache.Trim( showProgress, localSizeMiB );
+    }
+    if ( m_SharedCache )
+    {
+        OUTPUT( "Shared Cache:\n" );
+        result = m_SharedCache->Trim( showProgress, sizeMiB ) && result;
+    }
+    return result;
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TieredCache::ThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "TieredCache" );
+
+    static_cast< TieredCache * >( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void TieredCache::ThreadFunc()
+{
+    // Determine the size of the local cache. This can be slow, so it's done here
+    // instead of during Init (size is approximate and any writes happening
+    // in the meantime will only cause trimming to be slightly early)
+    if ( m_LocalCacheAvailable )
+    {
+        const uint64_t size = m_LocalCache.GetTotalSize();
+
+        MutexHolder mh( m_Mutex );
+        m_LocalCacheSize += size;
+        m_LocalCacheSizeKnown = true;
+        m_LocalTrimRequested = ( m_LocalCacheSize > m_LocalCacheSizeLimit );
+    }
+
+    for ( ;; )
+    {
+        // Process queued writes and trimming
+        for ( ;; )
+        {
+            PendingWrite write;
+            bool haveWrite = false;
+            bool doTrim = false;
+            {
+                MutexHolder mh( m_Mutex );
+                if ( m_PendingWrites.IsEmpty() == false )
+                {
+                    write = m_PendingWrites[ 0 ];
+                    m_PendingWrites.PopFront();
+                    haveWrite = true;
+                }
+                else if ( m_LocalTrimRequested )
+                {
+                    m_LocalTrimRequested = false;
+                    doTrim = true;
+                }
+            }
+
+            if ( haveWrite )
+            {
+                if ( write.m_Shared )
+                {
+                    const bool ok = m_SharedCache->Publish( write.m_CacheId, write.m_Data, write.m_DataSize );
+                    if ( ( ok == false ) && m_Verbose )
+                    {
+                        FLOG_OUTPUT( "TieredCache - Shared Store Fail: '%s'\n", write.m_CacheId.Get() );
+                    }
+
+                    MutexHolder mh( m_Mutex );
+                    ++( ok ? m_NumSharedPublishes : m_NumSharedPublishFailures );
+                }
+                else if ( m_LocalCache.Publish( write.m_CacheId, write.m_Data, write.m_DataSize ) )
+                {
+                    OnLocalWrite( write.m_DataSize );
+
+                    MutexHolder mh( m_Mutex );
+                    ++m_NumPromotions;
+                }
+                FREE( write.m_Data );
+
+                {
+                    MutexHolder mh( m_Mutex );
+                    m_PendingBytes -= write.m_DataSize;
+                }
+                m_WriteDoneSemaphore.Signal();
+                continue;
+            }
+
+            if ( doTrim )
+            {
+                TrimLocalCache();
+                continue;
+            }
+
+            break; // Nothing left to do
+        }
+
+        if ( AtomicLoadRelaxed( &m_ThreadExit ) )
+        {
+            return;
+        }
+
+        m_WorkSemaphore.Wait();
+    }
+}
+
+// QueueWrite
+//------------------------------------------------------------------------------
+bool TieredCache::QueueWrite( bool shared, const AString & cacheId, const void * data, size_t dataSize, bool canWait )
+{
+    {
+        MutexHolder mh( m_Mutex );
+
+        // Too much outstanding data? Promotions are optional, so skip them
+        // instead of stalling the build
+        while ( ( m_PendingBytes > 0 ) && ( ( m_PendingBytes + dataSize ) > MAX_PENDING_BYTES ) )
+        {
+            if ( canWait == false )
+            {
+                ++m_NumPromotionsSkipped;
+                return false;
+            }
+            m_Mutex.Unlock();
+            m_WriteDoneSemaphore.Wait( 100 );
+            m_Mutex.Lock();
+        }
+
+        // Take a copy, since caller retains ownership of the data
+        PendingWrite & write = m_PendingWrites.EmplaceBack();
+        write.m_Shared = shared;
+        write.m_CacheId = cacheId;
+        write.m_Data = ALLOC( dataSize );
+        write.m_DataSize = dataSize;
+        memcpy( write.m_Data, data, dataSize );
+        m_PendingBytes += dataSize;
+    }
+
+    m_WorkSemaphore.Signal();
+    return true;
+}
+
+// OnLocalWrite
+//------------------------------------------------------------------------------
+void TieredCache::OnLocalWrite( size_t dataSize )
+{
+    bool requestTrim = false;
+    {
+        MutexHolder mh( m_Mutex );
+        m_LocalCacheSize += dataSize;
+        if ( m_LocalCacheSizeKnown &&
+             ( m_LocalCacheSize > m_LocalCacheSizeLimit ) &&
+             ( m_LocalTrimRequested == false ) )
+        {
+            m_LocalTrimRequested = true;
+            requestTrim = true;
+        }
+    }
+
+    if ( requestTrim )
+    {
+        m_WorkSemaphore.Signal();
+    }
+}
+
+// TrimLocalCache
+//------------------------------------------------------------------------------
+void TieredCache::TrimLocalCache()
+{
+    PROFILE_FUNCTION;
+
+    // Trim below the limit so we don't need to trim again right away
+    const uint64_t target = ( m_LocalCacheSizeLimit - ( m_LocalCacheSizeLimit / 10 ) );
+    uint32_t numDeleted = 0;
+    const uint64_t newSize = m_LocalCache.TrimToSize( target, numDeleted );
+
+    if ( m_Verbose )
+    {
+        FLOG_OUTPUT( "TieredCache - Trimmed local cache to %u MiB (%u entries evicted)\n",
+                     (uint32_t)( newSize / MEGABYTE ), numDeleted );
+    }
+
+    MutexHolder mh( m_Mutex );
+    m_LocalCacheSize = newSize;
+    m_NumEvictions += numDeleted;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,96 @@
+// TieredCache - Local cache in front of a shared cache
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Cache.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AString.h"
+
+// TieredCache
+//  - Entries are retrieved from a local (L1) cache when possible, falling back to
+//    the shared (L2) cache (a Cache or CachePlugin). Shared hits are promoted to the
+//    local cache in the background.
+//  - Entries are published to the local cache immediately and to the shared cache
+//    in the background.
+//  - The local cache is trimmed to a fixed size, evicting least recently used entries.
+//------------------------------------------------------------------------------
+class TieredCache : public ICache
+{
+public:
+    explicit TieredCache( const AString & localCachePath, uint32_t localCacheSizeMiB, ICache * sharedCache );
+    virtual ~TieredCache() override;
+
+    virtual bool Init( const AString & cachePath,
+                       const AString & cachePathMountPoint,
+                       bool cacheRead,
+                       bool cacheWrite,
+                       bool cacheVerbose,
+                       const AString & pluginDLLConfig ) override;
+    virtual void Shutdown() override;
+    virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override;
+    virtual bool Retrieve( const AString & cacheId, void * & data, size_t & dataSize ) override;
+    virtual void FreeMemory( void * data, size_t dataSize ) override;
+    virtual bool OutputInfo( bool showProgress ) override;
+    virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual void QueryBatch( Array< BatchEntry > & entries ) override;
+    virtual void RetrieveBatch( Array< BatchEntry > & entries ) override;
+    virtual const Compressor::Dictionary * GetCompressionDictionary() const override;
+    virtual bool TrainDictionary( bool showProgress ) override;
+
+private:
+    enum : uint64_t { MAX_PENDING_BYTES = ( 256 * 1024 * 1024 ) };
+
+    static uint32_t ThreadFuncStatic( void * param );
+    void ThreadFunc();
+    bool QueueWrite( bool shared, const AString & cacheId, const void * data, size_t dataSize, bool canWait );
+    void OnLocalWrite( size_t dataSize );
+    void TrimLocalCache();
+
+    // A write waiting to be performed by the background thread
+    class PendingWrite
+    {
+    public:
+        bool        m_Shared;       // Publish to shared cache (or promote to local cache)
+        AString     m_CacheId;
+        void *      m_Data;
+        size_t      m_DataSize;
+    };
+
+    Cache                   m_LocalCache;
+    AString                 m_LocalCachePath;
+    uint64_t                m_LocalCacheSizeLimit;
+    bool                    m_LocalCacheAvailable;
+    ICache *                m_SharedCache;
+    bool                    m_Verbose;
+
+    // Background thread
+    Thread::ThreadHandle    m_Thread;
+    volatile bool           m_ThreadExit;
+    Semaphore               m_WorkSemaphore;
+    Semaphore               m_WriteDoneSemaphore;
+
+    // Protected by m_Mutex
+    Mutex                   m_Mutex;
+    Array< PendingWrite >   m_PendingWrites;
+    uint64_t                m_PendingBytes;
+    Array< void * >         m_SharedAllocations;    // Retrieved memory owned by the shared cache
+    uint64_t                m_LocalCacheSize;       // Approximate size of local cache
+    bool                    m_LocalCacheSizeKnown;
+    bool                    m_LocalTrimRequested;
+    uint32_t                m_NumLocalHits;
+    uint32_t                m_NumSharedHits;
+    uint32_t                m_NumPromotions;
+    uint32_t                m_NumPromotionsSkipped;
+    uint32_t                m_NumSharedPublishes;
+    uint32_t                m_NumSharedPublishFailures;
+    uint32_t                m_NumEvictions;
+};
+
+//------------------------------------------------------------------------------
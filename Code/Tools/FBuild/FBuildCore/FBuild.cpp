@@ -11,13 +11,19 @@
 #include "Cache/ICache.h"
 #include "Cache/Cache.h"
 #include "Cache/CachePlugin.h"
+#include "Cache/HTTPCache.h"
+#include "Cache/CachePrefetcher.h"
+#include "Cache/CachePublisher.h"
+#include "Cache/CacheMissMemo.h"
 #include "Cache/LightCache.h"
+#include "Cache/TieredCache.h"
 #include "Graph/Node.h"
 #include "Graph/NodeGraph.h"
 #include "Graph/NodeProxy.h"
 #include "Graph/SettingsNode.h"
 #include "Helpers/BuildProfiler.h"
 #include "Helpers/CompilationDatabase.h"
+#include "Helpers/Compressor.h"
 #include "Helpers/Report.h"
 #include "Protocol/Client.h"
 #include "Protocol/Protocol.h"
@@ -60,6 +66,9 @@ FBuild::FBuild( const FBuildOptions & options )
     , m_JobQueue( nullptr )
     , m_Client( nullptr )
     , m_Cache( nullptr )
+    , m_CachePublisher( nullptr )
+    , m_CachePrefetcher( nullptr )
+    , m_CacheMissMemo( nullptr )
     , m_LastProgressOutputTime( 0.0f )
     , m_LastProgressCalcTime( 0.0f )
     , m_SmoothedProgressCurrent( 0.0f )
@@ -96,6 +105,10 @@ FBuild::FBuild( const FBuildOptions & options )
 
     Function::Create();
 
+    // Large cache entries and job payloads are compressed using all cores (the
+    // calling thread participates too)
+    Compressor::CreateThreadPool( Env::GetNumProcessors() - 1 );
+
     NetworkStartupHelper::SetMainShutdownFlag( &s_AbortBuild );
 }
 
@@ -117,6 +130,8 @@ FBuild::~FBuild()
         FDELETE m_Cache;
     }
 
+    Compressor::DestroyThreadPool();
+
     // restore the old working dir to restore
     ASSERT( !m_OldWorkingDir.IsEmpty() );
     if ( !FileIO::SetCurrentDir( m_OldWorkingDir ) )
@@ -183,15 +198,28 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
     const SettingsNode * settings = m_DependencyGraph->GetSettings();
 
     // if the cache is enabled, make sure the path is set and accessible
-    if ( m_Options.m_UseCacheRead || m_Options.m_UseCacheWrite || m_Options.m_CacheInfo || m_Options.m_CacheTrim )
+    if ( m_Options.m_UseCacheRead || m_Options.m_UseCacheWrite || m_Options.m_CacheInfo || m_Options.m_CacheTrim || m_Options.m_CacheTrainDictionary )
     {
         if ( !settings->GetCachePluginDLL().IsEmpty() )
         {
             m_Cache = FNEW( CachePlugin( settings->GetCachePluginDLL() ) );
         }
-        else
+        else if ( HTTPCache::IsHTTPCachePath( settings->GetCachePath() ) )
+        {
+            m_Cache = FNEW( HTTPCache() );
+        }
+        else if ( !settings->GetCachePath().IsEmpty() || settings->GetCacheLocalPath().IsEmpty() )
         {
-            m_Cache = FNEW( Cache() );
+            Cache * cache = FNEW( Cache() );
+            cache->SetSizeLimit( (uint64_t)settings->GetCacheMaxSizeMiB() * MEGABYTE );
+            cache->SetUseSummary( m_Options.m_CacheSummary );
+            m_Cache = cache;
+        }
+
+        // Put a local cache in front of the shared one?
+        if ( !settings->GetCacheLocalPath().IsEmpty() )
+        {
+            m_Cache = FNEW( TieredCache( settings->GetCacheLocalPath(), settings->GetCacheLocalSizeMiB(), m_Cache ) );
         }
 
         if ( m_Cache->Init( settings->GetCachePath(),
@@ -382,6 +410,27 @@ bool FBuild::Build( Node * nodeToBuild )
     // create worker threads
     m_JobQueue = FNEW( JobQueue( m_Options.m_NumWorkerThreads ) );
 
+    // create threads to write to the cache in the background if needed
+    if ( m_Cache && m_Options.m_UseCacheWrite && ( m_Options.m_CachePublishThreads > 0 ) )
+    {
+        m_CachePublisher = FNEW( CachePublisher( m_Cache,
+                                                 m_Options.m_CachePublishThreads,
+                                                 m_Options.m_CacheCompressionLevel,
+                                                 m_Options.m_CacheVerbose ) );
+    }
+
+    // create threads to look up cache entries ahead of building if needed
+    if ( m_Cache && m_Options.m_UseCacheRead && ( m_Options.m_CachePrefetchThreads > 0 ) )
+    {
+        m_CachePrefetcher = FNEW( CachePrefetcher( *m_JobQueue, m_Options.m_CachePrefetchThreads ) );
+    }
+
+    // avoid repeating lookups which missed
+    if ( m_Cache && m_Options.m_UseCacheRead )
+    {
+        m_CacheMissMemo = FNEW( CacheMissMemo );
+    }
+
     // create the connection management system if needed
     // (must be after JobQueue is created)
     if ( m_Options.m_AllowDistributed )
@@ -403,8 +452,10 @@ bool FBuild::Build( Node * nodeToBuild )
         }
         else
         {
-            OUTPUT( "Distributed Compilation : %u Workers in pool '%s'\n", (uint32_t)workers.GetSize(), m_WorkerBrokerage.GetBrokerageRootPaths().Get() );
-            m_Client = FNEW( Client( workers, m_Options.m_DistributionPort, settings->GetWorkerConnectionLimit(), m_Options.m_DistVerbose ) );
+            const bool workersRanked = m_WorkerBrokerage.AreWorkersFromCoordinator();
+            OUTPUT( "Distributed Compilation : %u Workers in pool '%s'\n", (uint32_t)workers.GetSize(), workersRanked ? m_WorkerBrokerage.GetCoordinatorAddress().Get()
+                                                                                                                     : m_WorkerBrokerage.GetBrokerageRootPaths().Get() );
+            m_Client = FNEW( Client( workers, workersRanked, m_Options.m_DistributionPort, settings->GetWorkerConnectionLimit(), settings->GetWorkerConnectionFanOut(), m_Options.m_DistVerbose, m_Options.m_DistDeduplicateJobData, m_Options.m_DistCache, m_Options.m_DistPriority, m_Options.m_DistProtocolVersion_Debug ) );
         }
     }
 
@@ -498,12 +549,37 @@ bool FBuild::Build( Node * nodeToBuild )
             UpdateBuildStatus( nodeToBuild );
         }
 
+        // stop prefetching (jobs it completes or returns are handled below)
+        if ( m_CachePrefetcher )
+        {
+            m_CachePrefetcher->GetStats( m_BuildStats );
+            FDELETE m_CachePrefetcher;
+            m_CachePrefetcher = nullptr;
+        }
+
         // wrap up/free any jobs that come from the last build pass
         m_JobQueue->FinalizeCompletedJobs( *m_DependencyGraph );
 
         FDELETE m_JobQueue;
         m_JobQueue = nullptr;
 
+        // complete any outstanding cache writes
+        if ( m_CachePublisher )
+        {
+            m_CachePublisher->Flush( m_BuildStats );
+            FDELETE m_CachePublisher;
+            m_CachePublisher = nullptr;
+        }
+
+        if ( m_CacheMissMemo )
+        {
+            m_BuildStats.m_CacheKnownMisses += m_CacheMissMemo->GetNumSkipped();
+            FDELETE m_CacheMissMemo;
+            m_CacheMissMemo = nullptr;
+        }
+
+        m_BuildStats.m_CacheTimings.OutputToMonitor();
+
         FLog::StopBuild();
     }
 
@@ -892,6 +968,20 @@ bool FBuild::CacheOutputInfo() const
     return false;
 }
 
+// CacheTrainDictionary
+//------------------------------------------------------------------------------
+bool FBuild::CacheTrainDictionary() const
+{
+    OUTPUT( "CacheTrainDictionary:\n" );
+    if ( m_Cache )
+    {
+        return m_Cache->TrainDictionary( m_Options.m_ShowProgress );
+    }
+
+    OUTPUT( "- Cache not configured\n" );
+    return false;
+}
+
 // CacheTrim
 //------------------------------------------------------------------------------
 bool FBuild::CacheTrim() const
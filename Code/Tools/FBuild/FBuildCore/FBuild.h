@@ -18,6 +18,9 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class CacheMissMemo;
+class CachePrefetcher;
+class CachePublisher;
 class Client;
 class Dependencies;
 class FileStream;
@@ -104,10 +107,14 @@ public:
     static inline volatile bool * GetAbortBuildPointer() { return &s_AbortBuild; }
 
     inline ICache * GetCache() const { return m_Cache; }
+    inline CachePublisher * GetCachePublisher() const { return m_CachePublisher; }
+    inline CachePrefetcher * GetCachePrefetcher() const { return m_CachePrefetcher; }
+    inline CacheMissMemo * GetCacheMissMemo() const { return m_CacheMissMemo; }
 
     static bool GetTempDir( AString & outTempDir );
 
     bool CacheOutputInfo() const;
+    bool CacheTrainDictionary() const;
     bool CacheTrim() const;
 
 protected:
@@ -124,6 +131,9 @@ protected:
 
     AString m_DependencyGraphFile;
     ICache * m_Cache;
+    CachePublisher * m_CachePublisher; // Asynchronous cache writes (during a build)
+    CachePrefetcher * m_CachePrefetcher; // Asynchronous cache lookups (during a build)
+    CacheMissMemo * m_CacheMissMemo; // Cache lookups which missed (during a build)
 
     Timer m_Timer;
     float m_LastProgressOutputTime;
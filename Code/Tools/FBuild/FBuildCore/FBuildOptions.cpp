@@ -130,6 +130,16 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_CacheInfo = true;
                 continue;
             }
+            else if ( thisArg == "-cachesummary" )
+            {
+                m_CacheSummary = true;
+                continue;
+            }
+            else if ( thisArg == "-cachetraindict" )
+            {
+                m_CacheTrainDictionary = true;
+                continue;
+            }
             else if ( thisArg == "-cachetrim" )
             {
                 const int sizeIndex = ( i + 1 );
@@ -178,6 +188,50 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += argv[ sizeIndex ];
                 continue;
             }
+            else if ( thisArg == "-cacheprefetchthreads" )
+            {
+                const int sizeIndex = ( i + 1 );
+                PRAGMA_DISABLE_PUSH_MSVC( 4996 ) // This function or variable may be unsafe...
+                PRAGMA_DISABLE_PUSH_CLANG_WINDOWS( "-Wdeprecated-declarations" ) // 'sscanf' is deprecated: This function or variable may be unsafe...
+                if ( ( sizeIndex >= argc ) ||
+                     ( sscanf( argv[ sizeIndex ], "%u", &m_CachePrefetchThreads ) != 1 ) || // TODO:C Consider using sscanf_s
+                     ( m_CachePrefetchThreads > 64 ) )
+                PRAGMA_DISABLE_POP_CLANG_WINDOWS // -Wdeprecated-declarations
+                PRAGMA_DISABLE_POP_MSVC // 4996
+                {
+                    OUTPUT( "FBuild: Error: Missing or bad <num> for '-cacheprefetchthreads' argument\n" );
+                    OUTPUT( "Try \"%s -help\"\n", programName.Get() );
+                    return OPTIONS_ERROR;
+                }
+                i++; // skip extra arg we've consumed
+
+                // add to args we might pass to subprocess
+                m_Args += ' ';
+                m_Args += argv[ sizeIndex ];
+                continue;
+            }
+            else if ( thisArg == "-cachepublishthreads" )
+            {
+                const int sizeIndex = ( i + 1 );
+                PRAGMA_DISABLE_PUSH_MSVC( 4996 ) // This function or variable may be unsafe...
+                PRAGMA_DISABLE_PUSH_CLANG_WINDOWS( "-Wdeprecated-declarations" ) // 'sscanf' is deprecated: This function or variable may be unsafe...
+                if ( ( sizeIndex >= argc ) ||
+                     ( sscanf( argv[ sizeIndex ], "%u", &m_CachePublishThreads ) != 1 ) || // TODO:C Consider using sscanf_s
+                     ( m_CachePublishThreads > 64 ) )
+                PRAGMA_DISABLE_POP_CLANG_WINDOWS // -Wdeprecated-declarations
+                PRAGMA_DISABLE_POP_MSVC // 4996
+                {
+                    OUTPUT( "FBuild: Error: Missing or bad <num> for '-cachepublishthreads' argument\n" );
+                    OUTPUT( "Try \"%s -help\"\n", programName.Get() );
+                    return OPTIONS_ERROR;
+                }
+                i++; // skip extra arg we've consumed
+
+                // add to args we might pass to subprocess
+                m_Args += ' ';
+                m_Args += argv[ sizeIndex ];
+                continue;
+            }
             else if ( thisArg == "-clean" )
             {
                 m_ForceCleanBuild = true;
@@ -219,6 +273,48 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_AllowDistributed = true;
                 continue;
             }
+            else if ( thisArg == "-distcache" )
+            {
+                m_AllowDistributed = true;
+                m_DistCache = true;
+                continue;
+            }
+            else if ( thisArg == "-distdedup" )
+            {
+                m_AllowDistributed = true;
+                m_DistDeduplicateJobData = true;
+                continue;
+            }
+            else if ( thisArg == "-distpriority" )
+            {
+                const int priorityIndex = ( i + 1 );
+                const AStackString<> priority( ( priorityIndex < argc ) ? argv[ priorityIndex ] : "" );
+                if ( priority == "low" )
+                {
+                    m_DistPriority = Protocol::PRIORITY_LOW;
+                }
+                else if ( priority == "normal" )
+                {
+                    m_DistPriority = Protocol::PRIORITY_NORMAL;
+                }
+                else if ( priority == "high" )
+                {
+                    m_DistPriority = Protocol::PRIORITY_HIGH;
+                }
+                else
+                {
+                    OUTPUT( "FBuild: Error: Missing or bad <low|normal|high> for '-distpriority' argument\n" );
+                    OUTPUT( "Try \"%s -help\"\n", programName.Get() );
+                    return OPTIONS_ERROR;
+                }
+                i++; // skip extra arg we've consumed
+
+                // add to args we might pass to subprocess
+                m_Args += ' ';
+                m_Args += argv[ priorityIndex ];
+                m_AllowDistributed = true;
+                continue;
+            }
             else if ( thisArg == "-distverbose" )
             {
                 m_AllowDistributed = true;
@@ -582,6 +678,15 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             "                   - ==  0 : disable compression\n"
             "                   - >=  1 : more compression, with 12 being the highest\n"
             " -cacheinfo        Output cache statistics.\n"
+            " -cacheprefetchthreads <num>\n"
+            "                   Threads used to look up objects in the cache before\n"
+            "                   they are scheduled (default: 4). 0 disables prefetching.\n"
+            " -cachepublishthreads <num>\n"
+            "                   Threads used to write to the cache in the background\n"
+            "                   (default: 2). 0 writes on the build threads.\n"
+            " -cachesummary     Skip cache lookups of objects absent from the cache's\n"
+            "                   summary of its contents.\n"
+            " -cachetraindict   Train a compression dictionary from the cache contents.\n"
             " -cachetrim <size> Trim the cache to the given size in MiB.\n"
             " -cacheverbose     Emit details about cache interactions.\n"
             " -clean            Force a clean build.\n"
@@ -591,6 +696,13 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             "       Allow builds after a DB move.\n"
             " -debug            (Windows) Break at startup, to attach debugger.\n"
             " -dist             Allow distributed compilation.\n"
+            " -distcache        Allow distributed compilation, with workers using the\n"
+            "                   cache on our behalf (per -cache[read|write]).\n"
+            " -distdedup        Allow distributed compilation, sending only the parts of\n"
+            "                   preprocessed files not already sent to each worker.\n"
+            " -distpriority <low|normal|high>\n"
+            "                   Allow distributed compilation, with the given share of\n"
+            "                   workers used by other builds (default: normal).\n"
             " -distverbose      Print detailed info for distributed compilation.\n"
             " -dot[full]        Emit known dependency tree info for specified targets to an\n"
             "                   fbuild.gv file in DOT format.\n"
@@ -66,16 +66,25 @@ public:
     bool        m_UseCacheRead                      = false;
     bool        m_UseCacheWrite                     = false;
     bool        m_CacheInfo                         = false;
+    bool        m_CacheSummary                      = false;
+    bool        m_CacheTrainDictionary              = false;
     bool        m_CacheVerbose                      = false;
     uint32_t    m_CacheTrim                         = 0;
     int32_t     m_CacheCompressionLevel             = -1; // See Compresssor.h
+    uint32_t    m_CachePrefetchThreads              = 4; // 0 = look up cache on build threads
+    uint32_t    m_CachePublishThreads               = 2; // 0 = write to cache on build threads
 
     // Distributed Compilation
     bool        m_AllowDistributed                  = false;
     bool        m_DistVerbose                       = false;
+    bool        m_DistCache                         = false;
+    bool        m_DistDeduplicateJobData            = false;
+    uint8_t     m_DistPriority                      = Protocol::PRIORITY_NORMAL;
     bool        m_NoLocalConsumptionOfRemoteJobs    = false;
     bool        m_AllowLocalRace                    = true;
     uint16_t    m_DistributionPort                  = Protocol::PROTOCOL_PORT;
+    uint32_t    m_DistProtocolVersion_Debug         = Protocol::PROTOCOL_VERSION; // Emulate an older client (for tests)
+    bool        m_DistCacheKeyMismatch_Debug        = false; // Send workers cache keys which don't match the job (for tests)
 
     // General Output
     bool        m_ShowVerbose                       = false;
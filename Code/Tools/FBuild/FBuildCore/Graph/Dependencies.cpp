@@ -12,16 +12,79 @@
 
 // Core
 #include "Core/FileIO/IOStream.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+
+#include <string.h>
+
+// Defines
+//------------------------------------------------------------------------------
+// How a list of dependencies is saved when sharing with previously saved lists
+enum : uint8_t
+{
+    DEPS_SAVED_IN_FULL      = 0,    // All dependencies follow
+    DEPS_SAVED_AS_REFERENCE = 1,    // Identical to a previously saved list
+    DEPS_SAVED_WITH_PREFIX  = 2,    // Starts with the dependencies of a previously saved list
+};
+static const uint32_t INVALID_SET_INDEX( 0xFFFFFFFF );
 
 // Save
 //------------------------------------------------------------------------------
 void Dependencies::Save( IOStream & stream ) const
 {
-    const size_t numDeps = GetSize();
+    SaveRange( stream, Begin(), End() );
+}
+
+// Save
+//------------------------------------------------------------------------------
+void Dependencies::Save( IOStream & stream, DependencySetSaver & saver ) const
+{
+    // Empty lists are not worth sharing
+    if ( IsEmpty() )
+    {
+        stream.Write( (uint8_t)DEPS_SAVED_IN_FULL );
+        Save( stream );
+        return;
+    }
+
+    // Identical to a previously saved list?
+    const uint64_t hash = DependencySetSaver::CalcHash( *this );
+    const uint32_t identicalIndex = saver.FindIdentical( *this, hash );
+    if ( identicalIndex != INVALID_SET_INDEX )
+    {
+        stream.Write( (uint8_t)DEPS_SAVED_AS_REFERENCE );
+        stream.Write( identicalIndex );
+        return;
+    }
+
+    // Starts the same way as the previously saved list?
+    uint32_t prefixIndex = INVALID_SET_INDEX;
+    const uint32_t prefixLength = saver.GetPrefixLength( *this, prefixIndex );
+    if ( prefixLength > 0 )
+    {
+        stream.Write( (uint8_t)DEPS_SAVED_WITH_PREFIX );
+        stream.Write( prefixIndex );
+        stream.Write( prefixLength );
+        SaveRange( stream, Begin() + prefixLength, End() );
+    }
+    else
+    {
+        stream.Write( (uint8_t)DEPS_SAVED_IN_FULL );
+        Save( stream );
+    }
+
+    saver.AddSavedSet( *this, hash );
+}
+
+// SaveRange
+//------------------------------------------------------------------------------
+/*static*/ void Dependencies::SaveRange( IOStream & stream, const Dependency * begin, const Dependency * end )
+{
+    const size_t numDeps = (size_t)( end - begin );
     stream.Write( (uint32_t)numDeps );
 
-    Iter endIt = End();
-    for ( Iter it = Begin(); it != endIt; ++it )
+    for ( const Dependency * it = begin; it != end; ++it )
     {
         const Dependency & dep = *it;
 
@@ -45,12 +108,92 @@ bool Dependencies::Load( NodeGraph & nodeGraph, IOStream & stream )
 {
     ASSERT( IsEmpty() );
 
+    return LoadAppend( nodeGraph, stream );
+}
+
+// Load
+//------------------------------------------------------------------------------
+bool Dependencies::Load( NodeGraph & nodeGraph, IOStream & stream, DependencySetLoader & loader )
+{
+    ASSERT( IsEmpty() );
+
+    uint8_t saveMode;
+    if ( stream.Read( saveMode ) == false )
+    {
+        return false;
+    }
+
+    switch ( saveMode )
+    {
+        case DEPS_SAVED_IN_FULL:
+        {
+            if ( LoadAppend( nodeGraph, stream ) == false )
+            {
+                return false;
+            }
+            if ( IsEmpty() == false )
+            {
+                loader.AddLoadedSet( *this );
+            }
+            return true;
+        }
+        case DEPS_SAVED_AS_REFERENCE:
+        {
+            uint32_t setIndex;
+            if ( stream.Read( setIndex ) == false )
+            {
+                return false;
+            }
+            const Dependencies * other = loader.GetLoadedSet( setIndex );
+            if ( other == nullptr )
+            {
+                return false; // Corrupt DB
+            }
+
+            // Share the set
+            Append( *other );
+            m_SharedSet = loader.Intern( nodeGraph, setIndex );
+            return true;
+        }
+        case DEPS_SAVED_WITH_PREFIX:
+        {
+            uint32_t setIndex;
+            uint32_t prefixLength;
+            if ( ( stream.Read( setIndex ) == false ) ||
+                 ( stream.Read( prefixLength ) == false ) )
+            {
+                return false;
+            }
+            const Dependencies * other = loader.GetLoadedSet( setIndex );
+            if ( ( other == nullptr ) || ( prefixLength > other->GetSize() ) )
+            {
+                return false; // Corrupt DB
+            }
+
+            // Copy the prefix and load the remainder
+            SetCapacity( prefixLength );
+            Append( other->Begin(), other->Begin() + prefixLength );
+            if ( LoadAppend( nodeGraph, stream ) == false )
+            {
+                return false;
+            }
+            loader.AddLoadedSet( *this );
+            return true;
+        }
+        default: return false; // Corrupt DB
+    }
+}
+
+// LoadAppend
+//------------------------------------------------------------------------------
+bool Dependencies::LoadAppend( NodeGraph & nodeGraph, IOStream & stream )
+{
     uint32_t numDeps;
     if ( stream.Read( numDeps ) == false )
     {
         return false;
     }
-    SetCapacity( numDeps );
+    SetCapacity( GetSize() + numDeps );
     for ( uint32_t i=0; i<numDeps; ++i )
     {
         // Read node index
@@ -83,4 +226,127 @@ bool Dependencies::Load( NodeGraph & nodeGraph, IOStream & stream )
     }
     return true;
 }
+
+// Clear
+//------------------------------------------------------------------------------
+void Dependencies::Clear()
+{
+    Array< Dependency >::Clear();
+    m_SharedSet = nullptr;
+}
+
+// DependencySetSaver (CONSTRUCTOR)
+//------------------------------------------------------------------------------
+DependencySetSaver::DependencySetSaver()
+    : m_SavedSets( 0, true )
+    , m_Buckets( FNEW_ARRAY( uint32_t[ NUM_BUCKETS ] ) )
+{
+    memset( m_Buckets, 0xFF, sizeof( uint32_t ) * NUM_BUCKETS );
+}
+
+// DependencySetSaver (DESTRUCTOR)
+//------------------------------------------------------------------------------
+DependencySetSaver::~DependencySetSaver()
+{
+    FDELETE_ARRAY( m_Buckets );
+}
+
+// FindIdentical
+//------------------------------------------------------------------------------
+uint32_t DependencySetSaver::FindIdentical( const Dependencies & deps, uint64_t hash ) const
+{
+    uint32_t setIndex = m_Buckets[ hash & ( NUM_BUCKETS - 1 ) ];
+    while ( setIndex != INVALID_SET_INDEX )
+    {
+        const SavedSet & savedSet = m_SavedSets[ setIndex ];
+        if ( ( savedSet.m_Hash == hash ) &&
+             ( savedSet.m_Deps->GetSize() == deps.GetSize() ) &&
+             AreIdentical( *savedSet.m_Deps, deps, deps.GetSize() ) )
+        {
+            return setIndex;
+        }
+        setIndex = savedSet.m_Next;
+    }
+    return INVALID_SET_INDEX;
+}
+
+// GetPrefixLength
+//------------------------------------------------------------------------------
+uint32_t DependencySetSaver::GetPrefixLength( const Dependencies & deps, uint32_t & outSetIndex ) const
+{
+    // Lists are saved in dependency order, so similar lists (objects in the
+    // same ObjectList for example) tend to be saved one after the other
+    if ( m_SavedSets.IsEmpty() )
+    {
+        return 0;
+    }
+    const Dependencies & previous = *m_SavedSets.Top().m_Deps;
+    const size_t maxLength = Math::Min( previous.GetSize(), deps.GetSize() );
+    size_t length = 0;
+    while ( ( length < maxLength ) && AreIdentical( previous[ length ], deps[ length ] ) )
+    {
+        ++length;
+    }
+    outSetIndex = (uint32_t)( m_SavedSets.GetSize() - 1 );
+    return (uint32_t)length;
+}
+
+// AddSavedSet
+//------------------------------------------------------------------------------
+void DependencySetSaver::AddSavedSet( const Dependencies & deps, uint64_t hash )
+{
+    const uint32_t setIndex = (uint32_t)m_SavedSets.GetSize();
+    uint32_t & bucket = m_Buckets[ hash & ( NUM_BUCKETS - 1 ) ];
+    m_SavedSets.Append( SavedSet{ &deps, hash, bucket } );
+    bucket = setIndex;
+}
+
+// CalcHash
+//------------------------------------------------------------------------------
+/*static*/ uint64_t DependencySetSaver::CalcHash( const Dependencies & deps )
+{
+    // Hash only the serialized fields (Dependency contains padding)
+    Array< uint64_t > data( deps.GetSize() * 2, false );
+    for ( const Dependency & dep : deps )
+    {
+        data.Append( ( (uint64_t)dep.GetNode()->GetIndex() << 1 ) | ( dep.IsWeak() ? 1 : 0 ) );
+        data.Append( dep.GetNodeStamp() );
+    }
+    return xxHash::Calc64( data.Begin(), data.GetSize() * sizeof( uint64_t ) );
+}
+
+// AreIdentical
+//------------------------------------------------------------------------------
+/*static*/ bool DependencySetSaver::AreIdentical( const Dependencies & depsA, const Dependencies & depsB, size_t num )
+{
+    for ( size_t i = 0; i < num; ++i )
+    {
+        if ( AreIdentical( depsA[ i ], depsB[ i ] ) == false )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// AreIdentical
+//------------------------------------------------------------------------------
+/*static*/ bool DependencySetSaver::AreIdentical( const Dependency & depA, const Dependency & depB )
+{
+    return ( depA.GetNode() == depB.GetNode() ) &&
+           ( depA.GetNodeStamp() == depB.GetNodeStamp() ) &&
+           ( depA.IsWeak() == depB.IsWeak() );
+}
+
+// Intern
+//------------------------------------------------------------------------------
+DependencySet * DependencySetLoader::Intern( NodeGraph & nodeGraph, uint32_t index )
+{
+    Dependencies & deps = *m_LoadedSets[ index ];
+    if ( deps.GetSharedSet() == nullptr )
+    {
+        deps.SetSharedSet( nodeGraph.CreateDependencySet() );
+    }
+    return deps.GetSharedSet();
+}
 //------------------------------------------------------------------------------
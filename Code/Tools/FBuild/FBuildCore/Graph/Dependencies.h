@@ -8,6 +8,9 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class DependencySet;
+class DependencySetLoader;
+class DependencySetSaver;
 class IOStream;
 class Node;
 class NodeGraph;
@@ -57,6 +60,92 @@ public:
 
     void Save( IOStream & stream ) const;
     bool Load( NodeGraph & nodeGraph, IOStream & stream );
+
+    // Save/Load, sharing storage with identical or prefix-identical lists saved earlier
+    void Save( IOStream & stream, DependencySetSaver & saver ) const;
+    bool Load( NodeGraph & nodeGraph, IOStream & stream, DependencySetLoader & loader );
+
+    // Clearing also removes the list from any DependencySet it belongs to
+    void Clear();
+
+    // Lists identical to other lists in the graph are interned when loaded
+    inline DependencySet *  GetSharedSet() const { return m_SharedSet; }
+    inline void             SetSharedSet( DependencySet * set ) { m_SharedSet = set; }
+
+private:
+    static void SaveRange( IOStream & stream, const Dependency * begin, const Dependency * end );
+    bool        LoadAppend( NodeGraph & nodeGraph, IOStream & stream );
+
+    DependencySet * m_SharedSet = nullptr;
+};
+
+// DependencySet
+//  - Dependencies shared (identically) by several nodes, typically the includes
+//    of translation units in the same module
+//  - The result of checking the set for changes is cached so each set is
+//    only checked once per build
+//------------------------------------------------------------------------------
+class DependencySet
+{
+public:
+    enum CheckResult : uint8_t
+    {
+        NOT_CHECKED,
+        UNCHANGED,
+        CHANGED,
+    };
+
+    inline CheckResult  GetCheckResult() const                  { return m_CheckResult; }
+    inline void         SetCheckResult( CheckResult result )    { m_CheckResult = result; }
+
+private:
+    CheckResult m_CheckResult = NOT_CHECKED;
+};
+
+// DependencySetSaver
+//  - Tracks lists saved so far so that subsequent identical lists can be
+//    saved as a reference and similar lists can share a prefix
+//------------------------------------------------------------------------------
+class DependencySetSaver
+{
+public:
+    explicit DependencySetSaver();
+    ~DependencySetSaver();
+
+    uint32_t    FindIdentical( const Dependencies & deps, uint64_t hash ) const;
+    uint32_t    GetPrefixLength( const Dependencies & deps, uint32_t & outSetIndex ) const;
+    void        AddSavedSet( const Dependencies & deps, uint64_t hash );
+
+    static uint64_t CalcHash( const Dependencies & deps );
+
+private:
+    static bool AreIdentical( const Dependencies & depsA, const Dependencies & depsB, size_t num );
+    static bool AreIdentical( const Dependency & depA, const Dependency & depB );
+
+    struct SavedSet
+    {
+        const Dependencies *    m_Deps;
+        uint64_t                m_Hash;
+        uint32_t                m_Next;     // Next SavedSet in same bucket
+    };
+    enum : uint32_t { NUM_BUCKETS = 65536 };
+    Array< SavedSet >   m_SavedSets;
+    uint32_t *          m_Buckets;
+};
+
+// DependencySetLoader
+//  - Resolves references to previously loaded lists, interning each referenced
+//    list as a DependencySet owned by the NodeGraph
+//------------------------------------------------------------------------------
+class DependencySetLoader
+{
+public:
+    inline const Dependencies * GetLoadedSet( uint32_t index ) const { return ( index < m_LoadedSets.GetSize() ) ? m_LoadedSets[ index ] : nullptr; }
+    void                        AddLoadedSet( Dependencies & deps ) { m_LoadedSets.Append( &deps ); }
+    DependencySet *             Intern( NodeGraph & nodeGraph, uint32_t index );
+
+private:
+    Array< Dependencies * > m_LoadedSets;
 };
 
 //------------------------------------------------------------------------------
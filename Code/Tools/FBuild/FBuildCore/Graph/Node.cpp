@@ -183,6 +183,22 @@ bool Node::DetermineNeedToBuild( const Dependencies & deps ) const
         }
     }
 
+    // Nodes sharing an identical set of dependencies only need to check them once
+    DependencySet * sharedSet = deps.GetSharedSet();
+    if ( sharedSet )
+    {
+        switch ( sharedSet->GetCheckResult() )
+        {
+            case DependencySet::NOT_CHECKED:    break;
+            case DependencySet::UNCHANGED:      return false;
+            case DependencySet::CHANGED:
+            {
+                FLOG_BUILD_REASON( "Need to build '%s' (shared deps changed)\n", GetName().Get() );
+                return true;
+            }
+        }
+    }
+
     // static deps
     for ( const Dependency & dep : deps )
     {
@@ -199,6 +215,10 @@ bool Node::DetermineNeedToBuild( const Dependencies & deps ) const
         {
             // file missing - this may be ok, but node needs to build to find out
             FLOG_BUILD_REASON( "Need to build '%s' (dep missing: '%s')\n", GetName().Get(), n->GetName().Get() );
+            if ( sharedSet )
+            {
+                sharedSet->SetCheckResult( DependencySet::CHANGED );
+            }
             return true;
         }
 
@@ -208,9 +228,17 @@ bool Node::DetermineNeedToBuild( const Dependencies & deps ) const
         if ( stamp != oldStamp )
         {
             FLOG_BUILD_REASON( "Need to build '%s' (dep changed: '%s', %" PRIu64 " -> %" PRIu64 ")\n", GetName().Get(), n->GetName().Get(), oldStamp, stamp );
+            if ( sharedSet )
+            {
+                sharedSet->SetCheckResult( DependencySet::CHANGED );
+            }
             return true;
         }
     }
+    if ( sharedSet )
+    {
+        sharedSet->SetCheckResult( DependencySet::UNCHANGED );
+    }
 
     // nothing needs building
     return false;
@@ -241,6 +269,9 @@ bool Node::DetermineNeedToBuild( const Dependencies & deps ) const
     Dependencies * allDeps[2] = { &m_StaticDependencies, &m_DynamicDependencies };
     for ( Dependencies * deps : allDeps )
     {
+        // Restamped dependencies can no longer be shared
+        deps->SetSharedSet( nullptr );
+
         for ( Dependency & dep : *deps )
         {
             // If not built, each node should have a non-zero node stamp
@@ -348,7 +379,7 @@ void Node::SetLastBuildTime( uint32_t ms )
 
 // Load
 //------------------------------------------------------------------------------
-/*static*/ Node * Node::Load( NodeGraph & nodeGraph, IOStream & stream )
+/*static*/ Node * Node::Load( NodeGraph & nodeGraph, IOStream & stream, DependencySetLoader & depSetLoader )
 {
     // read type
     uint8_t nodeType;
@@ -394,7 +425,7 @@ void Node::SetLastBuildTime( uint32_t ms )
     // Dependencies
     if ( ( n->m_PreBuildDependencies.Load( nodeGraph, stream ) == false ) ||
          ( n->m_StaticDependencies.Load( nodeGraph, stream ) == false ) ||
-         ( n->m_DynamicDependencies.Load( nodeGraph, stream ) == false ) )
+         ( n->m_DynamicDependencies.Load( nodeGraph, stream, depSetLoader ) == false ) )
     {
         return nullptr;
     }
@@ -420,7 +451,7 @@ void Node::SetLastBuildTime( uint32_t ms )
 
 // Save
 //------------------------------------------------------------------------------
-/*static*/ void Node::Save( IOStream & stream, const Node * node )
+/*static*/ void Node::Save( IOStream & stream, const Node * node, DependencySetSaver & depSetSaver )
 {
     ASSERT( node );
 
@@ -455,7 +486,7 @@ void Node::SetLastBuildTime( uint32_t ms )
     // Deps
     node->m_PreBuildDependencies.Save( stream );
     node->m_StaticDependencies.Save( stream );
-    node->m_DynamicDependencies.Save( stream );
+    node->m_DynamicDependencies.Save( stream, depSetSaver ); // Often identical between nodes
 
     // Properties
     const ReflectionInfo * const ri = node->GetReflectionInfoV();
@@ -152,8 +152,8 @@ public:
     inline void     SetProgressAccumulator( uint32_t p ) const { m_ProgressAccumulator = p; }
 
     static Node *   CreateNode( NodeGraph & nodeGraph, Node::Type nodeType, const AString & name );
-    static Node *   Load( NodeGraph & nodeGraph, IOStream & stream );
-    static void     Save( IOStream & stream, const Node * node );
+    static Node *   Load( NodeGraph & nodeGraph, IOStream & stream, DependencySetLoader & depSetLoader );
+    static void     Save( IOStream & stream, const Node * node, DependencySetSaver & depSetSaver );
     virtual void    PostLoad( NodeGraph & nodeGraph ); // TODO:C Eliminate the need for this function
 
     static Node *   LoadRemote( IOStream & stream );
@@ -190,6 +190,7 @@ public:
     inline const Dependencies & GetDynamicDependencies() const { return m_DynamicDependencies; }
 
 protected:
+    friend class CachePublisher;
     friend class FBuild;
     friend struct FBuildStats;
     friend class Function;
@@ -68,6 +68,7 @@
 NodeGraph::NodeGraph()
 : m_AllNodes( 1024, true )
 , m_NextNodeIndex( 0 )
+, m_DependencySets( 0, true )
 , m_UsedFiles( 16, true )
 , m_Settings( nullptr )
 {
@@ -86,6 +87,11 @@ NodeGraph::~NodeGraph()
         FDELETE ( *i );
     }
 
+    for ( DependencySet * depSet : m_DependencySets )
+    {
+        FDELETE depSet;
+    }
+
     FDELETE_ARRAY( m_NodeMap );
 }
 
@@ -424,9 +430,10 @@ NodeGraph::LoadResult NodeGraph::Load( IOStream & stream, const char * nodeGraph
 
     m_AllNodes.SetSize( numNodes );
     memset( m_AllNodes.Begin(), 0, numNodes * sizeof( Node * ) );
+    DependencySetLoader depSetLoader;
     for ( uint32_t i=0; i<numNodes; ++i )
     {
-        if ( LoadNode( stream ) == false )
+        if ( LoadNode( stream, depSetLoader ) == false )
         {
             return LoadResult::LOAD_ERROR;
         }
@@ -464,7 +471,7 @@ NodeGraph::LoadResult NodeGraph::Load( IOStream & stream, const char * nodeGraph
 
 // LoadNode
 //------------------------------------------------------------------------------
-bool NodeGraph::LoadNode( IOStream & stream )
+bool NodeGraph::LoadNode( IOStream & stream, DependencySetLoader & depSetLoader )
 {
     // load index
     uint32_t nodeIndex( INVALID_NODE_INDEX );
@@ -478,7 +485,7 @@ bool NodeGraph::LoadNode( IOStream & stream )
     m_NextNodeIndex = nodeIndex;
 
     // load specifics (create node)
-    const Node * const n = Node::Load( *this, stream );
+    const Node * const n = Node::Load( *this, stream, depSetLoader );
     if ( n == nullptr )
     {
         return false;
@@ -560,9 +567,10 @@ void NodeGraph::Save( IOStream & stream, const char* nodeGraphDBFile ) const
     Array< bool > savedNodeFlags( numNodes, false );
     savedNodeFlags.SetSize( numNodes );
     memset( savedNodeFlags.Begin(), 0, numNodes );
+    DependencySetSaver depSetSaver;
     for ( size_t i=0; i<numNodes; ++i )
     {
-        SaveRecurse( stream, m_AllNodes[ i ], savedNodeFlags );
+        SaveRecurse( stream, m_AllNodes[ i ], savedNodeFlags, depSetSaver );
     }
 
     // sanity check saving
@@ -574,7 +582,7 @@ void NodeGraph::Save( IOStream & stream, const char* nodeGraphDBFile ) const
 
 // SaveRecurse
 //------------------------------------------------------------------------------
-/*static*/ void NodeGraph::SaveRecurse( IOStream & stream, Node * node, Array< bool > & savedNodeFlags )
+/*static*/ void NodeGraph::SaveRecurse( IOStream & stream, Node * node, Array< bool > & savedNodeFlags, DependencySetSaver & depSetSaver )
 {
     // ignore any already saved nodes
     uint32_t nodeIndex = node->GetIndex();
@@ -585,9 +593,9 @@ void NodeGraph::Save( IOStream & stream, const char* nodeGraphDBFile ) const
     }
 
     // Dependencies
-    SaveRecurse( stream, node->GetPreBuildDependencies(), savedNodeFlags );
-    SaveRecurse( stream, node->GetStaticDependencies(), savedNodeFlags );
-    SaveRecurse( stream, node->GetDynamicDependencies(), savedNodeFlags );
+    SaveRecurse( stream, node->GetPreBuildDependencies(), savedNodeFlags, depSetSaver );
+    SaveRecurse( stream, node->GetStaticDependencies(), savedNodeFlags, depSetSaver );
+    SaveRecurse( stream, node->GetDynamicDependencies(), savedNodeFlags, depSetSaver );
 
     // save this node
     ASSERT( savedNodeFlags[ nodeIndex ] == false ); // sanity check recursion
@@ -596,20 +604,20 @@ void NodeGraph::Save( IOStream & stream, const char* nodeGraphDBFile ) const
     stream.Write( nodeIndex );
 
     // save node specific data
-    Node::Save( stream, node );
+    Node::Save( stream, node, depSetSaver );
 
     savedNodeFlags[ nodeIndex ] = true; // mark as saved
 }
 
 // SaveRecurse
 //------------------------------------------------------------------------------
-/*static*/ void NodeGraph::SaveRecurse( IOStream & stream, const Dependencies & dependencies, Array< bool > & savedNodeFlags )
+/*static*/ void NodeGraph::SaveRecurse( IOStream & stream, const Dependencies & dependencies, Array< bool > & savedNodeFlags, DependencySetSaver & depSetSaver )
 {
     const Dependency * const end = dependencies.End();
     for ( const Dependency * it = dependencies.Begin(); it != end; ++it )
     {
         Node * n = it->GetNode();
-        SaveRecurse( stream, n, savedNodeFlags );
+        SaveRecurse( stream, n, savedNodeFlags, depSetSaver );
     }
 }
 
@@ -1164,6 +1172,17 @@ TextFileNode* NodeGraph::CreateTextFileNode( const AString& nodeName )
     return node;
 }
 
+// CreateDependencySet
+//------------------------------------------------------------------------------
+DependencySet * NodeGraph::CreateDependencySet()
+{
+    ASSERT( Thread::IsMainThread() );
+
+    DependencySet * depSet = FNEW( DependencySet() );
+    m_DependencySets.Append( depSet );
+    return depSet;
+}
+
 // AddNode
 //------------------------------------------------------------------------------
 void NodeGraph::AddNode( Node * node )
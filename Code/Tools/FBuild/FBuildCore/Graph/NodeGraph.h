@@ -21,6 +21,9 @@ class CopyDirNode;
 class CopyFileNode;
 class CSNode;
 class Dependencies;
+class DependencySet;
+class DependencySetLoader;
+class DependencySetSaver;
 class DirectoryListNode;
 class DLLNode;
 class ExeNode;
@@ -59,7 +62,7 @@ public:
     }
     inline ~NodeGraphHeader() = default;
 
-    enum : uint8_t { NODE_GRAPH_CURRENT_VERSION = 159 };
+    enum : uint8_t { NODE_GRAPH_CURRENT_VERSION = 165 };
 
     bool IsValid() const
     {
@@ -132,6 +135,9 @@ public:
     ListDependenciesNode* CreateListDependenciesNode( const AString& name );
     TextFileNode * CreateTextFileNode( const AString & name );
 
+    // dependency lists shared between nodes
+    DependencySet * CreateDependencySet();
+
     void DoBuildPass( Node * nodeToBuild );
 
     static void CleanPath( AString & name, bool makeFullPath = true );
@@ -179,9 +185,9 @@ private:
     uint32_t GetLibEnvVarHash() const;
 
     // load/save helpers
-    static void SaveRecurse( IOStream & stream, Node * node, Array< bool > & savedNodeFlags );
-    static void SaveRecurse( IOStream & stream, const Dependencies & dependencies, Array< bool > & savedNodeFlags );
-    bool LoadNode( IOStream & stream );
+    static void SaveRecurse( IOStream & stream, Node * node, Array< bool > & savedNodeFlags, DependencySetSaver & depSetSaver );
+    static void SaveRecurse( IOStream & stream, const Dependencies & dependencies, Array< bool > & savedNodeFlags, DependencySetSaver & depSetSaver );
+    bool LoadNode( IOStream & stream, DependencySetLoader & depSetLoader );
     static void SerializeToText( Node * node, uint32_t depth, AString & outBuffer );
     static void SerializeToText( const char * title, const Dependencies & dependencies, uint32_t depth, AString & outBuffer );
     static void SerializeToDot( Node * node,
@@ -210,6 +216,7 @@ private:
     Node **         m_NodeMap;
     Array< Node * > m_AllNodes;
     uint32_t        m_NextNodeIndex;
+    Array< DependencySet * > m_DependencySets;
 
     Timer m_Timer;
 
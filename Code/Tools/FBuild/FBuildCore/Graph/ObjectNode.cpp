@@ -7,6 +7,8 @@
 
 #include "Tools/FBuild/FBuildCore/BFF/Functions/FunctionObjectList.h"
 #include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheMissMemo.h"
+#include "Tools/FBuild/FBuildCore/Cache/CachePublisher.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Cache/LightCache.h"
@@ -187,6 +189,13 @@ ObjectNode::~ObjectNode()
 //------------------------------------------------------------------------------
 /*virtual*/ Node::BuildResult ObjectNode::DoBuild( Job * job )
 {
+    // Already retrieved from the cache by the CachePrefetcher?
+    if ( job->GetCachePrefetchResult() == Job::CACHE_PREFETCH_HIT )
+    {
+        job->GetBuildProfilerScope()->SetStepName( "Cache Hit" );
+        return NODE_RESULT_OK_CACHE;
+    }
+
     // Set a sensible catch-all default name for compilation. This will be modified
     // for various cases
     job->GetBuildProfilerScope()->SetStepName( "Compile" );
@@ -229,6 +238,19 @@ ObjectNode::~ObjectNode()
     // Graphing the current amount of distributable jobs
     FLOG_MONITOR( "GRAPH FASTBuild \"Distributable Jobs MemUsage\" MB %f\n", (double)( (float)Job::GetTotalLocalDataMemoryUsage() / (float)MEGABYTE ) );
 
+    // GCC/Clang can emit dependencies as a side effect of compilation, so if
+    // we don't need the preprocessed output for caching or distribution, we
+    // can avoid a separate preprocessing pass
+    if ( GetCompiler()->GetUseDepFile() &&
+         ( GetFlag( FLAG_GCC ) || GetFlag( FLAG_CLANG ) ) &&
+         !useCache &&
+         !useDist &&
+         !useSimpleDist &&
+         ( GetDedicatedPreprocessor() == nullptr ) )
+    {
+        return DoBuildWithDepFile( job, useDeoptimization );
+    }
+
     if ( usePreProcessor || useSimpleDist )
     {
         return DoBuildWithPreProcessor( job, useDeoptimization, useCache, useSimpleDist );
@@ -402,8 +424,11 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
     // Try to use the light cache if enabled
     if ( useCache && GetCompiler()->GetUseLightCache() )
     {
+        // The CachePrefetcher may have already hashed and checked the cache
+        const bool prefetched = ( job->GetCachePrefetchResult() == Job::CACHE_PREFETCH_MISS );
+
         LightCache lc;
-        if ( lc.Hash( this, fullArgs.GetFinalArgs(), m_LightCacheKey, m_Includes ) == false )
+        if ( ( prefetched == false ) && ( lc.Hash( this, fullArgs.GetFinalArgs(), m_LightCacheKey, m_Includes ) == false ) )
         {
             // Light cache could not be used (can't parse includes)
             if ( FBuild::Get().GetOptions().m_CacheVerbose )
@@ -418,14 +443,17 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
         }
         else
         {
-            // LightCache hashing was successful
-            SetStatFlag( Node::STATS_LIGHT_CACHE ); // Light compatible
-
-            // Try retrieve from cache
-            GetCacheName( job ); // Prepare the cache key (always done here even if write only mode)
-            if ( RetrieveFromCache( job ) )
+            if ( prefetched == false )
             {
-                return NODE_RESULT_OK_CACHE;
+                // LightCache hashing was successful
+                SetStatFlag( Node::STATS_LIGHT_CACHE ); // Light compatible
+
+                // Try retrieve from cache
+                GetCacheName( job ); // Prepare the cache key (always done here even if write only mode)
+                if ( RetrieveFromCache( job ) )
+                {
+                    return NODE_RESULT_OK_CACHE;
+                }
             }
 
             // Cache miss
@@ -491,9 +519,10 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
     const bool belowMemoryLimit = ( ( Job::GetTotalLocalDataMemoryUsage() / MEGABYTE ) < FBuild::Get().GetSettings()->GetDistributableJobMemoryLimitMiB() );
     if ( canDistribute && belowMemoryLimit )
     {
-        // compress job data
+        // compress job data (using the cache's dictionary, which is sent to workers as needed)
+        const ICache * cache = FBuild::Get().GetCache();
         Compressor c;
-        c.Compress( job->GetData(), job->GetDataSize() );
+        c.CompressChunked( job->GetData(), job->GetDataSize(), -1, cache ? cache->GetCompressionDictionary() : nullptr );
         size_t compressedSize = c.GetResultSize();
         job->OwnData( c.ReleaseResult(), compressedSize, true );
 
@@ -767,6 +796,57 @@ Node::BuildResult ObjectNode::DoBuild_QtRCC( Job * job )
     return NODE_RESULT_OK;
 }
 
+// DoBuildWithDepFile
+//------------------------------------------------------------------------------
+Node::BuildResult ObjectNode::DoBuildWithDepFile( Job * job, bool useDeoptimization )
+{
+    // Format compiler args string
+    Args fullArgs;
+    const bool showIncludes( false );
+    const bool useSourceMapping( true );
+    const bool finalize( false ); // We'll add the dependency file args
+    if ( !BuildArgs( job, fullArgs, PASS_COMPILE, useDeoptimization, showIncludes, useSourceMapping, finalize ) )
+    {
+        return NODE_RESULT_FAILED; // BuildArgs will have emitted an error
+    }
+
+    // Have the compiler write the dependencies to a file in our thread-local
+    // temp dir as a side effect of compilation
+    AStackString<> depFileName;
+    {
+        const char * lastSlash = GetName().FindLast( NATIVE_SLASH );
+        AStackString<> fileName( lastSlash ? ( lastSlash + 1 ) : GetName().Get() );
+        fileName += ".d";
+        WorkerThread::CreateTempFilePath( fileName.Get(), depFileName );
+    }
+    fullArgs += " -MD -MF \"";
+    fullArgs += depFileName;
+    fullArgs += '"';
+    if ( fullArgs.Finalize( GetCompiler()->GetExecutable(), GetName(), GetResponseFileMode() ) == false )
+    {
+        return NODE_RESULT_FAILED; // Finalize will have emitted an error
+    }
+
+    EmitCompilationMessage( fullArgs, useDeoptimization );
+
+    // spawn the process
+    const bool result = BuildFinalOutput( job, fullArgs ) &&
+                        ProcessIncludesWithDepFile( depFileName );
+
+    // cleanup temp file
+    FileIO::FileDelete( depFileName.Get() );
+
+    if ( result == false )
+    {
+        return NODE_RESULT_FAILED; // BuildFinalOutput or ProcessIncludesWithDepFile will have emitted an error
+    }
+
+    // record new file time
+    RecordStampFromBuiltFile();
+
+    return NODE_RESULT_OK;
+}
+
 // ProcessIncludesMSCL
 //------------------------------------------------------------------------------
 bool ObjectNode::ProcessIncludesMSCL( const char * output, uint32_t outputSize )
@@ -854,6 +934,48 @@ bool ObjectNode::ProcessIncludesWithPreProcessor( Job * job )
     return true;
 }
 
+// ProcessIncludesWithDepFile
+//------------------------------------------------------------------------------
+bool ObjectNode::ProcessIncludesWithDepFile( const AString & depFileName )
+{
+    Timer t;
+
+    {
+        // Read dependency file written by the compiler
+        FileStream f;
+        if ( f.Open( depFileName.Get(), FileStream::READ_ONLY ) == false )
+        {
+            FLOG_ERROR( "Failed to open dependency file '%s' for '%s'. Error: %s", depFileName.Get(), GetName().Get(), LAST_ERROR_STR );
+            return false;
+        }
+        const uint32_t fileSize = (uint32_t)f.GetFileSize();
+        AString depFile;
+        depFile.SetLength( fileSize );
+        if ( f.Read( depFile.Get(), fileSize ) != fileSize )
+        {
+            FLOG_ERROR( "Failed to read dependency file '%s' for '%s'. Error: %s", depFileName.Get(), GetName().Get(), LAST_ERROR_STR );
+            return false;
+        }
+
+        CIncludeParser parser;
+        if ( parser.ParseGCC_DepFile( depFile.Get(), depFile.GetLength() ) == false )
+        {
+            FLOG_ERROR( "Failed to process includes for '%s'", GetName().Get() );
+            return false;
+        }
+
+        // record that we have a list of includes
+        // (we need a flag because we can't use the array size
+        // as a determinator, because the file might not include anything)
+        m_Includes.Clear();
+        parser.SwapIncludes( m_Includes );
+    }
+
+    FLOG_VERBOSE( "Process Includes:\n - File: %s\n - Time: %u ms\n - Num : %u", m_Name.Get(), uint32_t( t.GetElapsedMS() ), uint32_t( m_Includes.GetSize() ) );
+
+    return true;
+}
+
 // LoadRemote
 //------------------------------------------------------------------------------
 /*static*/ Node * ObjectNode::LoadRemote( IOStream & stream )
@@ -1296,9 +1418,33 @@ bool ObjectNode::RetrieveFromCache( Job * job )
     ICache * cache = FBuild::Get().GetCache();
     ASSERT( cache );
 
+    // Don't repeat lookups which missed earlier in the build
+    CacheMissMemo * memo = FBuild::Get().GetCacheMissMemo();
     void * cacheData( nullptr );
     size_t cacheDataSize( 0 );
-    if ( cache->Retrieve( cacheFileName, cacheData, cacheDataSize ) )
+    const bool knownMiss = ( memo && memo->IsKnownMiss( cacheFileName ) );
+    const bool found = ( knownMiss == false ) && cache->Retrieve( cacheFileName, cacheData, cacheDataSize );
+    if ( knownMiss == false )
+    {
+        FBuild::Get().GetStatsMutable().m_CacheTimings.Record( found ? CacheTimings::TRANSFER : CacheTimings::LOOKUP, t.GetElapsedMS(), cacheDataSize );
+        if ( ( found == false ) && memo )
+        {
+            memo->RecordMiss( cacheFileName );
+        }
+    }
+    return ExtractFromCache( job, found, cacheData, cacheDataSize, t );
+}
+
+// ExtractFromCache
+//------------------------------------------------------------------------------
+bool ObjectNode::ExtractFromCache( Job * job, bool found, void * cacheData, size_t cacheDataSize, const Timer & t )
+{
+    PROFILE_FUNCTION;
+
+    const AString & cacheFileName = GetCacheName( job );
+    ICache * cache = FBuild::Get().GetCache();
+
+    if ( found )
     {
         const uint32_t retrieveTime = uint32_t( t.GetElapsedMS() );
 
@@ -1309,50 +1455,53 @@ bool ObjectNode::RetrieveFromCache( Job * job )
             pchKey = xxHash::Calc64( cacheData, cacheDataSize );
         }
 
-        const uint32_t startDecompress = uint32_t( t.GetElapsedMS() );
+        Array< AString > fileNames( 4, false );
+        fileNames.Append( m_Name );
+
+        GetExtraCacheFilePaths( job, fileNames );
+
+        const float startDecompressMS = t.GetElapsedMS();
+        const uint32_t startDecompress = uint32_t( startDecompressMS );
 
         // do decompression
         Compressor c;
         if ( c.IsValidData( cacheData, cacheDataSize ) == false )
         {
+            cache->FreeMemory( cacheData, cacheDataSize );
             FLOG_WARN( "Cache returned invalid data (header)\n"
                        " - File: '%s'\n"
                        " - Key : %s\n",
                        m_Name.Get(), cacheFileName.Get() );
             return false;
         }
-        if ( c.Decompress( cacheData ) == false )
+
+        // Extract the files, decompressing directly into them
+        MultiBufferFileExtractor extractor( fileNames );
+        const bool decompressOK = c.Decompress( cacheData, extractor );
+        if ( extractor.HasWriteError() )
+        {
+            cache->FreeMemory( cacheData, cacheDataSize );
+            FLOG_ERROR( "Failed to write local file during cache retrieval '%s'", fileNames[ extractor.GetFailedFileIndex() ].Get() );
+            return false;
+        }
+        if ( ( decompressOK == false ) || ( extractor.IsComplete() == false ) )
         {
+            cache->FreeMemory( cacheData, cacheDataSize );
             FLOG_WARN( "Cache returned invalid data (payload)\n"
                        " - File: '%s'\n"
                        " - Key : %s\n",
                        m_Name.Get(), cacheFileName.Get() );
             return false;
         }
-        const void * data = c.GetResult();
-        const size_t dataSize = c.GetResultSize();
-
-        const uint32_t stopDecompress = uint32_t( t.GetElapsedMS() );
-
-        MultiBuffer buffer( data, dataSize );
-
-        Array< AString > fileNames( 4, false );
-        fileNames.Append( m_Name );
+        const size_t dataSize = (size_t)extractor.Tell();
 
-        GetExtraCacheFilePaths( job, fileNames );
+        const float stopDecompressMS = t.GetElapsedMS();
+        const uint32_t stopDecompress = uint32_t( stopDecompressMS );
 
-        // Extract the files
+        // Update file modification times
         const size_t numFiles = fileNames.GetSize();
         for ( size_t i=0; i<numFiles; ++i )
         {
-            if ( !buffer.ExtractFile( i, fileNames[ i ] ) )
-            {
-                cache->FreeMemory( cacheData, cacheDataSize );
-                FLOG_ERROR( "Failed to write local file during cache retrieval '%s'", fileNames[ i ].Get() );
-                return false;
-            }
-
-            // Update file modification time
             const bool timeSetOK = FileIO::SetFileLastWriteTimeToNow( fileNames[ i ] );
 
             // set the time on the local file
@@ -1366,6 +1515,12 @@ bool ObjectNode::RetrieveFromCache( Job * job )
 
         cache->FreeMemory( cacheData, cacheDataSize );
 
+        // Decompression is interleaved with writing the files
+        CacheTimings & cacheTimings = FBuild::Get().GetStatsMutable().m_CacheTimings;
+        const float writeMS = extractor.GetWriteTimeMS();
+        cacheTimings.Record( CacheTimings::DECOMPRESS, Math::Max( ( stopDecompressMS - startDecompressMS ) - writeMS, 0.0f ), dataSize );
+        cacheTimings.Record( CacheTimings::WRITE, writeMS + ( t.GetElapsedMS() - stopDecompressMS ), dataSize );
+
         FileIO::WorkAroundForWindowsFilePermissionProblem( m_Name );
 
         // record new file time (note that time may differ from what we set above due to
@@ -1410,6 +1565,65 @@ bool ObjectNode::RetrieveFromCache( Job * job )
     return false;
 }
 
+// ShouldPrefetchFromCache
+//------------------------------------------------------------------------------
+bool ObjectNode::ShouldPrefetchFromCache() const
+{
+    // Only objects whose cache key can be calculated without preprocessing
+    // can be looked up ahead of time (must match the DoBuild logic)
+    return FBuild::Get().GetOptions().m_UseCacheRead &&
+           ShouldUseCache() &&
+           GetCompiler()->GetUseLightCache() &&
+           ( GetCompiler()->SimpleDistributionMode() == false ) &&
+           ( GetDedicatedPreprocessor() == nullptr );
+}
+
+// PrepareCachePrefetch
+//------------------------------------------------------------------------------
+bool ObjectNode::PrepareCachePrefetch( Job * job )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( job->GetCachePrefetchResult() == Job::CACHE_PREFETCH_NONE );
+
+    // Args are not finalized here since that can create a response file, which
+    // must be done on a worker thread. Args which would use a response file
+    // are hashed differently, so leave those to be handled normally.
+    Args fullArgs;
+    const bool showIncludes( false );
+    const bool useSourceMapping( true );
+    const bool finalize( false );
+    if ( !BuildArgs( job, fullArgs, PASS_PREPROCESSOR_ONLY, ShouldUseDeoptimization(), showIncludes, useSourceMapping, finalize ) ||
+         fullArgs.RequiresResponseFile( GetCompiler()->GetExecutable(), GetResponseFileMode() ) )
+    {
+        return false;
+    }
+
+    LightCache lc;
+    if ( lc.Hash( this, fullArgs.GetRawArgs(), m_LightCacheKey, m_Includes ) == false )
+    {
+        return false; // Normal build will handle (and report) this
+    }
+    SetStatFlag( Node::STATS_LIGHT_CACHE ); // Light compatible
+
+    // Ensure output path exists so files can be extracted
+    if ( EnsurePathExistsForFile( GetName() ) == false )
+    {
+        return false; // Normal build will report the error
+    }
+
+    GetCacheName( job ); // Prepare the cache key (also used for cache writes)
+    return true;
+}
+
+// CompleteCachePrefetch
+//------------------------------------------------------------------------------
+void ObjectNode::CompleteCachePrefetch( Job * job, bool found, void * cacheData, size_t cacheDataSize, const Timer & t )
+{
+    const bool hit = ExtractFromCache( job, found, cacheData, cacheDataSize, t );
+    job->SetCachePrefetchResult( hit ? Job::CACHE_PREFETCH_HIT : Job::CACHE_PREFETCH_MISS );
+}
+
 // WriteToCache
 //------------------------------------------------------------------------------
 void ObjectNode::WriteToCache( Job * job )
@@ -1437,16 +1651,41 @@ void ObjectNode::WriteToCache( Job * job )
     MultiBuffer buffer;
     if ( buffer.CreateFromFiles( fileNames ) )
     {
+        // Lookups which missed earlier in the build can now succeed
+        CacheMissMemo * memo = FBuild::Get().GetCacheMissMemo();
+        if ( memo )
+        {
+            memo->RecordPublish( cacheFileName );
+        }
+
+        // Hand off compression and publishing to background threads, unless
+        // this is an MSVC PCH, as dependent objects need the PCH key immediately
+        CachePublisher * publisher = FBuild::Get().GetCachePublisher();
+        if ( publisher && ( ( GetFlag( FLAG_CREATING_PCH ) && GetFlag( FLAG_MSVC ) ) == false ) )
+        {
+            size_t uncompressedSize;
+            void * uncompressedData = buffer.Release( uncompressedSize );
+            publisher->Enqueue( this, cacheFileName, uncompressedData, uncompressedSize );
+            AddCachingTime( uint32_t( t.GetElapsedMS() ) );
+            return;
+        }
+
         // try to compress
-        const uint32_t startCompress( (uint32_t)t.GetElapsedMS() );
+        const float startCompressMS = t.GetElapsedMS();
+        const uint32_t startCompress( (uint32_t)startCompressMS );
         Compressor c;
-        c.Compress( buffer.GetData(), (size_t)buffer.GetDataSize(), FBuild::Get().GetOptions().m_CacheCompressionLevel );
+        c.CompressChunked( buffer.GetData(), (size_t)buffer.GetDataSize(), FBuild::Get().GetOptions().m_CacheCompressionLevel, cache->GetCompressionDictionary() );
         const void * data = c.GetResult();
         const size_t dataSize = c.GetResultSize();
-        const uint32_t stopCompress( (uint32_t)t.GetElapsedMS() );
+        const float stopCompressMS = t.GetElapsedMS();
+        const uint32_t stopCompress( (uint32_t)stopCompressMS );
+        CacheTimings & cacheTimings = FBuild::Get().GetStatsMutable().m_CacheTimings;
+        cacheTimings.Record( CacheTimings::COMPRESS, stopCompressMS - startCompressMS, (uint64_t)buffer.GetDataSize() );
 
         const uint32_t startPublish( stopCompress );
-        if ( cache->Publish( cacheFileName, data, dataSize ) )
+        const bool published = cache->Publish( cacheFileName, data, dataSize );
+        cacheTimings.Record( CacheTimings::PUBLISH, t.GetElapsedMS() - stopCompressMS, dataSize );
+        if ( published )
         {
             // cache store complete
             const uint32_t stopPublish( (uint32_t)t.GetElapsedMS() );
@@ -2406,11 +2645,22 @@ bool ObjectNode::WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpF
     Compressor c; // scoped here so we can access decompression buffer
     if ( job->IsDataCompressed() )
     {
-        VERIFY( c.Decompress( dataToWrite ) );
+        if ( c.Decompress( dataToWrite ) == false )
+        {
+            job->Error( "Failed to decompress job data (dictionary %08X). Target: '%s'", Compressor::GetDictionaryId( dataToWrite ), GetName().Get() );
+            job->OnSystemError();
+            return NODE_RESULT_FAILED;
+        }
         dataToWrite = c.GetResult();
         dataToWriteSize = c.GetResultSize();
     }
 
+    // On the worker, hash what was received so the cache key can be checked before publishing
+    if ( ( job->IsLocal() == false ) && ( job->GetRemoteCacheAccess() & Job::REMOTE_CACHE_ACCESS_WRITE ) )
+    {
+        job->SetRemoteSourceHash( xxHash::Calc64( dataToWrite, dataToWriteSize ) );
+    }
+
     WorkerThread::GetTempFileDirectory( tmpDirectory );
     tmpDirectory.AppendFormat( "%08X%c", sourceNameHash, NATIVE_SLASH );
     if ( FileIO::DirectoryCreate( tmpDirectory ) == false )
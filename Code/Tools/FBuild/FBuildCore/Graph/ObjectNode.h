@@ -19,6 +19,7 @@ class Function;
 class NodeGraph;
 class NodeProxy;
 class ObjectNode;
+class Timer;
 enum class ArgsResponseFileMode : uint32_t;
 
 // ObjectNode
@@ -100,6 +101,11 @@ public:
 
     const AString & GetPCHObjectName() const { return m_PCHObjectFileName; }
     const AString & GetOwnerObjectList() const { return m_OwnerObjectList; }
+
+    // Cache prefetching (see CachePrefetcher)
+    bool ShouldPrefetchFromCache() const;
+    bool PrepareCachePrefetch( Job * job );
+    void CompleteCachePrefetch( Job * job, bool found, void * cacheData, size_t cacheDataSize, const Timer & t );
 private:
     virtual BuildResult DoBuild( Job * job ) override;
     virtual BuildResult DoBuild2( Job * job, bool racingRemoteJob ) override;
@@ -116,12 +122,15 @@ private:
                                           bool isFollowingLightCacheMiss );
     BuildResult DoBuild_QtRCC( Job * job );
     BuildResult DoBuildOther( Job * job, bool useDeoptimization );
+    BuildResult DoBuildWithDepFile( Job * job, bool useDeoptimization );
 
     bool ProcessIncludesMSCL( const char * output, uint32_t outputSize );
     bool ProcessIncludesWithPreProcessor( Job * job );
+    bool ProcessIncludesWithDepFile( const AString & depFileName );
 
     const AString & GetCacheName( Job * job ) const;
     bool RetrieveFromCache( Job * job );
+    bool ExtractFromCache( Job * job, bool found, void * cacheData, size_t cacheDataSize, const Timer & t );
     void WriteToCache( Job * job );
     void GetExtraCacheFilePaths( const Job * job, Array< AString > & outFileNames ) const;
 
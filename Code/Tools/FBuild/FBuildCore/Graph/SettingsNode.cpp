@@ -29,8 +29,12 @@ REFLECT_NODE_BEGIN( SettingsNode, Node, MetaNone() )
     REFLECT(        m_CachePathMountPoint,      "CachePathMountPoint",      MetaOptional() )
     REFLECT(        m_CachePluginDLL,           "CachePluginDLL",           MetaOptional() )
     REFLECT(        m_CachePluginDLLConfig,     "CachePluginDLLConfig",     MetaOptional() )
+    REFLECT(        m_CacheLocalPath,           "CacheLocalPath",           MetaOptional() + MetaPath() )
+    REFLECT(        m_CacheLocalSizeMiB,        "CacheLocalSizeMiB",        MetaOptional() + MetaRange( 1, 1024 * 1024 ) )
+    REFLECT(        m_CacheMaxSizeMiB,          "CacheMaxSizeMiB",          MetaOptional() + MetaRange( 0, 1024 * 1024 * 1024 ) )
     REFLECT_ARRAY(  m_Workers,                  "Workers",                  MetaOptional() )
     REFLECT(        m_WorkerConnectionLimit,    "WorkerConnectionLimit",    MetaOptional() )
+    REFLECT(        m_WorkerConnectionFanOut,   "WorkerConnectionFanOut",   MetaOptional() + MetaRange( 1, 64 ) )
     REFLECT(        m_DistributableJobMemoryLimitMiB, "DistributableJobMemoryLimitMiB", MetaOptional() + MetaRange( DIST_MEMORY_LIMIT_MIN, DIST_MEMORY_LIMIT_MAX ) )
     REFLECT(        m_DisableDBMigration,       "DisableDBMigration",       MetaOptional() )
 REFLECT_END( SettingsNode )
@@ -39,7 +43,10 @@ REFLECT_END( SettingsNode )
 //------------------------------------------------------------------------------
 SettingsNode::SettingsNode()
 : Node( AString::GetEmpty(), Node::SETTINGS_NODE, Node::FLAG_NONE )
+, m_CacheLocalSizeMiB( 10 * 1024 )
+, m_CacheMaxSizeMiB( 0 )
 , m_WorkerConnectionLimit( 15 )
+, m_WorkerConnectionFanOut( 8 )
 , m_DistributableJobMemoryLimitMiB( DIST_MEMORY_LIMIT_DEFAULT )
 , m_DisableDBMigration( false )
 {
@@ -29,8 +29,12 @@ public:
     const AString &                     GetCachePathMountPoint() const;
     const AString &                     GetCachePluginDLL() const;
     const AString &                     GetCachePluginDLLConfig() const;
+    const AString &                     GetCacheLocalPath() const { return m_CacheLocalPath; }
+    uint32_t                            GetCacheLocalSizeMiB() const { return m_CacheLocalSizeMiB; }
+    uint32_t                            GetCacheMaxSizeMiB() const { return m_CacheMaxSizeMiB; }
     inline const Array< AString > &     GetWorkerList() const { return m_Workers; }
     uint32_t                            GetWorkerConnectionLimit() const { return m_WorkerConnectionLimit; }
+    uint32_t                            GetWorkerConnectionFanOut() const { return m_WorkerConnectionFanOut; }
     uint32_t                            GetDistributableJobMemoryLimitMiB() const { return m_DistributableJobMemoryLimitMiB; }
     bool                                GetDisableDBMigration() const { return m_DisableDBMigration; }
 
@@ -48,8 +52,12 @@ private:
     AString             m_CachePathMountPoint;
     AString             m_CachePluginDLL;
     AString             m_CachePluginDLLConfig;
+    AString             m_CacheLocalPath;
+    uint32_t            m_CacheLocalSizeMiB;
+    uint32_t            m_CacheMaxSizeMiB;
     Array< AString  >   m_Workers;
     uint32_t            m_WorkerConnectionLimit;
+    uint32_t            m_WorkerConnectionFanOut;
     uint32_t            m_DistributableJobMemoryLimitMiB;
     bool                m_DisableDBMigration; // TODO:C Remove this option some time after v0.99
 };
@@ -104,16 +104,7 @@ bool Args::Finalize( const AString & exe, const AString & nodeNameForError, Args
     // as well as the args: "%exe%" %args%
     const uint32_t totalLen = ( argLen + exeLen + extraLen );
 
-    #if defined( __WINDOWS__ )
-        // Windows has a 32KiB (inc null terminator) command line length limit with CreateProcess
-        // https://msdn.microsoft.com/en-us/library/windows/desktop/ms682425(v=vs.85).aspx
-        const uint32_t argLimit( 32767 );
-    #elif defined( __OSX__ )
-        const uint32_t argLimit( ARG_MAX - 1 );
-    #elif defined( __LINUX__ )
-        // On Linux it's problematic to reliably determine this, so we make a best guess
-        const uint32_t argLimit( ( 128 * 1024 ) - 1 );
-    #endif
+    const uint32_t argLimit = GetCommandLineLimit();
 
     // If the args exceed the cmd line limit, a response file is required
     const bool needResponseFile = ( totalLen >= argLimit );
@@ -178,6 +169,38 @@ bool Args::Finalize( const AString & exe, const AString & nodeNameForError, Args
     return true; // Ok to proceed
 }
 
+// RequiresResponseFile
+//------------------------------------------------------------------------------
+bool Args::RequiresResponseFile( const AString & exe, ArgsResponseFileMode responseFileMode ) const
+{
+    switch ( responseFileMode )
+    {
+        case ArgsResponseFileMode::NEVER:       return false;
+        case ArgsResponseFileMode::ALWAYS:      return true;
+        case ArgsResponseFileMode::IF_NEEDED:   break;
+    }
+
+    // Same calculation as Finalize: "%exe%" %args%
+    const uint32_t totalLen = ( m_Args.GetLength() + exe.GetLength() + 3 );
+    return ( totalLen >= GetCommandLineLimit() );
+}
+
+// GetCommandLineLimit
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Args::GetCommandLineLimit()
+{
+    #if defined( __WINDOWS__ )
+        // Windows has a 32KiB (inc null terminator) command line length limit with CreateProcess
+        // https://msdn.microsoft.com/en-us/library/windows/desktop/ms682425(v=vs.85).aspx
+        return 32767;
+    #elif defined( __OSX__ )
+        return ( ARG_MAX - 1 );
+    #elif defined( __LINUX__ )
+        // On Linux it's problematic to reliably determine this, so we make a best guess
+        return ( ( 128 * 1024 ) - 1 );
+    #endif
+}
+
 // Generate
 //------------------------------------------------------------------------------
 /*static*/ void Args::StripQuotes( const char * start, const char * end, AString & out )
@@ -48,6 +48,9 @@ public:
     // Do final fixups and create response file if needed/supported
     bool Finalize( const AString & exe, const AString & nodeNameForError, ArgsResponseFileMode responseFileMode );
 
+    // Check if Finalize would create a response file
+    bool RequiresResponseFile( const AString & exe, ArgsResponseFileMode responseFileMode ) const;
+
     // After finalization, access args
     const AString& GetRawArgs() const   { return m_Args; }
     const AString& GetFinalArgs() const { ASSERT( m_Finalized ); return m_ResponseFileArgs.IsEmpty() ? m_Args : m_ResponseFileArgs; }
@@ -56,6 +59,8 @@ public:
     static void StripQuotes( const char * start, const char * end, AString & out );
 
 protected:
+    static uint32_t GetCommandLineLimit();
+
     AStackString< 4096 >    m_Args;
     AString                 m_ResponseFileArgs;
     Array< uint32_t >       m_DelimiterIndices;
@@ -6,6 +6,7 @@
 #include "BuildProfiler.h"
 
 // FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FBuildOptions.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
@@ -188,6 +189,9 @@ bool BuildProfiler::SaveJSON( const FBuildOptions & options,  const char * fileN
         }
     }
 
+    // Serialize cache operation timings
+    SerializeCacheStats( buffer, (uint64_t)( (double)saveStart * freqMul ) );
+
     // Open output file and write the majority of the profiling info
     FileStream f;
     if ( ( f.Open( fileName, FileStream::WRITE_ONLY ) == false ) ||
@@ -209,6 +213,54 @@ bool BuildProfiler::SaveJSON( const FBuildOptions & options,  const char * fileN
     return( f.WriteBuffer( buffer.Get(), buffer.GetLength() ) == buffer.GetLength() );
 }
 
+// SerializeCacheStats
+//------------------------------------------------------------------------------
+void BuildProfiler::SerializeCacheStats( AString & buffer, uint64_t timeStamp ) const
+{
+    if ( FBuild::IsValid() == false )
+    {
+        return;
+    }
+
+    // Emit an instant event summarizing each operation, at the end of the build
+    const CacheTimings & cacheTimings = FBuild::Get().GetStats().m_CacheTimings;
+    AStackString<> bucketName;
+    for ( uint32_t i = 0; i < CacheTimings::NUM_OPERATIONS; ++i )
+    {
+        CacheTimings::OperationStats stats;
+        cacheTimings.GetStats( (CacheTimings::Operation)i, stats );
+        if ( stats.m_Count == 0 )
+        {
+            continue;
+        }
+
+        buffer.AppendFormat( "{\"name\":\"Cache %s\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%" PRIu64 ",\"pid\":%i,\"tid\":0,\"args\":{"
+                             "\"count\":%u,\"totalMS\":%.3f,\"bytes\":%" PRIu64 ",\"p50MS\":%.3f,\"p90MS\":%.3f,\"p99MS\":%.3f,\"maxMS\":%.3f,\"histogram\":{",
+                             CacheTimings::GetOperationName( (CacheTimings::Operation)i ),
+                             timeStamp,
+                             Event::LOCAL_MACHINE_ID,
+                             stats.m_Count,
+                             (double)stats.m_TotalTimeUS / 1000.0,
+                             stats.m_Bytes,
+                             (double)CacheTimings::GetPercentileMS( stats, 50 ),
+                             (double)CacheTimings::GetPercentileMS( stats, 90 ),
+                             (double)CacheTimings::GetPercentileMS( stats, 99 ),
+                             (double)stats.m_MaxTimeUS / 1000.0 );
+        bool first = true;
+        for ( uint32_t bucket = 0; bucket < CacheTimings::NUM_BUCKETS; ++bucket )
+        {
+            if ( stats.m_Buckets[ bucket ] == 0 )
+            {
+                continue;
+            }
+            CacheTimings::GetBucketName( bucket, bucketName );
+            buffer.AppendFormat( "%s\"%s\":%u", first ? "" : ",", bucketName.Get(), stats.m_Buckets[ bucket ] );
+            first = false;
+        }
+        buffer += "}}},";
+    }
+}
+
 // MetricsThreadWrapper
 //------------------------------------------------------------------------------
 /*static*/ uint32_t BuildProfiler::MetricsThreadWrapper( void * /*userData*/ )
@@ -52,6 +52,7 @@ public:
 
 protected:
     static uint32_t MetricsThreadWrapper( void * userData );
+    void SerializeCacheStats( AString & buffer, uint64_t timeStamp ) const;
     void MetricsUpdate();
 
     // Items processed during the build
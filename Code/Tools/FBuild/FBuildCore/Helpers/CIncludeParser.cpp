@@ -359,6 +359,113 @@ bool CIncludeParser::ParseGCC_Preprocessed( const char * compilerOutput,
 }
 PRAGMA_DISABLE_POP_MSVC
 
+// ParseGCC_DepFile
+//  - Parse a Makefile style dependency file as written by GCC/Clang -MD -MF
+//------------------------------------------------------------------------------
+bool CIncludeParser::ParseGCC_DepFile( const char * depFile, size_t depFileSize )
+{
+    // we require null terminated input
+    ASSERT( depFile[ depFileSize ] == 0 );
+    (void)depFileSize;
+
+    // Skip the target. It ends at the first colon followed by whitespace
+    // (colons can also be part of paths on Windows)
+    const char * pos = depFile;
+    for ( ;; )
+    {
+        pos = strchr( pos, ':' );
+        if ( !pos )
+        {
+            return false; // corrupt input
+        }
+        ++pos;
+        const char c = *pos;
+        if ( ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' ) || ( c == '\n' ) || ( c == 0 ) )
+        {
+            break;
+        }
+    }
+
+    AStackString< 256 > include;
+    bool isSourceFile = true; // first prerequisite is the file being compiled
+    for ( ;; )
+    {
+        // skip whitespace and line continuations
+        for ( ;; )
+        {
+            const char c = *pos;
+            if ( ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' ) )
+            {
+                ++pos;
+                continue;
+            }
+            if ( c == '\\' )
+            {
+                if ( pos[ 1 ] == '\n' )
+                {
+                    pos += 2;
+                    continue;
+                }
+                if ( ( pos[ 1 ] == '\r' ) && ( pos[ 2 ] == '\n' ) )
+                {
+                    pos += 3;
+                    continue;
+                }
+            }
+            break;
+        }
+
+        // end of rule? (subsequent rules are phony targets from -MP which we ignore)
+        if ( ( *pos == 0 ) || ( *pos == '\n' ) )
+        {
+            break;
+        }
+
+        // extract path, handling escaped characters
+        include.Clear();
+        for ( ;; )
+        {
+            const char c = *pos;
+            if ( ( c == 0 ) || ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' ) || ( c == '\n' ) )
+            {
+                break;
+            }
+            if ( c == '\\' )
+            {
+                const char next = pos[ 1 ];
+                if ( ( next == ' ' ) || ( next == '#' ) )
+                {
+                    include += next;
+                    pos += 2;
+                    continue;
+                }
+                if ( ( next == '\n' ) || ( next == '\r' ) )
+                {
+                    break; // line continuation
+                }
+            }
+            if ( ( c == '$' ) && ( pos[ 1 ] == '$' ) )
+            {
+                include += '$';
+                pos += 2;
+                continue;
+            }
+            include += c;
+            ++pos;
+        }
+
+        if ( isSourceFile )
+        {
+            isSourceFile = false;
+            continue;
+        }
+
+        AddInclude( include.Get(), include.GetEnd() );
+    }
+
+    return true;
+}
+
 // SwapIncludes
 //------------------------------------------------------------------------------
 void CIncludeParser::SwapIncludes( Array< AString > & includes )
@@ -11,17 +11,157 @@
 // Core
 #include "Core/Containers/UniquePtr.h"
 #include "Core/Env/Assert.h"
+#include "Core/FileIO/IOStream.h"
 #include "Core/Env/Types.h"
 #include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 
 // External
+#define LZ4_STATIC_LINKING_ONLY // For LZ4_attach_dictionary
 #include "lz4.h"
 #include "lz4hc.h"
 
 #include <memory.h>
 
+// CompressorThreadPool
+//  - Threads which help callers process the chunks of chunked data. Callers
+//    process chunks too, so progress never depends on a thread being available.
+//------------------------------------------------------------------------------
+class CompressorThreadPool
+{
+public:
+    explicit CompressorThreadPool( uint32_t numThreads );
+    ~CompressorThreadPool();
+
+    typedef void (*ChunkFunction)( void * userData, uint32_t chunkIndex, void * & ioState );
+
+    class Task
+    {
+    public:
+        explicit Task( uint32_t numChunks, ChunkFunction function, void * userData )
+            : m_Function( function )
+            , m_UserData( userData )
+            , m_NumChunks( numChunks )
+            , m_NextChunk( 0 )
+            , m_NumHelpers( 0 )
+        {}
+
+        void Process();
+        bool HasUnclaimedChunks() const { return ( AtomicLoadRelaxed( &m_NextChunk ) < m_NumChunks ); }
+
+        ChunkFunction       m_Function;
+        void *              m_UserData;
+        uint32_t            m_NumChunks;
+        volatile uint32_t   m_NextChunk;
+        uint32_t            m_NumHelpers;       // Threads processing chunks, protected by pool mutex
+        Semaphore           m_HelperFinished;
+    };
+
+    // Process all chunks of the task, returning once they are complete
+    void Run( Task & task );
+
+    uint32_t GetNumThreads() const { return (uint32_t)m_Threads.GetSize(); }
+
+private:
+    static uint32_t ThreadFuncStatic( void * param );
+    void ThreadFunc();
+
+    volatile bool                   m_ThreadExit;
+    Semaphore                       m_WorkSemaphore;
+    Mutex                           m_Mutex;
+    Array< Task * >                 m_Tasks;    // Tasks which may have unclaimed chunks
+    Array< Thread::ThreadHandle >   m_Threads;
+};
+
+// Static Data
+//------------------------------------------------------------------------------
+static Mutex g_DictionariesMutex;
+static Compressor::Dictionary * g_Dictionaries = nullptr; // Registered dictionaries (linked list)
+static CompressorThreadPool * g_ThreadPool = nullptr;
+
+// Chunks decompressed together when streaming, if the thread pool exists
+static const uint32_t kStreamChunksPerBatch = 16;
+
+// ChunkContext
+//  - Shared by the threads processing the chunks of some data
+//------------------------------------------------------------------------------
+class ChunkContext
+{
+public:
+    const char *                    m_Data;             // Uncompressed data (compression)
+    char *                          m_Output;           // Uncompressed data (decompression)
+    size_t                          m_DataSize;
+    char *                          m_Slots;            // Worst case sized space for each compressed chunk
+    size_t                          m_SlotSize;
+    int32_t                         m_CompressionLevel;
+    const Compressor::Dictionary *  m_Dictionary;
+    const char * const *            m_Chunks;           // Location of each compressed chunk
+    const char *                    m_ChunksEnd;
+    volatile bool                   m_Failed;
+};
+
+// DictionaryReference
+//  - Keeps a dictionary registered while data compressed with it is decompressed
+//    (the owner may release it concurrently)
+//------------------------------------------------------------------------------
+class DictionaryReference
+{
+public:
+    explicit DictionaryReference( const Compressor::Dictionary * dictionary ) : m_Dictionary( dictionary ) {}
+    ~DictionaryReference() { Compressor::ReleaseDictionary( m_Dictionary ); }
+    DictionaryReference( const DictionaryReference & ) = delete;
+    DictionaryReference & operator = ( const DictionaryReference & ) = delete;
+
+private:
+    const Compressor::Dictionary * m_Dictionary;
+};
+
+// Dictionary training
+//------------------------------------------------------------------------------
+static const size_t kDmerSize = 8;          // Length of content compared
+static const size_t kSegmentSize = 256;     // Length of content selected
+static const uint32_t kDmerTableBits = 20;
+
+// HashDmer
+//------------------------------------------------------------------------------
+static inline uint32_t HashDmer( const char * dmer )
+{
+    uint64_t value;
+    memcpy( &value, dmer, sizeof( value ) );
+    return (uint32_t)( ( value * 0xCF1BBCDCB7A56463ULL ) >> ( 64 - kDmerTableBits ) );
+}
+
+// Dictionary CONSTRUCTOR
+//------------------------------------------------------------------------------
+Compressor::Dictionary::Dictionary( const void * data, uint32_t dataSize, uint32_t id )
+    : m_Id( id )
+    , m_DataSize( dataSize )
+    , m_RefCount( 1 )
+    , m_Data( (char *)ALLOC( dataSize ) )
+    , m_Stream( ALLOC( sizeof( LZ4_stream_t ) ) )
+    , m_Next( nullptr )
+{
+    memcpy( m_Data, data, dataSize );
+
+    // Prepare the dictionary once, so it can be attached to each compression cheaply
+    LZ4_stream_t * stream = LZ4_initStream( m_Stream, sizeof( LZ4_stream_t ) );
+    LZ4_loadDict( stream, m_Data, (int)dataSize );
+}
+
+// Dictionary DESTRUCTOR
+//------------------------------------------------------------------------------
+Compressor::Dictionary::~Dictionary()
+{
+    FREE( m_Stream );
+    FREE( m_Data );
+}
+
 //------------------------------------------------------------------------------
 Compressor::Compressor()
     : m_Result( nullptr )
@@ -41,7 +181,7 @@ Compressor::~Compressor()
 bool Compressor::IsValidData( const void * data, size_t dataSize ) const
 {
     const Header * header = (const Header *)data;
-    if ( header->m_CompressionType > 1 )
+    if ( header->m_CompressionType > COMPRESSION_TYPE_LZ4_CHUNKED_DICT )
     {
         return false;
     }
@@ -58,7 +198,7 @@ bool Compressor::IsValidData( const void * data, size_t dataSize ) const
 
 // Compress
 //------------------------------------------------------------------------------
-bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressionLevel )
+bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressionLevel, const Dictionary * dictionary )
 {
     PROFILE_FUNCTION;
 
@@ -72,16 +212,11 @@ bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressi
     int32_t compressedSize;
 
     // do compression
-    if ( compressionLevel > 0 )
+    if ( compressionLevel != 0 )
     {
-        // Higher compression, using LZ4HC
-        compressedSize = LZ4_compress_HC( (const char*)data, output.Get(), (int)dataSize, worstCaseSize, compressionLevel );
-    }
-    else if ( compressionLevel < 0 )
-    {
-        // Lower compression, using regular LZ4
-        const int32_t acceleration = ( 0 - compressionLevel );
-        compressedSize = LZ4_compress_fast( (const char*)data, output.Get(), (int)dataSize, worstCaseSize, acceleration );
+        void * state = nullptr;
+        compressedSize = CompressBlock( (const char *)data, (int)dataSize, output.Get(), worstCaseSize, compressionLevel, dictionary, state );
+        FREE( state );
     }
     else
     {
@@ -89,15 +224,23 @@ bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressi
         compressedSize = (int32_t)dataSize; // Act as if compression achieved nothing
     }
 
+    // data compressed with a dictionary is preceded by the dictionary id
+    const size_t prefixSize = dictionary ? sizeof( uint32_t ) : 0;
+
     // did the compression yield any benefit?
-    const bool compressed = ( compressedSize < (int)dataSize );
+    const bool compressed = ( compressedSize > 0 ) && ( ( (size_t)compressedSize + prefixSize ) < dataSize );
 
     if ( compressed )
     {
         // trim memory usage to compressed size
-        m_Result = ALLOC( (uint32_t)compressedSize + sizeof( Header ) );
-        memcpy( (char *)m_Result + sizeof( Header ), output.Get(), (size_t)compressedSize );
-        m_ResultSize = (uint32_t)compressedSize + sizeof( Header );
+        m_ResultSize = (size_t)compressedSize + prefixSize + sizeof( Header );
+        m_Result = ALLOC( m_ResultSize );
+        if ( dictionary )
+        {
+            const uint32_t dictionaryId = dictionary->GetId();
+            memcpy( (char *)m_Result + sizeof( Header ), &dictionaryId, sizeof( uint32_t ) );
+        }
+        memcpy( (char *)m_Result + sizeof( Header ) + prefixSize, output.Get(), (size_t)compressedSize );
     }
     else
     {
@@ -109,9 +252,9 @@ bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressi
 
     // fill out header
     Header * header = (Header*)m_Result;
-    header->m_CompressionType = compressed ? 1u : 0u;   // compression type
+    header->m_CompressionType = compressed ? ( dictionary ? COMPRESSION_TYPE_LZ4_DICT : COMPRESSION_TYPE_LZ4 ) : COMPRESSION_TYPE_NONE; // compression type
     header->m_UncompressedSize = (uint32_t)dataSize;    // input size
-    header->m_CompressedSize = compressed ? (uint32_t)compressedSize : (uint32_t)dataSize;    // output size
+    header->m_CompressedSize = compressed ? (uint32_t)( (size_t)compressedSize + prefixSize ) : (uint32_t)dataSize;    // output size
 
     return compressed;
 }
@@ -128,25 +271,67 @@ bool Compressor::Decompress( const void * data )
     const Header * header = (const Header *)data;
 
     // handle uncompressed case
-    if ( header->m_CompressionType == 0 )
+    if ( header->m_CompressionType == COMPRESSION_TYPE_NONE )
     {
         m_Result = ALLOC( header->m_UncompressedSize );
         memcpy( m_Result, (char *)data + sizeof( Header ), header->m_UncompressedSize );
         m_ResultSize = header->m_UncompressedSize;
         return true;
     }
-    ASSERT( header->m_CompressionType == 1 );
+
+    // skip over header (and dictionary id) to LZ4 data
+    const char * compressedData = ( (const char *)data + sizeof( Header ) );
+    uint32_t compressedSize = header->m_CompressedSize;
+    const Dictionary * dictionary;
+    const bool dictionaryAvailable = ReadDictionaryId( header, compressedData, compressedSize, dictionary );
+    const DictionaryReference dictionaryReference( dictionary );
+    if ( dictionaryAvailable == false )
+    {
+        return false; // Dictionary is unavailable
+    }
+
+    // handle chunked case
+    if ( ( header->m_CompressionType == COMPRESSION_TYPE_LZ4_CHUNKED ) ||
+         ( header->m_CompressionType == COMPRESSION_TYPE_LZ4_CHUNKED_DICT ) )
+    {
+        Array< const char * > chunks;
+        if ( FindChunks( compressedData, compressedSize, header->m_UncompressedSize, chunks ) == false )
+        {
+            return false; // Data is corrupt
+        }
+
+        m_Result = ALLOC( header->m_UncompressedSize );
+        m_ResultSize = header->m_UncompressedSize;
+
+        ChunkContext context;
+        context.m_Output = (char *)m_Result;
+        context.m_DataSize = m_ResultSize;
+        context.m_Dictionary = dictionary;
+        context.m_Chunks = chunks.Begin();
+        context.m_ChunksEnd = ( compressedData + compressedSize );
+        context.m_Failed = false;
+        ProcessChunks( (uint32_t)chunks.GetSize(), DecompressChunkFunc, &context );
+        if ( AtomicLoadRelaxed( &context.m_Failed ) )
+        {
+            // Data is corrupt
+            FREE( m_Result );
+            m_Result = nullptr;
+            m_ResultSize = 0;
+            return false;
+        }
+        return true;
+    }
+    ASSERT( ( header->m_CompressionType == COMPRESSION_TYPE_LZ4 ) ||
+            ( header->m_CompressionType == COMPRESSION_TYPE_LZ4_DICT ) );
 
     // uncompressed size
     const uint32_t uncompressedSize = header->m_UncompressedSize;
     m_Result = ALLOC( uncompressedSize );
     m_ResultSize = uncompressedSize;
 
-    // skip over header to LZ4 data
-    const char * compressedData = ( (const char *)data + sizeof( Header ) );
-
     // decompress
-    const int bytesDecompressed = LZ4_decompress_safe( compressedData, (char *)m_Result, (int)header->m_CompressedSize, (int)uncompressedSize);
+    const int bytesDecompressed = dictionary ? LZ4_decompress_safe_usingDict( compressedData, (char *)m_Result, (int)compressedSize, (int)uncompressedSize, dictionary->GetData(), (int)dictionary->GetDataSize() )
+                                             : LZ4_decompress_safe( compressedData, (char *)m_Result, (int)compressedSize, (int)uncompressedSize );
     if ( bytesDecompressed == (int)uncompressedSize )
     {
         return true;
@@ -159,4 +344,695 @@ bool Compressor::Decompress( const void * data )
     return false;
 }
 
+// CompressChunked
+//------------------------------------------------------------------------------
+bool Compressor::CompressChunked( const void * data, size_t dataSize, int32_t compressionLevel, const Dictionary * dictionary )
+{
+    // Small data and disabled compression gain nothing from chunking, and remain
+    // readable by older versions
+    if ( ( dataSize <= CHUNK_SIZE ) || ( compressionLevel == 0 ) )
+    {
+        return Compress( data, dataSize, compressionLevel, dictionary );
+    }
+
+    PROFILE_FUNCTION;
+
+    ASSERT( data );
+    ASSERT( m_Result == nullptr );
+
+    // compress each chunk independently into worst case sized slots
+    const uint32_t numChunks = (uint32_t)( ( dataSize + CHUNK_SIZE - 1 ) / CHUNK_SIZE );
+    const size_t slotSize = ( sizeof( uint32_t ) + (size_t)LZ4_compressBound( (int)CHUNK_SIZE ) );
+    UniquePtr< char > slots( (char *)ALLOC( numChunks * slotSize ) );
+    ChunkContext context;
+    context.m_Data = (const char *)data;
+    context.m_DataSize = dataSize;
+    context.m_Slots = slots.Get();
+    context.m_SlotSize = slotSize;
+    context.m_CompressionLevel = compressionLevel;
+    context.m_Dictionary = dictionary;
+    ProcessChunks( numChunks, CompressChunkFunc, &context );
+
+    // data compressed with a dictionary is preceded by the dictionary id
+    size_t compressedSize = ( dictionary ? sizeof( uint32_t ) : 0 );
+    for ( uint32_t i = 0; i < numChunks; ++i )
+    {
+        uint32_t chunkHeader;
+        memcpy( &chunkHeader, slots.Get() + ( i * slotSize ), sizeof( uint32_t ) );
+        compressedSize += ( sizeof( uint32_t ) + ( chunkHeader & ~CHUNK_UNCOMPRESSED_FLAG ) );
+    }
+
+    // did the compression yield any benefit?
+    if ( compressedSize >= dataSize )
+    {
+        return Compress( data, dataSize, 0 ); // store uncompressed
+    }
+
+    // gather the chunks
+    m_ResultSize = ( compressedSize + sizeof( Header ) );
+    m_Result = ALLOC( m_ResultSize );
+    char * dst = ( (char *)m_Result + sizeof( Header ) );
+    if ( dictionary )
+    {
+        const uint32_t dictionaryId = dictionary->GetId();
+        memcpy( dst, &dictionaryId, sizeof( uint32_t ) );
+        dst += sizeof( uint32_t );
+    }
+    for ( uint32_t i = 0; i < numChunks; ++i )
+    {
+        const char * slot = ( slots.Get() + ( i * slotSize ) );
+        uint32_t chunkHeader;
+        memcpy( &chunkHeader, slot, sizeof( uint32_t ) );
+        const size_t size = ( sizeof( uint32_t ) + ( chunkHeader & ~CHUNK_UNCOMPRESSED_FLAG ) );
+        memcpy( dst, slot, size );
+        dst += size;
+    }
+    ASSERT( dst == ( (char *)m_Result + m_ResultSize ) );
+
+    // fill out header
+    Header * header = (Header*)m_Result;
+    header->m_CompressionType = dictionary ? COMPRESSION_TYPE_LZ4_CHUNKED_DICT : COMPRESSION_TYPE_LZ4_CHUNKED;
+    header->m_UncompressedSize = (uint32_t)dataSize;
+    header->m_CompressedSize = (uint32_t)compressedSize;
+
+    return true;
+}
+
+// Decompress
+//------------------------------------------------------------------------------
+bool Compressor::Decompress( const void * data, IOStream & output ) const
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( data );
+
+    const Header * header = (const Header *)data;
+    const char * payload = ( (const char *)data + sizeof( Header ) );
+
+    // uncompressed data can be written directly
+    if ( header->m_CompressionType == COMPRESSION_TYPE_NONE )
+    {
+        return ( output.WriteBuffer( payload, header->m_UncompressedSize ) == header->m_UncompressedSize );
+    }
+
+    // single block data must be decompressed in its entirety
+    if ( ( header->m_CompressionType == COMPRESSION_TYPE_LZ4 ) ||
+         ( header->m_CompressionType == COMPRESSION_TYPE_LZ4_DICT ) )
+    {
+        Compressor c;
+        if ( c.Decompress( data ) == false )
+        {
+            return false;
+        }
+        return ( output.WriteBuffer( c.GetResult(), c.GetResultSize() ) == c.GetResultSize() );
+    }
+    ASSERT( ( header->m_CompressionType == COMPRESSION_TYPE_LZ4_CHUNKED ) ||
+            ( header->m_CompressionType == COMPRESSION_TYPE_LZ4_CHUNKED_DICT ) );
+
+    uint32_t payloadSize = header->m_CompressedSize;
+    const Dictionary * dictionary;
+    const bool dictionaryAvailable = ReadDictionaryId( header, payload, payloadSize, dictionary );
+    const DictionaryReference dictionaryReference( dictionary );
+    if ( dictionaryAvailable == false )
+    {
+        return false; // Dictionary is unavailable
+    }
+
+    const uint32_t uncompressedSize = header->m_UncompressedSize;
+    Array< const char * > chunks;
+    if ( FindChunks( payload, payloadSize, uncompressedSize, chunks ) == false )
+    {
+        return false; // Data is corrupt
+    }
+
+    // chunked data is decompressed and written a chunk at a time (or a batch
+    // of chunks at a time, decompressed in parallel)
+    const uint32_t numChunks = (uint32_t)chunks.GetSize();
+    const uint32_t chunksPerBatch = g_ThreadPool ? Math::Min( kStreamChunksPerBatch, numChunks ) : 1;
+    const uint32_t batchSize = Math::Min< uint32_t >( ( chunksPerBatch * CHUNK_SIZE ), uncompressedSize );
+    UniquePtr< char > batchBuffer( (char *)ALLOC( batchSize ) );
+    for ( uint32_t firstChunk = 0; firstChunk < numChunks; firstChunk += chunksPerBatch )
+    {
+        const uint32_t numBatchChunks = Math::Min( chunksPerBatch, ( numChunks - firstChunk ) );
+        const uint32_t offset = ( firstChunk * (uint32_t)CHUNK_SIZE );
+        const uint32_t size = Math::Min( batchSize, ( uncompressedSize - offset ) );
+
+        ChunkContext context;
+        context.m_Output = batchBuffer.Get();
+        context.m_DataSize = size;
+        context.m_Dictionary = dictionary;
+        context.m_Chunks = ( chunks.Begin() + firstChunk );
+        context.m_ChunksEnd = ( ( firstChunk + numBatchChunks ) < numChunks ) ? chunks[ firstChunk + numBatchChunks ]
+                                                                               : ( payload + payloadSize );
+        context.m_Failed = false;
+        ProcessChunks( numBatchChunks, DecompressChunkFunc, &context );
+        if ( AtomicLoadRelaxed( &context.m_Failed ) )
+        {
+            return false; // Data is corrupt
+        }
+        if ( output.WriteBuffer( batchBuffer.Get(), size ) != size )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// DecompressChunk
+//------------------------------------------------------------------------------
+/*static*/ bool Compressor::DecompressChunk( const char * & chunk, const char * chunksEnd, char * output, uint32_t outputSize, const Dictionary * dictionary )
+{
+    // read chunk size
+    if ( (size_t)( chunksEnd - chunk ) < sizeof( uint32_t ) )
+    {
+        return false;
+    }
+    uint32_t chunkHeader;
+    memcpy( &chunkHeader, chunk, sizeof( uint32_t ) );
+    chunk += sizeof( uint32_t );
+    const uint32_t chunkSize = ( chunkHeader & ~CHUNK_UNCOMPRESSED_FLAG );
+    if ( chunkSize > (size_t)( chunksEnd - chunk ) )
+    {
+        return false;
+    }
+
+    // handle uncompressed case
+    if ( chunkHeader & CHUNK_UNCOMPRESSED_FLAG )
+    {
+        if ( chunkSize != outputSize )
+        {
+            return false;
+        }
+        memcpy( output, chunk, chunkSize );
+    }
+    else
+    {
+        const int bytesDecompressed = dictionary ? LZ4_decompress_safe_usingDict( chunk, output, (int)chunkSize, (int)outputSize, dictionary->GetData(), (int)dictionary->GetDataSize() )
+                                                 : LZ4_decompress_safe( chunk, output, (int)chunkSize, (int)outputSize );
+        if ( bytesDecompressed != (int)outputSize )
+        {
+            return false;
+        }
+    }
+
+    chunk += chunkSize;
+    return true;
+}
+
+// FindChunks
+//------------------------------------------------------------------------------
+/*static*/ bool Compressor::FindChunks( const char * chunks, uint32_t chunksSize, uint32_t uncompressedSize, Array< const char * > & outChunks )
+{
+    const char * chunk = chunks;
+    const char * chunksEnd = ( chunks + chunksSize );
+    outChunks.SetCapacity( ( uncompressedSize + CHUNK_SIZE - 1 ) / CHUNK_SIZE );
+    for ( uint32_t offset = 0; offset < uncompressedSize; offset += CHUNK_SIZE )
+    {
+        if ( (size_t)( chunksEnd - chunk ) < sizeof( uint32_t ) )
+        {
+            return false;
+        }
+        uint32_t chunkHeader;
+        memcpy( &chunkHeader, chunk, sizeof( uint32_t ) );
+        const uint32_t chunkSize = ( chunkHeader & ~CHUNK_UNCOMPRESSED_FLAG );
+        if ( chunkSize > (size_t)( chunksEnd - chunk - sizeof( uint32_t ) ) )
+        {
+            return false;
+        }
+        outChunks.Append( chunk );
+        chunk += ( sizeof( uint32_t ) + chunkSize );
+    }
+    return true;
+}
+
+// ProcessChunks
+//------------------------------------------------------------------------------
+/*static*/ void Compressor::ProcessChunks( uint32_t numChunks, ChunkFunction function, void * userData )
+{
+    PROFILE_FUNCTION;
+
+    if ( ( g_ThreadPool == nullptr ) || ( numChunks < 2 ) )
+    {
+        void * state = nullptr;
+        for ( uint32_t i = 0; i < numChunks; ++i )
+        {
+            function( userData, i, state );
+        }
+        FREE( state );
+        return;
+    }
+
+    CompressorThreadPool::Task task( numChunks, function, userData );
+    g_ThreadPool->Run( task );
+}
+
+// CompressChunkFunc
+//------------------------------------------------------------------------------
+/*static*/ void Compressor::CompressChunkFunc( void * userData, uint32_t chunkIndex, void * & ioState )
+{
+    const ChunkContext & context = *static_cast< const ChunkContext * >( userData );
+
+    const size_t offset = ( (size_t)chunkIndex * CHUNK_SIZE );
+    const char * src = ( context.m_Data + offset );
+    const int srcSize = (int)Math::Min< size_t >( CHUNK_SIZE, context.m_DataSize - offset );
+    char * slot = ( context.m_Slots + ( chunkIndex * context.m_SlotSize ) );
+    char * chunkData = ( slot + sizeof( uint32_t ) );
+
+    const int compressedSize = CompressBlock( src, srcSize, chunkData, (int)( context.m_SlotSize - sizeof( uint32_t ) ), context.m_CompressionLevel, context.m_Dictionary, ioState );
+
+    // store chunks which don't compress as-is
+    uint32_t chunkHeader;
+    if ( ( compressedSize > 0 ) && ( compressedSize < srcSize ) )
+    {
+        chunkHeader = (uint32_t)compressedSize;
+    }
+    else
+    {
+        memcpy( chunkData, src, (size_t)srcSize );
+        chunkHeader = ( (uint32_t)srcSize | CHUNK_UNCOMPRESSED_FLAG );
+    }
+    memcpy( slot, &chunkHeader, sizeof( uint32_t ) );
+}
+
+// DecompressChunkFunc
+//------------------------------------------------------------------------------
+/*static*/ void Compressor::DecompressChunkFunc( void * userData, uint32_t chunkIndex, void * & /*ioState*/ )
+{
+    ChunkContext & context = *static_cast< ChunkContext * >( userData );
+
+    const size_t offset = ( (size_t)chunkIndex * CHUNK_SIZE );
+    const uint32_t outputSize = (uint32_t)Math::Min< size_t >( CHUNK_SIZE, context.m_DataSize - offset );
+    const char * chunk = context.m_Chunks[ chunkIndex ];
+    const char * chunkEnd = ( ( offset + CHUNK_SIZE ) < context.m_DataSize ) ? context.m_Chunks[ chunkIndex + 1 ]
+                                                                            : context.m_ChunksEnd;
+    if ( DecompressChunk( chunk, chunkEnd, context.m_Output + offset, outputSize, context.m_Dictionary ) == false )
+    {
+        AtomicStoreRelaxed( &context.m_Failed, true );
+    }
+}
+
+// CreateThreadPool
+//------------------------------------------------------------------------------
+/*static*/ void Compressor::CreateThreadPool( uint32_t numThreads )
+{
+    ASSERT( g_ThreadPool == nullptr );
+    if ( numThreads > 0 )
+    {
+        g_ThreadPool = FNEW( CompressorThreadPool( numThreads ) );
+    }
+}
+
+// DestroyThreadPool
+//------------------------------------------------------------------------------
+/*static*/ void Compressor::DestroyThreadPool()
+{
+    FDELETE g_ThreadPool;
+    g_ThreadPool = nullptr;
+}
+
+// ReadDictionaryId
+//------------------------------------------------------------------------------
+/*static*/ bool Compressor::ReadDictionaryId( const Header * header, const char * & payload, uint32_t & payloadSize, const Dictionary * & outDictionary )
+{
+    outDictionary = nullptr;
+    if ( ( header->m_CompressionType != COMPRESSION_TYPE_LZ4_DICT ) &&
+         ( header->m_CompressionType != COMPRESSION_TYPE_LZ4_CHUNKED_DICT ) )
+    {
+        return true; // No dictionary needed
+    }
+
+    if ( payloadSize < sizeof( uint32_t ) )
+    {
+        return false; // Data is corrupt
+    }
+    uint32_t dictionaryId;
+    memcpy( &dictionaryId, payload, sizeof( uint32_t ) );
+    payload += sizeof( uint32_t );
+    payloadSize -= (uint32_t)sizeof( uint32_t );
+
+    // reference the dictionary, to be released by the caller
+    MutexHolder mh( g_DictionariesMutex );
+    for ( Dictionary * dictionary = g_Dictionaries; dictionary; dictionary = dictionary->m_Next )
+    {
+        if ( dictionary->m_Id == dictionaryId )
+        {
+            ++dictionary->m_RefCount;
+            outDictionary = dictionary;
+            return true;
+        }
+    }
+    return false;
+}
+
+// CompressBlock
+//------------------------------------------------------------------------------
+/*static*/ int Compressor::CompressBlock( const char * src, int srcSize, char * dst, int dstCapacity, int32_t compressionLevel, const Dictionary * dictionary, void * & ioState )
+{
+    ASSERT( compressionLevel != 0 );
+
+    if ( dictionary == nullptr )
+    {
+        if ( compressionLevel > 0 )
+        {
+            // Higher compression, using LZ4HC
+            return LZ4_compress_HC( src, dst, srcSize, dstCapacity, compressionLevel );
+        }
+
+        // Lower compression, using regular LZ4
+        return LZ4_compress_fast( src, dst, srcSize, dstCapacity, ( 0 - compressionLevel ) );
+    }
+
+    // Compressing with a dictionary requires a stream, which is reused
+    // for subsequent blocks (each block remains independent)
+    if ( compressionLevel > 0 )
+    {
+        if ( ioState == nullptr )
+        {
+            ioState = ALLOC( sizeof( LZ4_streamHC_t ) );
+            LZ4_initStreamHC( ioState, sizeof( LZ4_streamHC_t ) );
+        }
+        LZ4_streamHC_t * stream = static_cast< LZ4_streamHC_t * >( ioState );
+        LZ4_resetStreamHC_fast( stream, compressionLevel );
+        LZ4_loadDictHC( stream, dictionary->GetData(), (int)dictionary->GetDataSize() );
+        return LZ4_compress_HC_continue( stream, src, dst, srcSize, dstCapacity );
+    }
+
+    if ( ioState == nullptr )
+    {
+        ioState = ALLOC( sizeof( LZ4_stream_t ) );
+        LZ4_initStream( ioState, sizeof( LZ4_stream_t ) );
+    }
+    LZ4_stream_t * stream = static_cast< LZ4_stream_t * >( ioState );
+    LZ4_resetStream_fast( stream );
+    LZ4_attach_dictionary( stream, static_cast< const LZ4_stream_t * >( dictionary->m_Stream ) );
+    return LZ4_compress_fast_continue( stream, src, dst, srcSize, dstCapacity, ( 0 - compressionLevel ) );
+}
+
+// RegisterDictionary
+//------------------------------------------------------------------------------
+/*static*/ const Compressor::Dictionary * Compressor::RegisterDictionary( const void * data, size_t dataSize )
+{
+    if ( ( dataSize == 0 ) || ( dataSize > MAX_DICTIONARY_SIZE ) )
+    {
+        return nullptr; // Invalid dictionary
+    }
+
+    uint32_t id = xxHash::Calc32( data, dataSize );
+    id = ( id == 0 ) ? 1 : id; // 0 indicates no dictionary
+
+    MutexHolder mh( g_DictionariesMutex );
+
+    // Share existing dictionary
+    for ( Dictionary * dictionary = g_Dictionaries; dictionary; dictionary = dictionary->m_Next )
+    {
+        if ( dictionary->m_Id == id )
+        {
+            if ( ( dictionary->m_DataSize != dataSize ) || ( memcmp( dictionary->m_Data, data, dataSize ) != 0 ) )
+            {
+                return nullptr; // Id collision
+            }
+            ++dictionary->m_RefCount;
+            return dictionary;
+        }
+    }
+
+    Dictionary * dictionary = FNEW( Dictionary( data, (uint32_t)dataSize, id ) );
+    dictionary->m_Next = g_Dictionaries;
+    g_Dictionaries = dictionary;
+    return dictionary;
+}
+
+// ReleaseDictionary
+//------------------------------------------------------------------------------
+/*static*/ void Compressor::ReleaseDictionary( const Dictionary * dictionary )
+{
+    if ( dictionary == nullptr )
+    {
+        return;
+    }
+
+    MutexHolder mh( g_DictionariesMutex );
+    for ( Dictionary ** it = &g_Dictionaries; *it; it = &( *it )->m_Next )
+    {
+        if ( *it == dictionary )
+        {
+            Dictionary * d = *it;
+            ASSERT( d->m_RefCount > 0 );
+            if ( --d->m_RefCount == 0 )
+            {
+                *it = d->m_Next;
+                FDELETE d;
+            }
+            return;
+        }
+    }
+    ASSERT( false ); // Not registered
+}
+
+// FindDictionary
+//------------------------------------------------------------------------------
+/*static*/ const Compressor::Dictionary * Compressor::FindDictionary( uint32_t id )
+{
+    MutexHolder mh( g_DictionariesMutex );
+    for ( const Dictionary * dictionary = g_Dictionaries; dictionary; dictionary = dictionary->m_Next )
+    {
+        if ( dictionary->m_Id == id )
+        {
+            return dictionary;
+        }
+    }
+    return nullptr;
+}
+
+// GetDictionaryId
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Compressor::GetDictionaryId( const void * data )
+{
+    const Header * header = (const Header *)data;
+    if ( ( header->m_CompressionType != COMPRESSION_TYPE_LZ4_DICT ) &&
+         ( header->m_CompressionType != COMPRESSION_TYPE_LZ4_CHUNKED_DICT ) )
+    {
+        return 0;
+    }
+    uint32_t dictionaryId;
+    memcpy( &dictionaryId, (const char *)data + sizeof( Header ), sizeof( uint32_t ) );
+    return dictionaryId;
+}
+
+// TrainDictionary
+//------------------------------------------------------------------------------
+/*static*/ void Compressor::TrainDictionary( const void * samples, size_t samplesSize, Array< char > & outDictionary )
+{
+    PROFILE_FUNCTION;
+
+    const char * src = (const char *)samples;
+    outDictionary.Clear();
+
+    // Samples which fit are used as-is
+    if ( samplesSize <= MAX_DICTIONARY_SIZE )
+    {
+        outDictionary.Append( src, src + samplesSize );
+        return;
+    }
+
+    // Similar to the "FastCover" algorithm used by Zstandard: the samples are
+    // divided into epochs, and from each the segment of content which occurs
+    // most frequently across all the samples is selected
+
+    // Count the occurrences of all content (by hash)
+    Array< uint32_t > frequencies;
+    frequencies.SetSize( (size_t)1 << kDmerTableBits );
+    memset( frequencies.Begin(), 0, frequencies.GetSize() * sizeof( uint32_t ) );
+    const size_t numDmers = ( samplesSize - kDmerSize + 1 );
+    for ( size_t i = 0; i < numDmers; ++i )
+    {
+        ++frequencies[ HashDmer( src + i ) ];
+    }
+
+    // Select the best segment from each epoch
+    const size_t dmersPerSegment = ( kSegmentSize - kDmerSize + 1 );
+    const size_t numEpochs = ( MAX_DICTIONARY_SIZE / kSegmentSize );
+    const size_t epochSize = ( numDmers / numEpochs );
+    outDictionary.SetCapacity( MAX_DICTIONARY_SIZE );
+    for ( size_t epoch = 0; epoch < numEpochs; ++epoch )
+    {
+        const size_t epochBegin = ( epoch * epochSize );
+        if ( ( epochBegin + dmersPerSegment ) > numDmers )
+        {
+            break;
+        }
+        const size_t epochEnd = Math::Min( epochBegin + epochSize, numDmers - dmersPerSegment + 1 );
+
+        // Score each segment by the frequency of its content
+        uint64_t score = 0;
+        for ( size_t i = 0; i < dmersPerSegment; ++i )
+        {
+            score += frequencies[ HashDmer( src + epochBegin + i ) ];
+        }
+        uint64_t bestScore = score;
+        size_t bestBegin = epochBegin;
+        for ( size_t begin = ( epochBegin + 1 ); begin < epochEnd; ++begin )
+        {
+            score -= frequencies[ HashDmer( src + begin - 1 ) ];
+            score += frequencies[ HashDmer( src + begin + dmersPerSegment - 1 ) ];
+            if ( score > bestScore )
+            {
+                bestScore = score;
+                bestBegin = begin;
+            }
+        }
+
+        // Ignore content which doesn't recur
+        if ( bestScore <= dmersPerSegment )
+        {
+            continue;
+        }
+
+        outDictionary.Append( src + bestBegin, src + bestBegin + kSegmentSize );
+
+        // Don't select the same content again
+        for ( size_t i = 0; i < dmersPerSegment; ++i )
+        {
+            frequencies[ HashDmer( src + bestBegin + i ) ] = 0;
+        }
+    }
+}
+
+
+// CompressorThreadPool CONSTRUCTOR
+//------------------------------------------------------------------------------
+CompressorThreadPool::CompressorThreadPool( uint32_t numThreads )
+    : m_ThreadExit( false )
+    , m_Tasks( 8, true )
+    , m_Threads( numThreads, false )
+{
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        Thread::ThreadHandle h = Thread::CreateThread( ThreadFuncStatic,
+                                                       "Compressor",
+                                                       ( 256 * KILOBYTE ),
+                                                       this );
+        ASSERT( h != INVALID_THREAD_HANDLE );
+        m_Threads.Append( h );
+    }
+}
+
+// CompressorThreadPool DESTRUCTOR
+//------------------------------------------------------------------------------
+CompressorThreadPool::~CompressorThreadPool()
+{
+    AtomicStoreRelaxed( &m_ThreadExit, true );
+    m_WorkSemaphore.Signal( (uint32_t)m_Threads.GetSize() );
+    for ( Thread::ThreadHandle h : m_Threads )
+    {
+        Thread::WaitForThread( h );
+        Thread::CloseHandle( h );
+    }
+
+    ASSERT( m_Tasks.IsEmpty() );
+}
+
+// Task::Process
+//------------------------------------------------------------------------------
+void CompressorThreadPool::Task::Process()
+{
+    void * state = nullptr;
+    for ( ;; )
+    {
+        const uint32_t chunkIndex = ( AtomicIncU32( &m_NextChunk ) - 1 );
+        if ( chunkIndex >= m_NumChunks )
+        {
+            break;
+        }
+        m_Function( m_UserData, chunkIndex, state );
+    }
+    FREE( state );
+}
+
+// Run
+//------------------------------------------------------------------------------
+void CompressorThreadPool::Run( Task & task )
+{
+    {
+        MutexHolder mh( m_Mutex );
+        m_Tasks.Append( &task );
+    }
+    m_WorkSemaphore.Signal( Math::Min( ( task.m_NumChunks - 1 ), GetNumThreads() ) );
+
+    // Help process our own task
+    task.Process();
+
+    // Wait for any threads still processing chunks (the last chunks may
+    // have been claimed by other threads)
+    {
+        MutexHolder mh( m_Mutex );
+        m_Tasks.FindAndErase( &task );
+    }
+    for ( ;; )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            if ( task.m_NumHelpers == 0 )
+            {
+                break;
+            }
+        }
+        task.m_HelperFinished.Wait();
+    }
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CompressorThreadPool::ThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "Compressor" );
+
+    static_cast< CompressorThreadPool * >( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void CompressorThreadPool::ThreadFunc()
+{
+    for ( ;; )
+    {
+        m_WorkSemaphore.Wait();
+
+        // Find a task with chunks left to process
+        Task * task = nullptr;
+        {
+            MutexHolder mh( m_Mutex );
+            if ( AtomicLoadRelaxed( &m_ThreadExit ) )
+            {
+                return;
+            }
+            while ( m_Tasks.IsEmpty() == false )
+            {
+                if ( m_Tasks[ 0 ]->HasUnclaimedChunks() )
+                {
+                    task = m_Tasks[ 0 ];
+                    ++task->m_NumHelpers;
+                    break;
+                }
+                m_Tasks.PopFront();
+            }
+        }
+
+        // NOTE: Signals outnumber the threads needed when tasks are completed
+        // by their callers, so threads may find no work, which is harmless.
+        if ( task == nullptr )
+        {
+            continue;
+        }
+
+        task->Process();
+
+        // Signal while holding the mutex so the task outlives the signal
+        MutexHolder mh( m_Mutex );
+        --task->m_NumHelpers;
+        task->m_HelperFinished.Signal();
+    }
+}
+
 //------------------------------------------------------------------------------
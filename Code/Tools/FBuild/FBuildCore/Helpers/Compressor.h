@@ -4,13 +4,44 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
 #include "Core/Env/Types.h"
 
+// Forward Declarations
+//------------------------------------------------------------------------------
+class IOStream;
+
 // Compressor
 //------------------------------------------------------------------------------
 class Compressor
 {
 public:
+    // Content representative of the data to be compressed, which improves the
+    // compression of small buffers. Identified by a hash of its contents, which
+    // is stored with data compressed using it.
+    class Dictionary
+    {
+    public:
+        inline uint32_t     GetId() const       { return m_Id; }
+        inline const char * GetData() const     { return m_Data; }
+        inline uint32_t     GetDataSize() const { return m_DataSize; }
+
+    private:
+        friend class Compressor;
+
+        explicit Dictionary( const void * data, uint32_t dataSize, uint32_t id );
+        ~Dictionary();
+        Dictionary( const Dictionary & ) = delete;
+        Dictionary & operator = ( const Dictionary & ) = delete;
+
+        uint32_t        m_Id;
+        uint32_t        m_DataSize;
+        uint32_t        m_RefCount;     // Protected by registry mutex
+        char *          m_Data;
+        void *          m_Stream;       // LZ4 stream with the dictionary loaded, attached for each compression
+        Dictionary *    m_Next;         // Next registered dictionary
+    };
+
     explicit Compressor();
     ~Compressor();
 
@@ -20,14 +51,47 @@ public:
     //   < 0 : use LZ4, with values directly mapping to "acceleration level"
     //  == 0 : disable compression
     //   > 0 : use LZ4HC, with values direcly mapping to "compression level"
-    bool Compress( const void * data, size_t dataSize, int32_t compressionLevel = -1 ); // -1 = default LZ4 compression level
+    //
+    // A dictionary (optional) must be registered wherever the data is decompressed.
+    bool Compress( const void * data, size_t dataSize, int32_t compressionLevel = -1, const Dictionary * dictionary = nullptr ); // -1 = default LZ4 compression level
     bool Decompress( const void * data );
 
+    // Compress in independent chunks so the result can be decompressed a chunk at
+    // a time (data no larger than a single chunk is compressed as per Compress)
+    bool CompressChunked( const void * data, size_t dataSize, int32_t compressionLevel = -1, const Dictionary * dictionary = nullptr );
+
+    // Decompress directly into a stream (chunked data is streamed without allocating the whole result)
+    bool Decompress( const void * data, IOStream & output ) const;
+
     const void *    GetResult() const       { return m_Result; }
     size_t          GetResultSize() const   { return m_ResultSize; }
 
     inline void *   ReleaseResult()         { void * r = m_Result; m_Result = nullptr; m_ResultSize = 0; return r; }
 
+    // Dictionaries are shared by all Compressors. Registering a dictionary which is
+    // already registered returns the existing one, and each call must be balanced
+    // by a call to ReleaseDictionary.
+    static const Dictionary *   RegisterDictionary( const void * data, size_t dataSize );
+    static void                 ReleaseDictionary( const Dictionary * dictionary );
+    static const Dictionary *   FindDictionary( uint32_t id );
+
+    // Id of the dictionary needed to decompress the data (0 if none)
+    static uint32_t GetDictionaryId( const void * data );
+
+    // Build a dictionary from samples of the data to be compressed
+    static void TrainDictionary( const void * samples, size_t samplesSize, Array< char > & outDictionary );
+
+    // Chunks of chunked data are compressed and decompressed in parallel by a pool
+    // of threads shared by all Compressors, as well as by the calling thread.
+    // Without a pool, all chunks are processed by the calling thread.
+    static void CreateThreadPool( uint32_t numThreads );
+    static void DestroyThreadPool();
+
+    enum : uint32_t
+    {
+        MAX_DICTIONARY_SIZE         = ( 64 * 1024 ),    // LZ4 can't reference data further back
+    };
+
 private:
     struct Header
     {
@@ -35,6 +99,29 @@ private:
         uint32_t m_UncompressedSize;
         uint32_t m_CompressedSize;
     };
+    enum : uint32_t
+    {
+        COMPRESSION_TYPE_NONE       = 0,
+        COMPRESSION_TYPE_LZ4        = 1,
+        COMPRESSION_TYPE_LZ4_CHUNKED= 2,    // Sequence of chunks, each prefixed by a uint32 size
+        COMPRESSION_TYPE_LZ4_DICT   = 3,    // As COMPRESSION_TYPE_LZ4, prefixed by a uint32 dictionary id
+        COMPRESSION_TYPE_LZ4_CHUNKED_DICT = 4,  // As COMPRESSION_TYPE_LZ4_CHUNKED, prefixed by a uint32 dictionary id
+
+        CHUNK_SIZE                  = ( 256 * 1024 ),
+        CHUNK_UNCOMPRESSED_FLAG     = 0x80000000,   // Set in a chunk's size if it is stored uncompressed
+    };
+
+    static bool ReadDictionaryId( const Header * header, const char * & payload, uint32_t & payloadSize, const Dictionary * & outDictionary ); // outDictionary must be released
+    static int CompressBlock( const char * src, int srcSize, char * dst, int dstCapacity, int32_t compressionLevel, const Dictionary * dictionary, void * & ioState );
+    static bool DecompressChunk( const char * & chunk, const char * chunksEnd, char * output, uint32_t outputSize, const Dictionary * dictionary );
+    static bool FindChunks( const char * chunks, uint32_t chunksSize, uint32_t uncompressedSize, Array< const char * > & outChunks );
+
+    // Process numChunks chunks using the thread pool (state is per thread, and freed by the caller)
+    typedef void (*ChunkFunction)( void * userData, uint32_t chunkIndex, void * & ioState );
+    static void ProcessChunks( uint32_t numChunks, ChunkFunction function, void * userData );
+    static void CompressChunkFunc( void * userData, uint32_t chunkIndex, void * & ioState );
+    static void DecompressChunkFunc( void * userData, uint32_t chunkIndex, void * & ioState );
+
     void * m_Result;
     size_t m_ResultSize;
 };
@@ -38,6 +38,19 @@ FBuildStats::FBuildStats()
     , m_TotalBuildTime( 0.0f )
     , m_TotalLocalCPUTimeMS( 0 )
     , m_TotalRemoteCPUTimeMS( 0 )
+    , m_CachePublishCount( 0 )
+    , m_CachePublishFailures( 0 )
+    , m_CachePublishMaxQueueDepth( 0 )
+    , m_CachePublishBytes( 0 )
+    , m_CachePublishTimeMS( 0 )
+    , m_CachePublishStallTimeMS( 0 )
+    , m_CachePublishFlushTimeMS( 0 )
+    , m_CachePrefetchLookups( 0 )
+    , m_CachePrefetchHits( 0 )
+    , m_CachePrefetchSkipped( 0 )
+    , m_CachePrefetchBatches( 0 )
+    , m_CachePrefetchTimeMS( 0 )
+    , m_CacheKnownMisses( 0 )
     , m_RootNode( nullptr )
     , m_NodesByTime( 100 * 1000, true )
 {}
@@ -189,6 +202,30 @@ void FBuildStats::OutputSummary() const
         output.AppendFormat( " - Hits       : %u (%2.1f %%)\n", hits, (double)hitPerc );
         output.AppendFormat( " - Misses     : %u\n", misses );
         output.AppendFormat( " - Stores     : %u\n", stores );
+        if ( ( m_CachePublishCount + m_CachePublishFailures ) > 0 )
+        {
+            output.AppendFormat( " - Publishing : %u (%u failed) %2.1f MiB - Busy: %u ms - Stalled: %u ms - Flush: %u ms - Max Queued: %u\n",
+                                 m_CachePublishCount,
+                                 m_CachePublishFailures,
+                                 (double)( (float)m_CachePublishBytes / (float)MEGABYTE ),
+                                 m_CachePublishTimeMS,
+                                 m_CachePublishStallTimeMS,
+                                 m_CachePublishFlushTimeMS,
+                                 m_CachePublishMaxQueueDepth );
+        }
+        if ( ( m_CachePrefetchLookups + m_CachePrefetchSkipped ) > 0 )
+        {
+            output.AppendFormat( " - Prefetch   : %u (%u hits, %u skipped) - Batches: %u - Busy: %u ms\n",
+                                 m_CachePrefetchLookups,
+                                 m_CachePrefetchHits,
+                                 m_CachePrefetchSkipped,
+                                 m_CachePrefetchBatches,
+                                 m_CachePrefetchTimeMS );
+        }
+        if ( m_CacheKnownMisses > 0 )
+        {
+            output.AppendFormat( " - Known Miss : %u (lookups skipped)\n", m_CacheKnownMisses );
+        }
     }
 
     AStackString<> buffer;
@@ -5,6 +5,7 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "Core/Env/Types.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheTimings.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 
 // Forward Declarations
@@ -32,6 +33,28 @@ public:
     uint32_t    m_TotalLocalCPUTimeMS;  // Total CPU time on local host
     uint32_t    m_TotalRemoteCPUTimeMS; // Total CPU time on remote workers
 
+    // asynchronous cache publishing (see CachePublisher)
+    uint32_t    m_CachePublishCount;
+    uint32_t    m_CachePublishFailures;
+    uint32_t    m_CachePublishMaxQueueDepth;
+    uint64_t    m_CachePublishBytes;        // Compressed bytes stored
+    uint32_t    m_CachePublishTimeMS;       // Time spent on publishing threads
+    uint32_t    m_CachePublishStallTimeMS;  // Time build threads waited for space in the queue
+    uint32_t    m_CachePublishFlushTimeMS;  // Time spent waiting for the queue to drain at build end
+
+    // cache lookups ahead of scheduling (see CachePrefetcher)
+    uint32_t    m_CachePrefetchLookups;
+    uint32_t    m_CachePrefetchHits;
+    uint32_t    m_CachePrefetchSkipped;     // Jobs which could not be looked up ahead of time
+    uint32_t    m_CachePrefetchBatches;     // Batched requests made to the cache
+    uint32_t    m_CachePrefetchTimeMS;      // Time spent on prefetch threads
+
+    // cache lookups skipped, having missed earlier in the build (see CacheMissMemo)
+    uint32_t    m_CacheKnownMisses;
+
+    // durations of cache operations (updated from any thread)
+    CacheTimings  m_CacheTimings;
+
     // after the build it complete, accumulate all the stats
     void GatherPostBuildStatistics( Node * node );
 
@@ -10,7 +10,11 @@
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+#include <string.h>
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
@@ -171,4 +175,199 @@ void * MultiBuffer::Release( size_t & outSize )
     return m_WriteStream->Release();
 }
 
+// MultiBufferFileExtractor (CONSTRUCTOR)
+//------------------------------------------------------------------------------
+MultiBufferFileExtractor::MultiBufferFileExtractor( const Array< AString > & fileNames )
+    : m_FileNames( fileNames )
+    , m_Position( 0 )
+    , m_HeaderSize( 0 )
+    , m_NumFiles( 0 )
+    , m_HeaderComplete( false )
+    , m_Corrupt( false )
+    , m_FileIndex( 0 )
+    , m_FileRemaining( 0 )
+    , m_FailedFileIndex( INVALID_INDEX )
+    , m_WriteTime( 0 )
+{
+    ASSERT( fileNames.GetSize() <= MultiBuffer::MAX_FILES );
+}
+
+// MultiBufferFileExtractor (DESTRUCTOR)
+//------------------------------------------------------------------------------
+MultiBufferFileExtractor::~MultiBufferFileExtractor() = default;
+
+// IsComplete
+//------------------------------------------------------------------------------
+bool MultiBufferFileExtractor::IsComplete() const
+{
+    return m_HeaderComplete &&
+           ( m_Corrupt == false ) &&
+           ( HasWriteError() == false ) &&
+           ( m_FileIndex >= m_FileNames.GetSize() );
+}
+
+// ReadBuffer
+//------------------------------------------------------------------------------
+/*virtual*/ uint64_t MultiBufferFileExtractor::ReadBuffer( void * /*buffer*/, uint64_t /*bytesToRead*/ )
+{
+    ASSERT( false ); // Not supported
+    return 0;
+}
+
+// WriteBuffer
+//------------------------------------------------------------------------------
+/*virtual*/ uint64_t MultiBufferFileExtractor::WriteBuffer( const void * buffer, uint64_t bytesToWrite )
+{
+    const int64_t startTime = Timer::GetNow();
+
+    const char * src = (const char *)buffer;
+    uint64_t remaining = bytesToWrite;
+    while ( remaining > 0 )
+    {
+        if ( m_Corrupt || HasWriteError() )
+        {
+            break;
+        }
+
+        // Header (number of files and size of each)
+        if ( m_HeaderComplete == false )
+        {
+            if ( ReadHeader( src, remaining ) == false )
+            {
+                m_Corrupt = true;
+            }
+            continue;
+        }
+
+        // Data for files which were not requested is skipped
+        if ( m_FileIndex >= m_FileNames.GetSize() )
+        {
+            src += remaining;
+            remaining = 0;
+            break;
+        }
+
+        // Write as much of the current file as we have
+        const uint64_t writeNow = Math::Min( remaining, m_FileRemaining );
+        if ( m_File.WriteBuffer( src, writeNow ) != writeNow )
+        {
+            m_FailedFileIndex = m_FileIndex;
+            break;
+        }
+        src += writeNow;
+        remaining -= writeNow;
+        m_FileRemaining -= writeNow;
+
+        // Move on to the next file?
+        if ( m_FileRemaining == 0 )
+        {
+            m_File.Close();
+            ++m_FileIndex;
+            OpenNextFile();
+        }
+    }
+
+    const uint64_t written = ( bytesToWrite - remaining );
+    m_Position += written;
+    m_WriteTime += ( Timer::GetNow() - startTime );
+    return written;
+}
+
+// GetWriteTimeMS
+//------------------------------------------------------------------------------
+float MultiBufferFileExtractor::GetWriteTimeMS() const
+{
+    return ( (float)m_WriteTime * Timer::GetFrequencyInvFloatMS() );
+}
+
+// Flush
+//------------------------------------------------------------------------------
+/*virtual*/ void MultiBufferFileExtractor::Flush()
+{
+    if ( m_File.IsOpen() )
+    {
+        m_File.Flush();
+    }
+}
+
+// Seek
+//------------------------------------------------------------------------------
+/*virtual*/ bool MultiBufferFileExtractor::Seek( uint64_t /*pos*/ ) const
+{
+    ASSERT( false ); // Not supported
+    return false;
+}
+
+// ReadHeader
+//------------------------------------------------------------------------------
+bool MultiBufferFileExtractor::ReadHeader( const char * & buffer, uint64_t & bytesRemaining )
+{
+    // Number of files is needed first to know the size of the header
+    const uint32_t headerSize = ( m_HeaderSize < sizeof( uint32_t ) )
+                              ? (uint32_t)sizeof( uint32_t )
+                              : (uint32_t)( sizeof( uint32_t ) + ( sizeof( uint64_t ) * m_NumFiles ) );
+    const uint32_t copyNow = (uint32_t)Math::Min< uint64_t >( headerSize - m_HeaderSize, bytesRemaining );
+    memcpy( m_Header + m_HeaderSize, buffer, copyNow );
+    m_HeaderSize += copyNow;
+    buffer += copyNow;
+    bytesRemaining -= copyNow;
+
+    if ( m_HeaderSize < headerSize )
+    {
+        return true; // Need more data
+    }
+
+    if ( headerSize == sizeof( uint32_t ) )
+    {
+        memcpy( &m_NumFiles, m_Header, sizeof( uint32_t ) );
+        if ( ( m_NumFiles > MultiBuffer::MAX_FILES ) || ( m_NumFiles < m_FileNames.GetSize() ) )
+        {
+            return false; // Corrupt, or doesn't contain the files we need
+        }
+        if ( m_NumFiles > 0 )
+        {
+            return true; // Need file sizes
+        }
+    }
+
+    // Header complete - start writing files
+    m_HeaderComplete = true;
+    OpenNextFile();
+    return true;
+}
+
+// OpenNextFile
+//------------------------------------------------------------------------------
+bool MultiBufferFileExtractor::OpenNextFile()
+{
+    while ( m_FileIndex < m_FileNames.GetSize() )
+    {
+        const AString & fileName = m_FileNames[ m_FileIndex ];
+        if ( !m_File.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
+        {
+            // On Windows, we can occasionally fail to open the file with error 1224 (ERROR_USER_MAPPED_FILE), due to
+            // things like anti-virus etc. Simply retry if that happens (see MultiBuffer::ExtractFile)
+            FileIO::WorkAroundForWindowsFilePermissionProblem( fileName, FileStream::WRITE_ONLY, 15 ); // 15 secs max wait
+
+            // Try again
+            if ( !m_File.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
+            {
+                m_FailedFileIndex = m_FileIndex;
+                return false;
+            }
+        }
+
+        memcpy( &m_FileRemaining, m_Header + sizeof( uint32_t ) + ( sizeof( uint64_t ) * m_FileIndex ), sizeof( uint64_t ) );
+        if ( m_FileRemaining > 0 )
+        {
+            return true;
+        }
+
+        // Empty file is complete as soon as it's created
+        m_File.Close();
+        ++m_FileIndex;
+    }
+    return true;
+}
+
 //------------------------------------------------------------------------------
@@ -7,6 +7,8 @@
 // Core
 #include "Core/Containers/Array.h"
 #include "Core/Env/Types.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/IOStream.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
@@ -32,10 +34,61 @@ public:
     void *          Release( size_t & outSize );
 
 private:
+    friend class MultiBufferFileExtractor;
+
     enum : uint32_t { MAX_FILES = 4 };
 
     ConstMemoryStream * m_ReadStream;
     MemoryStream *      m_WriteStream;
 };
 
+// MultiBufferFileExtractor
+//  - Extracts files from MultiBuffer data as it is streamed in, so the MultiBuffer
+//    never needs to be held in memory in its entirety
+//------------------------------------------------------------------------------
+class MultiBufferFileExtractor : public IOStream
+{
+public:
+    explicit MultiBufferFileExtractor( const Array< AString > & fileNames );
+    virtual ~MultiBufferFileExtractor() override;
+
+    // Have all files been fully written?
+    bool            IsComplete() const;
+
+    // Index of file which could not be written (if any)
+    bool            HasWriteError() const       { return ( m_FailedFileIndex != INVALID_INDEX ); }
+    size_t          GetFailedFileIndex() const  { return m_FailedFileIndex; }
+
+    // IOStream (only writing is supported)
+    virtual uint64_t ReadBuffer( void * buffer, uint64_t bytesToRead ) override;
+    virtual uint64_t WriteBuffer( const void * buffer, uint64_t bytesToWrite ) override;
+    virtual void     Flush() override;
+    virtual uint64_t Tell() const override          { return m_Position; }
+    virtual bool     Seek( uint64_t pos ) const override;
+    virtual uint64_t GetFileSize() const override   { return m_Position; }
+
+    // Time spent writing files
+    float           GetWriteTimeMS() const;
+
+private:
+    bool    ReadHeader( const char * & buffer, uint64_t & bytesRemaining );
+    bool    OpenNextFile();
+
+    enum : size_t { INVALID_INDEX = (size_t)-1 };
+    enum : uint32_t { MAX_HEADER_SIZE = sizeof( uint32_t ) + ( sizeof( uint64_t ) * MultiBuffer::MAX_FILES ) };
+
+    const Array< AString > &    m_FileNames;
+    uint64_t                    m_Position;
+    uint32_t                    m_HeaderSize;       // Bytes of header received so far
+    uint32_t                    m_NumFiles;         // Number of files in data (once header is received)
+    bool                        m_HeaderComplete;
+    bool                        m_Corrupt;
+    size_t                      m_FileIndex;        // File currently being written
+    uint64_t                    m_FileRemaining;    // Bytes still to be written to current file
+    size_t                      m_FailedFileIndex;
+    int64_t                     m_WriteTime;        // Timer ticks spent writing files
+    FileStream                  m_File;
+    uint8_t                     m_Header[ MAX_HEADER_SIZE ];
+};
+
 //------------------------------------------------------------------------------
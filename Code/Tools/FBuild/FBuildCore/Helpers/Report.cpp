@@ -93,6 +93,7 @@ void Report::Generate( const FBuildStats & stats )
 
     DoCPUTimeByType( stats );
     DoCacheStats( stats );
+    DoCachePerformance( stats );
     DoCPUTimeByLibrary();
     DoCPUTimeByItem( stats );
 
@@ -453,6 +454,87 @@ void Report::DoCacheStats( const FBuildStats & stats )
     }
 }
 
+// DoCachePerformance
+//------------------------------------------------------------------------------
+void Report::DoCachePerformance( const FBuildStats & stats )
+{
+    const CacheTimings & cacheTimings = stats.m_CacheTimings;
+    if ( cacheTimings.HasStats() == false )
+    {
+        return; // Cache not used, or nothing was looked up or stored
+    }
+
+    DoSectionTitle( "Cache Performance", "cachePerformance" );
+
+    // Summary of each operation
+    CacheTimings::OperationStats opStats[ CacheTimings::NUM_OPERATIONS ];
+    DoTableStart();
+    Write( "<tr><th>Operation</th><th>Count</th><th>Total</th><th>Average</th><th>p50</th><th>p90</th><th>p99</th><th>Max</th><th>Data (MiB)</th><th>MiB/s</th></tr>\n" );
+    for ( uint32_t i = 0; i < CacheTimings::NUM_OPERATIONS; ++i )
+    {
+        const CacheTimings::Operation op = (CacheTimings::Operation)i;
+        CacheTimings::OperationStats & s = opStats[ i ];
+        cacheTimings.GetStats( op, s );
+        if ( s.m_Count == 0 )
+        {
+            continue;
+        }
+
+        const double totalS = ( (double)s.m_TotalTimeUS / 1000000.0 );
+        const double dataMiB = ( (double)s.m_Bytes / (double)MEGABYTE );
+        Write( "<tr><td>%s</td><td>%u</td><td>%2.3fs</td><td>%2.3fms</td><td>%2.3fms</td><td>%2.3fms</td><td>%2.3fms</td><td>%2.3fms</td><td>%2.3f</td><td>%2.1f</td></tr>\n",
+               CacheTimings::GetOperationName( op ),
+               s.m_Count,
+               totalS,
+               ( (double)s.m_TotalTimeUS / 1000.0 ) / (double)s.m_Count,
+               (double)CacheTimings::GetPercentileMS( s, 50 ),
+               (double)CacheTimings::GetPercentileMS( s, 90 ),
+               (double)CacheTimings::GetPercentileMS( s, 99 ),
+               ( (double)s.m_MaxTimeUS / 1000.0 ),
+               dataMiB,
+               ( totalS > 0.0 ) ? ( dataMiB / totalS ) : 0.0 );
+    }
+    DoTableStop();
+
+    // Distribution of durations
+    DoTableStart();
+    Write( "<tr><th>Duration</th>" );
+    for ( uint32_t i = 0; i < CacheTimings::NUM_OPERATIONS; ++i )
+    {
+        if ( opStats[ i ].m_Count > 0 )
+        {
+            Write( "<th>%s</th>", CacheTimings::GetOperationName( (CacheTimings::Operation)i ) );
+        }
+    }
+    Write( "</tr>\n" );
+    AStackString<> bucketName;
+    for ( uint32_t bucket = 0; bucket < CacheTimings::NUM_BUCKETS; ++bucket )
+    {
+        // Skip durations which no operation took
+        bool used = false;
+        for ( const CacheTimings::OperationStats & s : opStats )
+        {
+            used |= ( s.m_Buckets[ bucket ] > 0 );
+        }
+        if ( used == false )
+        {
+            continue;
+        }
+
+        CacheTimings::GetBucketName( bucket, bucketName );
+        Write( "<tr><td>%s</td>", bucketName.Get() );
+        for ( const CacheTimings::OperationStats & s : opStats )
+        {
+            if ( s.m_Count > 0 )
+            {
+                Write( "<td>%u <font class='perc'>(%2.1f%%)</font></td>", s.m_Buckets[ bucket ], (double)( ( (float)s.m_Buckets[ bucket ] / (float)s.m_Count ) * 100.0f ) );
+            }
+        }
+        Write( "</tr>\n" );
+    }
+    DoTableStop();
+}
+
 // DoCPUTimeByType
 //------------------------------------------------------------------------------
 void Report::DoCPUTimeByType( const FBuildStats & stats )
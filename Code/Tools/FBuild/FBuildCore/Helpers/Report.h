@@ -32,6 +32,7 @@ private:
     void CreateTitle();
     void CreateOverview( const FBuildStats & stats );
     void DoCacheStats( const FBuildStats & stats );
+    void DoCachePerformance( const FBuildStats & stats );
     void DoCPUTimeByType( const FBuildStats & stats );
     void DoCPUTimeByItem( const FBuildStats & stats );
     void DoCPUTimeByLibrary();
@@ -0,0 +1,301 @@
+// SegmentDeduplicator - Avoid re-sending repeated parts of preprocessed output
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "SegmentDeduplicator.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/IOStream.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+
+#include <string.h>
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+SegmentDeduplicator::SegmentDeduplicator()
+    : m_Segments()
+    , m_NumSegments( 0 )
+    , m_StoredSize( 0 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+SegmentDeduplicator::~SegmentDeduplicator()
+{
+    Clear();
+}
+
+// Encode
+//------------------------------------------------------------------------------
+void SegmentDeduplicator::Encode( const void * data, size_t dataSize, IOStream & stream )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( dataSize <= 0xFFFFFFFF ); // only 32bit data supported
+
+    stream.Write( (uint32_t)dataSize );
+
+    const char * pos = static_cast< const char * >( data );
+    const char * const end = ( pos + dataSize );
+    const char * inlineStart = pos; // Start of segments not yet written
+    while ( pos < end )
+    {
+        const char * const segmentEnd = FindSegmentEnd( pos, end );
+        const uint32_t segmentSize = (uint32_t)( segmentEnd - pos );
+
+        // Small segments are not worth referencing
+        uint8_t type = SEGMENT_INLINE;
+        uint64_t hash = 0;
+        if ( segmentSize >= MIN_SEGMENT_SIZE )
+        {
+            hash = xxHash::Calc64( pos, segmentSize );
+            hash = ( hash == 0 ) ? 1 : hash; // 0 is reserved for unused slots
+            if ( Find( hash ) )
+            {
+                type = SEGMENT_STORED;
+            }
+            else if ( ( m_StoredSize + segmentSize ) <= MAX_STORED_SIZE )
+            {
+                type = SEGMENT_NEW;
+                Add( hash, nullptr, segmentSize );
+            }
+        }
+        if ( type == SEGMENT_INLINE )
+        {
+            pos = segmentEnd;
+            continue; // Combined with adjacent inline segments
+        }
+
+        // Write any pending inline segments
+        if ( inlineStart < pos )
+        {
+            const uint32_t inlineSize = (uint32_t)( pos - inlineStart );
+            stream.Write( (uint8_t)SEGMENT_INLINE );
+            stream.Write( inlineSize );
+            stream.WriteBuffer( inlineStart, inlineSize );
+        }
+
+        stream.Write( type );
+        stream.Write( hash );
+        if ( type == SEGMENT_NEW )
+        {
+            stream.Write( segmentSize );
+            stream.WriteBuffer( pos, segmentSize );
+        }
+        pos = segmentEnd;
+        inlineStart = pos;
+    }
+
+    // Write any remaining inline segments
+    if ( inlineStart < end )
+    {
+        const uint32_t inlineSize = (uint32_t)( end - inlineStart );
+        stream.Write( (uint8_t)SEGMENT_INLINE );
+        stream.Write( inlineSize );
+        stream.WriteBuffer( inlineStart, inlineSize );
+    }
+}
+
+// Decode
+//------------------------------------------------------------------------------
+bool SegmentDeduplicator::Decode( IOStream & stream, void * & outData, size_t & outDataSize )
+{
+    PROFILE_FUNCTION;
+
+    uint32_t dataSize;
+    if ( stream.Read( dataSize ) == false )
+    {
+        return false;
+    }
+
+    char * const data = static_cast< char * >( ALLOC( dataSize ) );
+    uint32_t pos = 0;
+    while ( pos < dataSize )
+    {
+        uint8_t type;
+        if ( stream.Read( type ) == false )
+        {
+            break;
+        }
+
+        if ( type == SEGMENT_INLINE )
+        {
+            uint32_t size;
+            if ( ( stream.Read( size ) == false ) ||
+                 ( size > ( dataSize - pos ) ) ||
+                 ( stream.ReadBuffer( data + pos, size ) != size ) )
+            {
+                break;
+            }
+            pos += size;
+            continue;
+        }
+
+        uint64_t hash;
+        if ( stream.Read( hash ) == false )
+        {
+            break;
+        }
+
+        if ( type == SEGMENT_STORED )
+        {
+            const Segment * segment = Find( hash );
+            if ( ( segment == nullptr ) || ( segment->m_Size > ( dataSize - pos ) ) )
+            {
+                break; // Unknown segment (or corrupt data)
+            }
+            memcpy( data + pos, segment->m_Data, segment->m_Size );
+            pos += segment->m_Size;
+            continue;
+        }
+
+        if ( type == SEGMENT_NEW )
+        {
+            uint32_t size;
+            if ( ( stream.Read( size ) == false ) ||
+                 ( size > ( dataSize - pos ) ) ||
+                 ( stream.ReadBuffer( data + pos, size ) != size ) ||
+                 ( hash == 0 ) ||
+                 ( Find( hash ) != nullptr ) ||
+                 ( ( m_StoredSize + size ) > MAX_STORED_SIZE ) )
+            {
+                break;
+            }
+            void * segmentData = ALLOC( size );
+            memcpy( segmentData, data + pos, size );
+            Add( hash, segmentData, size );
+            pos += size;
+            continue;
+        }
+
+        break; // Unknown segment type
+    }
+
+    if ( pos != dataSize )
+    {
+        FREE( data );
+        return false;
+    }
+
+    outData = data;
+    outDataSize = dataSize;
+    return true;
+}
+
+// Clear
+//------------------------------------------------------------------------------
+void SegmentDeduplicator::Clear()
+{
+    for ( Segment & segment : m_Segments )
+    {
+        FREE( segment.m_Data );
+    }
+    m_Segments.Clear();
+    m_NumSegments = 0;
+    m_StoredSize = 0;
+}
+
+// Find
+//------------------------------------------------------------------------------
+const SegmentDeduplicator::Segment * SegmentDeduplicator::Find( uint64_t hash ) const
+{
+    if ( m_NumSegments == 0 )
+    {
+        return nullptr;
+    }
+
+    const size_t mask = ( m_Segments.GetSize() - 1 );
+    for ( size_t index = ( (size_t)hash & mask ); ; index = ( ( index + 1 ) & mask ) )
+    {
+        const Segment & segment = m_Segments[ index ];
+        if ( segment.m_Hash == hash )
+        {
+            return &segment;
+        }
+        if ( segment.m_Hash == 0 )
+        {
+            return nullptr;
+        }
+    }
+}
+
+// Add
+//------------------------------------------------------------------------------
+void SegmentDeduplicator::Add( uint64_t hash, void * data, uint32_t size )
+{
+    ASSERT( hash != 0 );
+    ASSERT( Find( hash ) == nullptr );
+
+    // Grow the table to keep it at most half full
+    if ( ( ( m_NumSegments + 1 ) * 2 ) > m_Segments.GetSize() )
+    {
+        Array< Segment > oldSegments;
+        oldSegments.Swap( m_Segments );
+        const size_t newSize = oldSegments.IsEmpty() ? 256 : ( oldSegments.GetSize() * 2 );
+        m_Segments.SetSize( newSize );
+        memset( m_Segments.Begin(), 0, newSize * sizeof( Segment ) );
+        const size_t mask = ( newSize - 1 );
+        for ( const Segment & segment : oldSegments )
+        {
+            if ( segment.m_Hash != 0 )
+            {
+                size_t index = ( (size_t)segment.m_Hash & mask );
+                while ( m_Segments[ index ].m_Hash != 0 )
+                {
+                    index = ( ( index + 1 ) & mask );
+                }
+                m_Segments[ index ] = segment;
+            }
+        }
+    }
+
+    const size_t mask = ( m_Segments.GetSize() - 1 );
+    size_t index = ( (size_t)hash & mask );
+    while ( m_Segments[ index ].m_Hash != 0 )
+    {
+        index = ( ( index + 1 ) & mask );
+    }
+    Segment & segment = m_Segments[ index ];
+    segment.m_Hash = hash;
+    segment.m_Data = data;
+    segment.m_Size = size;
+    ++m_NumSegments;
+    m_StoredSize += size;
+}
+
+// FindSegmentEnd
+//------------------------------------------------------------------------------
+/*static*/ const char * SegmentDeduplicator::FindSegmentEnd( const char * pos, const char * end )
+{
+    // Segments end before the next line directive:
+    //  - GCC/Clang: # <line> "<file>" [flags]
+    //  - MSVC     : #line <line> "<file>"
+    for ( ;; )
+    {
+        const char * const newLine = static_cast< const char * >( memchr( pos, '\n', (size_t)( end - pos ) ) );
+        if ( newLine == nullptr )
+        {
+            return end;
+        }
+        pos = ( newLine + 1 );
+        const size_t remaining = (size_t)( end - pos );
+        if ( ( remaining >= 3 ) && ( pos[ 0 ] == '#' ) )
+        {
+            if ( ( pos[ 1 ] == ' ' ) && ( pos[ 2 ] >= '0' ) && ( pos[ 2 ] <= '9' ) )
+            {
+                return pos;
+            }
+            if ( ( remaining >= 5 ) && ( strncmp( pos + 1, "line", 4 ) == 0 ) )
+            {
+                return pos;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,70 @@
+// SegmentDeduplicator - Avoid re-sending repeated parts of preprocessed output
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class IOStream;
+
+// SegmentDeduplicator
+//  - Preprocessed output is mostly made up of the same headers, repeated for
+//    every job. It is split into segments at line directives (where an included
+//    file begins or resumes), and segments already sent over a connection are
+//    replaced by their hash.
+//  - The client keeps one per worker connection (tracking segments sent) and
+//    the worker one per client connection (storing segments received).
+//------------------------------------------------------------------------------
+class SegmentDeduplicator
+{
+public:
+    explicit SegmentDeduplicator();
+    ~SegmentDeduplicator();
+
+    // Client: write data, referring to segments already written by hash
+    void Encode( const void * data, size_t dataSize, IOStream & stream );
+
+    // Worker: reconstruct data written by Encode, storing new segments
+    bool Decode( IOStream & stream, void * & outData, size_t & outDataSize );
+
+    // Forget all segments (when the connection is lost)
+    void Clear();
+
+    inline uint32_t GetNumSegments() const  { return m_NumSegments; }
+    inline uint64_t GetStoredSize() const   { return m_StoredSize; }
+
+private:
+    enum : uint32_t
+    {
+        MIN_SEGMENT_SIZE    = 256,                  // Smaller segments are always sent inline
+        MAX_STORED_SIZE     = ( 64 * 1024 * 1024 ), // Once exceeded, new segments are sent inline
+    };
+    enum SegmentType : uint8_t
+    {
+        SEGMENT_INLINE      = 0,    // size, data
+        SEGMENT_NEW         = 1,    // hash, size, data (stored)
+        SEGMENT_STORED      = 2,    // hash
+    };
+
+    struct Segment
+    {
+        uint64_t    m_Hash; // 0 = unused slot
+        void *      m_Data; // Only kept by the worker
+        uint32_t    m_Size;
+    };
+
+    const Segment * Find( uint64_t hash ) const;
+    void            Add( uint64_t hash, void * data, uint32_t size );
+    static const char * FindSegmentEnd( const char * pos, const char * end );
+
+    Array< Segment >    m_Segments; // Open addressing hash table
+    uint32_t            m_NumSegments;
+    uint64_t            m_StoredSize;
+};
+
+//------------------------------------------------------------------------------
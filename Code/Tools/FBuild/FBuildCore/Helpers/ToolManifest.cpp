@@ -20,6 +20,7 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/FileNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 
 // system
 #include <memory.h> // memcpy
@@ -38,6 +39,7 @@ REFLECT_STRUCT_BEGIN( ToolManifestFile, Struct, MetaNone() )
     REFLECT( m_Name,        "Name",         MetaHidden() )
     REFLECT( m_TimeStamp,   "TimeStamp",    MetaHidden() )
     REFLECT( m_Hash,        "Hash",         MetaHidden() )
+    REFLECT( m_ContentHash, "ContentHash",  MetaHidden() )
     REFLECT( m_UncompressedContentSize, "UncompressedContentSize",  MetaHidden() )
     REFLECT( m_CompressedContentSize, "CompressedContentSize",  MetaHidden() )
 REFLECT_END( ToolManifestFile )
@@ -48,10 +50,11 @@ ToolManifestFile::ToolManifestFile() = default;
 
 // CONSTRUCTOR (ToolManifestFile)
 //------------------------------------------------------------------------------
-ToolManifestFile::ToolManifestFile( const AString & name, uint64_t stamp, uint32_t hash, uint32_t size )
+ToolManifestFile::ToolManifestFile( const AString & name, uint64_t stamp, uint32_t hash, uint64_t contentHash, uint32_t size )
     : m_Name( name )
     , m_TimeStamp( stamp )
     , m_Hash( hash )
+    , m_ContentHash( contentHash )
     , m_UncompressedContentSize( size )
 {}
 
@@ -141,6 +144,7 @@ bool ToolManifestFile::DoBuild()
 
     // Store the hash and timestamp
     m_Hash = xxHash::Calc32( uncompressedContent, uncompressedContentSize ); // TODO:C Switch to 64 bit hash
+    m_ContentHash = xxHash::Calc64( uncompressedContent, uncompressedContentSize );
     m_TimeStamp = FileIO::GetFileLastWriteTime( m_Name );
 
     // Compress and keep the data if it might be useful
@@ -161,6 +165,7 @@ void ToolManifestFile::Migrate( const ToolManifestFile & oldFile )
     ASSERT( m_Name == oldFile.m_Name );
     m_TimeStamp = oldFile.m_TimeStamp;
     m_Hash = oldFile.m_Hash;
+    m_ContentHash = oldFile.m_ContentHash;
 }
 
 // Generate
@@ -175,7 +180,7 @@ void ToolManifest::Initialize( const AString & mainExecutableRoot, const Depende
     m_Files.SetCapacity( dependencies.GetSize() );
     for ( const Dependency & dep : dependencies )
     {
-        m_Files.EmplaceBack( dep.GetNode()->GetName(), (uint64_t)0, (uint32_t)0, (uint32_t)0 );
+        m_Files.EmplaceBack( dep.GetNode()->GetName(), (uint64_t)0, (uint32_t)0, (uint64_t)0, (uint32_t)0 );
     }
 }
 
@@ -248,7 +253,7 @@ void ToolManifest::Migrate( const ToolManifest & oldManifest )
 
 // SerializeForRemote
 //------------------------------------------------------------------------------
-void ToolManifest::SerializeForRemote( IOStream & ms ) const
+void ToolManifest::SerializeForRemote( IOStream & ms, uint32_t protocolVersion ) const
 {
     ms.Write( m_ToolId );
     ms.Write( m_MainExecutableRootPath );
@@ -262,6 +267,10 @@ void ToolManifest::SerializeForRemote( IOStream & ms ) const
         ms.Write( f.GetName() );
         ms.Write( f.GetTimeStamp() );
         ms.Write( f.GetHash() );
+        if ( protocolVersion >= Protocol::PROTOCOL_VERSION_CONTENT_HASHES )
+        {
+            ms.Write( f.GetContentHash() );
+        }
         ms.Write( f.GetUncompressedContentSize() );
     }
 
@@ -275,7 +284,7 @@ void ToolManifest::SerializeForRemote( IOStream & ms ) const
 
 // DeserializeFromRemote
 //------------------------------------------------------------------------------
-void ToolManifest::DeserializeFromRemote( IOStream & ms )
+void ToolManifest::DeserializeFromRemote( IOStream & ms, uint32_t protocolVersion )
 {
     ms.Read( m_ToolId );
     ms.Read( m_MainExecutableRootPath );
@@ -291,12 +300,17 @@ void ToolManifest::DeserializeFromRemote( IOStream & ms )
         AStackString<> name;
         uint64_t timeStamp( 0 );
         uint32_t hash( 0 );
+        uint64_t contentHash( 0 );
         uint32_t uncompressedContentSize( 0 );
         ms.Read( name );
         ms.Read( timeStamp );
         ms.Read( hash );
+        if ( protocolVersion >= Protocol::PROTOCOL_VERSION_CONTENT_HASHES )
+        {
+            ms.Read( contentHash );
+        }
         ms.Read( uncompressedContentSize );
-        m_Files.EmplaceBack( name, timeStamp, hash, uncompressedContentSize );
+        m_Files.EmplaceBack( name, timeStamp, hash, contentHash, uncompressedContentSize );
     }
 
     ASSERT( m_CustomEnvironmentVariables.IsEmpty() );
@@ -327,28 +341,24 @@ void ToolManifest::DeserializeFromRemote( IOStream & ms )
         FileIO::SetFileLastWriteTimeToNow( localFile );
 
         // is this file already present?
-        UniquePtr< FileStream, DeleteDeletor > fileStream( FNEW( FileStream ) );
-        FileStream & f = *( fileStream.Get() );
-        if ( f.Open( localFile.Get() ) == false )
-        {
-            continue; // file not found
-        }
-        if ( f.GetFileSize() != m_Files[ i ].GetUncompressedContentSize() )
+        FileStream * fileStream = OpenFileIfValid( localFile, m_Files[ i ] );
+        if ( fileStream == nullptr )
         {
-            continue; // file is not complete
-        }
-        UniquePtr< char > mem( (char *)ALLOC( (size_t)f.GetFileSize() ) );
-        if ( f.Read( mem.Get(), (size_t)f.GetFileSize() ) != f.GetFileSize() )
-        {
-            continue; // problem reading file
-        }
-        if ( xxHash::Calc32( mem.Get(), (size_t)f.GetFileSize() ) != m_Files[ i ].GetHash() )
-        {
-            continue; // file contents unexpected
+            // was the same file received for another toolchain?
+            if ( RestoreFileFromStore( (uint32_t)i, localFile ) == false )
+            {
+                continue; // file must be synchronized
+            }
+            fileStream = FNEW( FileStream );
+            if ( fileStream->Open( localFile.Get(), FileStream::READ_ONLY ) == false )
+            {
+                FDELETE fileStream;
+                continue; // problem opening copied file
+            }
         }
 
         // file present and ok
-        m_Files[ i ].SetFileLock( fileStream.Release() ); // NOTE: keep file open to prevent deletions
+        m_Files[ i ].SetFileLock( fileStream ); // NOTE: keep file open to prevent deletions
         m_Files[ i ].SetSyncState( ToolManifestFile::SYNCHRONIZED );
         numFilesAlreadySynchronized++;
     }
@@ -585,6 +595,9 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId, const void * data, size_t &
         FileIO::SetExecutable( fileName.Get() );
     #endif
 
+    // keep a copy for other toolchains which use the same file
+    AddFileToStore( fileId, uncompressedData, uncompressedDataSize );
+
     // open read-only
     UniquePtr< FileStream, DeleteDeletor > fileStream( FNEW( FileStream ) );
     if ( fileStream.Get()->Open( fileName.Get(), FileStream::READ_ONLY ) == false )
@@ -609,6 +622,9 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId, const void * data, size_t &
 
     // all files received
     m_Synchronized = true;
+
+    // files were added to the store, so keep it within its limit
+    TrimStore();
     return true; // file stored ok
 }
 
@@ -643,6 +659,13 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId, const void * data, size_t &
         
             // Make modification time now
             FileIO::SetFileLastWriteTimeToNow( fileName );
+
+            // Keep the stored copy too, while the file is in use
+            if ( m_Files[ fileId ].GetContentHash() != 0 )
+            {
+                GetStoreFilePath( (uint32_t)fileId, fileName );
+                FileIO::SetFileLastWriteTimeToNow( fileName );
+            }
         }
     }
 #endif
@@ -675,6 +698,169 @@ void ToolManifest::GetRemotePath( AString & path ) const
     path += subDir;
 }
 
+// GetStoreFilePath
+//------------------------------------------------------------------------------
+void ToolManifest::GetStoreFilePath( uint32_t fileId, AString & path ) const
+{
+    // Files received for any toolchain are stored by content, so toolchains which
+    // share files (such as different versions of the same compiler) only need
+    // to synchronize the files which differ, even across worker restarts
+    const ToolManifestFile & f = m_Files[ fileId ];
+    ASSERT( f.GetContentHash() != 0 ); // Only files with a 64 bit hash are stored
+    GetStorePath( path );
+    path.AppendFormat( "%016" PRIX64 ".%u", f.GetContentHash(), f.GetUncompressedContentSize() );
+}
+
+// GetStorePath
+//------------------------------------------------------------------------------
+/*static*/ void ToolManifest::GetStorePath( AString & path )
+{
+    VERIFY( FBuild::GetTempDir( path ) );
+    #if defined( __WINDOWS__ )
+        path += ".fbuild.tmp\\worker\\files\\";
+    #else
+        path += "_fbuild.tmp/worker/files/";
+    #endif
+}
+
+// TrimStore
+//------------------------------------------------------------------------------
+/*static*/ void ToolManifest::TrimStore( uint64_t maxSize )
+{
+    PROFILE_FUNCTION;
+
+    AStackString<> storePath;
+    GetStorePath( storePath );
+    Array< FileIO::FileInfo > files;
+    if ( FileIO::GetFilesEx( storePath, nullptr, false, &files ) == false )
+    {
+        return; // Nothing stored yet
+    }
+
+    uint64_t totalSize = 0;
+    for ( const FileIO::FileInfo & file : files )
+    {
+        totalSize += file.m_Size;
+    }
+    if ( totalSize <= maxSize )
+    {
+        return;
+    }
+
+    // Delete the least recently used files (stored files are touched when used,
+    // and copied into each toolchain, so toolchains in use are unaffected)
+    files.Sort( []( const FileIO::FileInfo & a, const FileIO::FileInfo & b )
+    {
+        return ( a.m_LastWriteTime < b.m_LastWriteTime );
+    } );
+    for ( const FileIO::FileInfo & file : files )
+    {
+        if ( totalSize <= maxSize )
+        {
+            break;
+        }
+        if ( FileIO::FileDelete( file.m_Name.Get() ) )
+        {
+            totalSize -= file.m_Size;
+        }
+    }
+}
+
+// OpenFileIfValid
+//------------------------------------------------------------------------------
+/*static*/ FileStream * ToolManifest::OpenFileIfValid( const AString & fileName, const ToolManifestFile & file )
+{
+    UniquePtr< FileStream, DeleteDeletor > fileStream( FNEW( FileStream ) );
+    FileStream & f = *( fileStream.Get() );
+    if ( f.Open( fileName.Get() ) == false )
+    {
+        return nullptr; // file not found
+    }
+    if ( f.GetFileSize() != file.GetUncompressedContentSize() )
+    {
+        return nullptr; // file is not complete
+    }
+    UniquePtr< char > mem( (char *)ALLOC( (size_t)f.GetFileSize() ) );
+    if ( f.Read( mem.Get(), (size_t)f.GetFileSize() ) != f.GetFileSize() )
+    {
+        return nullptr; // problem reading file
+    }
+    const bool hashMatches = ( file.GetContentHash() != 0 ) ? ( xxHash::Calc64( mem.Get(), (size_t)f.GetFileSize() ) == file.GetContentHash() )
+                                                            : ( xxHash::Calc32( mem.Get(), (size_t)f.GetFileSize() ) == file.GetHash() );
+    if ( hashMatches == false )
+    {
+        return nullptr; // file contents unexpected
+    }
+    return fileStream.Release();
+}
+
+// RestoreFileFromStore
+//------------------------------------------------------------------------------
+bool ToolManifest::RestoreFileFromStore( uint32_t fileId, const AString & fileName ) const
+{
+    // files are only shared if identified by a 64 bit hash, as 32 bit hashes
+    // of different files in different toolchains can collide
+    if ( m_Files[ fileId ].GetContentHash() == 0 )
+    {
+        return false;
+    }
+
+    // is the file in the store (and intact)?
+    AStackString<> storeFileName;
+    GetStoreFilePath( fileId, storeFileName );
+    {
+        UniquePtr< FileStream, DeleteDeletor > storeFile( OpenFileIfValid( storeFileName, m_Files[ fileId ] ) );
+        if ( storeFile.Get() == nullptr )
+        {
+            return false;
+        }
+    }
+
+    // copy to the toolchain
+    if ( ( FileIO::EnsurePathExistsForFile( fileName ) == false ) ||
+         ( FileIO::FileCopy( storeFileName.Get(), fileName.Get() ) == false ) )
+    {
+        return false;
+    }
+    #if defined( __LINUX__ ) || defined( __OSX__ )
+        FileIO::SetExecutable( fileName.Get() );
+    #endif
+    FileIO::SetFileLastWriteTimeToNow( storeFileName );
+    return true;
+}
+
+// AddFileToStore
+//------------------------------------------------------------------------------
+void ToolManifest::AddFileToStore( uint32_t fileId, const void * data, size_t dataSize ) const
+{
+    // only store files whose content matches the hash they're shared by
+    const uint64_t contentHash = m_Files[ fileId ].GetContentHash();
+    if ( ( contentHash == 0 ) || ( xxHash::Calc64( data, dataSize ) != contentHash ) )
+    {
+        return;
+    }
+
+    AStackString<> storeFileName;
+    GetStoreFilePath( fileId, storeFileName );
+    if ( FileIO::FileExists( storeFileName.Get() ) )
+    {
+        return; // already received for another toolchain
+    }
+
+    // NOTE: Failure to store is not an error, as the file is already in the
+    // toolchain. Stored files are verified before use, so partially written
+    // files are harmless.
+    if ( FileIO::EnsurePathExistsForFile( storeFileName ) == false )
+    {
+        return;
+    }
+    FileStream fs;
+    if ( fs.Open( storeFileName.Get(), FileStream::WRITE_ONLY ) )
+    {
+        fs.Write( data, dataSize );
+    }
+}
+
 // LoadFile (ToolManifestFile)
 //------------------------------------------------------------------------------
 bool ToolManifestFile::LoadFile( void * & uncompressedContent, uint32_t & uncompressedContentSize ) const
@@ -26,7 +26,7 @@ class ToolManifestFile : public Struct
     REFLECT_STRUCT_DECLARE( ToolManifestFile )
 public:
     ToolManifestFile();
-    explicit ToolManifestFile( const AString & name, uint64_t stamp, uint32_t hash, uint32_t size );
+    explicit ToolManifestFile( const AString & name, uint64_t stamp, uint32_t hash, uint64_t contentHash, uint32_t size );
     ~ToolManifestFile();
 
     enum SyncState
@@ -46,6 +46,7 @@ public:
     const AString &     GetName() const                     { return m_Name; }
     uint64_t            GetTimeStamp() const                { return m_TimeStamp; }
     uint32_t            GetHash() const                     { return m_Hash; }
+    uint64_t            GetContentHash() const              { return m_ContentHash; }
     uint32_t            GetUncompressedContentSize() const  { return m_UncompressedContentSize; }
     SyncState           GetSyncState() const                { return m_SyncState; }
 
@@ -60,6 +61,7 @@ protected:
     AString          m_Name;
     uint64_t         m_TimeStamp     = 0;
     uint32_t         m_Hash          = 0;
+    uint64_t         m_ContentHash   = 0; // 64 bit hash identifying the file in the worker's store (0 if sent by older clients)
     mutable uint32_t m_UncompressedContentSize = 0;
     mutable uint32_t m_CompressedContentSize = 0;
 
@@ -88,8 +90,8 @@ public:
     inline uint64_t GetToolId() const { return m_ToolId; }
     inline uint64_t GetTimeStamp() const { return m_TimeStamp; }
 
-    void SerializeForRemote( IOStream & ms ) const;
-    void DeserializeFromRemote( IOStream & ms );
+    void SerializeForRemote( IOStream & ms, uint32_t protocolVersion ) const;
+    void DeserializeFromRemote( IOStream & ms, uint32_t protocolVersion );
 
     inline bool IsSynchronized() const { return m_Synchronized; }
     bool GetSynchronizationStatus( uint32_t & syncDone, uint32_t & syncTotal ) const;
@@ -112,15 +114,26 @@ public:
 
     void            GetRemotePath( AString & path ) const;
     void            GetRemoteFilePath( uint32_t fileId, AString & exe ) const;
+    void            GetStoreFilePath( uint32_t fileId, AString & path ) const;
     const char *    GetRemoteEnvironmentString() const { return m_RemoteEnvironmentString; }
 
     static void     GetRelativePath( const AString & root, const AString & otherFile, AString & otherFileRelativePath );
+
+    // Files received by workers are stored (by content) for use by other toolchains,
+    // with the least recently used files deleted to keep the store within a size limit
+    enum : uint64_t { MAX_STORE_SIZE = ( 2048ULL * 1024 * 1024 ) };
+    static void     GetStorePath( AString & path );
+    static void     TrimStore( uint64_t maxSize = MAX_STORE_SIZE );
     
     #if defined( __OSX__ ) || defined( __LINUX__ )
         void            TouchFiles() const;
     #endif
 
 private:
+    static FileStream * OpenFileIfValid( const AString & fileName, const ToolManifestFile & file );
+    bool                RestoreFileFromStore( uint32_t fileId, const AString & fileName ) const;
+    void                AddFileToStore( uint32_t fileId, const void * data, size_t dataSize ) const;
+
     mutable Mutex   m_Mutex;
 
     // Reflected
@@ -6,6 +6,7 @@
 #include "Client.h"
 
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheMissMemo.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/CompilerNode.h"
@@ -13,6 +14,7 @@
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include <Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h>
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
@@ -20,6 +22,7 @@
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Math/Random.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Profile/Profile.h"
@@ -28,24 +31,55 @@
 //------------------------------------------------------------------------------
 #define CLIENT_STATUS_UPDATE_FREQUENCY_SECONDS ( 0.1f )
 #define CONNECTION_REATTEMPT_DELAY_TIME ( 10.0f )
+#define CONNECTION_REATTEMPT_DELAY_TIME_MAX ( 80.0f )
+#define CONNECTION_TIMEOUT_MS ( 2000 )
 #define SYSTEM_ERROR_ATTEMPT_COUNT ( 3 )
+#define WORKER_STATS_MIN_JOBS ( 4 )             // results needed before a worker is judged
+#define SLOW_WORKER_TIME_RATIO ( 1.5f )         // relative to the average of all workers
+#define UNRELIABLE_WORKER_FAILURE_RATE ( 0.25f )
 #define DIST_INFO( ... ) do { if ( m_DetailedLogging ) { FLOG_OUTPUT( __VA_ARGS__ ); } } while( false )
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 Client::Client( const Array< AString > & workerList,
+                bool workerListRanked,
                 uint16_t port,
                 uint32_t workerConnectionLimit,
-                bool detailedLogging )
+                uint32_t workerConnectionFanOut,
+                bool detailedLogging,
+                bool deduplicateJobData,
+                bool workerCache,
+                uint8_t priority,
+                uint32_t protocolVersion )
     : m_WorkerList( workerList )
+    , m_WorkerListRanked( workerListRanked )
     , m_ShouldExit( false )
     , m_DetailedLogging( detailedLogging )
+    , m_DeduplicateJobData( deduplicateJobData && ( protocolVersion >= Protocol::PROTOCOL_VERSION_DEDUPLICATED_JOBS ) )
+    , m_WorkerCache( workerCache && ( protocolVersion >= Protocol::PROTOCOL_VERSION_WORKER_CACHE ) )
+    , m_Priority( priority )
+    , m_ProtocolVersion( protocolVersion )
     , m_WorkerConnectionLimit( workerConnectionLimit )
     , m_Port( port )
+    , m_TimeRatio( 0.0f )
+    , m_PendingConnections( 0, true )
+    , m_ConnectionThreads( 0, true )
 {
     // allocate space for server states
     m_ServerList.SetSize( workerList.GetSize() );
 
+    // create threads to make connection attempts
+    const uint32_t numConnectionThreads = Math::Min( Math::Max( workerConnectionFanOut, 1u ), (uint32_t)workerList.GetSize() );
+    for ( uint32_t i = 0; i < numConnectionThreads; ++i )
+    {
+        Thread::ThreadHandle h = Thread::CreateThread( ConnectionThreadFuncStatic,
+                                                       "ClientConnection",
+                                                       ( 64 * KILOBYTE ),
+                                                       this );
+        ASSERT( h );
+        m_ConnectionThreads.Append( h );
+    }
+
     m_Thread = Thread::CreateThread( ThreadFuncStatic,
                                      "Client",
                                      ( 64 * KILOBYTE ),
@@ -64,6 +98,17 @@ Client::~Client()
     AtomicStoreRelaxed( &m_ShouldExit, true );
     Thread::WaitForThread( m_Thread );
 
+    // connection attempts in progress are aborted by SetShuttingDown
+    if ( m_ConnectionThreads.IsEmpty() == false )
+    {
+        m_PendingConnectionsSemaphore.Signal( (uint32_t)m_ConnectionThreads.GetSize() );
+    }
+    for ( Thread::ThreadHandle h : m_ConnectionThreads )
+    {
+        Thread::WaitForThread( h );
+        Thread::CloseHandle( h );
+    }
+
     ShutdownAllConnections();
 
     Thread::CloseHandle( m_Thread );
@@ -77,9 +122,19 @@ Client::~Client()
     ASSERT( ss );
 
     MutexHolder mh( ss->m_Mutex );
-    DIST_INFO( "Disconnected: %s\n", ss->m_RemoteName.Get() );
+    DIST_INFO( "Disconnected: %s (Jobs: %u, Failed: %u, MaxInFlight: %u, TimeRatio: %.2f, Latency: %.0fms)\n",
+               ss->m_RemoteName.Get(),
+               ss->m_NumJobsCompleted,
+               ss->m_NumJobsFailed,
+               ss->m_MaxJobsInFlight,
+               (double)ss->m_TimeRatio,
+               (double)ss->m_LatencyMS );
     if ( ss->m_Jobs.IsEmpty() == false )
     {
+        // jobs lost with the connection count against the worker
+        ss->m_NumJobsFailed += (uint32_t)ss->m_Jobs.GetSize();
+        ss->m_JobTimings.Clear();
+
         Job ** it = ss->m_Jobs.Begin();
         const Job * const * end = ss->m_Jobs.End();
         while ( it != end )
@@ -96,6 +151,8 @@ Client::~Client()
     FREE( (void *)( ss->m_CurrentMessage ) );
 
     ss->m_RemoteName.Clear();
+    ss->m_DictionariesSent.Clear();
+    ss->m_Deduplicator.Clear();
     AtomicStoreRelaxed( &ss->m_Connection, static_cast< const ConnectionInfo * >( nullptr ) );
     ss->m_CurrentMessage = nullptr;
 }
@@ -152,41 +209,59 @@ void Client::LookForWorkers()
 
     const size_t numWorkers( m_ServerList.GetSize() );
 
-    // find out how many connections we have now
+    // find out how many connections we have now, or are in the process of making
     size_t numConnections = 0;
+    size_t numConnecting = 0;
     for ( size_t i=0; i<numWorkers; i++ )
     {
         if ( AtomicLoadRelaxed( &m_ServerList[ i ].m_Connection ) )
         {
             numConnections++;
         }
+        else if ( AtomicLoadAcquire( &m_ServerList[ i ].m_Connecting ) )
+        {
+            numConnecting++;
+        }
     }
 
     // limit maximum concurrent connections
-    if ( numConnections >= m_WorkerConnectionLimit )
+    if ( ( numConnections + numConnecting ) >= m_WorkerConnectionLimit )
+    {
+        return;
+    }
+
+    // limit concurrent connection attempts
+    if ( numConnecting >= m_ConnectionThreads.GetSize() )
     {
         return;
     }
 
     // if we're connected to every possible worker already
-    if ( numConnections == numWorkers )
+    if ( ( numConnections + numConnecting ) == numWorkers )
     {
         return;
     }
 
+    const size_t maxAttempts = Math::Min( ( m_WorkerConnectionLimit - ( numConnections + numConnecting ) ),
+                                          ( m_ConnectionThreads.GetSize() - numConnecting ) );
+
     // randomize the start index to better distribute workers when there
     // are many workers/clients - otherwise all clients will attempt to connect
     // to the same subset of workers
+    // (unless the coordinator has already ranked them for us)
     Random r;
-    size_t startIndex = r.GetRandIndex( (uint32_t)numWorkers );
+    const size_t startIndex = m_WorkerListRanked ? 0 : r.GetRandIndex( (uint32_t)numWorkers );
 
-    // find someone to connect to
-    for ( size_t j=0; j<numWorkers; j++ )
+    // find workers to connect to, preferring those not previously found
+    // to be slow or unreliable
+    uint32_t numAttempts = 0;
+    for ( size_t j=0; ( j<( numWorkers * 2 ) ) && ( numAttempts < maxAttempts ); j++ )
     {
         const size_t i( ( j + startIndex ) % numWorkers );
+        const bool firstPass = ( j < numWorkers );
 
         ServerState & ss = m_ServerList[ i ];
-        if ( AtomicLoadRelaxed( &ss.m_Connection ) )
+        if ( AtomicLoadRelaxed( &ss.m_Connection ) || AtomicLoadAcquire( &ss.m_Connecting ) )
         {
             continue;
         }
@@ -202,35 +277,109 @@ void Client::LookForWorkers()
 
         ASSERT( ss.m_Jobs.IsEmpty() );
 
-        if ( ss.m_DelayTimer.GetElapsed() < CONNECTION_REATTEMPT_DELAY_TIME )
+        if ( firstPass && IsSlowWorker( ss ) )
+        {
+            continue;
+        }
+
+        // back off from workers we repeatedly fail to connect to
+        float reattemptDelay = CONNECTION_REATTEMPT_DELAY_TIME;
+        for ( uint32_t k = 1; ( k < ss.m_NumFailedConnections ) && ( reattemptDelay < CONNECTION_REATTEMPT_DELAY_TIME_MAX ); ++k )
+        {
+            reattemptDelay *= 2.0f;
+        }
+        if ( ss.m_DelayTimer.GetElapsed() < reattemptDelay )
         {
             continue;
         }
 
-        DIST_INFO( "Connecting to: %s\n", m_WorkerList[ i ].Get() );
-        const ConnectionInfo * ci = Connect( m_WorkerList[ i ], m_Port, 2000, &ss ); // 2000ms connection timeout
+        // hand over to a connection thread
+        AtomicStoreRelaxed( &ss.m_Connecting, true );
+        {
+            MutexHolder mhPC( m_PendingConnectionsMutex );
+            m_PendingConnections.Append( (uint32_t)i );
+        }
+        ++numAttempts;
+    }
+
+    if ( numAttempts > 0 )
+    {
+        m_PendingConnectionsSemaphore.Signal( numAttempts );
+    }
+}
+
+// ConnectionThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Client::ConnectionThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "ClientConnectionThread" );
+
+    Client * c = (Client *)param;
+    c->ConnectionThreadFunc();
+    return 0;
+}
+
+// ConnectionThreadFunc
+//------------------------------------------------------------------------------
+void Client::ConnectionThreadFunc()
+{
+    for ( ;; )
+    {
+        m_PendingConnectionsSemaphore.Wait();
+        if ( AtomicLoadRelaxed( &m_ShouldExit ) )
+        {
+            break;
+        }
+
+        uint32_t workerIndex;
+        {
+            MutexHolder mh( m_PendingConnectionsMutex );
+            ASSERT( m_PendingConnections.IsEmpty() == false );
+            workerIndex = m_PendingConnections.Top();
+            m_PendingConnections.Pop();
+        }
+
+        ConnectToWorker( workerIndex );
+    }
+}
+
+// ConnectToWorker
+//------------------------------------------------------------------------------
+void Client::ConnectToWorker( size_t workerIndex )
+{
+    PROFILE_FUNCTION;
+
+    ServerState & ss = m_ServerList[ workerIndex ];
+    {
+        // lock the server state for the duration of the attempt, so a disconnection
+        // can't be processed before the connection has been recorded
+        MutexHolder mhSS( ss.m_Mutex );
+
+        DIST_INFO( "Connecting to: %s\n", m_WorkerList[ workerIndex ].Get() );
+        const ConnectionInfo * ci = Connect( m_WorkerList[ workerIndex ], m_Port, CONNECTION_TIMEOUT_MS, &ss );
         if ( ci == nullptr )
         {
-            DIST_INFO( " - connection: %s (FAILED)\n", m_WorkerList[ i ].Get() );
+            DIST_INFO( " - connection: %s (FAILED)\n", m_WorkerList[ workerIndex ].Get() );
+            ss.m_NumFailedConnections++;
             ss.m_DelayTimer.Start(); // reset connection attempt delay
         }
         else
         {
-            DIST_INFO( " - connection: %s (OK)\n", m_WorkerList[ i ].Get() );
+            DIST_INFO( " - connection: %s (OK)\n", m_WorkerList[ workerIndex ].Get() );
             const uint32_t numJobsAvailable = (uint32_t)JobQueue::Get().GetNumDistributableJobsAvailable();
 
-            ss.m_RemoteName = m_WorkerList[ i ];
+            ss.m_RemoteName = m_WorkerList[ workerIndex ];
+            ss.m_NumFailedConnections = 0;
             AtomicStoreRelaxed( &ss.m_Connection, ci ); // success!
             ss.m_NumJobsAvailable = numJobsAvailable;
 
             // send connection msg
-            Protocol::MsgConnection msg( numJobsAvailable );
+            Protocol::MsgConnection msg( numJobsAvailable, m_Priority, m_ProtocolVersion );
             SendMessageInternal( ci, msg );
         }
-
-        // limit to one connection attempt per iteration
-        return;
     }
+
+    AtomicStoreRelease( &ss.m_Connecting, false );
 }
 
 // CommunicateJobAvailability
@@ -251,6 +400,13 @@ void Client::CommunicateJobAvailability()
     MutexHolder mh( m_ServerListMutex );
     for ( ServerState & ss : m_ServerList )
     {
+        // Skip servers without a connection without locking them, as servers
+        // being connected to remain locked until the attempt completes
+        if ( AtomicLoadRelaxed( &ss.m_Connection ) == nullptr )
+        {
+            continue;
+        }
+
         // Do we have a connection?
         MutexHolder ssMH( ss.m_Mutex );
         const ConnectionInfo * connection = AtomicLoadRelaxed( &ss.m_Connection );
@@ -322,6 +478,22 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
                 (uint32_t)memoryStream.GetSize() );
 }
 
+// SendMessageInternal
+//------------------------------------------------------------------------------
+void Client::SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const Protocol::PayloadBuffers & payload )
+{
+    if ( msg.Send( connection, payload ) )
+    {
+        return;
+    }
+
+    DIST_INFO( "Send Failed: %s (Type: %u, Size: %u, Payload: %u)\n",
+                ((ServerState *)connection->GetUserData())->m_RemoteName.Get(),
+                (uint32_t)msg.GetType(),
+                msg.GetSize(),
+                (uint32_t)payload.GetSize() );
+}
+
 // OnReceive
 //------------------------------------------------------------------------------
 /*virtual*/ void Client::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory )
@@ -367,12 +539,24 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
             Process( connection, msg );
             break;
         }
+        case Protocol::MSG_REQUEST_JOBS:
+        {
+            const Protocol::MsgRequestJobs * msg = static_cast< const Protocol::MsgRequestJobs * >( imsg );
+            Process( connection, msg );
+            break;
+        }
         case Protocol::MSG_JOB_RESULT:
         {
             const Protocol::MsgJobResult * msg = static_cast< const Protocol::MsgJobResult * >( imsg );
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_JOB_RESULTS:
+        {
+            const Protocol::MsgJobResults * msg = static_cast< const Protocol::MsgJobResults * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
         case Protocol::MSG_REQUEST_MANIFEST:
         {
             const Protocol::MsgRequestManifest * msg = static_cast< const Protocol::MsgRequestManifest * >( imsg );
@@ -410,16 +594,8 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     ServerState * ss = (ServerState *)connection->GetUserData();
     ASSERT( ss );
 
-    // no jobs for deny listed workers
-    if ( ss->m_Denylisted )
-    {
-        MutexHolder mh( ss->m_Mutex );
-        Protocol::MsgNoJobAvailable msg;
-        SendMessageInternal( connection, msg );
-        return;
-    }
-
-    Job * job = JobQueue::Get().GetDistributableJobToProcess( true );
+    uint64_t toolId = 0;
+    Job * job = GetJobForServer( connection, toolId );
     if ( job == nullptr )
     {
         PROFILE_SECTION( "NoJob" );
@@ -432,12 +608,84 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     }
 
     // send the job to the client
-    MemoryStream stream;
-    job->Serialize( stream );
+    MutexHolder mh( ss->m_Mutex );
+    Protocol::PayloadBuffers payload;
+    WriteJob( *ss, job, payload );
+    {
+        PROFILE_SECTION( "SendJob" );
+        Protocol::MsgJob msg( toolId );
+        SendMessageInternal( connection, msg, payload );
+    }
+}
+
+// Process( MsgRequestJobs )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequestJobs * msg )
+{
+    PROFILE_SECTION( "MsgRequestJobs" );
+
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    // send as many of the requested jobs as are available, each preceded by its tool id
+    MutexHolder mh( ss->m_Mutex );
+    Protocol::PayloadBuffers payload;
+    uint32_t numJobs = 0;
+    while ( numJobs < msg->GetNumJobs() )
+    {
+        uint64_t toolId = 0;
+        Job * job = GetJobForServer( connection, toolId );
+        if ( job == nullptr )
+        {
+            break; // we completed or gave away the other jobs already
+        }
+        payload.GetStream().Write( toolId );
+        WriteJob( *ss, job, payload );
+        ++numJobs;
+    }
+
+    DIST_INFO( "Job Requests: %s (Requested: %u, Sent: %u)\n", ss->m_RemoteName.Get(), msg->GetNumJobs(), numJobs );
+
+    {
+        PROFILE_SECTION( "SendJobs" );
+        Protocol::MsgJobs reply( msg->GetNumJobs(), numJobs );
+        if ( numJobs > 0 )
+        {
+            SendMessageInternal( connection, reply, payload );
+        }
+        else
+        {
+            SendMessageInternal( connection, reply );
+        }
+    }
+}
+
+// GetJobForServer
+//------------------------------------------------------------------------------
+Job * Client::GetJobForServer( const ConnectionInfo * connection, uint64_t & outToolId )
+{
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    // no jobs for deny listed workers
+    if ( ss->m_Denylisted )
+    {
+        return nullptr;
+    }
 
     MutexHolder mh( ss->m_Mutex );
 
-    ss->m_Jobs.Append( job ); // Track in-flight job
+    // slow workers are given short jobs, so long ones are left for faster workers
+    Job * job = JobQueue::Get().GetDistributableJobToProcess( true, IsSlowWorker( *ss ) );
+    if ( job == nullptr )
+    {
+        return nullptr;
+    }
+
+    // Track in-flight job
+    ss->m_Jobs.Append( job );
+    ss->m_JobTimings.Append( ServerState::JobTiming{ job->GetJobId(), job->GetNode()->GetLastBuildTime(), Timer::GetNow() } );
+    ss->m_MaxJobsInFlight = Math::Max( ss->m_MaxJobsInFlight, (uint32_t)ss->m_Jobs.GetSize() );
 
     // Reset the Available Jobs count for this worker. This ensures that we send
     // another status update message to communicate new jobs becoming available.
@@ -458,16 +706,118 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     }
     FLOG_MONITOR( "START_JOB %s \"%s\" \n", ss->m_RemoteName.Get(), job->GetNode()->GetName().Get() );
 
+    // send the dictionary needed to decompress the job, if the server doesn't have it
+    // (deduplicated job data is decompressed before being sent)
+    const uint32_t dictionaryId = ( job->IsDataCompressed() && !m_DeduplicateJobData ) ? Compressor::GetDictionaryId( job->GetData() ) : 0;
+    if ( ( dictionaryId != 0 ) && ( ss->m_DictionariesSent.Find( dictionaryId ) == nullptr ) )
     {
-        PROFILE_SECTION( "SendJob" );
-        Protocol::MsgJob msg( toolId );
-        SendMessageInternal( connection, msg, stream );
+        const Compressor::Dictionary * dictionary = Compressor::FindDictionary( dictionaryId );
+        ASSERT( dictionary ); // Registered by the cache which compressed the job
+        if ( dictionary )
+        {
+            PROFILE_SECTION( "SendDictionary" );
+            Protocol::MsgCompressionDictionary msg;
+            const ConstMemoryStream ms( dictionary->GetData(), dictionary->GetDataSize() );
+            msg.Send( connection, ms );
+            ss->m_DictionariesSent.Append( dictionaryId );
+        }
+    }
+
+    outToolId = toolId;
+    return job;
+}
+
+// WriteJob
+//------------------------------------------------------------------------------
+void Client::WriteJob( ServerState & ss, Job * job, Protocol::PayloadBuffers & payload )
+{
+    // Let the worker use the cache with the key we calculated, as we would
+    uint8_t cacheAccess = Job::REMOTE_CACHE_ACCESS_NONE;
+    if ( m_WorkerCache && ( job->GetCacheName().IsEmpty() == false ) )
+    {
+        const FBuildOptions & options = FBuild::Get().GetOptions();
+        cacheAccess |= options.m_UseCacheRead ? Job::REMOTE_CACHE_ACCESS_READ : 0;
+        cacheAccess |= options.m_UseCacheWrite ? Job::REMOTE_CACHE_ACCESS_WRITE : 0;
+        job->SetRemoteCacheCompressionLevel( (int8_t)options.m_CacheCompressionLevel ); // Validated to fit by FBuildOptions
+
+        if ( options.m_DistCacheKeyMismatch_Debug )
+        {
+            // Alter the preprocessed source part of the key
+            const AString & cacheName = job->GetCacheName();
+            AStackString<> mismatchedCacheName;
+            mismatchedCacheName.Format( "%c%s", ( cacheName[ 0 ] == '0' ) ? '1' : '0', cacheName.Get() + 1 );
+            job->SetCacheName( mismatchedCacheName );
+        }
+    }
+    job->SetRemoteCacheAccess( cacheAccess );
+
+    // The job data is usually sent directly from the job
+    if ( m_DeduplicateJobData == false )
+    {
+        job->SerializeHeader( payload.GetStream(), m_ProtocolVersion );
+        payload.AddBuffer( job->GetData(), job->GetDataSize() );
+        return;
+    }
+
+    PROFILE_FUNCTION;
+
+    // Segments are identified by the uncompressed data
+    Compressor decompressor;
+    const void * data = job->GetData();
+    size_t dataSize = job->GetDataSize();
+    if ( job->IsDataCompressed() )
+    {
+        if ( decompressor.Decompress( data ) == false )
+        {
+            // Send the job as is (can't happen unless memory is corrupt)
+            ASSERT( false );
+            job->SerializeHeader( payload.GetStream(), m_ProtocolVersion );
+            payload.AddBuffer( job->GetData(), job->GetDataSize() );
+            return;
+        }
+        data = decompressor.GetResult();
+        dataSize = decompressor.GetResultSize();
     }
+
+    // Replace segments already sent to this worker with references to them
+    // (the caller holds the lock until the job is sent, so the worker receives
+    // segments in the order they are encoded)
+    MemoryStream encoded;
+    ss.m_Deduplicator.Encode( data, dataSize, encoded );
+
+    // Compress what remains
+    Compressor compressor;
+    compressor.Compress( encoded.GetData(), encoded.GetSize() );
+
+    job->SerializeHeaderForDeduplicatedData( payload.GetStream(), m_ProtocolVersion, (uint32_t)compressor.GetResultSize() );
+    payload.GetStream().WriteBuffer( compressor.GetResult(), compressor.GetResultSize() );
 }
 
 // Process( MsgJobResult )
 //------------------------------------------------------------------------------
 void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobResult *, const void * payload, size_t payloadSize )
+{
+    ConstMemoryStream ms( payload, payloadSize );
+    ProcessJobResult( connection, ms );
+}
+
+// Process( MsgJobResults )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobResults * msg, const void * payload, size_t payloadSize )
+{
+    DIST_INFO( "Got Results: %s (Results: %u)\n", ( (const ServerState *)connection->GetUserData() )->m_RemoteName.Get(), msg->GetNumResults() );
+
+    // payload contains each result, in the same form as for MsgJobResult
+    ConstMemoryStream ms( payload, payloadSize );
+    for ( uint32_t i = 0; i < msg->GetNumResults(); ++i )
+    {
+        ProcessJobResult( connection, ms );
+    }
+}
+
+// ProcessJobResult
+//------------------------------------------------------------------------------
+void Client::ProcessJobResult( const ConnectionInfo * connection, ConstMemoryStream & ms )
 {
     PROFILE_SECTION( "MsgJobResult" );
 
@@ -480,8 +830,6 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
     ServerState * ss = (ServerState *)connection->GetUserData();
     ASSERT( ss );
 
-    ConstMemoryStream ms( payload, payloadSize );
-
     uint32_t jobId = 0;
     ms.Read( jobId );
 
@@ -503,14 +851,22 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
     uint16_t remoteThreadId = 0;
     ms.Read( remoteThreadId );
 
+    uint8_t cacheResult = Job::REMOTE_CACHE_NONE;
+    if ( m_ProtocolVersion >= Protocol::PROTOCOL_VERSION_WORKER_CACHE )
+    {
+        ms.Read( cacheResult );
+    }
+
     // get result data (built data or errors if failed)
     uint32_t dataSize = 0;
     ms.Read( dataSize );
     const void * data = (const char *)ms.GetData() + ms.Tell();
+    ms.Seek( ms.Tell() + dataSize ); // skip to the next result (if any)
 
     {
         MutexHolder mh( ss->m_Mutex );
         VERIFY( ss->m_Jobs.FindDerefAndErase( jobId ) );
+        OnJobCompleted( *ss, jobId, receivedResultEndTime, buildTime, systemError );
     }
 
     // Has the job been cancelled in the interim?
@@ -586,16 +942,35 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
                 // record new file time
                 objectNode->RecordStampFromBuiltFile();
 
-                // record time taken to build
-                objectNode->SetLastBuildTime( buildTime );
-                objectNode->SetStatFlag(Node::STATS_BUILT);
-                objectNode->SetStatFlag(Node::STATS_BUILT_REMOTE);
-
-                // commit to cache?
-                if ( FBuild::Get().GetOptions().m_UseCacheWrite &&
-                        objectNode->ShouldUseCache() )
+                if ( cacheResult == Job::REMOTE_CACHE_HIT )
+                {
+                    // retrieved from the cache by the worker (not built, so
+                    // the time taken is not recorded)
+                    objectNode->SetStatFlag( Node::STATS_CACHE_HIT );
+                }
+                else
                 {
-                    objectNode->WriteToCache( job );
+                    // record time taken to build
+                    objectNode->SetLastBuildTime( buildTime );
+                    objectNode->SetStatFlag(Node::STATS_BUILT);
+                    objectNode->SetStatFlag(Node::STATS_BUILT_REMOTE);
+
+                    if ( cacheResult == Job::REMOTE_CACHE_STORE )
+                    {
+                        // already committed to cache by the worker
+                        objectNode->SetStatFlag( Node::STATS_CACHE_STORE );
+                        CacheMissMemo * memo = FBuild::Get().GetCacheMissMemo();
+                        if ( memo )
+                        {
+                            memo->RecordPublish( job->GetCacheName() );
+                        }
+                    }
+                    else if ( FBuild::Get().GetOptions().m_UseCacheWrite &&
+                              objectNode->ShouldUseCache() )
+                    {
+                        // commit to cache
+                        objectNode->WriteToCache( job );
+                    }
                 }
             }
             else
@@ -724,7 +1099,7 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     }
 
     MemoryStream ms;
-    manifest->SerializeForRemote( ms );
+    manifest->SerializeForRemote( ms, m_ProtocolVersion );
 
     // Send manifest to worker
     Protocol::MsgManifest resultMsg( toolId );
@@ -767,6 +1142,81 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     resultMsg.Send( connection, ms );
 }
 
+// OnJobCompleted
+//------------------------------------------------------------------------------
+void Client::OnJobCompleted( ServerState & ss, uint32_t jobId, int64_t resultTime, uint32_t buildTimeMS, bool systemError )
+{
+    // NOTE: ss.m_Mutex must be held
+
+    ServerState::JobTiming timing = { 0, 0, 0 };
+    for ( size_t i = 0; i < ss.m_JobTimings.GetSize(); ++i )
+    {
+        if ( ss.m_JobTimings[ i ].m_JobId == jobId )
+        {
+            timing = ss.m_JobTimings[ i ];
+            ss.m_JobTimings.EraseIndex( i );
+            break;
+        }
+    }
+    ASSERT( timing.m_JobId == jobId );
+
+    if ( systemError )
+    {
+        ss.m_NumJobsFailed++;
+        return;
+    }
+    ss.m_NumJobsCompleted++;
+
+    // time from sending the job to getting the result, including transfer and
+    // time spent waiting on the worker
+    const float timeMS = (float)( resultTime - timing.m_SendTime ) * Timer::GetFrequencyInvFloatMS();
+    const float latencyMS = Math::Max( timeMS - (float)buildTimeMS, 0.0f );
+    ss.m_LatencyMS = ( ss.m_LatencyMS > 0.0f ) ? ( ( ss.m_LatencyMS * 0.875f ) + ( latencyMS * 0.125f ) )
+                                                : latencyMS;
+
+    // compare to how long the job took last time it was built (if known)
+    if ( timing.m_ExpectedTimeMS == 0 )
+    {
+        return;
+    }
+    const float ratio = ( timeMS / (float)timing.m_ExpectedTimeMS );
+    ss.m_TimeRatio = ( ss.m_NumJobsTimed > 0 ) ? ( ( ss.m_TimeRatio * 0.875f ) + ( ratio * 0.125f ) )
+                                               : ratio;
+    ss.m_NumJobsTimed++;
+
+    MutexHolder mh( m_WorkerStatsMutex );
+    m_TimeRatio = ( m_TimeRatio > 0.0f ) ? ( ( m_TimeRatio * 0.875f ) + ( ratio * 0.125f ) )
+                                         : ratio;
+}
+
+// IsSlowWorker
+//------------------------------------------------------------------------------
+bool Client::IsSlowWorker( const ServerState & ss ) const
+{
+    // NOTE: ss.m_Mutex must be held
+
+    // workers are given the benefit of the doubt until enough jobs are complete
+    const uint32_t numJobs = ( ss.m_NumJobsCompleted + ss.m_NumJobsFailed );
+    if ( numJobs < WORKER_STATS_MIN_JOBS )
+    {
+        return false;
+    }
+
+    // unreliable workers are treated as slow, so failures cost less
+    if ( (float)ss.m_NumJobsFailed > ( (float)numJobs * UNRELIABLE_WORKER_FAILURE_RATE ) )
+    {
+        return true;
+    }
+
+    // slower than the other workers? (includes overloaded or distant workers)
+    if ( ss.m_NumJobsTimed < WORKER_STATS_MIN_JOBS )
+    {
+        return false;
+    }
+    MutexHolder mh( m_WorkerStatsMutex );
+    return ( ss.m_TimeRatio > ( m_TimeRatio * SLOW_WORKER_TIME_RATIO ) );
+}
+
 // FindManifest
 //------------------------------------------------------------------------------
 const ToolManifest * Client::FindManifest( const ConnectionInfo * connection, uint64_t toolId ) const
@@ -811,7 +1261,17 @@ Client::ServerState::ServerState()
     , m_CurrentMessage( nullptr )
     , m_NumJobsAvailable( 0 )
     , m_Jobs( 16, true )
+    , m_DictionariesSent( 0, true )
     , m_Denylisted( false )
+    , m_Connecting( false )
+    , m_NumFailedConnections( 0 )
+    , m_JobTimings( 16, true )
+    , m_NumJobsCompleted( 0 )
+    , m_NumJobsFailed( 0 )
+    , m_NumJobsTimed( 0 )
+    , m_TimeRatio( 0.0f )
+    , m_LatencyMS( 0.0f )
+    , m_MaxJobsInFlight( 0 )
 {
     m_DelayTimer.Start( 999.0f );
 }
@@ -4,14 +4,18 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/Helpers/SegmentDeduplicator.h"
+
 #include "Core/Containers/Array.h"
 #include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Semaphore.h"
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AString.h"
 #include "Core/Time/Timer.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class ConstMemoryStream;
 class Job;
 class MemoryStream;
 class MultiBuffer;
@@ -19,10 +23,13 @@ namespace Protocol
 {
     class IMessage;
     class MsgJobResult;
+    class MsgJobResults;
     class MsgRequestJob;
+    class MsgRequestJobs;
     class MsgRequestManifest;
     class MsgRequestFile;
     class MsgServerStatus;
+    class PayloadBuffers;
 }
 class ToolManifest;
 
@@ -32,20 +39,35 @@ class Client : public TCPConnectionPool
 {
 public:
     Client( const Array< AString > & workerList,
+            bool workerListRanked,
             uint16_t port,
             uint32_t workerConnectionLimit,
-            bool detailedLogging );
+            uint32_t workerConnectionFanOut,
+            bool detailedLogging,
+            bool deduplicateJobData,
+            bool workerCache,
+            uint8_t priority,
+            uint32_t protocolVersion );
     virtual ~Client() override;
 
 private:
+    friend class TestDistributed;
+
     virtual void OnDisconnected( const ConnectionInfo * connection ) override;
     virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
 
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestJob * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestJobs * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgJobResult *, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJobResults * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestManifest * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFile * msg );
 
+    struct ServerState;
+    Job * GetJobForServer( const ConnectionInfo * connection, uint64_t & outToolId );
+    void WriteJob( ServerState & ss, Job * job, Protocol::PayloadBuffers & payload );
+    void ProcessJobResult( const ConnectionInfo * connection, ConstMemoryStream & ms );
+
     const ToolManifest * FindManifest( const ConnectionInfo * connection, uint64_t toolId ) const;
     bool WriteFileToDisk( const AString& fileName, const MultiBuffer & multiBuffer, size_t index ) const;
 
@@ -53,15 +75,27 @@ private:
     void            ThreadFunc();
 
     void            LookForWorkers();
+    static uint32_t ConnectionThreadFuncStatic( void * param );
+    void            ConnectionThreadFunc();
+    void            ConnectToWorker( size_t workerIndex );
     void            CommunicateJobAvailability();
 
+    void            OnJobCompleted( ServerState & ss, uint32_t jobId, int64_t resultTime, uint32_t buildTimeMS, bool systemError );
+    bool            IsSlowWorker( const ServerState & ss ) const;
+
     // More verbose name to avoid conflict with windows.h SendMessage
     void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg );
     void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const MemoryStream & memoryStream );
+    void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const Protocol::PayloadBuffers & payload );
 
     Array< AString >    m_WorkerList;   // workers to connect to
+    bool                m_WorkerListRanked; // workers are ordered best first (from coordinator)
     volatile bool       m_ShouldExit;   // signal from main thread
     bool                m_DetailedLogging;
+    bool                m_DeduplicateJobData; // send job data as segments, referencing those already sent
+    bool                m_WorkerCache;  // allow workers to use the cache on our behalf
+    uint8_t             m_Priority;     // Protocol::ClientPriority, for workers shared with other clients
+    uint32_t            m_ProtocolVersion; // version spoken to workers (older versions are emulated for tests)
     Thread::ThreadHandle m_Thread;      // the thread to find and manage workers
 
     // state
@@ -79,13 +113,43 @@ private:
         Timer                   m_DelayTimer;
         uint32_t                m_NumJobsAvailable;     // num jobs we've told this server we have available
         Array< Job * >          m_Jobs;                 // jobs we've sent to this server
+        Array< uint32_t >       m_DictionariesSent;     // compression dictionaries we've sent to this server
+        SegmentDeduplicator     m_Deduplicator;         // segments of job data we've sent to this server
 
         bool                    m_Denylisted;
+        volatile bool           m_Connecting;           // connection attempt in progress (see ConnectToWorker)
+        uint32_t                m_NumFailedConnections; // consecutive failed connection attempts
+
+        // Statistics (kept across connections), used to favor faster and more reliable workers
+        struct JobTiming
+        {
+            uint32_t            m_JobId;
+            uint32_t            m_ExpectedTimeMS;       // last known build time of the job (0 if unknown)
+            int64_t             m_SendTime;
+        };
+        Array< JobTiming >      m_JobTimings;           // for each job in m_Jobs
+        uint32_t                m_NumJobsCompleted;
+        uint32_t                m_NumJobsFailed;        // system errors and jobs lost on disconnection
+        uint32_t                m_NumJobsTimed;         // jobs contributing to m_TimeRatio
+        float                   m_TimeRatio;            // average of (time to get result / expected time)
+        float                   m_LatencyMS;            // average of (time to get result - remote build time)
+        uint32_t                m_MaxJobsInFlight;      // reflects the number of CPUs the worker uses
     };
     Mutex                   m_ServerListMutex;
     Array< ServerState >    m_ServerList;
     uint32_t                m_WorkerConnectionLimit;
     uint16_t                m_Port;
+
+    // Average of ServerState::m_TimeRatio across all workers
+    mutable Mutex           m_WorkerStatsMutex;
+    float                   m_TimeRatio;
+
+    // Connection attempts are made concurrently by the connection threads, so
+    // unresponsive workers don't delay connecting to the others
+    Mutex                   m_PendingConnectionsMutex;
+    Array< uint32_t >       m_PendingConnections;   // indices of workers to connect to
+    Semaphore               m_PendingConnectionsSemaphore;
+    Array< Thread::ThreadHandle > m_ConnectionThreads;
 };
 
 //------------------------------------------------------------------------------
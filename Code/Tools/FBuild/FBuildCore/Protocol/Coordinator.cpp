@@ -0,0 +1,235 @@
+// Coordinator - Tracks worker capacity and load for clients to query
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Coordinator.h"
+#include "Protocol.h"
+
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define COORDINATOR_WORKER_TIMEOUT_SECS ( 60.0f ) // Workers report at least every 10s
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+Coordinator::Coordinator()
+    : m_Workers( 256, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+Coordinator::~Coordinator()
+{
+    ShutdownAllConnections();
+
+    ASSERT( m_Workers.IsEmpty() ); // Removed as workers disconnected
+}
+
+// GetWorkers
+//------------------------------------------------------------------------------
+void Coordinator::GetWorkers( uint32_t protocolVersion,
+                              uint8_t platform,
+                              const AString & clientHostName,
+                              Array< AString > & outWorkers ) const
+{
+    PROFILE_FUNCTION;
+
+    struct Candidate
+    {
+        const WorkerState * m_Worker;
+        uint32_t            m_FreeCPUs;
+    };
+
+    MutexHolder mh( m_WorkersMutex );
+
+    Array< Candidate > candidates( m_Workers.GetSize(), false );
+    for ( const WorkerState * ws : m_Workers )
+    {
+        // ignore disabled workers and workers which stopped reporting
+        if ( ( ws->m_NumCPUs == 0 ) ||
+             ( ws->m_LastUpdate.GetElapsed() > COORDINATOR_WORKER_TIMEOUT_SECS ) )
+        {
+            continue;
+        }
+
+        // ignore workers which would refuse the client
+        if ( ( ws->m_Platform != platform ) ||
+             ( protocolVersion < ws->m_ProtocolVersionMinimum ) ||
+             ( protocolVersion > ws->m_ProtocolVersion ) )
+        {
+            continue;
+        }
+
+        // don't distribute to ourself
+        if ( ws->m_HostName.CompareI( clientHostName ) == 0 )
+        {
+            continue;
+        }
+
+        const uint32_t freeCPUs = ( ws->m_NumCPUs > ws->m_NumJobsInProgress ) ? ( ws->m_NumCPUs - ws->m_NumJobsInProgress ) : 0;
+        candidates.Append( Candidate{ ws, freeCPUs } );
+    }
+
+    // most free CPUs first, then least loaded (relative to capacity)
+    candidates.Sort( []( const Candidate & a, const Candidate & b )
+    {
+        if ( a.m_FreeCPUs != b.m_FreeCPUs )
+        {
+            return ( a.m_FreeCPUs > b.m_FreeCPUs );
+        }
+        return ( ( (uint64_t)a.m_Worker->m_NumJobsInProgress * b.m_Worker->m_NumCPUs ) <
+                 ( (uint64_t)b.m_Worker->m_NumJobsInProgress * a.m_Worker->m_NumCPUs ) );
+    } );
+
+    outWorkers.SetCapacity( outWorkers.GetSize() + candidates.GetSize() );
+    for ( const Candidate & candidate : candidates )
+    {
+        outWorkers.Append( candidate.m_Worker->m_Address );
+    }
+}
+
+// GetNumWorkers
+//------------------------------------------------------------------------------
+size_t Coordinator::GetNumWorkers() const
+{
+    MutexHolder mh( m_WorkersMutex );
+    return m_Workers.GetSize();
+}
+
+// OnDisconnected
+//------------------------------------------------------------------------------
+/*virtual*/ void Coordinator::OnDisconnected( const ConnectionInfo * connection )
+{
+    WorkerState * ws = static_cast< WorkerState * >( connection->GetUserData() );
+    if ( ws == nullptr )
+    {
+        return; // a client
+    }
+
+    MutexHolder mh( m_WorkersMutex );
+    WorkerState ** iter = m_Workers.Find( ws );
+    ASSERT( iter );
+    m_Workers.Erase( iter );
+    FDELETE ws;
+}
+
+// OnReceive
+//------------------------------------------------------------------------------
+/*virtual*/ void Coordinator::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & /*keepMemory*/ )
+{
+    // messages sent to the coordinator have no payload
+    const Protocol::IMessage * imsg = static_cast< const Protocol::IMessage * >( data );
+    if ( ( size < sizeof( Protocol::IMessage ) ) || ( size != imsg->GetSize() ) || imsg->HasPayload() )
+    {
+        Disconnect( connection );
+        return;
+    }
+
+    const Protocol::MessageType messageType = imsg->GetType();
+
+    PROTOCOL_DEBUG( "Remote -> Coordinator : %u (%s)\n", messageType, GetProtocolMessageDebugName( messageType ) );
+
+    switch ( messageType )
+    {
+        case Protocol::MSG_WORKER_STATUS:
+        {
+            if ( size == sizeof( Protocol::MsgWorkerStatus ) )
+            {
+                Process( connection, static_cast< const Protocol::MsgWorkerStatus * >( imsg ) );
+                return;
+            }
+            break;
+        }
+        case Protocol::MSG_REQUEST_WORKERS:
+        {
+            if ( size == sizeof( Protocol::MsgRequestWorkers ) )
+            {
+                Process( connection, static_cast< const Protocol::MsgRequestWorkers * >( imsg ) );
+                return;
+            }
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    // unknown or malformed message (possibly from an incompatible version)
+    AStackString<> remoteAddr;
+    TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
+    FLOG_WARN( "Disconnecting '%s' due to unexpected message\n", remoteAddr.Get() );
+    Disconnect( connection );
+}
+
+// Process( MsgWorkerStatus )
+//------------------------------------------------------------------------------
+void Coordinator::Process( const ConnectionInfo * connection, const Protocol::MsgWorkerStatus * msg )
+{
+    MutexHolder mh( m_WorkersMutex );
+
+    // first report from this worker?
+    WorkerState * ws = static_cast< WorkerState * >( connection->GetUserData() );
+    if ( ws == nullptr )
+    {
+        ws = FNEW( WorkerState );
+        ws->m_Connection = connection;
+        connection->SetUserData( ws );
+        m_Workers.Append( ws );
+    }
+
+    GetFixedString( msg->GetHostName(), 63, ws->m_HostName );
+    GetFixedString( msg->GetAddress(), 63, ws->m_Address );
+    if ( ws->m_Address.IsEmpty() )
+    {
+        TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), ws->m_Address );
+    }
+    ws->m_ProtocolVersion = msg->GetProtocolVersion();
+    ws->m_ProtocolVersionMinimum = msg->GetProtocolVersionMinimum();
+    ws->m_NumCPUs = msg->GetNumCPUs();
+    ws->m_NumJobsInProgress = msg->GetNumJobsInProgress();
+    ws->m_Platform = msg->GetPlatform();
+    ws->m_LastUpdate.Start();
+}
+
+// Process( MsgRequestWorkers )
+//------------------------------------------------------------------------------
+void Coordinator::Process( const ConnectionInfo * connection, const Protocol::MsgRequestWorkers * msg )
+{
+    PROFILE_FUNCTION;
+
+    AStackString<> hostName;
+    GetFixedString( msg->GetHostName(), 63, hostName );
+
+    Array< AString > workers;
+    GetWorkers( msg->GetProtocolVersion(), msg->GetPlatform(), hostName, workers );
+
+    MemoryStream ms;
+    ms.Write( workers );
+
+    Protocol::MsgWorkerList reply( (uint32_t)workers.GetSize() );
+    reply.Send( connection, ms );
+}
+
+// GetFixedString
+//------------------------------------------------------------------------------
+/*static*/ void Coordinator::GetFixedString( const char * data, size_t maxLength, AString & outString )
+{
+    // strings in messages are not trusted to be terminated
+    const char * end = data;
+    while ( ( end < ( data + maxLength ) ) && ( *end != '\000' ) )
+    {
+        ++end;
+    }
+    outString.Assign( data, end );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,69 @@
+// Coordinator - Tracks worker capacity and load for clients to query
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+namespace Protocol
+{
+    class MsgRequestWorkers;
+    class MsgWorkerStatus;
+}
+
+// Coordinator
+//  - An alternative to the file based brokerage (see WorkerBrokerage). Workers
+//    stay connected, reporting their capacity and load as they change, and
+//    clients ask for workers once at the start of a build.
+//------------------------------------------------------------------------------
+class Coordinator : public TCPConnectionPool
+{
+public:
+    explicit Coordinator();
+    virtual ~Coordinator() override;
+
+    // Compatible workers (excluding the client itself), those with the most
+    // free CPUs first, followed by busy workers (least loaded first)
+    void GetWorkers( uint32_t protocolVersion,
+                     uint8_t platform,
+                     const AString & clientHostName,
+                     Array< AString > & outWorkers ) const;
+
+    size_t GetNumWorkers() const;
+
+private:
+    // TCPConnection interface
+    virtual void OnDisconnected( const ConnectionInfo * connection ) override;
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
+
+    // helpers to handle messages
+    void Process( const ConnectionInfo * connection, const Protocol::MsgWorkerStatus * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestWorkers * msg );
+
+    static void GetFixedString( const char * data, size_t maxLength, AString & outString );
+
+    struct WorkerState
+    {
+        const ConnectionInfo *  m_Connection;
+        AString                 m_HostName;
+        AString                 m_Address;
+        uint32_t                m_ProtocolVersion;
+        uint32_t                m_ProtocolVersionMinimum;
+        uint32_t                m_NumCPUs;
+        uint32_t                m_NumJobsInProgress;
+        uint8_t                 m_Platform;
+        Timer                   m_LastUpdate;
+    };
+
+    mutable Mutex           m_WorkersMutex;
+    Array< WorkerState * >  m_Workers;
+};
+
+//------------------------------------------------------------------------------
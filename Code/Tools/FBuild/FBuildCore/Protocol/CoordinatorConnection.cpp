@@ -0,0 +1,230 @@
+// CoordinatorConnection - Communication with the Coordinator
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CoordinatorConnection.h"
+#include "Protocol.h"
+
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define COORDINATOR_CONNECTION_TIMEOUT_MS ( 2000 )
+#define COORDINATOR_REPLY_TIMEOUT_MS ( 5000 )
+#define COORDINATOR_REATTEMPT_DELAY_SECS ( 10.0f )
+#define COORDINATOR_STATUS_INTERVAL_SECS ( 10.0f ) // Send status at least this often, even if unchanged
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CoordinatorConnection::CoordinatorConnection( const AString & host, uint16_t port )
+    : m_Host( host )
+    , m_Port( port )
+    , m_Connection( nullptr )
+    , m_ConnectionAttempted( false )
+    , m_CurrentMessage( nullptr )
+    , m_WorkersReceived( false )
+    , m_LastNumCPUs( 0 )
+    , m_LastNumJobsInProgress( 0 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CoordinatorConnection::~CoordinatorConnection()
+{
+    ShutdownAllConnections();
+}
+
+// RequestWorkers
+//------------------------------------------------------------------------------
+bool CoordinatorConnection::RequestWorkers( const AString & hostName, Array< AString > & outWorkers )
+{
+    PROFILE_FUNCTION;
+
+    {
+        MutexHolder mh( m_Mutex );
+        const ConnectionInfo * connection = EnsureConnected();
+        if ( connection == nullptr )
+        {
+            return false;
+        }
+
+        m_WorkersReceived = false;
+        m_Workers.Clear();
+
+        const Protocol::MsgRequestWorkers msg( hostName );
+        if ( msg.Send( connection ) == false )
+        {
+            Disconnect( connection );
+            return false;
+        }
+    }
+
+    // wait for the reply (or disconnection)
+    const Timer t;
+    for ( ;; )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            if ( m_WorkersReceived || ( m_Connection == nullptr ) )
+            {
+                break;
+            }
+        }
+        const float elapsedMS = t.GetElapsedMS();
+        if ( elapsedMS >= (float)COORDINATOR_REPLY_TIMEOUT_MS )
+        {
+            break;
+        }
+        m_ReplySemaphore.Wait( COORDINATOR_REPLY_TIMEOUT_MS - (uint32_t)elapsedMS );
+    }
+
+    MutexHolder mh( m_Mutex );
+    if ( m_Connection )
+    {
+        Disconnect( m_Connection ); // Only one request per build
+    }
+    if ( m_WorkersReceived == false )
+    {
+        FLOG_WARN( "No reply from coordinator '%s'", m_Host.Get() );
+        return false;
+    }
+    outWorkers.Append( m_Workers );
+    return true;
+}
+
+// UpdateStatus
+//------------------------------------------------------------------------------
+void CoordinatorConnection::UpdateStatus( const AString & hostName, const AString & address, uint32_t numCPUs, uint32_t numJobsInProgress )
+{
+    MutexHolder mh( m_Mutex );
+
+    // Connection lost?
+    const bool reconnecting = ( m_Connection == nullptr );
+
+    // Only send status if it has changed (or periodically, so the coordinator
+    // knows we're still alive)
+    if ( ( reconnecting == false ) &&
+         ( numCPUs == m_LastNumCPUs ) &&
+         ( numJobsInProgress == m_LastNumJobsInProgress ) &&
+         ( m_StatusTimer.GetElapsed() < COORDINATOR_STATUS_INTERVAL_SECS ) )
+    {
+        return;
+    }
+
+    const ConnectionInfo * connection = EnsureConnected();
+    if ( connection == nullptr )
+    {
+        return;
+    }
+
+    const Protocol::MsgWorkerStatus msg( hostName, address, numCPUs, numJobsInProgress );
+    if ( msg.Send( connection ) == false )
+    {
+        Disconnect( connection );
+        return;
+    }
+
+    m_LastNumCPUs = numCPUs;
+    m_LastNumJobsInProgress = numJobsInProgress;
+    m_StatusTimer.Start();
+}
+
+// EnsureConnected
+//------------------------------------------------------------------------------
+const ConnectionInfo * CoordinatorConnection::EnsureConnected()
+{
+    if ( m_Connection )
+    {
+        return m_Connection;
+    }
+
+    // Don't retry too often if the coordinator is unavailable
+    if ( m_ConnectionAttempted && ( m_ConnectionAttemptTimer.GetElapsed() < COORDINATOR_REATTEMPT_DELAY_SECS ) )
+    {
+        return nullptr;
+    }
+    m_ConnectionAttempted = true;
+    m_ConnectionAttemptTimer.Start();
+
+    m_Connection = Connect( m_Host, m_Port, COORDINATOR_CONNECTION_TIMEOUT_MS );
+    if ( m_Connection == nullptr )
+    {
+        FLOG_WARN( "Failed to connect to coordinator '%s:%u'", m_Host.Get(), (uint32_t)m_Port );
+    }
+    return m_Connection;
+}
+
+// OnDisconnected
+//------------------------------------------------------------------------------
+/*virtual*/ void CoordinatorConnection::OnDisconnected( const ConnectionInfo * connection )
+{
+    {
+        MutexHolder mh( m_Mutex );
+        if ( m_Connection == connection )
+        {
+            m_Connection = nullptr;
+        }
+
+        // This is usually null here, but might need to be freed if
+        // we had the connection drop between message and payload
+        FREE( (void *)( m_CurrentMessage ) );
+        m_CurrentMessage = nullptr;
+    }
+
+    // wake any request waiting for a reply
+    m_ReplySemaphore.Signal();
+}
+
+// OnReceive
+//------------------------------------------------------------------------------
+/*virtual*/ void CoordinatorConnection::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory )
+{
+    // are we expecting a msg, or the payload for a msg?
+    if ( m_CurrentMessage == nullptr )
+    {
+        const Protocol::IMessage * imsg = static_cast< const Protocol::IMessage * >( data );
+        if ( ( size >= sizeof( Protocol::MsgWorkerList ) ) &&
+             ( imsg->GetType() == Protocol::MSG_WORKER_LIST ) &&
+             imsg->HasPayload() )
+        {
+            keepMemory = true; // freed once the payload is received
+            m_CurrentMessage = imsg;
+            return;
+        }
+
+        // unexpected message
+        Disconnect( connection );
+        return;
+    }
+
+    PROTOCOL_DEBUG( "Coordinator -> Remote : %u (%s)\n", m_CurrentMessage->GetType(), GetProtocolMessageDebugName( m_CurrentMessage->GetType() ) );
+
+    // payload
+    Array< AString > workers;
+    ConstMemoryStream ms( data, size );
+    const bool ok = ms.Read( workers );
+
+    FREE( (void *)( m_CurrentMessage ) );
+    m_CurrentMessage = nullptr;
+
+    if ( ok == false )
+    {
+        Disconnect( connection );
+        return;
+    }
+
+    {
+        MutexHolder mh( m_Mutex );
+        m_Workers.Swap( workers );
+        m_WorkersReceived = true;
+    }
+    m_ReplySemaphore.Signal();
+}
+
+//------------------------------------------------------------------------------
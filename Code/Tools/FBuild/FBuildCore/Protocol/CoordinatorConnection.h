@@ -0,0 +1,62 @@
+// CoordinatorConnection - Communication with the Coordinator
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+namespace Protocol
+{
+    class IMessage;
+}
+
+// CoordinatorConnection
+//------------------------------------------------------------------------------
+class CoordinatorConnection : public TCPConnectionPool
+{
+public:
+    CoordinatorConnection( const AString & host, uint16_t port );
+    virtual ~CoordinatorConnection() override;
+
+    // client interface
+    bool RequestWorkers( const AString & hostName, Array< AString > & outWorkers );
+
+    // worker interface (the connection is kept open, reconnecting if lost)
+    void UpdateStatus( const AString & hostName, const AString & address, uint32_t numCPUs, uint32_t numJobsInProgress );
+
+private:
+    // TCPConnection interface
+    virtual void OnDisconnected( const ConnectionInfo * connection ) override;
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
+
+    const ConnectionInfo * EnsureConnected();
+
+    AString                 m_Host;
+    uint16_t                m_Port;
+
+    Mutex                   m_Mutex;
+    const ConnectionInfo *  m_Connection;
+    Timer                   m_ConnectionAttemptTimer;   // Throttle reconnection attempts
+    bool                    m_ConnectionAttempted;
+
+    // client state
+    const Protocol::IMessage * m_CurrentMessage;        // Waiting for payload
+    Semaphore               m_ReplySemaphore;
+    bool                    m_WorkersReceived;
+    Array< AString >        m_Workers;
+
+    // worker state
+    Timer                   m_StatusTimer;              // Time since status last sent
+    uint32_t                m_LastNumCPUs;
+    uint32_t                m_LastNumJobsInProgress;
+};
+
+//------------------------------------------------------------------------------
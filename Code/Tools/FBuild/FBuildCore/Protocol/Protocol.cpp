@@ -8,6 +8,7 @@
 #include "Core/Env/Env.h"
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Network/TCPConnectionPool.h"
 
 // system
@@ -35,6 +36,13 @@
             "Manifest",
             "RequestFile",
             "File",
+            "CompressionDictionary",
+            "RequestJobs",
+            "Jobs",
+            "JobResults",
+            "WorkerStatus",
+            "RequestWorkers",
+            "WorkerList",
         };
         static_assert( ( sizeof( msgNames ) / sizeof(const char *) ) == Protocol::NUM_MESSAGES, "msgNames item count doesn't match NUM_MESSAGES" );
 
@@ -86,6 +94,38 @@ bool Protocol::IMessage::Send( const ConnectionInfo * connection, const ConstMem
     return pool.Send( connection, this, m_MsgSize, payload.GetData(), payload.GetSize() );
 }
 
+// IMessage::Send (with payload)
+//------------------------------------------------------------------------------
+bool Protocol::IMessage::Send( const ConnectionInfo * connection, const PayloadBuffers & payload ) const
+{
+    ASSERT( connection );
+    ASSERT( m_HasPayload == true ); // must NOT use Send with payload
+
+    // interleave the stream contents with the added buffers
+    Array< TCPConnectionPool::SendBuffer > buffers( ( payload.m_Buffers.GetSize() * 2 ) + 1, false );
+    const char * const streamData = static_cast< const char * >( payload.m_Stream.GetData() );
+    size_t streamPos = 0;
+    for ( const PayloadBuffers::Buffer & buffer : payload.m_Buffers )
+    {
+        if ( buffer.m_StreamPos > streamPos )
+        {
+            buffers.Append( TCPConnectionPool::SendBuffer{ (uint32_t)( buffer.m_StreamPos - streamPos ), streamData + streamPos } );
+            streamPos = buffer.m_StreamPos;
+        }
+        if ( buffer.m_Size > 0 )
+        {
+            buffers.Append( TCPConnectionPool::SendBuffer{ (uint32_t)buffer.m_Size, buffer.m_Data } );
+        }
+    }
+    if ( payload.m_Stream.GetSize() > streamPos )
+    {
+        buffers.Append( TCPConnectionPool::SendBuffer{ (uint32_t)( payload.m_Stream.GetSize() - streamPos ), streamData + streamPos } );
+    }
+
+    TCPConnectionPool & pool = connection->GetTCPConnectionPool();
+    return pool.Send( connection, this, m_MsgSize, buffers.Begin(), (uint32_t)buffers.GetSize() );
+}
+
 // IMessage::Broadcast
 //------------------------------------------------------------------------------
 bool Protocol::IMessage::Broadcast( TCPConnectionPool * pool ) const
@@ -97,13 +137,41 @@ bool Protocol::IMessage::Broadcast( TCPConnectionPool * pool ) const
     return pool->Broadcast( this, m_MsgSize );
 }
 
+// PayloadBuffers::AddBuffer
+//------------------------------------------------------------------------------
+void Protocol::PayloadBuffers::AddBuffer( const void * data, size_t size )
+{
+    m_Buffers.Append( Buffer{ m_Stream.GetSize(), data, size } );
+}
+
+// PayloadBuffers::GetSize
+//------------------------------------------------------------------------------
+size_t Protocol::PayloadBuffers::GetSize() const
+{
+    size_t size = m_Stream.GetSize();
+    for ( const Buffer & buffer : m_Buffers )
+    {
+        size += buffer.m_Size;
+    }
+    return size;
+}
+
+// PayloadBuffers::Reset
+//------------------------------------------------------------------------------
+void Protocol::PayloadBuffers::Reset()
+{
+    m_Stream.Reset();
+    m_Buffers.Clear();
+}
+
 // MsgConnection
 //------------------------------------------------------------------------------
-Protocol::MsgConnection::MsgConnection( uint32_t numJobsAvailable )
+Protocol::MsgConnection::MsgConnection( uint32_t numJobsAvailable, uint8_t priority, uint32_t protocolVersion )
     : Protocol::IMessage( Protocol::MSG_CONNECTION, sizeof( MsgConnection ), false )
-    , m_ProtocolVersion( PROTOCOL_VERSION )
+    , m_ProtocolVersion( protocolVersion )
     , m_NumJobsAvailable( numJobsAvailable )
     , m_Platform(Env::GetPlatform())
+    , m_Priority( priority )
 {
     memset( m_Padding2, 0, sizeof( m_Padding2 ) );
     memset( m_HostName, 0, sizeof( m_HostName ) );
@@ -188,4 +256,76 @@ Protocol::MsgFile::MsgFile( uint64_t toolId, uint32_t fileId )
 {
 }
 
+// MsgCompressionDictionary
+//------------------------------------------------------------------------------
+Protocol::MsgCompressionDictionary::MsgCompressionDictionary()
+    : Protocol::IMessage( Protocol::MSG_COMPRESSION_DICTIONARY, sizeof( MsgCompressionDictionary ), true )
+{
+}
+
+// MsgRequestJobs
+//------------------------------------------------------------------------------
+Protocol::MsgRequestJobs::MsgRequestJobs( uint32_t numJobs )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_JOBS, sizeof( MsgRequestJobs ), false )
+    , m_NumJobs( numJobs )
+{
+    ASSERT( numJobs );
+}
+
+// MsgJobs
+//------------------------------------------------------------------------------
+Protocol::MsgJobs::MsgJobs( uint32_t numJobsRequested, uint32_t numJobs )
+    : Protocol::IMessage( Protocol::MSG_JOBS, sizeof( MsgJobs ), ( numJobs > 0 ) ) // no payload if no jobs are available
+    , m_NumJobsRequested( numJobsRequested )
+    , m_NumJobs( numJobs )
+{
+    ASSERT( numJobs <= numJobsRequested );
+}
+
+// MsgJobResults
+//------------------------------------------------------------------------------
+Protocol::MsgJobResults::MsgJobResults( uint32_t numResults )
+    : Protocol::IMessage( Protocol::MSG_JOB_RESULTS, sizeof( MsgJobResults ), true )
+    , m_NumResults( numResults )
+{
+    ASSERT( numResults );
+}
+
+// MsgWorkerStatus
+//------------------------------------------------------------------------------
+Protocol::MsgWorkerStatus::MsgWorkerStatus( const AString & hostName, const AString & address, uint32_t numCPUs, uint32_t numJobsInProgress )
+    : Protocol::IMessage( Protocol::MSG_WORKER_STATUS, sizeof( MsgWorkerStatus ), false )
+    , m_ProtocolVersion( PROTOCOL_VERSION )
+    , m_ProtocolVersionMinimum( PROTOCOL_VERSION_MINIMUM )
+    , m_NumCPUs( numCPUs )
+    , m_NumJobsInProgress( numJobsInProgress )
+    , m_Platform( Env::GetPlatform() )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+    memset( m_HostName, 0, sizeof( m_HostName ) );
+    memset( m_Address, 0, sizeof( m_Address ) );
+    AString::Copy( hostName.Get(), m_HostName, Math::Min<size_t>( hostName.GetLength(), sizeof( m_HostName ) - 1 ) );
+    AString::Copy( address.Get(), m_Address, Math::Min<size_t>( address.GetLength(), sizeof( m_Address ) - 1 ) );
+}
+
+// MsgRequestWorkers
+//------------------------------------------------------------------------------
+Protocol::MsgRequestWorkers::MsgRequestWorkers( const AString & hostName )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_WORKERS, sizeof( MsgRequestWorkers ), false )
+    , m_ProtocolVersion( PROTOCOL_VERSION )
+    , m_Platform( Env::GetPlatform() )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+    memset( m_HostName, 0, sizeof( m_HostName ) );
+    AString::Copy( hostName.Get(), m_HostName, Math::Min<size_t>( hostName.GetLength(), sizeof( m_HostName ) - 1 ) );
+}
+
+// MsgWorkerList
+//------------------------------------------------------------------------------
+Protocol::MsgWorkerList::MsgWorkerList( uint32_t numWorkers )
+    : Protocol::IMessage( Protocol::MSG_WORKER_LIST, sizeof( MsgWorkerList ), true )
+    , m_NumWorkers( numWorkers )
+{
+}
+
 //------------------------------------------------------------------------------
@@ -4,14 +4,16 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
 #include "Core/Env/MSVCStaticAnalysis.h"
 #include "Core/Env/Types.h"
+#include "Core/FileIO/MemoryStream.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class AString;
 class ConnectionInfo;
 class ConstMemoryStream;
-class MemoryStream;
 class TCPConnectionPool;
 
 // Defines
@@ -29,9 +31,25 @@ class TCPConnectionPool;
 namespace Protocol
 {
     enum : uint16_t { PROTOCOL_PORT = 31264 }; // Arbitrarily chosen port
-    enum { PROTOCOL_VERSION = 22 };
+    enum { PROTOCOL_VERSION = 27 };
+    enum { PROTOCOL_VERSION_MINIMUM = 23 };             // Oldest client version accepted by the server
+    enum { PROTOCOL_VERSION_BATCHED_JOBS = 24 };        // Clients supporting MSG_REQUEST_JOBS/MSG_JOBS/MSG_JOB_RESULTS
+    enum { PROTOCOL_VERSION_DEDUPLICATED_JOBS = 25 };   // Clients able to send job data deduplicated (-distdedup)
+    enum { PROTOCOL_VERSION_WORKER_CACHE = 26 };        // Clients sending cache keys with jobs (and receiving cache use with results)
+    enum { PROTOCOL_VERSION_CONTENT_HASHES = 27 };      // Clients sending a 64 bit hash of each toolchain file (shared between toolchains by workers)
 
     enum { PROTOCOL_TEST_PORT = PROTOCOL_PORT + 1 }; // Different port for use by tests
+    enum : uint16_t { COORDINATOR_PORT = PROTOCOL_PORT + 2 };
+    enum { COORDINATOR_TEST_PORT = PROTOCOL_PORT + 3 }; // Different port for use by tests
+
+    // Share of a worker's CPUs a client receives when competing with other clients
+    // (see Server::FindNeedyClients)
+    enum ClientPriority : uint8_t
+    {
+        PRIORITY_NORMAL = 0,    // NOTE: Older clients send 0 (padding)
+        PRIORITY_LOW    = 1,
+        PRIORITY_HIGH   = 2,
+    };
 
     // Identifiers for all unique messages
     //------------------------------------------------------------------------------
@@ -52,6 +70,16 @@ namespace Protocol
         MSG_REQUEST_FILE        = 9, // Server -> Client : Ask client for a file
         MSG_FILE                = 10,// Server <- Client : Send a requested file
 
+        MSG_COMPRESSION_DICTIONARY = 11,// Server <- Client : Dictionary needed to decompress subsequent jobs
+
+        MSG_REQUEST_JOBS        = 12,// Server -> Client : Ask for several jobs to do
+        MSG_JOBS                = 13,// Server <- Client : Respond with as many of the requested jobs as are available (possibly none)
+        MSG_JOB_RESULTS         = 14,// Server -> Client : Return several completed jobs
+
+        MSG_WORKER_STATUS       = 15,// Coordinator <- Server : Capacity and current load
+        MSG_REQUEST_WORKERS     = 16,// Coordinator <- Client : Ask for workers to use
+        MSG_WORKER_LIST         = 17,// Coordinator -> Client : Respond with ranked list of workers
+
         NUM_MESSAGES            // leave last
     };
 };
@@ -62,6 +90,33 @@ namespace Protocol
 
 namespace Protocol
 {
+    // PayloadBuffers
+    //  - A payload built from data written to a stream, interleaved with large
+    //    buffers (like job data) which are sent directly instead of being copied
+    //    into the stream. Added buffers must remain valid until sent.
+    //------------------------------------------------------------------------------
+    class PayloadBuffers
+    {
+    public:
+        inline MemoryStream & GetStream() { return m_Stream; }
+        void AddBuffer( const void * data, size_t size );
+
+        size_t GetSize() const;
+        void Reset();
+
+    private:
+        friend class IMessage;
+
+        struct Buffer
+        {
+            size_t          m_StreamPos;    // Position in the stream the buffer is sent at
+            const void *    m_Data;
+            size_t          m_Size;
+        };
+        MemoryStream        m_Stream;
+        Array< Buffer >     m_Buffers;
+    };
+
     // base class for all messages
     //------------------------------------------------------------------------------
     class IMessage
@@ -70,6 +125,7 @@ namespace Protocol
         bool Send( const ConnectionInfo * connection ) const;
         bool Send( const ConnectionInfo * connection, const MemoryStream & payload ) const;
         bool Send( const ConnectionInfo * connection, const ConstMemoryStream & payload ) const;
+        bool Send( const ConnectionInfo * connection, const PayloadBuffers & payload ) const;
         bool Broadcast( TCPConnectionPool * pool ) const;
 
         inline MessageType  GetType() const { return m_MsgType; }
@@ -92,17 +148,19 @@ namespace Protocol
     class MsgConnection : public IMessage
     {
     public:
-        explicit MsgConnection( uint32_t numJobsAvailable );
+        MsgConnection( uint32_t numJobsAvailable, uint8_t priority, uint32_t protocolVersion = PROTOCOL_VERSION );
 
         inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
         inline uint32_t GetNumJobsAvailable() const { return m_NumJobsAvailable; }
         inline uint8_t  GetPlatform() const { return m_Platform; }
+        inline uint8_t  GetPriority() const { return m_Priority; }
         const char * GetHostName() const { return m_HostName; }
     private:
         uint32_t        m_ProtocolVersion;
         uint32_t        m_NumJobsAvailable;
         uint8_t         m_Platform;
-        uint8_t         m_Padding2[3];
+        uint8_t         m_Priority;         // ClientPriority
+        uint8_t         m_Padding2[2];
         char            m_HostName[ 64 ];
     };
     static_assert( sizeof( MsgConnection ) == sizeof( IMessage ) + 76, "MsgConnection message has incorrect size" );
@@ -219,6 +277,116 @@ namespace Protocol
     };
     static_assert( sizeof( MsgFile ) == sizeof( IMessage ) + 12, "MsgFile message has incorrect size" );
 
+    // MsgCompressionDictionary
+    //------------------------------------------------------------------------------
+    class MsgCompressionDictionary : public IMessage
+    {
+    public:
+        MsgCompressionDictionary();
+    };
+    static_assert( sizeof( MsgCompressionDictionary ) == sizeof( IMessage ), "MsgCompressionDictionary message has incorrect size" );
+
+    // MsgRequestJobs
+    //------------------------------------------------------------------------------
+    class MsgRequestJobs : public IMessage
+    {
+    public:
+        explicit MsgRequestJobs( uint32_t numJobs );
+
+        inline uint32_t GetNumJobs() const { return m_NumJobs; }
+    private:
+        uint32_t m_NumJobs;
+    };
+    static_assert( sizeof( MsgRequestJobs ) == sizeof( IMessage ) + 4, "MsgRequestJobs message has incorrect size" );
+
+    // MsgJobs
+    //  - payload contains ( toolId, job ) for each job
+    //------------------------------------------------------------------------------
+    class MsgJobs : public IMessage
+    {
+    public:
+        MsgJobs( uint32_t numJobsRequested, uint32_t numJobs );
+
+        inline uint32_t GetNumJobsRequested() const { return m_NumJobsRequested; }
+        inline uint32_t GetNumJobs() const { return m_NumJobs; }
+    private:
+        uint32_t m_NumJobsRequested;
+        uint32_t m_NumJobs;
+    };
+    static_assert( sizeof( MsgJobs ) == sizeof( IMessage ) + 8, "MsgJobs message has incorrect size" );
+
+    // MsgJobResults
+    //  - payload contains each result, as sent with MsgJobResult
+    //------------------------------------------------------------------------------
+    class MsgJobResults : public IMessage
+    {
+    public:
+        explicit MsgJobResults( uint32_t numResults );
+
+        inline uint32_t GetNumResults() const { return m_NumResults; }
+    private:
+        uint32_t m_NumResults;
+    };
+    static_assert( sizeof( MsgJobResults ) == sizeof( IMessage ) + 4, "MsgJobResults message has incorrect size" );
+
+    // MsgWorkerStatus
+    //------------------------------------------------------------------------------
+    class MsgWorkerStatus : public IMessage
+    {
+    public:
+        MsgWorkerStatus( const AString & hostName, const AString & address, uint32_t numCPUs, uint32_t numJobsInProgress );
+
+        inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
+        inline uint32_t GetProtocolVersionMinimum() const { return m_ProtocolVersionMinimum; }
+        inline uint32_t GetNumCPUs() const { return m_NumCPUs; }
+        inline uint32_t GetNumJobsInProgress() const { return m_NumJobsInProgress; }
+        inline uint8_t  GetPlatform() const { return m_Platform; }
+        const char * GetHostName() const { return m_HostName; }
+        const char * GetAddress() const { return m_Address; }
+    private:
+        uint32_t        m_ProtocolVersion;
+        uint32_t        m_ProtocolVersionMinimum;   // Oldest client version accepted
+        uint32_t        m_NumCPUs;                  // 0 = unavailable
+        uint32_t        m_NumJobsInProgress;        // Queued or being built
+        uint8_t         m_Platform;
+        uint8_t         m_Padding2[3];
+        char            m_HostName[ 64 ];
+        char            m_Address[ 64 ];            // Empty = use address of the connection
+    };
+    static_assert( sizeof( MsgWorkerStatus ) == sizeof( IMessage ) + 148, "MsgWorkerStatus message has incorrect size" );
+
+    // MsgRequestWorkers
+    //------------------------------------------------------------------------------
+    class MsgRequestWorkers : public IMessage
+    {
+    public:
+        explicit MsgRequestWorkers( const AString & hostName );
+
+        inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
+        inline uint8_t  GetPlatform() const { return m_Platform; }
+        const char * GetHostName() const { return m_HostName; }
+    private:
+        uint32_t        m_ProtocolVersion;
+        uint8_t         m_Platform;
+        uint8_t         m_Padding2[3];
+        char            m_HostName[ 64 ];
+    };
+    static_assert( sizeof( MsgRequestWorkers ) == sizeof( IMessage ) + 72, "MsgRequestWorkers message has incorrect size" );
+
+    // MsgWorkerList
+    //  - payload contains the worker addresses, best first
+    //------------------------------------------------------------------------------
+    class MsgWorkerList : public IMessage
+    {
+    public:
+        explicit MsgWorkerList( uint32_t numWorkers );
+
+        inline uint32_t GetNumWorkers() const { return m_NumWorkers; }
+    private:
+        uint32_t m_NumWorkers;
+    };
+    static_assert( sizeof( MsgWorkerList ) == sizeof( IMessage ) + 4, "MsgWorkerList message has incorrect size" );
+
     // MsgServerStatus
     //------------------------------------------------------------------------------
     class MsgServerStatus : public IMessage
@@ -13,26 +13,33 @@
 #include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
 
 #include "Core/Env/Env.h"
+#include "Core/Math/Conversions.h"
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/MemoryStream.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 
+// system
+#include <memory.h>
+
 // Defines
 //------------------------------------------------------------------------------
 #if defined( __OSX__ ) || defined( __LINUX__ )
     // Touch files every 4 hours
     #define SERVER_TOOLCHAIN_TIMESTAMP_REFRESH_INTERVAL_SECS (60.0f * 60.0f * 4.0f)
 #endif
+#define SERVER_CPU_TIME_WINDOW_BUCKET_SECS ( 10.0f ) // Client CPU time is tracked over the last 2 minutes (12 periods)
+#define SERVER_DEFAULT_JOB_TIME_MS ( 1000.0f ) // Assumed until jobs have been built
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-Server::Server( uint32_t numThreadsInJobQueue )
-    : m_ShouldExit( false )
+Server::Server( uint32_t numThreadsInJobQueue, ICache * cache, bool cacheWrite )
+    : m_JobTimeMS( 0.0f )
+    , m_ShouldExit( false )
     , m_ClientList( 32, true )
 {
-    m_JobQueueRemote = FNEW( JobQueueRemote( numThreadsInJobQueue ? numThreadsInJobQueue : Env::GetNumProcessors() ) );
+    m_JobQueueRemote = FNEW( JobQueueRemote( numThreadsInJobQueue ? numThreadsInJobQueue : Env::GetNumProcessors(), cache, cacheWrite ) );
 
     m_Thread = Thread::CreateThread( ThreadFuncStatic,
                                      "Server",
@@ -192,6 +199,12 @@ bool Server::IsSynchingTool( AString & statusStr ) const
         delete *it;
     }
 
+    // release dictionaries (kept while other clients or jobs in progress still use them)
+    for ( const Compressor::Dictionary * dictionary : cs->m_Dictionaries )
+    {
+        Compressor::ReleaseDictionary( dictionary );
+    }
+
     FDELETE cs;
 }
 
@@ -257,6 +270,12 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_JOBS:
+        {
+            const Protocol::MsgJobs * msg = static_cast< const Protocol::MsgJobs * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
         case Protocol::MSG_MANIFEST:
         {
             const Protocol::MsgManifest * msg = static_cast< const Protocol::MsgManifest * >( imsg );
@@ -269,6 +288,12 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_COMPRESSION_DICTIONARY:
+        {
+            const Protocol::MsgCompressionDictionary * msg = static_cast< const Protocol::MsgCompressionDictionary * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
         default:
         {
             // unknown message type
@@ -289,7 +314,9 @@ bool Server::IsSynchingTool( AString & statusStr ) const
 void Server::Process( const ConnectionInfo * connection, const Protocol::MsgConnection * msg )
 {
     // check for valid/supported protocol version
-    if ( msg->GetProtocolVersion() != Protocol::PROTOCOL_VERSION )
+    // (older clients are supported, using only the messages they understand)
+    if ( ( msg->GetProtocolVersion() < Protocol::PROTOCOL_VERSION_MINIMUM ) ||
+         ( msg->GetProtocolVersion() > Protocol::PROTOCOL_VERSION ) )
     {
         AStackString<> remoteAddr;
         TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
@@ -311,8 +338,10 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgConn
     // take note of initial status of client
     ClientState * cs = (ClientState *)connection->GetUserData();
     MutexHolder mh( cs->m_Mutex );
+    cs->m_ProtocolVersion = msg->GetProtocolVersion();
     cs->m_NumJobsAvailable = msg->GetNumJobsAvailable();
     cs->m_HostName = msg->GetHostName();
+    cs->m_Priority = msg->GetPriority();
 }
 
 // Process( MsgStatus )
@@ -337,6 +366,7 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgNoJo
     MutexHolder mh( cs->m_Mutex );
     ASSERT( cs->m_NumJobsRequested > 0 );
     cs->m_NumJobsRequested--;
+    cs->OnRequestAnswered();
 }
 
 // Process( MsgJob )
@@ -347,16 +377,72 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob
     MutexHolder mh( cs->m_Mutex );
     ASSERT( cs->m_NumJobsRequested > 0 );
     cs->m_NumJobsRequested--;
-    cs->m_NumJobsActive++;
+    cs->OnRequestAnswered();
 
-    // deserialize job
     ConstMemoryStream ms( payload, payloadSize );
+    ReceiveJob( connection, msg->GetToolId(), ms );
+}
+
+// Process( MsgJobs )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJobs * msg, const void * payload, size_t payloadSize )
+{
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    MutexHolder mh( cs->m_Mutex );
+    ASSERT( cs->m_NumJobsRequested >= msg->GetNumJobsRequested() );
+    cs->m_NumJobsRequested -= msg->GetNumJobsRequested();
+    cs->OnRequestAnswered();
+
+    // payload contains each job, preceded by its tool id
+    ConstMemoryStream ms( payload, payloadSize );
+    for ( uint32_t i = 0; i < msg->GetNumJobs(); ++i )
+    {
+        uint64_t toolId = 0;
+        ms.Read( toolId );
+        if ( ReceiveJob( connection, toolId, ms ) == false )
+        {
+            return; // disconnected
+        }
+    }
+}
+
+// ReceiveJob
+//------------------------------------------------------------------------------
+bool Server::ReceiveJob( const ConnectionInfo * connection, uint64_t toolId, ConstMemoryStream & stream )
+{
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    MutexHolder mh( cs->m_Mutex );
 
-    Job * job = FNEW( Job( ms ) );
+    // deserialize job
+    Job * job = FNEW( Job( stream, cs->m_ProtocolVersion ) );
     job->SetUserData( cs );
 
+    // reconstruct job data which refers to data from previous jobs
+    if ( job->IsDataDeduplicated() )
+    {
+        PROFILE_SECTION( "Deduplicated" );
+        Compressor c;
+        void * data = nullptr;
+        size_t dataSize = 0;
+        bool ok = c.Decompress( job->GetData() );
+        if ( ok )
+        {
+            ConstMemoryStream ms( c.GetResult(), c.GetResultSize() );
+            ok = cs->m_Deduplicator.Decode( ms, data, dataSize );
+        }
+        if ( ok == false )
+        {
+            FLOG_WARN( "Invalid job data received from %s\n", cs->m_HostName.Get() );
+            FDELETE job;
+            Disconnect( connection );
+            return false;
+        }
+        job->OwnData( data, dataSize, false );
+    }
+
+    cs->m_NumJobsActive++;
+
     //
-    const uint64_t toolId = msg->GetToolId();
     ASSERT( toolId );
 
     MutexHolder manifestMH( m_ToolManifestsMutex ); // ensure we don't make redundant requests
@@ -370,7 +456,7 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob
         {
             // we have all the files - we can do the job
             JobQueueRemote::Get().QueueJob( job );
-            return;
+            return true;
         }
 
         // missing some files - request them
@@ -392,6 +478,7 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob
 
     // can't start job yet - put it on hold
     cs->m_WaitingJobs.Append( job );
+    return true;
 }
 
 // Process( MsgManifest )
@@ -401,6 +488,7 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
     ToolManifest * manifest = nullptr;
     const uint64_t toolId = msg->GetToolId();
     ConstMemoryStream ms( payload, payloadSize );
+    const ClientState * cs = (const ClientState *)connection->GetUserData();
 
     {
         MutexHolder manifestMH( m_ToolManifestsMutex ); // ensure we don't make redundant requests
@@ -409,7 +497,7 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
         ToolManifest ** found = m_Tools.FindDeref( toolId );
         ASSERT( found );
         manifest = *found;
-        manifest->DeserializeFromRemote( ms );
+        manifest->DeserializeFromRemote( ms, cs->m_ProtocolVersion );
     }
 
     // manifest has checked local files, from previous sessions an may
@@ -462,6 +550,37 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFile
     CheckWaitingJobs( manifest );
 }
 
+// Process( MsgCompressionDictionary )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgCompressionDictionary *, const void * payload, size_t payloadSize )
+{
+    // Register the dictionary so jobs compressed with it can be decompressed. Dictionaries
+    // are held until the client disconnects, and shared with other clients using the same cache.
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    MutexHolder mh( cs->m_Mutex );
+    if ( cs->m_Dictionaries.GetSize() >= ClientState::MAX_DICTIONARIES )
+    {
+        FLOG_WARN( "Too many compression dictionaries received from '%s'\n", cs->m_HostName.Get() );
+        Disconnect( connection );
+        return;
+    }
+
+    const Compressor::Dictionary * dictionary = Compressor::RegisterDictionary( payload, payloadSize );
+    if ( dictionary == nullptr )
+    {
+        FLOG_WARN( "Invalid compression dictionary received (%zu bytes)\n", payloadSize );
+        Disconnect( connection );
+        return;
+    }
+
+    if ( cs->m_Dictionaries.Find( dictionary ) )
+    {
+        Compressor::ReleaseDictionary( dictionary ); // Already held
+        return;
+    }
+    cs->m_Dictionaries.Append( dictionary );
+}
+
 // CheckWaitingJobs
 //------------------------------------------------------------------------------
 void Server::CheckWaitingJobs( const ToolManifest * manifest )
@@ -545,13 +664,15 @@ void Server::FindNeedyClients()
     MutexHolder mh( m_ClientListMutex );
 
     // determine job availability
-    int availableJobs = (int)WorkerThreadRemote::GetNumCPUsToUse();
-    if ( availableJobs == 0 )
+    const uint32_t numCPUs = WorkerThreadRemote::GetNumCPUsToUse();
+    if ( numCPUs == 0 )
     {
         return;
     }
-    ++availableJobs; // over request to parallelize building/network transfers
 
+    // any jobs requested or in progress reduce the available count
+    int32_t reservedJobs = 0;
+    float requestTimeMS = 0.0f;
     ClientState ** iter = m_ClientList.Begin();
     const ClientState * const * end = m_ClientList.End();
     for ( ; iter != end; ++iter )
@@ -560,64 +681,186 @@ void Server::FindNeedyClients()
 
         MutexHolder mh2( cs->m_Mutex );
 
-        // any jobs requested or in progress reduce the available count
-        int32_t reservedJobs = (int32_t)( cs->m_NumJobsRequested + cs->m_NumJobsActive );
-        availableJobs -= reservedJobs;
-        if ( availableJobs <= 0 )
+        reservedJobs += (int32_t)( cs->m_NumJobsRequested + cs->m_NumJobsActive );
+        requestTimeMS = Math::Max( requestTimeMS, cs->m_RequestTimeMS );
+    }
+
+    // over request to parallelize building/network transfers
+    int32_t availableJobs = (int32_t)( numCPUs + GetNumJobsToPrefetch( numCPUs, requestTimeMS, m_JobTimeMS ) );
+    availableJobs -= reservedJobs;
+    if ( availableJobs <= 0 )
+    {
+        return;
+    }
+
+    // we have some jobs available
+    const float quantumMS = ( m_JobTimeMS > 0.0f ) ? m_JobTimeMS : SERVER_DEFAULT_JOB_TIME_MS;
+    Array< NeedyClient > needyClients( m_ClientList.GetSize(), false );
+    ShareJobRequests( m_ClientList, GetCPUTimeWindowBucket(), quantumMS, availableJobs, needyClients );
+
+    // send the requests
+    for ( const NeedyClient & needyClient : needyClients )
+    {
+        const uint32_t numJobs = needyClient.m_NumJobsToRequest;
+        if ( numJobs == 0 )
         {
-            return;
+            continue;
+        }
+
+        ClientState * cs = needyClient.m_ClientState;
+        MutexHolder mh2( cs->m_Mutex );
+        if ( cs->m_ProtocolVersion >= Protocol::PROTOCOL_VERSION_BATCHED_JOBS )
+        {
+            // all jobs in one request
+            Protocol::MsgRequestJobs msg( numJobs );
+            msg.Send( cs->m_Connection );
+            cs->m_RequestTimes.Append( Timer::GetNow() );
+        }
+        else
+        {
+            // older clients need a request for each job
+            Protocol::MsgRequestJob msg;
+            for ( uint32_t j = 0; j < numJobs; ++j )
+            {
+                msg.Send( cs->m_Connection );
+                cs->m_RequestTimes.Append( Timer::GetNow() );
+            }
         }
     }
+}
 
-    // we have some jobs available
+// ShareJobRequests
+//------------------------------------------------------------------------------
+/*static*/ void Server::ShareJobRequests( const Array< ClientState * > & clients,
+                                          uint32_t cpuTimeBucket,
+                                          float quantumMS,
+                                          int32_t availableJobs,
+                                          Array< NeedyClient > & outNeedyClients )
+{
+    // Clients which have had the least CPU time recently (relative to their
+    // priority) are first to receive free CPUs. Small builds sharing a worker
+    // with large builds can then complete quickly.
+    for ( ClientState * cs : clients )
+    {
+        MutexHolder mh2( cs->m_Mutex );
 
-    // sort clients to find neediest first
-    m_ClientList.SortDeref();
+        if ( cs->m_NumJobsRequested >= cs->m_NumJobsAvailable )
+        {
+            cs->m_DeficitMS = 0.0f; // unused share is not kept while a client has no jobs
+            continue;
+        }
 
-    Protocol::MsgRequestJob msg;
+        // include jobs being built (or requested) as if they were complete
+        const float jobTimeMS = ( cs->m_JobTimeMS > 0.0f ) ? cs->m_JobTimeMS : quantumMS;
+        const float cpuTimeMS = cs->GetRecentCPUTimeMS( cpuTimeBucket ) +
+                                ( (float)( cs->m_NumJobsRequested + cs->m_NumJobsActive ) * jobTimeMS );
+        outNeedyClients.Append( NeedyClient{ cs, ( cpuTimeMS / GetPriorityWeight( cs->m_Priority ) ), 0 } );
+    }
+    outNeedyClients.Sort( []( const NeedyClient & a, const NeedyClient & b )
+    {
+        return ( a.m_WeightedCPUTimeMS < b.m_WeightedCPUTimeMS );
+    } );
 
+    // distribute requests between clients using deficit round robin: each pass
+    // gives clients a quantum of CPU time (scaled by priority), which they
+    // spend on jobs costing their average build time. Clients with expensive
+    // jobs then don't receive more than their share.
     while ( availableJobs > 0 )
     {
-        bool anyJobsRequested = false;
+        bool anyClientsNeedy = false;
 
-        iter = m_ClientList.Begin();
-        for ( ; iter != end; ++iter )
+        for ( NeedyClient & needyClient : outNeedyClients )
         {
-            ClientState * cs = *iter;
+            if ( availableJobs <= 0 )
+            {
+                break;
+            }
 
-            MutexHolder mh2( cs->m_Mutex );
+            ClientState * cs = needyClient.m_ClientState;
 
-            size_t reservedJobs = cs->m_NumJobsRequested;
+            MutexHolder mh2( cs->m_Mutex );
 
-            if ( reservedJobs >= cs->m_NumJobsAvailable )
+            if ( cs->m_NumJobsRequested >= cs->m_NumJobsAvailable )
             {
-                continue; // we've maxed out the requests to this worker
+                cs->m_DeficitMS = 0.0f;
+                continue; // we've maxed out the requests to this client
+            }
+            anyClientsNeedy = true;
+
+            // request jobs from this client
+            const float jobTimeMS = ( cs->m_JobTimeMS > 0.0f ) ? cs->m_JobTimeMS : quantumMS;
+            cs->m_DeficitMS += ( quantumMS * GetPriorityWeight( cs->m_Priority ) );
+            while ( ( cs->m_DeficitMS >= jobTimeMS ) &&
+                    ( cs->m_NumJobsRequested < cs->m_NumJobsAvailable ) &&
+                    ( availableJobs > 0 ) )
+            {
+                cs->m_DeficitMS -= jobTimeMS;
+                needyClient.m_NumJobsToRequest++;
+                cs->m_NumJobsRequested++;
+                availableJobs--;
             }
-
-            // request job from this client
-            msg.Send( cs->m_Connection );
-            cs->m_NumJobsRequested++;
-            availableJobs--;
-            anyJobsRequested = true;
         }
 
-        // if we did a pass and couldn't request any more jobs, then bail out
-        if ( anyJobsRequested == false )
+        // if no client can accept more requests, then bail out
+        if ( anyClientsNeedy == false )
         {
             break;
         }
     }
 }
 
+// GetNumJobsToPrefetch
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Server::GetNumJobsToPrefetch( uint32_t numCPUs, float requestTimeMS, float jobTimeMS )
+{
+    // Until we have measurements, over request by one
+    if ( ( requestTimeMS <= 0.0f ) || ( jobTimeMS <= 0.0f ) )
+    {
+        return 1;
+    }
+
+    // While waiting for a request to be answered, each CPU will complete
+    // ( requestTime / jobTime ) jobs. Having that many extra jobs ready
+    // avoids CPUs sitting idle on high latency connections.
+    const float numJobs = ( (float)numCPUs * requestTimeMS / jobTimeMS );
+    return (uint32_t)Math::Clamp( numJobs + 0.5f, 1.0f, (float)numCPUs );
+}
+
+// GetPriorityWeight
+//------------------------------------------------------------------------------
+/*static*/ float Server::GetPriorityWeight( uint8_t priority )
+{
+    switch ( priority )
+    {
+        case Protocol::PRIORITY_LOW:    return 1.0f;
+        case Protocol::PRIORITY_HIGH:   return 4.0f;
+        default:                        return 2.0f; // PRIORITY_NORMAL (or unknown)
+    }
+}
+
+// GetCPUTimeWindowBucket
+//------------------------------------------------------------------------------
+uint32_t Server::GetCPUTimeWindowBucket() const
+{
+    return (uint32_t)( m_CPUTimeWindowTimer.GetElapsed() / SERVER_CPU_TIME_WINDOW_BUCKET_SECS );
+}
+
 // FinalizeCompletedJobs
 //------------------------------------------------------------------------------
 void Server::FinalizeCompletedJobs()
 {
     PROFILE_FUNCTION;
 
+    // results reference the job data, so jobs are kept until the results are sent
+    Array< Job * > completedJobs( 0, true );
+
     JobQueueRemote & jcr = JobQueueRemote::Get();
     while ( Job * job = jcr.GetCompletedJob() )
     {
+        completedJobs.Append( job );
+
+        const uint32_t buildTimeMS = job->GetNode()->GetLastBuildTime();
+
         // get associated connection
         ClientState * cs = (ClientState *)job->GetUserData();
 
@@ -626,28 +869,25 @@ void Server::FinalizeCompletedJobs()
         bool connectionStillActive = ( m_ClientList.Find( cs ) != nullptr );
         if ( connectionStillActive )
         {
-            Node::State result = job->GetNode()->GetState();
-            ASSERT( ( result == Node::UP_TO_DATE ) || ( result == Node::FAILED ) );
-
-            MemoryStream ms;
-            ms.Write( job->GetJobId() );
-            ms.Write( job->GetNode()->GetName() );
-            ms.Write( result == Node::UP_TO_DATE );
-            ms.Write( job->GetSystemErrorCount() > 0 );
-            ms.Write( job->GetMessages() );
-            ms.Write( job->GetNode()->GetLastBuildTime() );
-            ms.Write( job->GetRemoteThreadIndex() ); // The thread used to build the job to assist with visualization
-
-            // write the data - build result for success, or output+errors for failure
-            ms.Write( (uint32_t)job->GetDataSize() );
-            ms.WriteBuffer( job->GetData(), job->GetDataSize() );
-
             MutexHolder mh2( cs->m_Mutex );
             ASSERT( cs->m_NumJobsActive );
             cs->m_NumJobsActive--;
+            cs->OnJobCompleted( GetCPUTimeWindowBucket(), (float)buildTimeMS );
 
-            Protocol::MsgJobResult msg;
-            msg.Send( cs->m_Connection, ms );
+            if ( cs->m_ProtocolVersion >= Protocol::PROTOCOL_VERSION_BATCHED_JOBS )
+            {
+                // results completing together are sent together (below)
+                WriteJobResult( job, cs->m_ProtocolVersion, cs->m_ResultsBatch );
+                cs->m_NumResultsBatched++;
+            }
+            else
+            {
+                Protocol::PayloadBuffers payload;
+                WriteJobResult( job, cs->m_ProtocolVersion, payload );
+
+                Protocol::MsgJobResult msg;
+                msg.Send( cs->m_Connection, payload );
+            }
         }
         else
         {
@@ -655,10 +895,150 @@ void Server::FinalizeCompletedJobs()
             // (if the connection was lost before we completed)
         }
 
+        // track how long jobs take to build (see GetNumJobsToPrefetch)
+        if ( buildTimeMS > 0 )
+        {
+            m_JobTimeMS = ( m_JobTimeMS > 0.0f ) ? ( ( m_JobTimeMS * 0.875f ) + ( (float)buildTimeMS * 0.125f ) )
+                                                 : (float)buildTimeMS;
+        }
+    }
+
+    // send batched results
+    {
+        MutexHolder mh( m_ClientListMutex );
+        for ( ClientState * cs : m_ClientList )
+        {
+            MutexHolder mh2( cs->m_Mutex );
+            if ( cs->m_NumResultsBatched == 0 )
+            {
+                continue;
+            }
+
+            Protocol::MsgJobResults msg( cs->m_NumResultsBatched );
+            msg.Send( cs->m_Connection, cs->m_ResultsBatch );
+            cs->m_ResultsBatch.Reset();
+            cs->m_NumResultsBatched = 0;
+        }
+    }
+
+    for ( Job * job : completedJobs )
+    {
         FDELETE job;
     }
 }
 
+// WriteJobResult
+//------------------------------------------------------------------------------
+/*static*/ void Server::WriteJobResult( const Job * job, uint32_t protocolVersion, Protocol::PayloadBuffers & payload )
+{
+    MemoryStream & stream = payload.GetStream();
+
+    const Node::State result = job->GetNode()->GetState();
+    ASSERT( ( result == Node::UP_TO_DATE ) || ( result == Node::FAILED ) );
+
+    stream.Write( job->GetJobId() );
+    stream.Write( job->GetNode()->GetName() );
+    stream.Write( result == Node::UP_TO_DATE );
+    stream.Write( job->GetSystemErrorCount() > 0 );
+    stream.Write( job->GetMessages() );
+    stream.Write( job->GetNode()->GetLastBuildTime() );
+    stream.Write( job->GetRemoteThreadIndex() ); // The thread used to build the job to assist with visualization
+    if ( protocolVersion >= Protocol::PROTOCOL_VERSION_WORKER_CACHE )
+    {
+        stream.Write( (uint8_t)job->GetRemoteCacheResult() );
+    }
+
+    // write the data - build result for success, or output+errors for failure
+    // (sent directly from the job, without copying it into the stream)
+    stream.Write( (uint32_t)job->GetDataSize() );
+    payload.AddBuffer( job->GetData(), job->GetDataSize() );
+}
+
+// ClientState::CONSTRUCTOR
+//------------------------------------------------------------------------------
+Server::ClientState::ClientState( const ConnectionInfo * ci )
+    : m_CurrentMessage( nullptr )
+    , m_Connection( ci )
+    , m_ProtocolVersion( 0 )
+    , m_NumJobsAvailable( 0 )
+    , m_NumJobsRequested( 0 )
+    , m_NumJobsActive( 0 )
+    , m_Priority( Protocol::PRIORITY_NORMAL )
+    , m_CPUTimeBucket( 0 )
+    , m_JobTimeMS( 0.0f )
+    , m_DeficitMS( 0.0f )
+    , m_RequestTimes( 8, true )
+    , m_RequestTimeMS( 0.0f )
+    , m_NumResultsBatched( 0 )
+    , m_WaitingJobs( 16, true )
+    , m_Dictionaries( 0, true )
+{
+    memset( m_CPUTimeMS, 0, sizeof( m_CPUTimeMS ) );
+}
+
+// OnRequestAnswered
+//------------------------------------------------------------------------------
+void Server::ClientState::OnRequestAnswered()
+{
+    // NOTE: m_Mutex must be held
+
+    // requests are answered in order
+    ASSERT( m_RequestTimes.IsEmpty() == false );
+    const float timeMS = (float)( Timer::GetNow() - m_RequestTimes[ 0 ] ) * Timer::GetFrequencyInvFloatMS();
+    m_RequestTimes.EraseIndex( 0 );
+
+    // keep a moving average
+    m_RequestTimeMS = ( m_RequestTimeMS > 0.0f ) ? ( ( m_RequestTimeMS * 0.875f ) + ( timeMS * 0.125f ) )
+                                                 : timeMS;
+}
+
+// OnJobCompleted
+//------------------------------------------------------------------------------
+void Server::ClientState::OnJobCompleted( uint32_t cpuTimeBucket, float buildTimeMS )
+{
+    // NOTE: m_Mutex must be held
+
+    UpdateCPUTimeWindow( cpuTimeBucket );
+    m_CPUTimeMS[ cpuTimeBucket % CPU_TIME_WINDOW_BUCKETS ] += buildTimeMS;
+
+    // keep a moving average
+    if ( buildTimeMS > 0.0f )
+    {
+        m_JobTimeMS = ( m_JobTimeMS > 0.0f ) ? ( ( m_JobTimeMS * 0.875f ) + ( buildTimeMS * 0.125f ) )
+                                             : buildTimeMS;
+    }
+}
+
+// GetRecentCPUTimeMS
+//------------------------------------------------------------------------------
+float Server::ClientState::GetRecentCPUTimeMS( uint32_t cpuTimeBucket )
+{
+    // NOTE: m_Mutex must be held
+
+    UpdateCPUTimeWindow( cpuTimeBucket );
+    float cpuTimeMS = 0.0f;
+    for ( const float timeMS : m_CPUTimeMS )
+    {
+        cpuTimeMS += timeMS;
+    }
+    return cpuTimeMS;
+}
+
+// UpdateCPUTimeWindow
+//------------------------------------------------------------------------------
+void Server::ClientState::UpdateCPUTimeWindow( uint32_t cpuTimeBucket )
+{
+    // NOTE: m_Mutex must be held
+
+    // forget periods which have left the window
+    const uint32_t numExpired = Math::Min( ( cpuTimeBucket - m_CPUTimeBucket ), (uint32_t)CPU_TIME_WINDOW_BUCKETS );
+    for ( uint32_t i = 1; i <= numExpired; ++i )
+    {
+        m_CPUTimeMS[ ( m_CPUTimeBucket + i ) % CPU_TIME_WINDOW_BUCKETS ] = 0.0f;
+    }
+    m_CPUTimeBucket = cpuTimeBucket;
+}
+
 // TouchToolchains
 //------------------------------------------------------------------------------
 void Server::TouchToolchains()
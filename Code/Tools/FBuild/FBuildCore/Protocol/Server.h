@@ -4,11 +4,17 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/SegmentDeduplicator.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Time/Timer.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class ConstMemoryStream;
+class ICache;
 class Job;
 class JobQueueRemote;
 namespace Protocol
@@ -16,10 +22,12 @@ namespace Protocol
     class IMessage;
     class MsgConnection;
     class MsgJob;
+    class MsgJobs;
     class MsgManifest;
     class MsgNoJobAvailable;
     class MsgStatus;
     class MsgFile;
+    class MsgCompressionDictionary;
 }
 class ToolManifest;
 
@@ -28,7 +36,7 @@ class ToolManifest;
 class Server : public TCPConnectionPool
 {
 public:
-    Server( uint32_t numThreadsInJobQueue = 0 );
+    Server( uint32_t numThreadsInJobQueue = 0, ICache * cache = nullptr, bool cacheWrite = false );
     virtual ~Server() override;
 
     static void GetHostForJob( const Job * job, AString & hostName );
@@ -36,6 +44,8 @@ public:
     bool IsSynchingTool( AString & statusStr ) const;
 
 private:
+    friend class TestDistributed;
+
     // TCPConnection interface
     virtual void OnConnected( const ConnectionInfo * connection ) override;
     virtual void OnDisconnected( const ConnectionInfo * connection ) override;
@@ -46,41 +56,81 @@ private:
     void Process( const ConnectionInfo * connection, const Protocol::MsgStatus * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgNoJobAvailable * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgJob * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJobs * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgManifest * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgFile * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgCompressionDictionary * msg, const void * payload, size_t payloadSize );
 
     static uint32_t ThreadFuncStatic( void * param );
     void            ThreadFunc();
 
+    struct ClientState;
+    struct NeedyClient
+    {
+        ClientState *   m_ClientState;
+        float           m_WeightedCPUTimeMS;
+        uint32_t        m_NumJobsToRequest;
+    };
     void            FindNeedyClients();
+    static void     ShareJobRequests( const Array< ClientState * > & clients, uint32_t cpuTimeBucket, float quantumMS, int32_t availableJobs, Array< NeedyClient > & outNeedyClients );
     void            FinalizeCompletedJobs();
     void            TouchToolchains();
     void            CheckWaitingJobs( const ToolManifest * manifest );
+    bool            ReceiveJob( const ConnectionInfo * connection, uint64_t toolId, ConstMemoryStream & stream );
+    static void     WriteJobResult( const Job * job, uint32_t protocolVersion, Protocol::PayloadBuffers & payload );
+    static uint32_t GetNumJobsToPrefetch( uint32_t numCPUs, float requestTimeMS, float jobTimeMS );
+    static float    GetPriorityWeight( uint8_t priority );
+    uint32_t        GetCPUTimeWindowBucket() const;
 
     void            RequestMissingFiles( const ConnectionInfo * connection, ToolManifest * manifest ) const;
 
     struct ClientState
     {
-        explicit ClientState( const ConnectionInfo * ci ) : m_CurrentMessage( nullptr ), m_Connection( ci ), m_NumJobsAvailable( 0 ), m_NumJobsRequested( 0 ), m_NumJobsActive( 0 ), m_WaitingJobs( 16, true ) {}
+        explicit ClientState( const ConnectionInfo * ci );
 
-        inline bool operator < ( const ClientState & other ) const { return ( m_NumJobsAvailable > other.m_NumJobsAvailable ); }
+        void            OnRequestAnswered();
+        void            OnJobCompleted( uint32_t cpuTimeBucket, float buildTimeMS );
+        float           GetRecentCPUTimeMS( uint32_t cpuTimeBucket );
+        void            UpdateCPUTimeWindow( uint32_t cpuTimeBucket );
 
         Mutex                   m_Mutex;
 
         const Protocol::IMessage * m_CurrentMessage;
         const ConnectionInfo *  m_Connection;
+        uint32_t                m_ProtocolVersion;
         uint32_t                m_NumJobsAvailable;
         uint32_t                m_NumJobsRequested;
         uint32_t                m_NumJobsActive;
+        uint8_t                 m_Priority;             // Protocol::ClientPriority
+
+        // fair share of CPUs between clients (see FindNeedyClients)
+        enum { CPU_TIME_WINDOW_BUCKETS = 12 };
+        float                   m_CPUTimeMS[ CPU_TIME_WINDOW_BUCKETS ]; // CPU time used by recent jobs, per period
+        uint32_t                m_CPUTimeBucket;        // period of the most recent entry in m_CPUTimeMS
+        float                   m_JobTimeMS;            // average time to build jobs from this client
+        float                   m_DeficitMS;            // CPU time this client can still request jobs for
+
+        Array< int64_t >        m_RequestTimes;         // when each unanswered job request was sent
+        float                   m_RequestTimeMS;        // average time for job requests to be answered
+
+        Protocol::PayloadBuffers m_ResultsBatch;        // results to be sent together, referencing job data (see FinalizeCompletedJobs)
+        uint32_t                m_NumResultsBatched;
 
         AString                 m_HostName;
 
         Array< Job * >          m_WaitingJobs; // jobs waiting for manifests/toolchains
 
+        SegmentDeduplicator     m_Deduplicator; // segments of job data received, referenced by later jobs
+
+        enum { MAX_DICTIONARIES = 8 }; // a client only needs the dictionary of each cache it uses
+        Array< const Compressor::Dictionary * > m_Dictionaries; // registered for this client's jobs (released on disconnect)
+
         Timer                   m_StatusTimer;
     };
 
     JobQueueRemote *        m_JobQueueRemote;
+    float                   m_JobTimeMS;    // average time to build jobs (only accessed by m_Thread)
+    Timer                   m_CPUTimeWindowTimer; // measures periods of the sliding window of client CPU time
 
     volatile bool           m_ShouldExit;   // signal from main thread
     Thread::ThreadHandle    m_Thread;       // the thread to manage workload
@@ -89,6 +139,7 @@ private:
 
     mutable Mutex           m_ToolManifestsMutex;
     Array< ToolManifest * > m_Tools;
+
     
     #if defined( __OSX__ ) || defined( __LINUX__ )
         Timer                   m_TouchToolchainTimer;
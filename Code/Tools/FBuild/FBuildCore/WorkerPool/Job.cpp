@@ -7,6 +7,7 @@
 
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 
 #include "Core/Env/Assert.h"
 #include "Core/FileIO/FileIO.h"
@@ -31,10 +32,10 @@ Job::Job( Node * node )
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-Job::Job( IOStream & stream )
+Job::Job( IOStream & stream, uint32_t protocolVersion )
     : m_IsLocal( false )
 {
-    Deserialize( stream );
+    Deserialize( stream, protocolVersion );
 }
 
 // DESTRUCTOR
@@ -87,6 +88,7 @@ void Job::OwnData( void * data, size_t size, bool compressed )
     m_Data = data;
     m_DataSize = (uint32_t)size;
     m_DataIsCompressed = compressed;
+    m_DataIsDeduplicated = false;
 
     // Update total memory use tracking
     if ( m_IsLocal )
@@ -147,9 +149,24 @@ void Job::SetMessages( const Array< AString > & messages )
     m_Messages = messages;
 }
 
-// Serialize
+// SerializeHeader
 //------------------------------------------------------------------------------
-void Job::Serialize( IOStream & stream )
+void Job::SerializeHeader( IOStream & stream, uint32_t protocolVersion )
+{
+    SerializeHeader( stream, protocolVersion, IsDataCompressed() ? DATA_COMPRESSED : DATA_UNCOMPRESSED, m_DataSize );
+}
+
+// SerializeHeaderForDeduplicatedData
+//------------------------------------------------------------------------------
+void Job::SerializeHeaderForDeduplicatedData( IOStream & stream, uint32_t protocolVersion, uint32_t dataSize )
+{
+    ASSERT( protocolVersion >= Protocol::PROTOCOL_VERSION_DEDUPLICATED_JOBS );
+    SerializeHeader( stream, protocolVersion, DATA_DEDUPLICATED, dataSize );
+}
+
+// SerializeHeader
+//------------------------------------------------------------------------------
+void Job::SerializeHeader( IOStream & stream, uint32_t protocolVersion, DataFormat dataFormat, uint32_t dataSize )
 {
     PROFILE_FUNCTION;
 
@@ -163,15 +180,22 @@ void Job::Serialize( IOStream & stream )
     // write properties of node
     Node::SaveRemote( stream, m_Node );
 
-    stream.Write( IsDataCompressed() );
+    // write cache key for use by the worker
+    if ( protocolVersion >= Protocol::PROTOCOL_VERSION_WORKER_CACHE )
+    {
+        stream.Write( ( m_RemoteCacheAccess != REMOTE_CACHE_ACCESS_NONE ) ? m_CacheName : AString::GetEmpty() );
+        stream.Write( m_RemoteCacheAccess );
+        stream.Write( m_RemoteCacheCompressionLevel );
+    }
+
+    stream.Write( (uint8_t)dataFormat );
 
-    stream.Write( m_DataSize );
-    stream.Write( m_Data, m_DataSize );
+    stream.Write( dataSize );
 }
 
 // Deserialize
 //------------------------------------------------------------------------------
-void Job::Deserialize( IOStream & stream )
+void Job::Deserialize( IOStream & stream, uint32_t protocolVersion )
 {
     // read jobid
     stream.Read( m_JobId );
@@ -181,8 +205,16 @@ void Job::Deserialize( IOStream & stream )
     // read properties of node
     m_Node = Node::LoadRemote( stream );
 
-    bool compressed;
-    stream.Read( compressed );
+    // read cache key (older clients don't send it)
+    if ( protocolVersion >= Protocol::PROTOCOL_VERSION_WORKER_CACHE )
+    {
+        stream.Read( m_CacheName );
+        stream.Read( m_RemoteCacheAccess );
+        stream.Read( m_RemoteCacheCompressionLevel );
+    }
+
+    uint8_t dataFormat;
+    stream.Read( dataFormat );
 
     // read extra data
     uint32_t dataSize;
@@ -190,7 +222,8 @@ void Job::Deserialize( IOStream & stream )
     void * data = ALLOC( dataSize );
     stream.Read( data, dataSize );
 
-    OwnData( data, dataSize, compressed );
+    OwnData( data, dataSize, ( dataFormat != DATA_UNCOMPRESSED ) );
+    m_DataIsDeduplicated = ( dataFormat == DATA_DEDUPLICATED );
 }
 
 // GetMessagesForLog
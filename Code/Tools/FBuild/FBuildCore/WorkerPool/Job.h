@@ -21,7 +21,7 @@ class Job
 {
 public:
     explicit Job( Node * node );
-    explicit Job( IOStream & stream );
+    explicit Job( IOStream & stream, uint32_t protocolVersion );
             ~Job();
 
     inline uint32_t GetJobId() const { return m_JobId; }
@@ -50,6 +50,7 @@ public:
     inline ToolManifest *   GetToolManifest() const                     { return m_ToolManifest; }
 
     inline bool     IsDataCompressed() const { return m_DataIsCompressed; }
+    inline bool     IsDataDeduplicated() const { return m_DataIsDeduplicated; }
     inline bool     IsLocal() const     { return m_IsLocal; }
 
     inline const Array< AString > & GetMessages() const { return m_Messages; }
@@ -64,8 +65,14 @@ public:
     inline uint8_t GetSystemErrorCount() const { return m_SystemErrorCount; }
 
     // serialization for remote distribution
-    void Serialize( IOStream & stream );
-    void Deserialize( IOStream & stream );
+    //  - the data (GetData/GetDataSize) is not written by SerializeHeader and must
+    //    be sent directly after it, which avoids copying it
+    //  - alternatively, the data can be sent encoded by a SegmentDeduplicator and
+    //    compressed, which the receiver must reconstruct (see IsDataDeduplicated)
+    //  - the header is written in the form expected from a client of the given protocol version
+    void SerializeHeader( IOStream & stream, uint32_t protocolVersion );
+    void SerializeHeaderForDeduplicatedData( IOStream & stream, uint32_t protocolVersion, uint32_t dataSize );
+    void Deserialize( IOStream & stream, uint32_t protocolVersion );
 
     void                GetMessagesForLog( AString & buffer ) const;
     void                GetMessagesForMonitorLog( AString & buffer ) const;
@@ -92,6 +99,37 @@ public:
     inline void                 SetDistributionState( DistributionState state ) { m_DistributionState = state; }
     inline DistributionState    GetDistributionState() const                    { return m_DistributionState; }
 
+    enum CachePrefetchResult : uint8_t
+    {
+        CACHE_PREFETCH_NONE                 = 0, // Not prefetched (or prefetch was not possible)
+        CACHE_PREFETCH_HIT                  = 1, // Output retrieved from the cache by the CachePrefetcher
+        CACHE_PREFETCH_MISS                 = 2, // Cache key calculated by the CachePrefetcher, but not in cache
+    };
+    inline void                 SetCachePrefetchResult( CachePrefetchResult result ) { m_CachePrefetchResult = result; }
+    inline CachePrefetchResult  GetCachePrefetchResult() const                       { return m_CachePrefetchResult; }
+
+    // Use of the shared cache by workers, with the cache key sent with the job
+    enum RemoteCacheAccess : uint8_t
+    {
+        REMOTE_CACHE_ACCESS_NONE            = 0,
+        REMOTE_CACHE_ACCESS_READ            = 1, // Worker can retrieve the result instead of compiling
+        REMOTE_CACHE_ACCESS_WRITE           = 2, // Worker can publish the result
+    };
+    enum RemoteCacheResult : uint8_t
+    {
+        REMOTE_CACHE_NONE                   = 0, // Cache not used by the worker
+        REMOTE_CACHE_HIT                    = 1, // Result retrieved from the cache by the worker
+        REMOTE_CACHE_STORE                  = 2, // Result compiled and published to the cache by the worker
+    };
+    inline void                 SetRemoteCacheAccess( uint8_t access )              { m_RemoteCacheAccess = access; }
+    inline uint8_t              GetRemoteCacheAccess() const                        { return m_RemoteCacheAccess; }
+    inline void                 SetRemoteCacheCompressionLevel( int8_t level )      { m_RemoteCacheCompressionLevel = level; }
+    inline int8_t               GetRemoteCacheCompressionLevel() const              { return m_RemoteCacheCompressionLevel; }
+    inline void                 SetRemoteCacheResult( RemoteCacheResult result )    { m_RemoteCacheResult = result; }
+    inline RemoteCacheResult    GetRemoteCacheResult() const                        { return m_RemoteCacheResult; }
+    inline void                 SetRemoteSourceHash( uint64_t hash )                { m_RemoteSourceHash = hash; }
+    inline uint64_t             GetRemoteSourceHash() const                         { return m_RemoteSourceHash; }
+
     // Access total memory usage by job data
     static uint64_t             GetTotalLocalDataMemoryUsage();
 
@@ -99,6 +137,14 @@ public:
     BuildProfilerScope *    GetBuildProfilerScope() const { return m_BuildProfilerScope; }
 
 private:
+    enum DataFormat : uint8_t
+    {
+        DATA_UNCOMPRESSED   = 0,
+        DATA_COMPRESSED     = 1,
+        DATA_DEDUPLICATED   = 2, // Compressed SegmentDeduplicator encoding
+    };
+    void SerializeHeader( IOStream & stream, uint32_t protocolVersion, DataFormat dataFormat, uint32_t dataSize );
+
     uint32_t            m_JobId             = 0;
     uint32_t            m_DataSize          = 0;
     Node *              m_Node              = nullptr;
@@ -106,9 +152,15 @@ private:
     void *              m_UserData          = nullptr;
     volatile bool       m_Abort             = false;
     bool                m_DataIsCompressed  = false;
+    bool                m_DataIsDeduplicated = false;
     bool                m_IsLocal           = true;
     uint8_t             m_SystemErrorCount  = 0; // On client, the total error count, on the worker a flag for the current attempt
     DistributionState   m_DistributionState = DIST_NONE;
+    CachePrefetchResult m_CachePrefetchResult = CACHE_PREFETCH_NONE;
+    uint8_t             m_RemoteCacheAccess = REMOTE_CACHE_ACCESS_NONE;
+    int8_t              m_RemoteCacheCompressionLevel = -1; // See Compressor.h
+    RemoteCacheResult   m_RemoteCacheResult = REMOTE_CACHE_NONE;
+    uint64_t            m_RemoteSourceHash  = 0; // On server, hash of the received (decompressed) job data, to check the cache key
     uint16_t            m_RemoteThreadIndex = 0; // On server, the thread index used to build
     AString             m_RemoteName;
     AString             m_RemoteSourceRoot;
@@ -9,6 +9,7 @@
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Cache/CachePrefetcher.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
@@ -65,6 +66,13 @@ void JobSubQueue::QueueJobs( Array< Node * > & nodes )
         jobs.Append( job );
     }
 
+    QueueJobs( jobs );
+}
+
+// JobSubQueue:QueueJobs
+//------------------------------------------------------------------------------
+void JobSubQueue::QueueJobs( Array< Job * > & jobs )
+{
     // Sort Jobs by cost
     JobCostSorter sorter;
     jobs.Sort( sorter );
@@ -117,6 +125,7 @@ Job * JobSubQueue::RemoveJob()
 JobQueue::JobQueue( uint32_t numWorkerThreads ) :
     m_NumLocalJobsActive( 0 ),
     m_DistributableJobs_Available( 1024, true ),
+    m_DistributableJobs_First( 0 ),
     m_DistributableJobs_InProgress( 1024, true ),
     #if defined( __WINDOWS__ )
         m_MainThreadSemaphore( 1 ), // On Windows, take advantage of signalling limit
@@ -173,11 +182,12 @@ JobQueue::~JobQueue()
         // we may have some distributable jobs that could not be built,
         // so delete them here before checking mem usage below
         const size_t numJobsAvailable = m_DistributableJobs_Available.GetSize();
-        for ( size_t i=0; i<numJobsAvailable; ++i )
+        for ( size_t i=m_DistributableJobs_First; i<numJobsAvailable; ++i )
         {
             FDELETE m_DistributableJobs_Available[ i ];
         }
         m_DistributableJobs_Available.Clear();
+        m_DistributableJobs_First = 0;
     }
 
     ASSERT( m_CompletedJobs.IsEmpty() );
@@ -220,7 +230,7 @@ bool JobQueue::HaveWorkersStopped() const
 size_t JobQueue::GetNumDistributableJobsAvailable() const
 {
     MutexHolder m( m_DistributedJobsMutex );
-    return m_DistributableJobs_Available.GetSize();
+    return ( m_DistributableJobs_Available.GetSize() - m_DistributableJobs_First );
 }
 
 // GetJobStats
@@ -233,7 +243,12 @@ void JobQueue::GetJobStats( uint32_t & numJobs,
     MutexHolder m( m_DistributedJobsMutex );
 
     numJobs = m_LocalJobs_Available.GetCount();
-    numJobsDist = (uint32_t)m_DistributableJobs_Available.GetSize();
+    const CachePrefetcher * prefetcher = FBuild::Get().GetCachePrefetcher();
+    if ( prefetcher )
+    {
+        numJobs += prefetcher->GetNumPending(); // Jobs not yet available, but not in progress either
+    }
+    numJobsDist = (uint32_t)( m_DistributableJobs_Available.GetSize() - m_DistributableJobs_First );
     numJobsActive = AtomicLoadRelaxed( &m_NumLocalJobsActive );
     numJobsDistActive = (uint32_t)m_DistributableJobs_InProgress.GetSize();
 }
@@ -259,12 +274,65 @@ void JobQueue::FlushJobBatch()
         return;
     }
 
+    // Divert jobs which might be retrieved from the cache to be prefetched
+    CachePrefetcher * prefetcher = FBuild::Get().GetCachePrefetcher();
+    if ( prefetcher )
+    {
+        Array< Job * > prefetchJobs( m_LocalJobs_Staging.GetSize() );
+        size_t numRemaining = 0;
+        for ( Node * node : m_LocalJobs_Staging )
+        {
+            if ( ( node->GetType() == Node::OBJECT_NODE ) &&
+                 node->CastTo< ObjectNode >()->ShouldPrefetchFromCache() )
+            {
+                prefetchJobs.Append( FNEW( Job( node ) ) );
+                continue;
+            }
+            m_LocalJobs_Staging[ numRemaining++ ] = node;
+        }
+        m_LocalJobs_Staging.SetSize( numRemaining );
+        prefetcher->Enqueue( prefetchJobs );
+
+        if ( m_LocalJobs_Staging.IsEmpty() )
+        {
+            return;
+        }
+    }
+
     // Make the jobs available
     m_LocalJobs_Available.QueueJobs( m_LocalJobs_Staging );
     m_WorkerThreadSemaphore.Signal( (uint32_t)m_LocalJobs_Staging.GetSize() );
     m_LocalJobs_Staging.Clear();
 }
 
+// FinishedPrefetchingJob (Cache Prefetch Thread)
+//------------------------------------------------------------------------------
+void JobQueue::FinishedPrefetchingJob( Job * job )
+{
+    ASSERT( job->GetNode()->GetState() == Node::BUILDING );
+
+    if ( job->GetCachePrefetchResult() == Job::CACHE_PREFETCH_HIT )
+    {
+        // Output has already been restored, so complete the job here
+        // without occupying a worker thread
+        AtomicIncU32( &m_NumLocalJobsActive );
+        const Node::BuildResult result = DoBuild( job );
+        if ( result == Node::NODE_RESULT_FAILED )
+        {
+            FBuild::OnBuildError();
+        }
+        FinishedProcessingJob( job, ( result != Node::NODE_RESULT_FAILED ), false );
+        return;
+    }
+
+    // Make the job available
+    Array< Job * > jobs( 1 );
+    jobs.Append( job );
+    m_LocalJobs_Available.QueueJobs( jobs );
+    m_WorkerThreadSemaphore.Signal();
+    WakeMainThread(); // Main thread may be building jobs itself (-j0)
+}
+
 // QueueDistributableJob
 //------------------------------------------------------------------------------
 void JobQueue::QueueDistributableJob( Job * job )
@@ -275,6 +343,18 @@ void JobQueue::QueueDistributableJob( Job * job )
     {
         MutexHolder m( m_DistributedJobsMutex );
 
+        // Discard jobs taken from the start, now that we have to sort anyway
+        if ( m_DistributableJobs_First > 0 )
+        {
+            const size_t numJobs = ( m_DistributableJobs_Available.GetSize() - m_DistributableJobs_First );
+            for ( size_t i = 0; i < numJobs; ++i )
+            {
+                m_DistributableJobs_Available[ i ] = m_DistributableJobs_Available[ m_DistributableJobs_First + i ];
+            }
+            m_DistributableJobs_Available.SetSize( numJobs );
+            m_DistributableJobs_First = 0;
+        }
+
         m_DistributableJobs_Available.Append( job );
 
         // Jobs that have been preprocsssed and are ready to be distributed are
@@ -296,19 +376,34 @@ void JobQueue::QueueDistributableJob( Job * job )
 
 // GetDistributableJobToProcess
 //------------------------------------------------------------------------------
-Job * JobQueue::GetDistributableJobToProcess( bool remote )
+Job * JobQueue::GetDistributableJobToProcess( bool remote, bool cheapest )
 {
     MutexHolder m( m_DistributedJobsMutex );
 
-    if ( m_DistributableJobs_Available.IsEmpty() )
+    if ( m_DistributableJobs_Available.GetSize() == m_DistributableJobs_First )
     {
         return nullptr;
     }
 
     // Jobs are sorted from least to most expensive, so we consume
-    // from the end of the list.
-    Job * job = m_DistributableJobs_Available.Top();
-    m_DistributableJobs_Available.Pop();
+    // from the end of the list. (Slow workers are given the cheapest
+    // jobs instead, leaving expensive ones for faster workers)
+    Job * job;
+    if ( cheapest )
+    {
+        job = m_DistributableJobs_Available[ m_DistributableJobs_First ];
+        ++m_DistributableJobs_First; // Avoid shuffling the remaining jobs
+    }
+    else
+    {
+        job = m_DistributableJobs_Available.Top();
+        m_DistributableJobs_Available.Pop();
+    }
+    if ( m_DistributableJobs_Available.GetSize() == m_DistributableJobs_First )
+    {
+        m_DistributableJobs_Available.Clear();
+        m_DistributableJobs_First = 0;
+    }
 
     ASSERT( job->GetDistributionState() == Job::DIST_AVAILABLE );
 
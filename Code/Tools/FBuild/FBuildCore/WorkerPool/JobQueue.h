@@ -31,6 +31,9 @@ public:
     // jobs pushed by the main thread
     void QueueJobs( Array< Node * > & nodes );
 
+    // jobs pushed by the main thread or the CachePrefetcher
+    void QueueJobs( Array< Job * > & jobs );
+
     // jobs consumed by workers
     Job * RemoveJob();
 private:
@@ -75,11 +78,16 @@ private:
     static Node::BuildResult DoBuild( Job * job );
     void        FinishedProcessingJob( Job * job, bool result, bool wasARemoteJob );
 
+    // cache prefetch threads return jobs via this interface
+    friend class CachePrefetcher;
+    void        FinishedPrefetchingJob( Job * job );
+
     void        QueueDistributableJob( Job * job );
 
     // client side of protocol consumes jobs via this interface
     friend class Client;
-    Job *       GetDistributableJobToProcess( bool remote );
+    friend class TestDistributed;
+    Job *       GetDistributableJobToProcess( bool remote, bool cheapest = false );
     Job *       OnReturnRemoteJob( uint32_t jobId );
     void        ReturnUnfinishedDistributableJob( Job * job );
 
@@ -95,7 +103,8 @@ private:
 
     // Jobs available for distributed processing (can also be done locally)
     mutable Mutex       m_DistributedJobsMutex;
-    Array< Job * >      m_DistributableJobs_Available;  // Available, not in progress anywhere
+    Array< Job * >      m_DistributableJobs_Available;  // Available, not in progress anywhere (from m_DistributableJobs_First)
+    size_t              m_DistributableJobs_First;      // Jobs before this have been taken (cheapest first)
     Array< Job * >      m_DistributableJobs_InProgress; // In progress remotely, locally or both
 
     // Semaphore to manage thread idle
@@ -9,10 +9,13 @@
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
 
 // Core
 #include "Core/Env/ErrorFormat.h"
@@ -25,11 +28,13 @@
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-JobQueueRemote::JobQueueRemote( uint32_t numWorkerThreads ) :
+JobQueueRemote::JobQueueRemote( uint32_t numWorkerThreads, ICache * cache, bool cacheWrite ) :
     m_PendingJobs( 1024, true ),
     m_CompletedJobs( 1024, true ),
     m_CompletedJobsFailed( 1024, true ),
-    m_Workers( numWorkerThreads, false )
+    m_Workers( numWorkerThreads, false ),
+    m_Cache( cache ),
+    m_CacheWrite( cacheWrite )
 {
     WorkerThread::InitTmpDir( true ); // remote == true
 
@@ -99,6 +104,22 @@ void JobQueueRemote::GetWorkerStatus( size_t index, AString & hostName, AString
     ( (WorkerThreadRemote *)m_Workers[ index ] )->GetStatus( hostName, status, isIdle );
 }
 
+// GetNumJobsInProgress
+//------------------------------------------------------------------------------
+uint32_t JobQueueRemote::GetNumJobsInProgress() const
+{
+    size_t numJobs = 0;
+    {
+        MutexHolder mh( m_PendingJobsMutex );
+        numJobs += m_PendingJobs.GetSize();
+    }
+    {
+        MutexHolder mh( m_InFlightJobsMutex );
+        numJobs += m_InFlightJobs.GetSize();
+    }
+    return (uint32_t)numJobs;
+}
+
 // MainThreadWait
 //------------------------------------------------------------------------------
 void JobQueueRemote::MainThreadWait( uint32_t timeoutMS )
@@ -304,6 +325,16 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
         node->ReplaceDummyName( tmpFileName );
 
         //DEBUGSPAM( "REMOTE: %s (%s)\n", fileName, job->GetRemoteName().Get() );
+
+        // the result may already be in the cache
+        if ( JobQueueRemote::Get().RetrieveFromCache( job ) )
+        {
+            const uint32_t timeTakenMS = uint32_t( timer.GetElapsedMS() );
+            node->SetLastBuildTime( timeTakenMS );
+            node->SetStatFlag( Node::STATS_CACHE_HIT );
+            node->AddProcessingTime( timeTakenMS );
+            return Node::NODE_RESULT_OK;
+        }
     }
 
     ASSERT( node->IsAFile() );
@@ -371,6 +402,10 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
             {
                 result = Node::NODE_RESULT_FAILED;
             }
+            else
+            {
+                JobQueueRemote::Get().WriteToCache( job );
+            }
         }
     }
 
@@ -455,4 +490,114 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
     return true;
 }
 
+// CanUseCache
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueueRemote::CanUseCache( const Job * job )
+{
+    // Cache entries must contain the same files as the results sent to the
+    // client (see ReadResults and ObjectNode::GetExtraCacheFilePaths)
+    const ObjectNode * node = job->GetNode()->CastTo< ObjectNode >();
+    return ( job->GetCacheName().IsEmpty() == false ) &&
+           ( node->IsUsingPDB() == false ) &&
+           ( node->IsCreatingPCH() == false );
+}
+
+// IsCacheKeyValid
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueueRemote::IsCacheKeyValid( const Job * job )
+{
+    uint64_t preprocessedSourceKey;
+    uint32_t commandLineKey;
+    uint64_t toolChainKey;
+    uint64_t pchKey;
+    if ( ICache::ParseCacheId( job->GetCacheName(), preprocessedSourceKey, commandLineKey, toolChainKey, pchKey ) == false )
+    {
+        return false;
+    }
+
+    // Toolchain must be the one the job was built with
+    const ToolManifest * manifest = job->GetToolManifest();
+    if ( ( manifest == nullptr ) || ( toolChainKey != manifest->GetToolId() ) )
+    {
+        return false;
+    }
+
+    // Source must be the preprocessed source which was received
+    return ( ( job->GetRemoteSourceHash() != 0 ) &&
+             ( preprocessedSourceKey == job->GetRemoteSourceHash() ) );
+}
+
+// RetrieveFromCache
+//------------------------------------------------------------------------------
+bool JobQueueRemote::RetrieveFromCache( Job * job )
+{
+    if ( ( m_Cache == nullptr ) ||
+         ( ( job->GetRemoteCacheAccess() & Job::REMOTE_CACHE_ACCESS_READ ) == 0 ) ||
+         ( CanUseCache( job ) == false ) )
+    {
+        return false;
+    }
+
+    PROFILE_FUNCTION;
+
+    void * cacheData = nullptr;
+    size_t cacheDataSize = 0;
+    if ( m_Cache->Retrieve( job->GetCacheName(), cacheData, cacheDataSize ) == false )
+    {
+        return false;
+    }
+
+    // Results are sent uncompressed, as if read after compiling
+    Compressor c;
+    const bool valid = c.IsValidData( cacheData, cacheDataSize ) && c.Decompress( cacheData );
+    m_Cache->FreeMemory( cacheData, cacheDataSize );
+    if ( valid == false )
+    {
+        FLOG_WARN( "Cache returned invalid data\n"
+                   " - File: '%s'\n"
+                   " - Key : %s\n",
+                   job->GetRemoteName().Get(), job->GetCacheName().Get() );
+        return false;
+    }
+
+    const size_t dataSize = c.GetResultSize();
+    job->OwnData( c.ReleaseResult(), dataSize );
+    job->SetRemoteCacheResult( Job::REMOTE_CACHE_HIT );
+    return true;
+}
+
+// WriteToCache
+//------------------------------------------------------------------------------
+void JobQueueRemote::WriteToCache( Job * job )
+{
+    if ( ( m_Cache == nullptr ) ||
+         ( m_CacheWrite == false ) ||
+         ( ( job->GetRemoteCacheAccess() & Job::REMOTE_CACHE_ACCESS_WRITE ) == 0 ) ||
+         ( CanUseCache( job ) == false ) )
+    {
+        return;
+    }
+
+    PROFILE_FUNCTION;
+
+    // The key comes from the client, so check it matches what was built before
+    // publishing. Keys which can't be checked (i.e. LightCache keys) are refused.
+    if ( IsCacheKeyValid( job ) == false )
+    {
+        FLOG_WARN( "Cache key doesn't match job, not publishing\n"
+                   " - File: '%s'\n"
+                   " - Key : %s\n",
+                   job->GetRemoteName().Get(), job->GetCacheName().Get() );
+        return;
+    }
+
+    Compressor c;
+    c.CompressChunked( job->GetData(), job->GetDataSize(), job->GetRemoteCacheCompressionLevel(), m_Cache->GetCompressionDictionary() );
+    if ( m_Cache->Publish( job->GetCacheName(), c.GetResult(), c.GetResultSize() ) )
+    {
+        // The client doesn't need to publish the result itself
+        job->SetRemoteCacheResult( Job::REMOTE_CACHE_STORE );
+    }
+}
+
 //------------------------------------------------------------------------------
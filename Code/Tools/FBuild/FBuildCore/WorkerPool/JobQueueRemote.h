@@ -13,6 +13,7 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class ICache;
 class Node;
 class Job;
 class WorkerThread;
@@ -22,7 +23,7 @@ class WorkerThread;
 class JobQueueRemote : public Singleton< JobQueueRemote >
 {
 public:
-    explicit JobQueueRemote( uint32_t numWorkerThreads );
+    explicit JobQueueRemote( uint32_t numWorkerThreads, ICache * cache = nullptr, bool cacheWrite = false );
     ~JobQueueRemote();
 
     // main thread calls these
@@ -35,6 +36,7 @@ public:
     bool HaveWorkersStopped() const;
 
     inline size_t GetNumWorkers() const { return m_Workers.GetSize(); }
+    uint32_t      GetNumJobsInProgress() const; // queued or being built
     void          GetWorkerStatus( size_t index, AString & hostName, AString & status, bool & isIdle ) const;
 
     void MainThreadWait( uint32_t timeoutMS );
@@ -54,6 +56,10 @@ private:
 
     // internal helpers
     static bool ReadResults( Job * job );
+    static bool CanUseCache( const Job * job );
+    static bool IsCacheKeyValid( const Job * job );
+    bool        RetrieveFromCache( Job * job );
+    void        WriteToCache( Job * job );
 
     mutable Mutex       m_PendingJobsMutex;
     Array< Job * >      m_PendingJobs;
@@ -68,6 +74,9 @@ private:
     Semaphore           m_WorkerThreadSleepSemaphore;
 
     Array< WorkerThread * > m_Workers;
+
+    ICache *            m_Cache;    // Shared cache, used for jobs whose client allows it (optional)
+    bool                m_CacheWrite;   // Publish results for jobs whose client allows it
 };
 
 //------------------------------------------------------------------------------
@@ -8,6 +8,7 @@
 #include "Tools/FBuild/FBuildWorker/Worker/WorkerSettings.h"
 
 // FBuild
+#include "Tools/FBuild/FBuildCore/Protocol/CoordinatorConnection.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/FBuildVersion.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
@@ -18,6 +19,7 @@
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Mem/Mem.h"
 #include "Core/Network/Network.h"
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Profile/Profile.h"
@@ -25,6 +27,9 @@
 #include "Core/Process/Thread.h"
 #include "Core/Time/Time.h"
 
+// system
+#include <stdio.h>
+
 // Constants
 //------------------------------------------------------------------------------
 static const float sBrokerageElapsedTimeBetweenClean = ( 12 * 60 * 60.0f );
@@ -35,7 +40,9 @@ static const float sBrokerageIPAddressUpdateTime = ( 5 * 60.0f );
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 WorkerBrokerage::WorkerBrokerage()
-    : m_Availability( false )
+    : m_Coordinator( nullptr )
+    , m_WorkersFromCoordinator( false )
+    , m_Availability( false )
     , m_BrokerageInitialized( false )
     , m_SettingsWriteTime( 0 )
 {
@@ -52,9 +59,6 @@ void WorkerBrokerage::InitBrokerage()
         return;
     }
 
-    // brokerage path includes version to reduce unnecessary comms attempts
-    uint32_t protocolVersion = Protocol::PROTOCOL_VERSION;
-
     // root folder
     AStackString<> brokeragePath;
     if ( Env::GetEnvVariable( "FASTBUILD_BROKERAGE_PATH", brokeragePath ) )
@@ -80,14 +84,19 @@ void WorkerBrokerage::InitBrokerage()
             }
             root.TrimStart( ' ' );
             root.TrimEnd( ' ' );
-            // <path>/<group>/<version>/
-            #if defined( __WINDOWS__ )
-                brokerageRoot.Format( "%s\\main\\%u.windows\\", root.Get(), protocolVersion );
-            #elif defined( __OSX__ )
-                brokerageRoot.Format( "%s/main/%u.osx/", root.Get(), protocolVersion );
-            #else
-                brokerageRoot.Format( "%s/main/%u.linux/", root.Get(), protocolVersion );
-            #endif
+
+            // brokerage path includes version to reduce unnecessary comms attempts
+            // (workers register under each client version they accept, so clients
+            // only look under their own)
+            if ( m_BrokerageRoots.IsEmpty() )
+            {
+                for ( uint32_t version = Protocol::PROTOCOL_VERSION_MINIMUM; version <= Protocol::PROTOCOL_VERSION; ++version )
+                {
+                    GetBrokerageRoot( root, version, brokerageRoot );
+                    m_RegistrationRoots.Append( brokerageRoot );
+                }
+            }
+            GetBrokerageRoot( root, Protocol::PROTOCOL_VERSION, brokerageRoot );
 
             m_BrokerageRoots.Append( brokerageRoot );
             if ( !m_BrokerageRootPaths.IsEmpty() )
@@ -108,9 +117,39 @@ void WorkerBrokerage::InitBrokerage()
         }
     }
 
+    // optional coordinator, tracking workers instead of (or as well as) the brokerage path
+    AStackString<> coordinatorAddress;
+    if ( Env::GetEnvVariable( "FASTBUILD_COORDINATOR", coordinatorAddress ) )
+    {
+        coordinatorAddress.TrimStart( ' ' );
+        coordinatorAddress.TrimEnd( ' ' );
+        if ( coordinatorAddress.IsEmpty() == false )
+        {
+            // host[:port]
+            AStackString<> host( coordinatorAddress );
+            uint16_t port = Protocol::COORDINATOR_PORT;
+            const char * colon = coordinatorAddress.Find( ':' );
+            if ( colon )
+            {
+                host.Assign( coordinatorAddress.Get(), colon );
+                uint32_t p = 0;
+                PRAGMA_DISABLE_PUSH_MSVC( 4996 ) // This function or variable may be unsafe...
+                PRAGMA_DISABLE_PUSH_CLANG_WINDOWS( "-Wdeprecated-declarations" ) // 'sscanf' is deprecated: This function or variable may be unsafe...
+                if ( ( sscanf( colon + 1, "%u", &p ) == 1 ) && ( p > 0 ) && ( p <= 0xFFFF ) ) // TODO:C consider sscanf_s
+                PRAGMA_DISABLE_POP_CLANG_WINDOWS // -Wdeprecated-declarations
+                PRAGMA_DISABLE_POP_MSVC // 4996
+                {
+                    port = (uint16_t)p;
+                }
+            }
+            m_CoordinatorAddress = coordinatorAddress;
+            m_Coordinator = FNEW( CoordinatorConnection( host, port ) );
+        }
+    }
+
     Network::GetHostName( m_HostName );
 
-    UpdateBrokerageFilePath();
+    UpdateBrokerageFilePaths();
 
     m_TimerLastUpdate.Start();
     m_TimerLastIPUpdate.Start();
@@ -119,6 +158,20 @@ void WorkerBrokerage::InitBrokerage()
     m_BrokerageInitialized = true;
 }
 
+// GetBrokerageRoot
+//------------------------------------------------------------------------------
+/*static*/ void WorkerBrokerage::GetBrokerageRoot( const AString & root, uint32_t protocolVersion, AString & outBrokerageRoot )
+{
+    // <path>/<group>/<version>/
+    #if defined( __WINDOWS__ )
+        outBrokerageRoot.Format( "%s\\main\\%u.windows\\", root.Get(), protocolVersion );
+    #elif defined( __OSX__ )
+        outBrokerageRoot.Format( "%s/main/%u.osx/", root.Get(), protocolVersion );
+    #else
+        outBrokerageRoot.Format( "%s/main/%u.linux/", root.Get(), protocolVersion );
+    #endif
+}
+
 // DESTRUCTOR
 //------------------------------------------------------------------------------
 WorkerBrokerage::~WorkerBrokerage()
@@ -126,8 +179,10 @@ WorkerBrokerage::~WorkerBrokerage()
     // Ensure the file disappears when closing
     if ( m_Availability )
     {
-        FileIO::FileDelete( m_BrokerageFilePath.Get() );
+        DeleteBrokerageFiles();
     }
+
+    FDELETE m_Coordinator;
 }
 
 // FindWorkers
@@ -153,9 +208,19 @@ void WorkerBrokerage::FindWorkers( Array< AString > & workerList )
 
     // Init the brokerage
     InitBrokerage();
+
+    // Prefer the coordinator, falling back to the brokerage path if unavailable
+    if ( m_Coordinator && FindWorkersFromCoordinator( workerList ) )
+    {
+        return;
+    }
+
     if ( m_BrokerageRoots.IsEmpty() )
     {
-        FLOG_WARN( "No brokerage root; did you set FASTBUILD_BROKERAGE_PATH?" );
+        if ( m_Coordinator == nullptr )
+        {
+            FLOG_WARN( "No brokerage root; did you set FASTBUILD_BROKERAGE_PATH?" );
+        }
         return;
     }
 
@@ -196,13 +261,40 @@ void WorkerBrokerage::FindWorkers( Array< AString > & workerList )
     }
 }
 
+// FindWorkersFromCoordinator
+//------------------------------------------------------------------------------
+bool WorkerBrokerage::FindWorkersFromCoordinator( Array< AString > & workerList )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( m_Coordinator );
+    Array< AString > workers;
+    if ( m_Coordinator->RequestWorkers( m_HostName, workers ) == false )
+    {
+        FLOG_WARN( "Coordinator '%s' unavailable", m_CoordinatorAddress.Get() );
+        return false;
+    }
+
+    FLOG_WARN( "%zu workers found from coordinator '%s'", workers.GetSize(), m_CoordinatorAddress.Get() );
+    workerList.Append( workers );
+    m_WorkersFromCoordinator = true;
+    return true;
+}
+
 // SetAvailability
 //------------------------------------------------------------------------------
-void WorkerBrokerage::SetAvailability( bool available )
+void WorkerBrokerage::SetAvailability( bool available, uint32_t numCPUs, uint32_t numJobsInProgress )
 {
     // Init the brokerage if not already
     InitBrokerage();
 
+    // keep the coordinator up to date with capacity and load
+    // (it decides how often to actually send updates)
+    if ( m_Coordinator )
+    {
+        m_Coordinator->UpdateStatus( m_HostName, m_IPAddress, available ? numCPUs : 0, numJobsInProgress );
+    }
+
     // ignore if brokerage not configured
     if ( m_BrokerageRoots.IsEmpty() )
     {
@@ -245,11 +337,11 @@ void WorkerBrokerage::SetAvailability( bool available )
                     m_DomainName = domainName;
                     m_IPAddress = ipAddress;
 
-                    // Remove existing brokerage file, as filename is being updated
-                    FileIO::FileDelete( m_BrokerageFilePath.Get() );
+                    // Remove existing brokerage files, as filename is being updated
+                    DeleteBrokerageFiles();
 
-                    // Update brokerage path
-                    UpdateBrokerageFilePath();
+                    // Update brokerage paths
+                    UpdateBrokerageFilePaths();
 
                     // Host name, domain name, or IP address changed - create the file
                     createBrokerageFile = true;
@@ -263,10 +355,13 @@ void WorkerBrokerage::SetAvailability( bool available )
             {
                 // Update the modified time
                 // (Allows an external process to delete orphaned files (from crashes/terminated workers)
-                if ( FileIO::SetFileLastWriteTimeToNow( m_BrokerageFilePath ) == false )
+                for ( const AString & brokerageFilePath : m_BrokerageFilePaths )
                 {
-                    // Failed to update time - try to create or recreate the file
-                    createBrokerageFile = true;
+                    if ( FileIO::SetFileLastWriteTimeToNow( brokerageFilePath ) == false )
+                    {
+                        // Failed to update time - try to create or recreate the files
+                        createBrokerageFile = true;
+                    }
                 }
             }
 
@@ -312,13 +407,23 @@ void WorkerBrokerage::SetAvailability( bool available )
                     case WorkerSettings::PROPORTIONAL:  buffer += "Mode: proportional\n"; break;
                 }
 
-                // Create/write file which signifies availability
-                FileIO::EnsurePathExists( m_BrokerageRoots[0] );
-                FileStream fs;
-                if ( fs.Open( m_BrokerageFilePath.Get(), FileStream::WRITE_ONLY ) )
+                // Create/write files which signify availability
+                bool filesWritten = true;
+                for ( size_t i = 0; i < m_BrokerageFilePaths.GetSize(); ++i )
+                {
+                    FileIO::EnsurePathExists( m_RegistrationRoots[ i ] );
+                    FileStream fs;
+                    if ( fs.Open( m_BrokerageFilePaths[ i ].Get(), FileStream::WRITE_ONLY ) )
+                    {
+                        fs.WriteBuffer( buffer.Get(), buffer.GetLength() );
+                    }
+                    else
+                    {
+                        filesWritten = false;
+                    }
+                }
+                if ( filesWritten )
                 {
-                    fs.WriteBuffer( buffer.Get(), buffer.GetLength() );
-
                     // Take note of time we wrote the settings
                     m_SettingsWriteTime = settingsWriteTime;
                 }
@@ -330,8 +435,8 @@ void WorkerBrokerage::SetAvailability( bool available )
     }
     else if ( m_Availability != available )
     {
-        // remove file to remove availability
-        FileIO::FileDelete( m_BrokerageFilePath.Get() );
+        // remove files to remove availability
+        DeleteBrokerageFiles();
 
         // Restart the timer
         m_TimerLastUpdate.Start();
@@ -344,12 +449,15 @@ void WorkerBrokerage::SetAvailability( bool available )
         const uint64_t fileTimeNow = Time::FileTimeToSeconds( Time::GetCurrentFileTime() );
 
         Array< AString > files( 256, true );
-        if ( !FileIO::GetFiles( m_BrokerageRoots[ 0 ],
-                                AStackString<>( "*" ),
-                                false,
-                                &files ) )
+        for ( const AString & root : m_RegistrationRoots )
         {
-            FLOG_WARN( "No workers found in '%s' (or inaccessible)", m_BrokerageRoots[ 0 ].Get() );
+            if ( !FileIO::GetFiles( root,
+                                    AStackString<>( "*" ),
+                                    false,
+                                    &files ) )
+            {
+                FLOG_WARN( "No workers found in '%s' (or inaccessible)", root.Get() );
+            }
         }
 
         for ( const AString & file : files )
@@ -368,20 +476,34 @@ void WorkerBrokerage::SetAvailability( bool available )
 }
 
 //------------------------------------------------------------------------------
-// UpdateBrokerageFilePath
+// UpdateBrokerageFilePaths
 //------------------------------------------------------------------------------
-void WorkerBrokerage::UpdateBrokerageFilePath()
+void WorkerBrokerage::UpdateBrokerageFilePaths()
 {
-    if ( !m_BrokerageRoots.IsEmpty() )
+    m_BrokerageFilePaths.Clear();
+    for ( const AString & root : m_RegistrationRoots )
     {
+        AStackString<> brokerageFilePath;
         if ( !m_IPAddress.IsEmpty() )
         {
-            m_BrokerageFilePath.Format( "%s%s", m_BrokerageRoots[0].Get(), m_IPAddress.Get() );
+            brokerageFilePath.Format( "%s%s", root.Get(), m_IPAddress.Get() );
         }
         else
         {
-            m_BrokerageFilePath.Format( "%s%s", m_BrokerageRoots[0].Get(), m_HostName.Get() );
+            brokerageFilePath.Format( "%s%s", root.Get(), m_HostName.Get() );
         }
+        m_BrokerageFilePaths.Append( brokerageFilePath );
+    }
+}
+
+//------------------------------------------------------------------------------
+// DeleteBrokerageFiles
+//------------------------------------------------------------------------------
+void WorkerBrokerage::DeleteBrokerageFiles() const
+{
+    for ( const AString & brokerageFilePath : m_BrokerageFilePaths )
+    {
+        FileIO::FileDelete( brokerageFilePath.Get() );
     }
 }
 
@@ -9,6 +9,7 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class CoordinatorConnection;
 
 // WorkerBrokerage
 //------------------------------------------------------------------------------
@@ -21,24 +22,33 @@ public:
     inline const Array<AString> & GetBrokerageRoots() const { return m_BrokerageRoots; }
     inline const AString & GetBrokerageRootPaths() const { return m_BrokerageRootPaths; }
     inline const AString & GetHostName() const { return m_HostName; }
+    inline const AString & GetCoordinatorAddress() const { return m_CoordinatorAddress; }
 
     // client interface
     void FindWorkers( Array< AString > & workerList );
+    inline bool AreWorkersFromCoordinator() const { return m_WorkersFromCoordinator; } // Ranked, best first
 
     // server interface
-    void SetAvailability( bool available );
+    void SetAvailability( bool available, uint32_t numCPUs, uint32_t numJobsInProgress );
 private:
     void InitBrokerage();
-    void UpdateBrokerageFilePath();
-
-    Array<AString>      m_BrokerageRoots;
+    static void GetBrokerageRoot( const AString & root, uint32_t protocolVersion, AString & outBrokerageRoot );
+    void UpdateBrokerageFilePaths();
+    void DeleteBrokerageFiles() const;
+    bool FindWorkersFromCoordinator( Array< AString > & workerList );
+
+    Array<AString>      m_BrokerageRoots;       // searched by clients (for their protocol version)
+    Array<AString>      m_RegistrationRoots;    // first root, for each protocol version a worker accepts
+    AString             m_CoordinatorAddress;   // host[:port] (optional, see FASTBUILD_COORDINATOR)
+    CoordinatorConnection * m_Coordinator;
+    bool                m_WorkersFromCoordinator;
     AString             m_BrokerageRootPaths;
     bool                m_Availability;
     bool                m_BrokerageInitialized;
     AString             m_HostName;
     AString             m_DomainName;
     AString             m_IPAddress;
-    AString             m_BrokerageFilePath;
+    Array<AString>      m_BrokerageFilePaths;   // worker's file in each of m_RegistrationRoots
     Timer               m_TimerLastUpdate;      // Throttle network access
     Timer               m_TimerLastIPUpdate;    // Throttle dns access
     uint64_t            m_SettingsWriteTime;    // FileTime of settings time when last changed
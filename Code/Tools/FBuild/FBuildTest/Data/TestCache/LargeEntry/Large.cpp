@@ -0,0 +1,2 @@
+// Generate an object file larger than the cache's compression chunk size
+const char g_LargeData[ 1024 * 1024 ] = { 1, 2, 3, 4 };
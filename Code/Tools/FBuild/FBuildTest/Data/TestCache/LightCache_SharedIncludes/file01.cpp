@@ -0,0 +1,4 @@
+#include "shared1.h"
+#include "shared3.h"
+
+int Function01() { return Shared1(); }
@@ -0,0 +1,4 @@
+#include "shared1.h"
+#include "shared3.h"
+
+int Function03() { return Shared1(); }
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "shared2.h"
+
+inline int Shared1() { return Shared2() + 1; }
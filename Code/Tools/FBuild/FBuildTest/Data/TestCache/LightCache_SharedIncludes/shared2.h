@@ -0,0 +1,5 @@
+#pragma once
+
+#include "shared3.h"
+
+inline int Shared2() { return Shared3() + 2; }
@@ -0,0 +1,3 @@
+#pragma once
+
+inline int Shared3() { return 3; }
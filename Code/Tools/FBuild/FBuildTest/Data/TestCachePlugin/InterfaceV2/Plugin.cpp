@@ -0,0 +1,226 @@
+// Plugin - Test external cache plugin (interface version 2)
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include <stdio.h>
+
+// The FASTBuild DLL Interface
+//------------------------------------------------------------------------------
+#if defined(__WINDOWS__)
+#define CACHEPLUGIN_DLL_EXPORT __declspec(dllexport)
+#elif defined(__LINUX__) || defined(__APPLE__)
+#define CACHEPLUGIN_DLL_EXPORT
+#endif
+
+#include "Tools/FBuild/FBuildCore/Cache/CachePluginInterface.h"
+
+// System
+#include <memory.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Globals
+//------------------------------------------------------------------------------
+CacheOutputFunc gOutputFunction = nullptr;
+char gCachePath[ 1024 ] = { 0 };
+
+// GetEntryPath
+//------------------------------------------------------------------------------
+static void GetEntryPath( const char * cacheId, char * outPath, size_t outPathSize )
+{
+    snprintf( outPath, outPathSize, "%s/%s", gCachePath, cacheId );
+}
+
+// GetEntrySize
+//------------------------------------------------------------------------------
+static unsigned long long GetEntrySize( const char * cacheId )
+{
+    char path[ 1280 ];
+    GetEntryPath( cacheId, path, sizeof( path ) );
+    FILE * f = fopen( path, "rb" );
+    if ( f == nullptr )
+    {
+        return 0;
+    }
+    fseek( f, 0, SEEK_END );
+    const long size = ftell( f );
+    fclose( f );
+    return ( size > 0 ) ? (unsigned long long)size : 0;
+}
+
+// CacheInit
+//------------------------------------------------------------------------------
+extern "C" {
+
+bool STDCALL CacheInitEx( const char * cachePath,
+                          bool /*cacheRead*/,
+                          bool /*cacheWrite*/,
+                          bool /*cacheVerbose*/,
+                          const char * /*userConfig*/,
+                          CacheOutputFunc outputFunc )
+{
+    // DLL Export for Windows
+    #if defined( __WINDOWS__ )
+        #pragma comment(linker, "/EXPORT:" __FUNCTION__"=" __FUNCDNAME__)
+    #endif
+
+    // Store output function
+    gOutputFunction = outputFunc;
+
+    // Entries are stored as files in the cache path
+    snprintf( gCachePath, sizeof( gCachePath ), "%s", cachePath );
+
+    (*gOutputFunction)( "CacheInitEx Called" );
+    return true;
+}
+
+// CacheShutdown
+//------------------------------------------------------------------------------
+void STDCALL CacheShutdown()
+{
+    // DLL Export for Windows
+    #if defined( __WINDOWS__ )
+        #pragma comment(linker, "/EXPORT:" __FUNCTION__"=" __FUNCDNAME__)
+    #endif
+
+    (*gOutputFunction)( "CacheShutdown Called" );
+}
+
+// CacheGetInterfaceVersion
+//------------------------------------------------------------------------------
+unsigned int STDCALL CacheGetInterfaceVersion()
+{
+    // DLL Export for Windows
+    #if defined( __WINDOWS__ )
+        #pragma comment(linker, "/EXPORT:" __FUNCTION__"=" __FUNCDNAME__)
+    #endif
+
+    return CACHE_PLUGIN_INTERFACE_VERSION;
+}
+
+// CachePublish
+//------------------------------------------------------------------------------
+bool STDCALL CachePublish( const char * cacheId, const void * data, unsigned long long dataSize )
+{
+    // DLL Export for Windows
+    #if defined( __WINDOWS__ )
+        #pragma comment(linker, "/EXPORT:" __FUNCTION__"=" __FUNCDNAME__)
+    #endif
+
+    (*gOutputFunction)( "CachePublish Called" );
+
+    char path[ 1280 ];
+    GetEntryPath( cacheId, path, sizeof( path ) );
+    FILE * f = fopen( path, "wb" );
+    if ( f == nullptr )
+    {
+        return false;
+    }
+    const bool ok = ( fwrite( data, 1, (size_t)dataSize, f ) == (size_t)dataSize );
+    fclose( f );
+    return ok;
+}
+
+// CacheQuery
+//------------------------------------------------------------------------------
+bool STDCALL CacheQuery( const char * const * cacheIds, unsigned int numIds, unsigned long long * dataSizes )
+{
+    // DLL Export for Windows
+    #if defined( __WINDOWS__ )
+        #pragma comment(linker, "/EXPORT:" __FUNCTION__"=" __FUNCDNAME__)
+    #endif
+
+    (*gOutputFunction)( "CacheQuery Called" );
+
+    for ( unsigned int i = 0; i < numIds; ++i )
+    {
+        dataSizes[ i ] = GetEntrySize( cacheIds[ i ] );
+    }
+    return true;
+}
+
+// CacheRetrieveInto
+//------------------------------------------------------------------------------
+int STDCALL CacheRetrieveInto( const char * cacheId, void * buffer, unsigned long long bufferSize, unsigned long long & dataSize )
+{
+    // DLL Export for Windows
+    #if defined( __WINDOWS__ )
+        #pragma comment(linker, "/EXPORT:" __FUNCTION__"=" __FUNCDNAME__)
+    #endif
+
+    (*gOutputFunction)( "CacheRetrieveInto Called" );
+
+    dataSize = GetEntrySize( cacheId );
+    if ( dataSize == 0 )
+    {
+        return CACHE_RETRIEVE_NOT_FOUND;
+    }
+    if ( dataSize > bufferSize )
+    {
+        return CACHE_RETRIEVE_BUFFER_TOO_SMALL;
+    }
+
+    char path[ 1280 ];
+    GetEntryPath( cacheId, path, sizeof( path ) );
+    FILE * f = fopen( path, "rb" );
+    if ( f == nullptr )
+    {
+        return CACHE_RETRIEVE_ERROR;
+    }
+    const bool ok = ( fread( buffer, 1, (size_t)dataSize, f ) == (size_t)dataSize );
+    fclose( f );
+    return ok ? CACHE_RETRIEVE_OK : CACHE_RETRIEVE_ERROR;
+}
+
+// CacheRetrieveAsync
+//------------------------------------------------------------------------------
+bool STDCALL CacheRetrieveAsync( const char * cacheId,
+                                 void * buffer,
+                                 unsigned long long bufferSize,
+                                 CacheRetrieveCompleteFunc onComplete,
+                                 void * userData )
+{
+    // DLL Export for Windows
+    #if defined( __WINDOWS__ )
+        #pragma comment(linker, "/EXPORT:" __FUNCTION__"=" __FUNCDNAME__)
+    #endif
+
+    (*gOutputFunction)( "CacheRetrieveAsync Called" );
+
+    // Complete immediately (a remote cache would complete later, from another thread)
+    unsigned long long dataSize = 0;
+    const int result = CacheRetrieveInto( cacheId, buffer, bufferSize, dataSize );
+    (*onComplete)( userData, result, dataSize );
+    return true;
+}
+
+// CacheOutputInfo
+//------------------------------------------------------------------------------
+bool STDCALL CacheOutputInfo( bool /*showProgress*/ )
+{
+    // DLL Export for Windows
+    #if defined( __WINDOWS__ )
+        #pragma comment(linker, "/EXPORT:" __FUNCTION__"=" __FUNCDNAME__)
+    #endif
+
+    (*gOutputFunction)( "CacheOutputInfo Called" );
+    return true; // Success
+}
+
+// CacheTrim
+//------------------------------------------------------------------------------
+bool STDCALL CacheTrim( bool /*showProgress*/, unsigned int /*sizeMiB*/ )
+{
+    // DLL Export for Windows
+    #if defined( __WINDOWS__ )
+        #pragma comment(linker, "/EXPORT:" __FUNCTION__"=" __FUNCDNAME__)
+    #endif
+
+    (*gOutputFunction)( "CacheTrim Called" );
+    return true; // Success
+}
+
+//------------------------------------------------------------------------------
+
+}// extern "C"
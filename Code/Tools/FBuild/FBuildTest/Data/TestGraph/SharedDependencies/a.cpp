@@ -0,0 +1,3 @@
+#include "Common.h"
+
+int Function_a() { return COMMON_VALUE; }
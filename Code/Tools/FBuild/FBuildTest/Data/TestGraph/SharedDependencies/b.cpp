@@ -0,0 +1,3 @@
+#include "Common.h"
+
+int Function_b() { return COMMON_VALUE; }
@@ -0,0 +1,3 @@
+#include "Common.h"
+
+int Function_c() { return COMMON_VALUE; }
@@ -0,0 +1,4 @@
+#include "Common.h"
+#include "Extra.h"
+
+int Function_d() { return COMMON_VALUE + EXTRA_VALUE; }
@@ -0,0 +1,6 @@
+#include "Header.h"
+
+int Function()
+{
+    return VALUE;
+}
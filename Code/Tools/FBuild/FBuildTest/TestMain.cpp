@@ -16,10 +16,12 @@ int main( int, char *[] )
     REGISTER_TESTGROUP( TestBuildAndLinkLibrary )
     REGISTER_TESTGROUP( TestBuildFBuild )
     REGISTER_TESTGROUP( TestCache )
+    REGISTER_TESTGROUP( TestCacheHTTP )
     REGISTER_TESTGROUP( TestCachePlugin )
     REGISTER_TESTGROUP( TestCompilationDatabase )
     REGISTER_TESTGROUP( TestCompiler )
     REGISTER_TESTGROUP( TestCompressor )
+    REGISTER_TESTGROUP( TestCoordinator )
     REGISTER_TESTGROUP( TestCopy )
     REGISTER_TESTGROUP( TestDistributed )
     REGISTER_TESTGROUP( TestDLL )
@@ -39,6 +41,7 @@ int main( int, char *[] )
     REGISTER_TESTGROUP( TestPrecompiledHeaders )
     REGISTER_TESTGROUP( TestProjectGeneration )
     REGISTER_TESTGROUP( TestRemoveDir )
+    REGISTER_TESTGROUP( TestSegmentDeduplicator )
     REGISTER_TESTGROUP( TestTest )
     REGISTER_TESTGROUP( TestTextFile )
     REGISTER_TESTGROUP( TestUnity )
@@ -7,14 +7,26 @@
 
 // FBuild
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
+#include "Tools/FBuild/FBuildCore/Cache/LightCache.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 
 // Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 
+// system
+#include <string.h>
+
 // TestCache
 //------------------------------------------------------------------------------
 class TestCache : public FBuildTest
@@ -26,6 +38,18 @@ private:
     void Read() const;
     void ReadWrite() const;
     void ConsistentCacheKeysWithDist() const;
+    void WorkerCache() const;
+    void LargeEntry() const;
+    void AsyncPublish() const;
+    void TieredCache_Promotion() const;
+    void IndexedTrim() const;
+    void DeduplicatedStorage() const;
+    void CompressionDictionary() const;
+    void Summary() const;
+
+    // Helpers
+    void DeleteFilesInDir( const char * path ) const;
+    size_t CountFilesInDir( const char * path ) const;
 
     void LightCache_IncludeUsingMacro() const;
     void LightCache_IncludeUsingMacro2() const;
@@ -36,6 +60,8 @@ private:
     void LightCache_IncludeHierarchy() const;
     void LightCache_CyclicInclude() const;
     void LightCache_ImportDirective() const;
+    void LightCache_Prefetch() const;
+    void LightCache_SharedIncludes() const;
 
     // MSVC Static Analysis tests
     const char* const mAnalyzeMSVCBFFPath = "Tools/FBuild/FBuildTest/Data/TestCache/Analyze_MSVC/fbuild.bff";
@@ -63,6 +89,15 @@ REGISTER_TESTS_BEGIN( TestCache )
     REGISTER_TEST( Read )
     REGISTER_TEST( ReadWrite )
     REGISTER_TEST( ConsistentCacheKeysWithDist )
+    REGISTER_TEST( WorkerCache )
+    REGISTER_TEST( LargeEntry )
+    REGISTER_TEST( AsyncPublish )
+    REGISTER_TEST( TieredCache_Promotion )
+    REGISTER_TEST( IndexedTrim )
+    REGISTER_TEST( DeduplicatedStorage )
+    REGISTER_TEST( CompressionDictionary )
+    REGISTER_TEST( Summary )
+    REGISTER_TEST( LightCache_SharedIncludes )
     #if defined( __WINDOWS__ )
         REGISTER_TEST( LightCache_IncludeUsingMacro )
         REGISTER_TEST( LightCache_IncludeUsingMacro2 )
@@ -73,6 +108,7 @@ REGISTER_TESTS_BEGIN( TestCache )
         REGISTER_TEST( LightCache_IncludeHierarchy )
         REGISTER_TEST( LightCache_CyclicInclude )
         REGISTER_TEST( LightCache_ImportDirective )
+        REGISTER_TEST( LightCache_Prefetch )
         REGISTER_TEST( Analyze_MSVC_WarningsOnly_Write )
         REGISTER_TEST( Analyze_MSVC_WarningsOnly_Read )
 
@@ -108,6 +144,15 @@ void TestCache::Write() const
         TEST_ASSERT( objStats.m_NumCacheStores == objStats.m_NumProcessed );
         TEST_ASSERT( objStats.m_NumBuilt == objStats.m_NumProcessed );
 
+        // Ensure cache operations were timed
+        CacheTimings::OperationStats compressStats;
+        CacheTimings::OperationStats publishStats;
+        fBuild.GetStats().m_CacheTimings.GetStats( CacheTimings::COMPRESS, compressStats );
+        fBuild.GetStats().m_CacheTimings.GetStats( CacheTimings::PUBLISH, publishStats );
+        TEST_ASSERT( compressStats.m_Count == objStats.m_NumCacheStores );
+        TEST_ASSERT( publishStats.m_Count == objStats.m_NumCacheStores );
+        TEST_ASSERT( publishStats.m_Bytes > 0 );
+
         numDepsA = fBuild.GetRecursiveDependencyCount( "ObjectList" );
         TEST_ASSERT( numDepsA > 0 );
     }
@@ -167,6 +212,16 @@ void TestCache::Read() const
         TEST_ASSERT( objStats.m_NumCacheHits == objStats.m_NumProcessed );
         TEST_ASSERT( objStats.m_NumBuilt == 0 );
 
+        // Ensure cache operations were timed
+        CacheTimings::OperationStats transferStats;
+        CacheTimings::OperationStats writeStats;
+        fBuild.GetStats().m_CacheTimings.GetStats( CacheTimings::TRANSFER, transferStats );
+        fBuild.GetStats().m_CacheTimings.GetStats( CacheTimings::WRITE, writeStats );
+        TEST_ASSERT( transferStats.m_Count == objStats.m_NumCacheHits );
+        TEST_ASSERT( transferStats.m_Bytes > 0 );
+        TEST_ASSERT( writeStats.m_Count == objStats.m_NumCacheHits );
+        TEST_ASSERT( CacheTimings::GetPercentileMS( transferStats, 50 ) <= CacheTimings::GetPercentileMS( transferStats, 99 ) );
+
         numDepsA = fBuild.GetRecursiveDependencyCount( "ObjectList" );
         TEST_ASSERT( numDepsA > 0 );
     }
@@ -325,6 +380,601 @@ void TestCache::ConsistentCacheKeysWithDist() const
     TEST_ASSERT( storeKey == hitKey );
 }
 
+// WorkerCache
+//------------------------------------------------------------------------------
+void TestCache::WorkerCache() const
+{
+    // The worker uses its own cache, so results can only come from it
+    const char * const workerCachePath = "../tmp/Test/Cache/WorkerCache/WorkerStore/";
+    DeleteFilesInDir( workerCachePath );
+
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/WorkerCache/fbuild.bff";
+
+    // Ensure compilation is performed "remotely", allowing the worker to use the cache
+    options.m_AllowDistributed = true;
+    options.m_DistCache = true;
+    options.m_AllowLocalRace = false;
+    options.m_NoLocalConsumptionOfRemoteJobs = true;
+
+    // Write Only - worker compiles and publishes the result
+    {
+        options.m_UseCacheRead = false;
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        // Initialized after FBuild, which runs single threaded while initializing
+        Cache workerCache;
+        TEST_ASSERT( workerCache.Init( AStackString<>( workerCachePath ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        Server s( 1, &workerCache, true ); // cacheWrite
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        TEST_ASSERT( fBuild.Build( "WorkerCache" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumBuilt == 1 );
+        TEST_ASSERT( objStats.m_NumCacheStores == 1 );
+        TEST_ASSERT( CountFilesInDir( workerCachePath ) > 0 );
+
+        workerCache.Shutdown();
+    }
+
+    // Read Only - client misses (it didn't write), worker retrieves the result
+    {
+        options.m_UseCacheRead = true;
+        options.m_UseCacheWrite = false;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        Cache workerCache;
+        TEST_ASSERT( workerCache.Init( AStackString<>( workerCachePath ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        Server s( 1, &workerCache );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        TEST_ASSERT( fBuild.Build( "WorkerCache" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == 1 );
+        TEST_ASSERT( objStats.m_NumBuilt == 0 );
+
+        workerCache.Shutdown();
+    }
+
+    // Write Only - worker doesn't publish results unless it opts in
+    DeleteFilesInDir( workerCachePath );
+    {
+        options.m_UseCacheRead = false;
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        Cache workerCache;
+        TEST_ASSERT( workerCache.Init( AStackString<>( workerCachePath ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        Server s( 1, &workerCache );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        TEST_ASSERT( fBuild.Build( "WorkerCache" ) );
+
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumBuilt == 1 );
+        TEST_ASSERT( CountFilesInDir( workerCachePath ) == 0 );
+
+        workerCache.Shutdown();
+    }
+
+    // Write Only - worker doesn't publish results under a key which doesn't match the job
+    {
+        options.m_UseCacheRead = false;
+        options.m_UseCacheWrite = true;
+        options.m_DistCacheKeyMismatch_Debug = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        Cache workerCache;
+        TEST_ASSERT( workerCache.Init( AStackString<>( workerCachePath ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        Server s( 1, &workerCache, true ); // cacheWrite
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+        TEST_ASSERT( fBuild.Build( "WorkerCache" ) );
+
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumBuilt == 1 );
+        TEST_ASSERT( CountFilesInDir( workerCachePath ) == 0 );
+
+        workerCache.Shutdown();
+    }
+}
+
+// LargeEntry
+//------------------------------------------------------------------------------
+void TestCache::LargeEntry() const
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/LargeEntry/fbuild.bff";
+
+    // Compile, writing to the cache
+    AString objFileName;
+    UniquePtr< char > objData;
+    size_t objSize = 0;
+    {
+        options.m_UseCacheWrite = true;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "LargeEntry" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 1 );
+
+        // Keep a copy of the object (which should be larger than a compression chunk)
+        Array< const Node * > objectNodes;
+        fBuild.GetNodesOfType( Node::OBJECT_NODE, objectNodes );
+        TEST_ASSERT( objectNodes.GetSize() == 1 );
+        objFileName = objectNodes[ 0 ]->GetName();
+        FileStream fs;
+        TEST_ASSERT( fs.Open( objFileName.Get() ) );
+        objSize = (size_t)fs.GetFileSize();
+        TEST_ASSERT( objSize > ( 512 * 1024 ) );
+        objData = (char *)ALLOC( objSize );
+        TEST_ASSERT( fs.Read( objData.Get(), objSize ) == objSize );
+    }
+
+    // Clean build, reading from the cache
+    {
+        options.m_UseCacheWrite = false;
+        options.m_UseCacheRead = true;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "LargeEntry" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 1 );
+    }
+
+    // Object streamed from the cache should be identical
+    FileStream fs;
+    TEST_ASSERT( fs.Open( objFileName.Get() ) );
+    TEST_ASSERT( fs.GetFileSize() == objSize );
+    UniquePtr< char > restoredData( (char *)ALLOC( objSize ) );
+    TEST_ASSERT( fs.Read( restoredData.Get(), objSize ) == objSize );
+    TEST_ASSERT( memcmp( objData.Get(), restoredData.Get(), objSize ) == 0 );
+}
+
+// AsyncPublish
+//------------------------------------------------------------------------------
+void TestCache::AsyncPublish() const
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_UseCacheWrite = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/LargeEntry/fbuild.bff";
+
+    // Write to the cache on the build thread
+    {
+        options.m_CachePublishThreads = 0;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "LargeEntry" ) );
+
+        const FBuildStats & stats = fBuild.GetStats();
+        TEST_ASSERT( stats.GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 1 );
+        TEST_ASSERT( stats.m_CachePublishCount == 0 );
+    }
+
+    // Write to the cache in the background
+    {
+        options.m_CachePublishThreads = 1;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "LargeEntry" ) );
+
+        // Store is complete (and recorded) once the build returns
+        const FBuildStats & stats = fBuild.GetStats();
+        TEST_ASSERT( stats.GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 1 );
+        TEST_ASSERT( stats.m_CachePublishCount == 1 );
+        TEST_ASSERT( stats.m_CachePublishFailures == 0 );
+        TEST_ASSERT( stats.m_CachePublishBytes > 0 );
+        TEST_ASSERT( stats.m_CachePublishMaxQueueDepth == 1 );
+    }
+
+    // Ensure the entry is usable
+    {
+        options.m_UseCacheWrite = false;
+        options.m_UseCacheRead = true;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "LargeEntry" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 1 );
+    }
+}
+
+// TieredCache_Promotion
+//------------------------------------------------------------------------------
+void TestCache::TieredCache_Promotion() const
+{
+    const char * const localCachePath = "../tmp/Test/Cache/TieredCache/LocalCache";
+    const char * const sharedCachePath = "../tmp/Test/Cache/TieredCache/SharedCache";
+    DeleteFilesInDir( localCachePath );
+    DeleteFilesInDir( sharedCachePath );
+
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/TieredCache/fbuild.bff";
+
+    // Write - stored to both caches
+    {
+        options.m_UseCacheWrite = true;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "TieredCache" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 1 );
+    }
+    TEST_ASSERT( CountFilesInDir( localCachePath ) == 1 );
+    TEST_ASSERT( CountFilesInDir( sharedCachePath ) == 1 );
+
+    // Read from shared cache - promoted to local cache
+    DeleteFilesInDir( localCachePath );
+    options.m_UseCacheWrite = false;
+    options.m_UseCacheRead = true;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "TieredCache" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 1 );
+    }
+    TEST_ASSERT( CountFilesInDir( localCachePath ) == 1 );
+
+    // Read from local cache - shared cache is not needed
+    DeleteFilesInDir( sharedCachePath );
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "TieredCache" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 1 );
+    }
+    TEST_ASSERT( GetRecordedOutput().Find( "Local Hits      : 1" ) );
+}
+
+// IndexedTrim
+//------------------------------------------------------------------------------
+void TestCache::IndexedTrim() const
+{
+    const char * const cachePath = "../tmp/Test/Cache/IndexedTrim/";
+    DeleteFilesInDir( cachePath );
+
+    Cache cache;
+    TEST_ASSERT( cache.Init( AStackString<>( cachePath ), AString::GetEmpty(), true, false, false, AString::GetEmpty() ) );
+
+    // Entries are 1 KiB each
+    char data[ 1024 ];
+    memset( data, 'X', sizeof( data ) );
+    const AStackString<> idA( "AAAA000000000000_A" );
+    const AStackString<> idB( "BBBB000000000000_B" );
+    const AStackString<> idC( "CCCC000000000000_C" );
+    const AStackString<> idD( "DDDD000000000000_D" );
+    const AStackString<> pathA( "../tmp/Test/Cache/IndexedTrim/AA/AA/AAAA000000000000_A.manifest" );
+    const AStackString<> pathB( "../tmp/Test/Cache/IndexedTrim/BB/BB/BBBB000000000000_B.manifest" );
+    const AStackString<> pathC( "../tmp/Test/Cache/IndexedTrim/CC/CC/CCCC000000000000_C.manifest" );
+    const AStackString<> pathD( "../tmp/Test/Cache/IndexedTrim/DD/DD/DDDD000000000000_D" );
+
+    TEST_ASSERT( cache.Publish( idA, data, sizeof( data ) ) );
+    Thread::Sleep( 10 );
+    TEST_ASSERT( cache.Publish( idB, data, sizeof( data ) ) );
+    Thread::Sleep( 10 );
+    TEST_ASSERT( cache.Publish( idC, data, sizeof( data ) ) );
+    Thread::Sleep( 10 );
+
+    // Small entries are stored in their manifest
+    FileIO::FileInfo info;
+    TEST_ASSERT( FileIO::GetFileInfo( pathA, info ) );
+    const uint64_t entrySize = info.m_Size;
+    TEST_ASSERT( entrySize > sizeof( data ) );
+
+    // An entry which is not in the index (published by an older version for example)
+    {
+        TEST_ASSERT( FileIO::EnsurePathExistsForFile( pathD ) );
+        FileStream f;
+        TEST_ASSERT( f.Open( pathD.Get(), FileStream::WRITE_ONLY ) );
+        TEST_ASSERT( f.Write( data, sizeof( data ) ) == sizeof( data ) );
+    }
+    Thread::Sleep( 10 );
+
+    // First trim builds the index by scanning the cache
+    uint32_t numDeleted = 0;
+    const uint64_t totalSize = ( ( 3 * entrySize ) + sizeof( data ) );
+    TEST_ASSERT( cache.TrimToSize( totalSize, numDeleted ) == totalSize );
+    TEST_ASSERT( numDeleted == 0 );
+    TEST_ASSERT( cache.GetTotalSize() == totalSize );
+
+    // Use A, so it is the most recently used entry
+    void * retrievedData = nullptr;
+    size_t retrievedDataSize = 0;
+    TEST_ASSERT( cache.Retrieve( idA, retrievedData, retrievedDataSize ) );
+    TEST_ASSERT( retrievedDataSize == sizeof( data ) );
+    cache.FreeMemory( retrievedData, retrievedDataSize );
+
+    // Least recently used entries are evicted
+    TEST_ASSERT( cache.TrimToSize( entrySize + sizeof( data ), numDeleted ) == ( entrySize + sizeof( data ) ) );
+    TEST_ASSERT( numDeleted == 2 );
+    TEST_ASSERT( FileIO::FileExists( pathA.Get() ) );
+    TEST_ASSERT( FileIO::FileExists( pathB.Get() ) == false );
+    TEST_ASSERT( FileIO::FileExists( pathC.Get() ) == false );
+    TEST_ASSERT( FileIO::FileExists( pathD.Get() ) );
+
+    // Entries deleted without using the cache are removed from the index when trimming
+    TEST_ASSERT( FileIO::FileDelete( pathD.Get() ) );
+    TEST_ASSERT( cache.TrimToSize( 0, numDeleted ) == 0 );
+    TEST_ASSERT( numDeleted == 1 );
+    TEST_ASSERT( FileIO::FileExists( pathA.Get() ) == false );
+
+    cache.Shutdown();
+}
+
+// DeduplicatedStorage
+//------------------------------------------------------------------------------
+void TestCache::DeduplicatedStorage() const
+{
+    const char * const cachePath = "../tmp/Test/Cache/DeduplicatedStorage/";
+    const char * const chunksPath = "../tmp/Test/Cache/DeduplicatedStorage/chunks/";
+    DeleteFilesInDir( cachePath );
+
+    Cache cache;
+    TEST_ASSERT( cache.Init( AStackString<>( cachePath ), AString::GetEmpty(), true, false, false, AString::GetEmpty() ) );
+
+    // Data large enough to be split into several chunks
+    const size_t dataSize = ( 5 * MEGABYTE );
+    UniquePtr< char > data( (char *)ALLOC( dataSize ) );
+    for ( size_t i = 0; i < dataSize; ++i )
+    {
+        data.Get()[ i ] = (char)( ( i * 7 ) + ( i >> 12 ) );
+    }
+    const AStackString<> idA( "AAAA000000000000_A" );
+    const AStackString<> idB( "BBBB000000000000_B" );
+
+    // Identical data published under different keys is stored once
+    TEST_ASSERT( cache.Publish( idA, data.Get(), dataSize ) );
+    Thread::Sleep( 10 );
+    TEST_ASSERT( cache.Publish( idB, data.Get(), dataSize ) );
+    TEST_ASSERT( CountFilesInDir( chunksPath ) == 2 );
+    TEST_ASSERT( CountFilesInDir( cachePath ) == 2 ); // Manifests
+    {
+        void * retrievedData = nullptr;
+        size_t retrievedDataSize = 0;
+        TEST_ASSERT( cache.Retrieve( idB, retrievedData, retrievedDataSize ) );
+        TEST_ASSERT( retrievedDataSize == dataSize );
+        TEST_ASSERT( memcmp( retrievedData, data.Get(), dataSize ) == 0 );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+    }
+
+    // Recently stored chunks are never deleted, so make them old
+    Array< AString > chunkFiles( 2, true );
+    FileIO::GetFiles( AStackString<>( chunksPath ), AStackString<>( "*" ), true, &chunkFiles );
+    for ( const AString & chunkFile : chunkFiles )
+    {
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( chunkFile, 1 ) );
+    }
+
+    // Chunks are kept while any entry references them
+    const uint64_t totalSize = cache.GetTotalSize();
+    TEST_ASSERT( totalSize > dataSize );
+    TEST_ASSERT( totalSize < ( dataSize + KILOBYTE ) );
+    uint32_t numDeleted = 0;
+    TEST_ASSERT( cache.TrimToSize( totalSize - 1, numDeleted ) < totalSize );
+    TEST_ASSERT( numDeleted == 1 );
+    TEST_ASSERT( CountFilesInDir( chunksPath ) == 2 );
+    {
+        void * retrievedData = nullptr;
+        size_t retrievedDataSize = 0;
+        TEST_ASSERT( cache.Retrieve( idA, retrievedData, retrievedDataSize ) == false );
+        TEST_ASSERT( cache.Retrieve( idB, retrievedData, retrievedDataSize ) );
+        TEST_ASSERT( memcmp( retrievedData, data.Get(), dataSize ) == 0 );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+    }
+
+    // Chunks are deleted with the last entry referencing them
+    TEST_ASSERT( cache.TrimToSize( 0, numDeleted ) == 0 );
+    TEST_ASSERT( numDeleted == 1 );
+    TEST_ASSERT( CountFilesInDir( chunksPath ) == 0 );
+
+    cache.Shutdown();
+}
+
+// CompressionDictionary
+//------------------------------------------------------------------------------
+void TestCache::CompressionDictionary() const
+{
+    const char * const cachePath = "../tmp/Test/Cache/CompressionDictionary/";
+    DeleteFilesInDir( cachePath );
+
+    // Some data to populate the cache with
+    FileStream fs;
+    TEST_ASSERT( fs.Open( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii" ) );
+    const size_t fileSize = (size_t)fs.GetFileSize();
+    UniquePtr< char > data( (char *)ALLOC( fileSize ) );
+    TEST_ASSERT( fs.Read( data.Get(), fileSize ) == fileSize );
+    const size_t entrySize = ( 16 * KILOBYTE );
+    const AStackString<> dictionaryEntryId( "DDDD000000000000_D" );
+
+    uint32_t dictionaryId = 0;
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( AStackString<>( cachePath ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.GetCompressionDictionary() == nullptr );
+
+        // Publish compressed entries, as builds do
+        AStackString<> cacheId;
+        for ( size_t offset = 0; ( offset + entrySize ) <= fileSize; offset += entrySize )
+        {
+            Compressor c;
+            c.Compress( data.Get() + offset, entrySize );
+            cacheId.Format( "%08X00000000_E", (uint32_t)offset );
+            TEST_ASSERT( cache.Publish( cacheId, c.GetResult(), c.GetResultSize() ) );
+        }
+
+        // Train a dictionary from the entries
+        TEST_ASSERT( cache.TrainDictionary( false ) );
+        const Compressor::Dictionary * dictionary = cache.GetCompressionDictionary();
+        TEST_ASSERT( dictionary );
+        dictionaryId = dictionary->GetId();
+
+        // Publish an entry compressed with the dictionary
+        Compressor c;
+        TEST_ASSERT( c.Compress( data.Get(), entrySize, -1, dictionary ) );
+        TEST_ASSERT( cache.Publish( dictionaryEntryId, c.GetResult(), c.GetResultSize() ) );
+
+        cache.Shutdown();
+        TEST_ASSERT( Compressor::FindDictionary( dictionaryId ) == nullptr ); // Released by cache
+    }
+
+    // Dictionaries are loaded with the cache, so entries compressed with them can be decompressed
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( AStackString<>( cachePath ), AString::GetEmpty(), true, false, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.GetCompressionDictionary() );
+        TEST_ASSERT( cache.GetCompressionDictionary()->GetId() == dictionaryId );
+
+        void * retrievedData = nullptr;
+        size_t retrievedDataSize = 0;
+        TEST_ASSERT( cache.Retrieve( dictionaryEntryId, retrievedData, retrievedDataSize ) );
+        Compressor d;
+        TEST_ASSERT( d.IsValidData( retrievedData, retrievedDataSize ) );
+        TEST_ASSERT( d.Decompress( retrievedData ) );
+        TEST_ASSERT( d.GetResultSize() == entrySize );
+        TEST_ASSERT( memcmp( d.GetResult(), data.Get(), entrySize ) == 0 );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+
+        cache.Shutdown();
+    }
+}
+
+// Summary
+//------------------------------------------------------------------------------
+void TestCache::Summary() const
+{
+    const char * const cachePath = "../tmp/Test/Cache/Summary/";
+    DeleteFilesInDir( cachePath );
+
+    char data[ 1024 ];
+    memset( data, 'X', sizeof( data ) );
+    const AStackString<> idA( "AAAA000000000000_A" );
+    const AStackString<> idB( "BBBB000000000000_B" );
+    const AStackString<> idC( "CCCC000000000000_C" );
+    const AStackString<> idD( "DDDD000000000000_D" );
+    const AStackString<> pathD( "../tmp/Test/Cache/Summary/DD/DD/DDDD000000000000_D" );
+
+    // Indexing the cache writes the summary
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( AStackString<>( cachePath ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Publish( idA, data, sizeof( data ) ) );
+        uint32_t numDeleted = 0;
+        cache.TrimToSize( (uint64_t)-1, numDeleted );
+        cache.Shutdown();
+    }
+
+    // Entries published after the summary was written
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( AStackString<>( cachePath ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Publish( idB, data, sizeof( data ) ) );
+        cache.Shutdown();
+    }
+
+    // An entry which is not in the index (published by an older version for example)
+    {
+        TEST_ASSERT( FileIO::EnsurePathExistsForFile( pathD ) );
+        FileStream f;
+        TEST_ASSERT( f.Open( pathD.Get(), FileStream::WRITE_ONLY ) );
+        TEST_ASSERT( f.Write( data, sizeof( data ) ) == sizeof( data ) );
+    }
+
+    // With the summary, only entries which may be in the cache are looked up
+    void * retrievedData = nullptr;
+    size_t retrievedDataSize = 0;
+    {
+        Cache cache;
+        cache.SetUseSummary( true );
+        TEST_ASSERT( cache.Init( AStackString<>( cachePath ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Retrieve( idA, retrievedData, retrievedDataSize ) );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+        TEST_ASSERT( cache.Retrieve( idB, retrievedData, retrievedDataSize ) );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+        TEST_ASSERT( cache.Retrieve( idD, retrievedData, retrievedDataSize ) == false );
+
+        // Entries published during the build are found
+        TEST_ASSERT( cache.Retrieve( idC, retrievedData, retrievedDataSize ) == false );
+        TEST_ASSERT( cache.Publish( idC, data, sizeof( data ) ) );
+        TEST_ASSERT( cache.Retrieve( idC, retrievedData, retrievedDataSize ) );
+        TEST_ASSERT( retrievedDataSize == sizeof( data ) );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+        cache.Shutdown();
+    }
+
+    // Without the summary, every entry is looked up
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( AStackString<>( cachePath ), AString::GetEmpty(), true, false, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Retrieve( idD, retrievedData, retrievedDataSize ) );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+        cache.Shutdown();
+    }
+
+    // Re-indexing the cache refreshes the summary
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( AStackString<>( cachePath ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        uint32_t numDeleted = 0;
+        cache.TrimToSize( (uint64_t)-1, numDeleted ); // Replaces the summarized index file
+        TEST_ASSERT( numDeleted == 0 );
+        cache.Shutdown();
+    }
+    {
+        Cache cache;
+        cache.SetUseSummary( true );
+        TEST_ASSERT( cache.Init( AStackString<>( cachePath ), AString::GetEmpty(), true, false, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Retrieve( idC, retrievedData, retrievedDataSize ) );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+        cache.Shutdown();
+    }
+}
+
+// DeleteFilesInDir
+//------------------------------------------------------------------------------
+void TestCache::DeleteFilesInDir( const char * path ) const
+{
+    Array< AString > files( 64, true );
+    FileIO::GetFiles( AStackString<>( path ), AStackString<>( "*" ), true, &files );
+    for ( const AString & file : files )
+    {
+        TEST_ASSERT( FileIO::FileDelete( file.Get() ) );
+    }
+}
+
+// CountFilesInDir
+//------------------------------------------------------------------------------
+size_t TestCache::CountFilesInDir( const char * path ) const
+{
+    Array< AString > files( 64, true );
+    FileIO::GetFiles( AStackString<>( path ), AStackString<>( "*" ), true, &files );
+
+    // Count entries, not the cache index or chunks (unless counting chunks)
+    AStackString<> indexPath;
+    indexPath.Format( "%cindex%c", NATIVE_SLASH, NATIVE_SLASH );
+    AStackString<> chunksPath;
+    chunksPath.Format( "%cchunks%c", NATIVE_SLASH, NATIVE_SLASH );
+    const bool countChunks = ( AStackString<>( path ).Find( "chunks" ) != nullptr );
+    size_t numFiles = 0;
+    for ( const AString & file : files )
+    {
+        const bool isChunk = ( countChunks == false ) && file.Find( chunksPath );
+        numFiles += ( file.Find( indexPath ) || isChunk ) ? 0 : 1;
+    }
+    return numFiles;
+}
+
 // LightCache_IncludeUsingMacro
 //------------------------------------------------------------------------------
 void TestCache::LightCache_IncludeUsingMacro() const
@@ -820,6 +1470,150 @@ void TestCache::LightCache_ImportDirective() const
     TEST_ASSERT( GetRecordedOutput().Find( "#import is unsupported." ) );
 }
 
+// LightCache_Prefetch
+//------------------------------------------------------------------------------
+void TestCache::LightCache_Prefetch() const
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/LightCache_IncludeHierarchy/fbuild.bff";
+
+    const char * expectedFiles[] = { "Folder1/file.cpp", "Folder1/file.h", "Folder2/file.cpp", "Folder2/file.h", "common.h" };
+
+    // Write
+    {
+        options.m_UseCacheWrite = true;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 2 );
+
+        // Nothing is prefetched when not reading from the cache
+        TEST_ASSERT( fBuild.GetStats().m_CachePrefetchLookups == 0 );
+    }
+
+    // Read - objects are retrieved by the prefetcher
+    {
+        options.m_UseCacheRead = true;
+        options.m_UseCacheWrite = false;
+        options.m_CachePrefetchThreads = 2;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats & stats = fBuild.GetStats();
+        TEST_ASSERT( stats.GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 2 );
+        TEST_ASSERT( stats.GetLightCacheCount() == 2 );
+        TEST_ASSERT( stats.m_CachePrefetchLookups == 2 );
+        TEST_ASSERT( stats.m_CachePrefetchHits == 2 );
+        TEST_ASSERT( stats.m_CachePrefetchSkipped == 0 );
+
+        // Dependencies are recorded as for a normal LightCache hit
+        CheckForDependencies( fBuild, expectedFiles, sizeof( expectedFiles ) / sizeof( const char * ) );
+    }
+
+    // Read - prefetching disabled
+    {
+        options.m_CachePrefetchThreads = 0;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats & stats = fBuild.GetStats();
+        TEST_ASSERT( stats.GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 2 );
+        TEST_ASSERT( stats.m_CachePrefetchLookups == 0 );
+    }
+}
+
+// LightCache_SharedIncludes
+//------------------------------------------------------------------------------
+void TestCache::LightCache_SharedIncludes() const
+{
+    // Many threads hash files sharing the same includes (as when building
+    // many objects at once). Each included file should only be parsed once,
+    // with threads looking for a file being parsed waiting for the result.
+    #define NUM_FILES 16
+    #define NUM_THREADS 64
+
+    struct ThreadData
+    {
+        AString     m_Files[ NUM_FILES ];
+        uint32_t    m_StartIndex;
+        uint64_t    m_Hashes[ NUM_FILES ];
+        bool        m_OK;
+
+        static uint32_t HashFiles( void * param )
+        {
+            ThreadData & data = *static_cast< ThreadData * >( param );
+            data.m_OK = true;
+            for ( uint32_t i = 0; i < NUM_FILES; ++i )
+            {
+                // Threads start at different files, so all files are contended
+                const uint32_t index = ( ( data.m_StartIndex + i ) % NUM_FILES );
+                LightCache lc;
+                Array< AString > includes;
+                data.m_OK &= lc.Hash( data.m_Files[ index ], AString::GetEmpty(), data.m_Hashes[ index ], includes );
+            }
+            return 0;
+        }
+    };
+
+    AStackString<> dataPath;
+    TEST_ASSERT( FileIO::GetCurrentDir( dataPath ) );
+    PathUtils::EnsureTrailingSlash( dataPath );
+    dataPath += "Tools/FBuild/FBuildTest/Data/TestCache/LightCache_SharedIncludes/";
+
+    ThreadData * threadData = FNEW_ARRAY( ThreadData[ NUM_THREADS ] );
+    for ( uint32_t t = 0; t < NUM_THREADS; ++t )
+    {
+        for ( uint32_t i = 0; i < NUM_FILES; ++i )
+        {
+            threadData[ t ].m_Files[ i ].Format( "%sfile%02u.cpp", dataPath.Get(), ( i + 1 ) );
+        }
+        threadData[ t ].m_StartIndex = t;
+    }
+
+    // Single threaded, for comparison
+    LightCache::ClearCachedFiles();
+    ThreadData::HashFiles( &threadData[ 0 ] );
+    TEST_ASSERT( threadData[ 0 ].m_OK );
+    const uint32_t numFilesParsed = LightCache::GetNumFilesParsed();
+    TEST_ASSERT( numFilesParsed >= ( NUM_FILES + 3 ) ); // Each file and the 3 shared headers
+    TEST_ASSERT( LightCache::GetNumParseWaits() == 0 );
+
+    // Multi-threaded
+    LightCache::ClearCachedFiles();
+    Thread::ThreadHandle handles[ NUM_THREADS ];
+    for ( uint32_t t = 0; t < NUM_THREADS; ++t )
+    {
+        handles[ t ] = Thread::CreateThread( ThreadData::HashFiles, "LightCache", ( 64 * KILOBYTE ), &threadData[ t ] );
+    }
+    for ( Thread::ThreadHandle h : handles )
+    {
+        Thread::WaitForThread( h );
+        Thread::CloseHandle( h );
+    }
+
+    // Same results, with each file parsed once
+    for ( uint32_t t = 0; t < NUM_THREADS; ++t )
+    {
+        TEST_ASSERT( threadData[ t ].m_OK );
+        for ( uint32_t i = 0; i < NUM_FILES; ++i )
+        {
+            TEST_ASSERT( threadData[ t ].m_Hashes[ i ] == threadData[ 0 ].m_Hashes[ i ] );
+        }
+    }
+    TEST_ASSERT( LightCache::GetNumFilesParsed() == numFilesParsed );
+    OUTPUT( "LightCache: %u files parsed once for %u threads (%u lookups waited for another thread)\n",
+            numFilesParsed, NUM_THREADS, LightCache::GetNumParseWaits() );
+
+    LightCache::ClearCachedFiles();
+    FDELETE_ARRAY threadData;
+
+    #undef NUM_THREADS
+    #undef NUM_FILES
+}
+
 // Analyze_MSVC_WarningsOnly_Write
 //------------------------------------------------------------------------------
 void TestCache::Analyze_MSVC_WarningsOnly_Write() const
@@ -0,0 +1,529 @@
+// TestCacheHTTP.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/HTTPCache.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Containers/UniquePtr.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Network/TCPStream.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+
+// system
+#include <stdlib.h>
+#include <string.h>
+
+// TestHTTPServer
+//  - A minimal in-memory cache server (GET/PUT/HEAD with keep-alive)
+//------------------------------------------------------------------------------
+class TestHTTPServer
+{
+public:
+    explicit TestHTTPServer();
+    ~TestHTTPServer();
+
+    bool Start( uint16_t port );
+
+    uint32_t GetNumConnections() const      { return AtomicLoadRelaxed( &m_NumConnections ); }
+    uint32_t GetNumRequests() const         { return AtomicLoadRelaxed( &m_NumRequests ); }
+    uint32_t GetMaxActiveRequests() const   { return AtomicLoadRelaxed( &m_MaxActiveRequests ); }
+
+    uint32_t    m_ResponseDelayMS   = 0;        // Simulate latency
+    bool        m_CloseConnections  = false;    // Close connections after each response (without telling the client)
+
+private:
+    class Entry
+    {
+    public:
+        AString         m_Path;
+        Array< char >   m_Data;
+    };
+
+    class ConnectionData
+    {
+    public:
+        TestHTTPServer *    m_Server;
+        TCPStream           m_Stream;
+    };
+
+    static uint32_t ListenThreadFunc( void * userData );
+    static uint32_t ConnectionThreadFunc( void * userData );
+    void HandleConnection( TCPStream & stream );
+    bool HandleRequest( TCPStream & stream, const AString & method, const AString & path, const char * body, size_t bodySize );
+
+    TCPStream                       m_Listener;
+    Thread::ThreadHandle            m_ListenThread;
+    volatile bool                   m_Quit;
+
+    mutable Mutex                   m_Mutex;
+    Array< Entry * >                m_Entries;
+    Array< Thread::ThreadHandle >   m_ConnectionThreads;
+
+    volatile uint32_t               m_NumConnections;
+    volatile uint32_t               m_NumRequests;
+    volatile uint32_t               m_ActiveRequests;
+    volatile uint32_t               m_MaxActiveRequests;
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+TestHTTPServer::TestHTTPServer()
+    : m_ListenThread( INVALID_THREAD_HANDLE )
+    , m_Quit( false )
+    , m_Entries( 64, true )
+    , m_ConnectionThreads( 16, true )
+    , m_NumConnections( 0 )
+    , m_NumRequests( 0 )
+    , m_ActiveRequests( 0 )
+    , m_MaxActiveRequests( 0 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+TestHTTPServer::~TestHTTPServer()
+{
+    AtomicStoreRelaxed( &m_Quit, true );
+    if ( m_ListenThread != INVALID_THREAD_HANDLE )
+    {
+        Thread::WaitForThread( m_ListenThread );
+        Thread::CloseHandle( m_ListenThread );
+    }
+    for ( Thread::ThreadHandle h : m_ConnectionThreads )
+    {
+        Thread::WaitForThread( h );
+        Thread::CloseHandle( h );
+    }
+    for ( Entry * entry : m_Entries )
+    {
+        FDELETE entry;
+    }
+}
+
+// Start
+//------------------------------------------------------------------------------
+bool TestHTTPServer::Start( uint16_t port )
+{
+    if ( m_Listener.Listen( port ) == false )
+    {
+        return false;
+    }
+    m_ListenThread = Thread::CreateThread( ListenThreadFunc, "TestHTTPServer", ( 64 * KILOBYTE ), this );
+    return ( m_ListenThread != INVALID_THREAD_HANDLE );
+}
+
+// ListenThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TestHTTPServer::ListenThreadFunc( void * userData )
+{
+    TestHTTPServer * self = static_cast< TestHTTPServer * >( userData );
+    while ( AtomicLoadRelaxed( &self->m_Quit ) == false )
+    {
+        ConnectionData * connection = FNEW( ConnectionData );
+        connection->m_Server = self;
+        if ( self->m_Listener.Accept( connection->m_Stream, 100 ) == false )
+        {
+            FDELETE connection;
+            continue;
+        }
+        AtomicIncU32( &self->m_NumConnections );
+
+        Thread::ThreadHandle h = Thread::CreateThread( ConnectionThreadFunc, "TestHTTPConnection", ( 64 * KILOBYTE ), connection );
+        MutexHolder mh( self->m_Mutex );
+        self->m_ConnectionThreads.Append( h );
+    }
+    return 0;
+}
+
+// ConnectionThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TestHTTPServer::ConnectionThreadFunc( void * userData )
+{
+    ConnectionData * connection = static_cast< ConnectionData * >( userData );
+    connection->m_Server->HandleConnection( connection->m_Stream );
+    FDELETE connection;
+    return 0;
+}
+
+// HandleConnection
+//------------------------------------------------------------------------------
+void TestHTTPServer::HandleConnection( TCPStream & stream )
+{
+    Array< char > buffer( 64 * 1024, true );
+    for ( ;; )
+    {
+        // Receive the header
+        size_t headerSize = 0;
+        for ( ;; )
+        {
+            for ( size_t i = 3; i < buffer.GetSize(); ++i )
+            {
+                if ( memcmp( &buffer[ i - 3 ], "\r\n\r\n", 4 ) == 0 )
+                {
+                    headerSize = ( i + 1 );
+                    break;
+                }
+            }
+            if ( headerSize )
+            {
+                break;
+            }
+
+            char chunk[ 16 * 1024 ];
+            size_t received = 0;
+            if ( ( AtomicLoadRelaxed( &m_Quit ) ) || ( stream.Receive( chunk, sizeof( chunk ), received, 5000 ) == false ) )
+            {
+                return; // Closed by the client (or shutting down)
+            }
+            buffer.Append( chunk, chunk + received );
+        }
+
+        // Parse the request: <METHOD> <PATH> HTTP/1.1
+        AStackString<> header( buffer.Begin(), buffer.Begin() + headerSize );
+        Array< AString > lines;
+        header.Tokenize( lines, '\n' );
+        Array< AString > requestLine;
+        lines[ 0 ].Tokenize( requestLine, ' ' );
+        if ( requestLine.GetSize() != 3 )
+        {
+            return;
+        }
+        size_t contentLength = 0;
+        for ( const AString & line : lines )
+        {
+            if ( line.BeginsWithI( "Content-Length:" ) )
+            {
+                contentLength = (size_t)strtoull( line.Get() + 15, nullptr, 10 );
+            }
+        }
+
+        // Receive the body
+        while ( buffer.GetSize() < ( headerSize + contentLength ) )
+        {
+            char chunk[ 16 * 1024 ];
+            size_t received = 0;
+            if ( stream.Receive( chunk, sizeof( chunk ), received, 5000 ) == false )
+            {
+                return;
+            }
+            buffer.Append( chunk, chunk + received );
+        }
+
+        if ( HandleRequest( stream, requestLine[ 0 ], requestLine[ 1 ], buffer.Begin() + headerSize, contentLength ) == false )
+        {
+            return;
+        }
+
+        // Keep any data from the next request
+        const size_t consumed = ( headerSize + contentLength );
+        const size_t remaining = ( buffer.GetSize() - consumed );
+        memmove( buffer.Begin(), buffer.Begin() + consumed, remaining );
+        buffer.SetSize( remaining );
+    }
+}
+
+// HandleRequest
+//------------------------------------------------------------------------------
+bool TestHTTPServer::HandleRequest( TCPStream & stream, const AString & method, const AString & path, const char * body, size_t bodySize )
+{
+    AtomicIncU32( &m_NumRequests );
+
+    // Track concurrency
+    {
+        MutexHolder mh( m_Mutex );
+        ++m_ActiveRequests;
+        if ( m_ActiveRequests > m_MaxActiveRequests )
+        {
+            m_MaxActiveRequests = m_ActiveRequests;
+        }
+    }
+    if ( m_ResponseDelayMS )
+    {
+        Thread::Sleep( m_ResponseDelayMS );
+    }
+
+    AStackString<> response;
+    Array< char > responseBody;
+    {
+        MutexHolder mh( m_Mutex );
+        --m_ActiveRequests;
+
+        Entry * found = nullptr;
+        for ( Entry * entry : m_Entries )
+        {
+            if ( entry->m_Path == path )
+            {
+                found = entry;
+                break;
+            }
+        }
+
+        if ( method == "PUT" )
+        {
+            if ( found == nullptr )
+            {
+                found = FNEW( Entry );
+                found->m_Path = path;
+                m_Entries.Append( found );
+            }
+            found->m_Data.Clear();
+            found->m_Data.Append( body, body + bodySize );
+            response = "HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n";
+        }
+        else if ( ( method == "GET" ) || ( method == "HEAD" ) )
+        {
+            if ( found )
+            {
+                response.Format( "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n", (uint32_t)found->m_Data.GetSize() );
+                if ( method == "GET" )
+                {
+                    responseBody.Append( found->m_Data );
+                }
+            }
+            else
+            {
+                response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+            }
+        }
+        else
+        {
+            response = "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\n\r\n";
+        }
+    }
+
+    if ( ( stream.Send( response.Get(), response.GetLength(), 5000 ) == false ) ||
+         ( ( responseBody.IsEmpty() == false ) && ( stream.Send( responseBody.Begin(), responseBody.GetSize(), 5000 ) == false ) ) )
+    {
+        return false;
+    }
+
+    return ( m_CloseConnections == false );
+}
+
+// TestCacheHTTP
+//------------------------------------------------------------------------------
+class TestCacheHTTP : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void PublishRetrieve() const;
+    void LargeEntry() const;
+    void Batch() const;
+    void ClosedConnections() const;
+    void Unavailable() const;
+
+    static void GetURL( AString & outURL );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestCacheHTTP )
+    REGISTER_TEST( PublishRetrieve )
+    REGISTER_TEST( LargeEntry )
+    REGISTER_TEST( Batch )
+    REGISTER_TEST( ClosedConnections )
+    REGISTER_TEST( Unavailable )
+REGISTER_TESTS_END
+
+// PublishRetrieve
+//------------------------------------------------------------------------------
+void TestCacheHTTP::PublishRetrieve() const
+{
+    TestHTTPServer server;
+    TEST_ASSERT( server.Start( Protocol::PROTOCOL_TEST_PORT ) );
+
+    AStackString<> url;
+    GetURL( url );
+
+    HTTPCache cache;
+    TEST_ASSERT( cache.Init( url, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+    const AStackString<> cacheId( "0123456789ABCDEF-01234567-0123456789ABCDEF-0123456789ABCDEF" );
+    const char data[] = "Cached object data";
+
+    // Miss
+    void * retrieved = nullptr;
+    size_t retrievedSize = 0;
+    TEST_ASSERT( cache.Retrieve( cacheId, retrieved, retrievedSize ) == false );
+
+    // Publish then hit
+    TEST_ASSERT( cache.Publish( cacheId, data, sizeof( data ) ) );
+    TEST_ASSERT( cache.Retrieve( cacheId, retrieved, retrievedSize ) );
+    TEST_ASSERT( retrievedSize == sizeof( data ) );
+    TEST_ASSERT( memcmp( retrieved, data, sizeof( data ) ) == 0 );
+    cache.FreeMemory( retrieved, retrievedSize );
+
+    // Sequential requests re-use a single connection
+    TEST_ASSERT( server.GetNumRequests() == 3 );
+    TEST_ASSERT( server.GetNumConnections() == 1 );
+
+    cache.Shutdown();
+}
+
+// LargeEntry
+//------------------------------------------------------------------------------
+void TestCacheHTTP::LargeEntry() const
+{
+    TestHTTPServer server;
+    TEST_ASSERT( server.Start( Protocol::PROTOCOL_TEST_PORT ) );
+
+    AStackString<> url;
+    GetURL( url );
+
+    HTTPCache cache;
+    TEST_ASSERT( cache.Init( url, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+    // Larger than any socket or receive buffer
+    const size_t dataSize = ( 8 * MEGABYTE + 123 );
+    UniquePtr< uint8_t, FreeDeletor > data( (uint8_t *)ALLOC( dataSize ) );
+    for ( size_t i = 0; i < dataSize; ++i )
+    {
+        data.Get()[ i ] = (uint8_t)( i * 31 );
+    }
+
+    const AStackString<> cacheId( "Large" );
+    TEST_ASSERT( cache.Publish( cacheId, data.Get(), dataSize ) );
+
+    void * retrieved = nullptr;
+    size_t retrievedSize = 0;
+    TEST_ASSERT( cache.Retrieve( cacheId, retrieved, retrievedSize ) );
+    TEST_ASSERT( retrievedSize == dataSize );
+    TEST_ASSERT( memcmp( retrieved, data.Get(), dataSize ) == 0 );
+    cache.FreeMemory( retrieved, retrievedSize );
+
+    cache.Shutdown();
+}
+
+// Batch
+//------------------------------------------------------------------------------
+void TestCacheHTTP::Batch() const
+{
+    TestHTTPServer server;
+    TEST_ASSERT( server.Start( Protocol::PROTOCOL_TEST_PORT ) );
+
+    AStackString<> url;
+    GetURL( url );
+
+    HTTPCache cache;
+    TEST_ASSERT( cache.Init( url, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+    // Publish every other entry
+    const size_t numEntries = 64;
+    for ( size_t i = 0; i < numEntries; i += 2 )
+    {
+        AStackString<> cacheId;
+        cacheId.Format( "Entry%u", (uint32_t)i );
+        TEST_ASSERT( cache.Publish( cacheId, cacheId.Get(), cacheId.GetLength() ) );
+    }
+
+    // Make requests slow, so concurrency is observable
+    server.m_ResponseDelayMS = 10;
+
+    Array< ICache::BatchEntry > entries( numEntries, false );
+    for ( size_t i = 0; i < numEntries; ++i )
+    {
+        ICache::BatchEntry & entry = entries.EmplaceBack();
+        entry.m_CacheId.Format( "Entry%u", (uint32_t)i );
+    }
+
+    // Query
+    cache.QueryBatch( entries );
+    for ( size_t i = 0; i < numEntries; ++i )
+    {
+        TEST_ASSERT( entries[ i ].m_Found == ( ( i % 2 ) == 0 ) );
+        TEST_ASSERT( entries[ i ].m_Data == nullptr );
+    }
+
+    // Retrieve
+    cache.RetrieveBatch( entries );
+    for ( size_t i = 0; i < numEntries; ++i )
+    {
+        ICache::BatchEntry & entry = entries[ i ];
+        TEST_ASSERT( entry.m_Found == ( ( i % 2 ) == 0 ) );
+        if ( entry.m_Found )
+        {
+            TEST_ASSERT( entry.m_DataSize == entry.m_CacheId.GetLength() );
+            TEST_ASSERT( memcmp( entry.m_Data, entry.m_CacheId.Get(), entry.m_DataSize ) == 0 );
+            cache.FreeMemory( entry.m_Data, entry.m_DataSize );
+        }
+    }
+
+    // Requests were in flight concurrently, on a bounded number of connections
+    TEST_ASSERT( server.GetMaxActiveRequests() > 1 );
+    TEST_ASSERT( server.GetNumConnections() <= 8 );
+
+    cache.Shutdown();
+}
+
+// ClosedConnections
+//------------------------------------------------------------------------------
+void TestCacheHTTP::ClosedConnections() const
+{
+    TestHTTPServer server;
+    TEST_ASSERT( server.Start( Protocol::PROTOCOL_TEST_PORT ) );
+
+    AStackString<> url;
+    GetURL( url );
+
+    HTTPCache cache;
+    TEST_ASSERT( cache.Init( url, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+    // Server drops connections which the client expects to re-use
+    server.m_CloseConnections = true;
+
+    for ( uint32_t i = 0; i < 8; ++i )
+    {
+        AStackString<> cacheId;
+        cacheId.Format( "Entry%u", i );
+        TEST_ASSERT( cache.Publish( cacheId, cacheId.Get(), cacheId.GetLength() ) );
+
+        void * retrieved = nullptr;
+        size_t retrievedSize = 0;
+        TEST_ASSERT( cache.Retrieve( cacheId, retrieved, retrievedSize ) );
+        TEST_ASSERT( retrievedSize == cacheId.GetLength() );
+        cache.FreeMemory( retrieved, retrievedSize );
+    }
+
+    cache.Shutdown();
+}
+
+// Unavailable
+//------------------------------------------------------------------------------
+void TestCacheHTTP::Unavailable() const
+{
+    // No server
+    {
+        AStackString<> url;
+        GetURL( url );
+
+        HTTPCache cache;
+        TEST_ASSERT( cache.Init( url, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) == false );
+    }
+
+    // Invalid urls
+    {
+        HTTPCache cache;
+        TEST_ASSERT( cache.Init( AStackString<>( "http://" ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) == false );
+        TEST_ASSERT( cache.Init( AStackString<>( "http://127.0.0.1:badport/" ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) == false );
+    }
+}
+
+// GetURL
+//------------------------------------------------------------------------------
+/*static*/ void TestCacheHTTP::GetURL( AString & outURL )
+{
+    outURL.Format( "http://127.0.0.1:%u/fbuild/", (uint32_t)Protocol::PROTOCOL_TEST_PORT );
+}
+
+//------------------------------------------------------------------------------
@@ -7,11 +7,15 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Cache/CachePlugin.h"
 #include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
 
 // Core
 #include "Core/Strings/AStackString.h"
 
+// system
+#include <string.h>
+
 // TestCachePlugin
 //------------------------------------------------------------------------------
 class TestCachePlugin : public FBuildTest
@@ -26,6 +30,11 @@ private:
     // Ensure old plugins with only mangled names on Windows continue to work)
     void BuildPlugin_Old() const;
     void UsePlugin_Old() const;
+
+    // Batched and asynchronous interface
+    void BuildPlugin_V2() const;
+    void UsePlugin_V2() const;
+    void UsePlugin_V2_Batch() const;
 };
 
 // Register Tests
@@ -40,6 +49,11 @@ REGISTER_TESTS_BEGIN( TestCachePlugin )
         REGISTER_TEST( BuildPlugin_Old )
         REGISTER_TEST( UsePlugin_Old )
     #endif
+
+    // Batched and asynchronous interface
+    REGISTER_TEST( BuildPlugin_V2 )
+    REGISTER_TEST( UsePlugin_V2 )
+    REGISTER_TEST( UsePlugin_V2_Batch )
 REGISTER_TESTS_END
 
 // BuildPlugin
@@ -215,4 +229,109 @@ void TestCachePlugin::UsePlugin_Old() const
     }
 }
 
+// BuildPlugin_V2
+//------------------------------------------------------------------------------
+void TestCachePlugin::BuildPlugin_V2() const
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCachePlugin/InterfaceV2/buildplugin.bff";
+
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    TEST_ASSERT( fBuild.Build( "Plugin-DLL-X64" ) );
+}
+
+// UsePlugin_V2
+//------------------------------------------------------------------------------
+void TestCachePlugin::UsePlugin_V2() const
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_UseCacheWrite = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCachePlugin/InterfaceV2/useplugin.bff";
+
+    // Write (entries from previous runs of the test are overwritten)
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        // CacheRetrieve and CacheFreeMemory are not needed by v2 plugins
+        TEST_ASSERT( GetRecordedOutput().Find( "Missing CachePluginDLL function" ) == nullptr );
+
+        TEST_ASSERT( fBuild.Build( "TestFiles-Lib" ) );
+        TEST_ASSERT( fBuild.GetStats().GetCacheStores() == 1 );
+        TEST_ASSERT( fBuild.GetStats().GetCacheHits() == 0 );
+    }
+
+    // Read
+    {
+        options.m_UseCacheRead = true;
+        options.m_UseCacheWrite = false;
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "TestFiles-Lib" ) );
+        TEST_ASSERT( fBuild.GetStats().GetCacheStores() == 0 );
+        TEST_ASSERT( fBuild.GetStats().GetCacheHits() == 1 );
+
+        TEST_ASSERT( GetRecordedOutput().Find( "CacheRetrieveInto Called" ) );
+    }
+}
+
+// UsePlugin_V2_Batch
+//------------------------------------------------------------------------------
+void TestCachePlugin::UsePlugin_V2_Batch() const
+{
+    #if defined( __WINDOWS__ )
+        const AStackString<> dllName( "../tmp/Test/CachePlugin/InterfaceV2/CachePlugin.dll" );
+    #else
+        const AStackString<> dllName( "../tmp/Test/CachePlugin/InterfaceV2/CachePlugin.so" );
+    #endif
+    const AStackString<> cachePath( "../tmp/Test/CachePlugin/InterfaceV2" );
+
+    CachePlugin plugin( dllName );
+    TEST_ASSERT( plugin.GetInterfaceVersion() == CACHE_PLUGIN_INTERFACE_VERSION );
+    TEST_ASSERT( plugin.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+    // Publish some entries of different sizes
+    const char dataA[] = "EntryA";
+    const char dataB[] = "A slightly longer EntryB";
+    TEST_ASSERT( plugin.Publish( AStackString<>( "BatchEntryA" ), dataA, sizeof( dataA ) ) );
+    TEST_ASSERT( plugin.Publish( AStackString<>( "BatchEntryB" ), dataB, sizeof( dataB ) ) );
+
+    Array< ICache::BatchEntry > entries;
+    entries.EmplaceBack().m_CacheId = "BatchEntryA";
+    entries.EmplaceBack().m_CacheId = "BatchEntryMissing";
+    entries.EmplaceBack().m_CacheId = "BatchEntryB";
+
+    // Query
+    plugin.QueryBatch( entries );
+    TEST_ASSERT( entries[ 0 ].m_Found && ( entries[ 0 ].m_DataSize == sizeof( dataA ) ) );
+    TEST_ASSERT( entries[ 1 ].m_Found == false );
+    TEST_ASSERT( entries[ 2 ].m_Found && ( entries[ 2 ].m_DataSize == sizeof( dataB ) ) );
+
+    // Retrieve
+    plugin.RetrieveBatch( entries );
+    TEST_ASSERT( GetRecordedOutput().Find( "CacheRetrieveAsync Called" ) );
+    TEST_ASSERT( entries[ 0 ].m_Found && ( entries[ 0 ].m_DataSize == sizeof( dataA ) ) );
+    TEST_ASSERT( memcmp( entries[ 0 ].m_Data, dataA, sizeof( dataA ) ) == 0 );
+    TEST_ASSERT( entries[ 1 ].m_Found == false );
+    TEST_ASSERT( entries[ 1 ].m_Data == nullptr );
+    TEST_ASSERT( entries[ 2 ].m_Found && ( entries[ 2 ].m_DataSize == sizeof( dataB ) ) );
+    TEST_ASSERT( memcmp( entries[ 2 ].m_Data, dataB, sizeof( dataB ) ) == 0 );
+
+    for ( const ICache::BatchEntry & entry : entries )
+    {
+        if ( entry.m_Found )
+        {
+            plugin.FreeMemory( entry.m_Data, entry.m_DataSize );
+        }
+    }
+
+    plugin.Shutdown();
+}
+
 //------------------------------------------------------------------------------
@@ -10,6 +10,8 @@
 // Core
 #include "Core/Containers/UniquePtr.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Process/Thread.h"
 #include "Core/Strings/AString.h"
 #include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
@@ -27,12 +29,19 @@ private:
     void CompressPreprocessedFile() const;
     void CompressObjFile() const;
     void TestHeaderValidity() const;
+    void CompressChunked() const;
+    void CompressChunkedParallel() const;
+    void CompressWithDictionary() const;
+    void DictionaryBenchmark() const;
 
     void CompressSimpleHelper( const char * data,
                                size_t size,
                                size_t expectedCompressedSize,
                                bool shouldCompress ) const;
     void CompressHelper( const char * fileName ) const;
+    void DictionaryBenchmarkHelper( const char * fileName ) const;
+    void LoadFile( const char * fileName, MemoryStream & outData ) const;
+    static uint32_t RoundTripThreadFunc( void * param );
 };
 
 // Register Tests
@@ -42,6 +51,10 @@ REGISTER_TESTS_BEGIN( TestCompressor )
     REGISTER_TEST( CompressPreprocessedFile )
     REGISTER_TEST( CompressObjFile )
     REGISTER_TEST( TestHeaderValidity )
+    REGISTER_TEST( CompressChunked )
+    REGISTER_TEST( CompressChunkedParallel )
+    REGISTER_TEST( CompressWithDictionary )
+    REGISTER_TEST( DictionaryBenchmark )
 REGISTER_TESTS_END
 
 // CompressSimple
@@ -224,6 +237,404 @@ void TestCompressor::TestHeaderValidity() const
     data[ 1 ] = 8;  // uncompressed
     data[ 2 ] = 32; // compressed
     TEST_ASSERT( c.IsValidData( buffer.Get(), 44 ) == false );
+
+    // chunked data
+    data[ 0 ] = 2;
+    data[ 1 ] = 32; // uncompressed
+    data[ 2 ] = 8;  // compressed
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 20 ) );
+
+    // data compressed with a dictionary
+    data[ 0 ] = 3;
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 20 ) );
+    data[ 0 ] = 4;
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 20 ) );
+
+    // INVALID data - unknown compression type
+    data[ 0 ] = 5;
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 20 ) == false );
+}
+
+// CompressChunked
+//------------------------------------------------------------------------------
+void TestCompressor::CompressChunked() const
+{
+    // read some test data, repeated to span several chunks
+    const char * fileName = "Tools/FBuild/FBuildTest/Data/TestCompressor/TestObjFile.o";
+    MemoryStream input;
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( fileName ) );
+        const size_t fileSize = (size_t)fs.GetFileSize();
+        UniquePtr< char > fileData( (char *)ALLOC( fileSize ) );
+        TEST_ASSERT( fs.Read( fileData.Get(), fileSize ) == fileSize );
+        while ( input.GetSize() < ( 1024 * 1024 ) )
+        {
+            input.WriteBuffer( fileData.Get(), fileSize );
+        }
+    }
+    const size_t dataSize = (size_t)input.GetSize();
+
+    // compress
+    Compressor c;
+    TEST_ASSERT( c.CompressChunked( input.GetData(), dataSize ) );
+    TEST_ASSERT( c.IsValidData( c.GetResult(), c.GetResultSize() ) );
+    TEST_ASSERT( c.GetResultSize() < dataSize );
+
+    // decompress into memory
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( c.GetResult() ) );
+        TEST_ASSERT( d.GetResultSize() == dataSize );
+        TEST_ASSERT( memcmp( input.GetData(), d.GetResult(), dataSize ) == 0 );
+    }
+
+    // decompress into a stream
+    {
+        Compressor d;
+        MemoryStream output;
+        TEST_ASSERT( d.Decompress( c.GetResult(), output ) );
+        TEST_ASSERT( output.GetSize() == dataSize );
+        TEST_ASSERT( memcmp( input.GetData(), output.GetData(), dataSize ) == 0 );
+    }
+
+    // data which fits in a single chunk uses the single block format
+    {
+        Compressor small;
+        small.CompressChunked( input.GetData(), 1024 );
+        TEST_ASSERT( ( (const uint32_t *)small.GetResult() )[ 0 ] != 2 );
+
+        Compressor d;
+        MemoryStream output;
+        TEST_ASSERT( d.Decompress( small.GetResult(), output ) );
+        TEST_ASSERT( output.GetSize() == 1024 );
+        TEST_ASSERT( memcmp( input.GetData(), output.GetData(), 1024 ) == 0 );
+    }
+
+    // corrupt data is detected
+    {
+        UniquePtr< char > corrupt( (char *)ALLOC( c.GetResultSize() ) );
+        memcpy( corrupt.Get(), c.GetResult(), c.GetResultSize() );
+        corrupt.Get()[ 15 ] = (char)0x7F; // first chunk size (larger than data)
+        Compressor d;
+        TEST_ASSERT( d.Decompress( corrupt.Get() ) == false );
+        MemoryStream output;
+        TEST_ASSERT( d.Decompress( corrupt.Get(), output ) == false );
+    }
+}
+
+// CompressChunkedParallel
+//------------------------------------------------------------------------------
+void TestCompressor::CompressChunkedParallel() const
+{
+    // read some test data, repeated to span many chunks
+    MemoryStream file;
+    LoadFile( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", file );
+    LoadFile( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestObjFile.o", file );
+    MemoryStream input;
+    while ( input.GetSize() < ( 8 * MEGABYTE ) )
+    {
+        input.WriteBuffer( file.GetData(), file.GetSize() );
+    }
+    const size_t dataSize = (size_t)input.GetSize();
+
+    Array< char > dictionaryData;
+    Compressor::TrainDictionary( file.GetData(), (size_t)file.GetSize(), dictionaryData );
+    const Compressor::Dictionary * dictionary = Compressor::RegisterDictionary( dictionaryData.Begin(), dictionaryData.GetSize() );
+    TEST_ASSERT( dictionary );
+
+    const int32_t compressionLevels[] = { -1, 9 };
+    for ( const int32_t compressionLevel : compressionLevels )
+    {
+        for ( uint32_t useDictionary = 0; useDictionary < 2; ++useDictionary )
+        {
+            const Compressor::Dictionary * dict = useDictionary ? dictionary : nullptr;
+
+            // compress on this thread only
+            Timer t;
+            Compressor serial;
+            TEST_ASSERT( serial.CompressChunked( input.GetData(), dataSize, compressionLevel, dict ) );
+            const float serialTime = t.GetElapsedMS();
+
+            // compress in parallel
+            Compressor::CreateThreadPool( 3 );
+            t.Start();
+            Compressor parallel;
+            TEST_ASSERT( parallel.CompressChunked( input.GetData(), dataSize, compressionLevel, dict ) );
+            const float parallelTime = t.GetElapsedMS();
+
+            OUTPUT( "Level %2i %s: %u -> %u bytes, serial %.1f ms, parallel %.1f ms\n",
+                    compressionLevel, useDictionary ? "(dictionary)" : "            ",
+                    (uint32_t)dataSize, (uint32_t)parallel.GetResultSize(), (double)serialTime, (double)parallelTime );
+
+            // chunks are independent, so the output is identical
+            TEST_ASSERT( parallel.GetResultSize() == serial.GetResultSize() );
+            TEST_ASSERT( memcmp( parallel.GetResult(), serial.GetResult(), serial.GetResultSize() ) == 0 );
+            TEST_ASSERT( parallel.IsValidData( parallel.GetResult(), parallel.GetResultSize() ) );
+
+            // decompress into memory
+            {
+                Compressor d;
+                TEST_ASSERT( d.Decompress( parallel.GetResult() ) );
+                TEST_ASSERT( d.GetResultSize() == dataSize );
+                TEST_ASSERT( memcmp( input.GetData(), d.GetResult(), dataSize ) == 0 );
+            }
+
+            // decompress into a stream
+            {
+                Compressor d;
+                MemoryStream output;
+                TEST_ASSERT( d.Decompress( parallel.GetResult(), output ) );
+                TEST_ASSERT( output.GetSize() == dataSize );
+                TEST_ASSERT( memcmp( input.GetData(), output.GetData(), dataSize ) == 0 );
+            }
+
+            // corruption of a later chunk is detected
+            {
+                UniquePtr< char > corrupt( (char *)ALLOC( parallel.GetResultSize() ) );
+                memcpy( corrupt.Get(), parallel.GetResult(), parallel.GetResultSize() );
+                memset( corrupt.Get() + ( parallel.GetResultSize() / 2 ), 0xFF, 64 );
+                Compressor d;
+                TEST_ASSERT( d.Decompress( corrupt.Get() ) == false );
+                MemoryStream output;
+                TEST_ASSERT( d.Decompress( corrupt.Get(), output ) == false );
+            }
+
+            Compressor::DestroyThreadPool();
+        }
+    }
+
+    // several threads sharing the pool
+    {
+        Compressor::CreateThreadPool( 3 );
+        Thread::ThreadHandle threads[ 4 ];
+        for ( Thread::ThreadHandle & h : threads )
+        {
+            h = Thread::CreateThread( RoundTripThreadFunc, "RoundTrip", ( 64 * KILOBYTE ), &input );
+            TEST_ASSERT( h != INVALID_THREAD_HANDLE );
+        }
+        for ( Thread::ThreadHandle h : threads )
+        {
+            TEST_ASSERT( Thread::WaitForThread( h ) == 1 );
+            Thread::CloseHandle( h );
+        }
+        Compressor::DestroyThreadPool();
+    }
+
+    Compressor::ReleaseDictionary( dictionary );
+}
+
+// RoundTripThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TestCompressor::RoundTripThreadFunc( void * param )
+{
+    const MemoryStream & input = *static_cast< const MemoryStream * >( param );
+    for ( uint32_t i = 0; i < 4; ++i )
+    {
+        Compressor c;
+        Compressor d;
+        if ( ( c.CompressChunked( input.GetData(), (size_t)input.GetSize() ) == false ) ||
+             ( d.Decompress( c.GetResult() ) == false ) ||
+             ( d.GetResultSize() != input.GetSize() ) ||
+             ( memcmp( input.GetData(), d.GetResult(), d.GetResultSize() ) != 0 ) )
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// CompressWithDictionary
+//------------------------------------------------------------------------------
+void TestCompressor::CompressWithDictionary() const
+{
+    MemoryStream input;
+    LoadFile( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", input );
+    const char * data = static_cast< const char * >( input.GetData() );
+    const size_t halfSize = ( (size_t)input.GetSize() / 2 );
+
+    // train a dictionary from the first half of the data
+    Array< char > dictionaryData;
+    Compressor::TrainDictionary( data, halfSize, dictionaryData );
+    TEST_ASSERT( dictionaryData.IsEmpty() == false );
+    TEST_ASSERT( dictionaryData.GetSize() <= Compressor::MAX_DICTIONARY_SIZE );
+
+    // registering the same dictionary again shares it
+    const Compressor::Dictionary * dictionary = Compressor::RegisterDictionary( dictionaryData.Begin(), dictionaryData.GetSize() );
+    TEST_ASSERT( dictionary );
+    TEST_ASSERT( Compressor::RegisterDictionary( dictionaryData.Begin(), dictionaryData.GetSize() ) == dictionary );
+    Compressor::ReleaseDictionary( dictionary );
+    TEST_ASSERT( Compressor::FindDictionary( dictionary->GetId() ) == dictionary );
+
+    // compress small pieces of the second half, with and without the dictionary
+    const size_t sampleSize = 4096;
+    size_t sizeWithoutDictionary = 0;
+    size_t sizeWithDictionary = 0;
+    for ( uint32_t i = 0; i < 32; ++i )
+    {
+        const char * piece = ( data + halfSize + ( i * sampleSize ) );
+        Compressor withoutDictionary;
+        withoutDictionary.Compress( piece, sampleSize );
+        TEST_ASSERT( Compressor::GetDictionaryId( withoutDictionary.GetResult() ) == 0 );
+        sizeWithoutDictionary += withoutDictionary.GetResultSize();
+
+        Compressor withDictionary;
+        TEST_ASSERT( withDictionary.Compress( piece, sampleSize, -1, dictionary ) );
+        TEST_ASSERT( withDictionary.IsValidData( withDictionary.GetResult(), withDictionary.GetResultSize() ) );
+        TEST_ASSERT( Compressor::GetDictionaryId( withDictionary.GetResult() ) == dictionary->GetId() );
+        sizeWithDictionary += withDictionary.GetResultSize();
+
+        Compressor d;
+        TEST_ASSERT( d.Decompress( withDictionary.GetResult() ) );
+        TEST_ASSERT( d.GetResultSize() == sampleSize );
+        TEST_ASSERT( memcmp( piece, d.GetResult(), sampleSize ) == 0 );
+    }
+    TEST_ASSERT( sizeWithDictionary < sizeWithoutDictionary );
+
+    const char * sample = ( data + halfSize );
+    Compressor withDictionary;
+    TEST_ASSERT( withDictionary.Compress( sample, sampleSize, -1, dictionary ) );
+
+    // compress with LZ4HC
+    Compressor withDictionaryHC;
+    TEST_ASSERT( withDictionaryHC.Compress( sample, sampleSize, 9, dictionary ) );
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( withDictionaryHC.GetResult() ) );
+        TEST_ASSERT( memcmp( sample, d.GetResult(), sampleSize ) == 0 );
+    }
+
+    // compress in chunks (each chunk uses the dictionary)
+    Compressor chunked;
+    TEST_ASSERT( chunked.CompressChunked( data, (size_t)input.GetSize(), -1, dictionary ) );
+    TEST_ASSERT( chunked.IsValidData( chunked.GetResult(), chunked.GetResultSize() ) );
+    TEST_ASSERT( Compressor::GetDictionaryId( chunked.GetResult() ) == dictionary->GetId() );
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( chunked.GetResult() ) );
+        TEST_ASSERT( d.GetResultSize() == input.GetSize() );
+        TEST_ASSERT( memcmp( data, d.GetResult(), d.GetResultSize() ) == 0 );
+    }
+    {
+        Compressor d;
+        MemoryStream output;
+        TEST_ASSERT( d.Decompress( chunked.GetResult(), output ) );
+        TEST_ASSERT( output.GetSize() == input.GetSize() );
+        TEST_ASSERT( memcmp( data, output.GetData(), (size_t)output.GetSize() ) == 0 );
+    }
+
+    // data can't be decompressed once the dictionary is unavailable
+    const uint32_t dictionaryId = dictionary->GetId();
+    Compressor::ReleaseDictionary( dictionary );
+    TEST_ASSERT( Compressor::FindDictionary( dictionaryId ) == nullptr );
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( withDictionary.GetResult() ) == false );
+        TEST_ASSERT( d.Decompress( chunked.GetResult() ) == false );
+        MemoryStream output;
+        TEST_ASSERT( d.Decompress( chunked.GetResult(), output ) == false );
+    }
+
+    // invalid dictionaries are rejected
+    TEST_ASSERT( Compressor::RegisterDictionary( data, 0 ) == nullptr );
+    TEST_ASSERT( Compressor::RegisterDictionary( data, Compressor::MAX_DICTIONARY_SIZE + 1 ) == nullptr );
+}
+
+// DictionaryBenchmark
+//------------------------------------------------------------------------------
+void TestCompressor::DictionaryBenchmark() const
+{
+    DictionaryBenchmarkHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii" );
+    DictionaryBenchmarkHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestObjFile.o" );
+}
+
+// DictionaryBenchmarkHelper
+//------------------------------------------------------------------------------
+void TestCompressor::DictionaryBenchmarkHelper( const char * fileName ) const
+{
+    MemoryStream input;
+    LoadFile( fileName, input );
+    const char * data = static_cast< const char * >( input.GetData() );
+    const size_t halfSize = ( (size_t)input.GetSize() / 2 );
+
+    // Train from the first half of the file and compress pieces of the second
+    // half, representing small objects similar to those seen before
+    Timer trainTimer;
+    Array< char > dictionaryData;
+    Compressor::TrainDictionary( data, halfSize, dictionaryData );
+    const float trainTime = trainTimer.GetElapsedMS();
+    const Compressor::Dictionary * dictionary = Compressor::RegisterDictionary( dictionaryData.Begin(), dictionaryData.GetSize() );
+    TEST_ASSERT( dictionary );
+
+    OUTPUT( "File           : %s\n", fileName );
+    OUTPUT( "Dictionary     : %u bytes (trained in %.3f ms)\n", dictionary->GetDataSize(), (double)trainTime );
+
+    OUTPUT( "                       Without Dictionary  |     With Dictionary\n" );
+    OUTPUT( "Size   | Level | Ratio    MB/s    MB/s     | Ratio    MB/s    MB/s\n" );
+    OUTPUT( "-------------------------------------------------------------------\n" );
+
+    const size_t pieceSizes[] = { 1024, 4096, 16384, 65536 };
+    const int32_t compressionLevels[] = { -1, 9 };
+    for ( const size_t pieceSize : pieceSizes )
+    {
+        for ( const int32_t compressionLevel : compressionLevels )
+        {
+            double ratio[ 2 ];
+            double compressThroughputMBs[ 2 ];
+            double decompressThroughputMBs[ 2 ];
+            for ( uint32_t useDictionary = 0; useDictionary < 2; ++useDictionary )
+            {
+                uint64_t uncompressedSize = 0;
+                uint64_t compressedSize = 0;
+                double compressTimeTaken = 0.0;
+                double decompressTimeTaken = 0.0;
+                for ( size_t offset = halfSize; ( offset + pieceSize ) <= input.GetSize(); offset += pieceSize )
+                {
+                    Timer t;
+                    Compressor c;
+                    c.Compress( data + offset, pieceSize, compressionLevel, useDictionary ? dictionary : nullptr );
+                    compressTimeTaken += (double)t.GetElapsedMS();
+
+                    Timer t2;
+                    Compressor d;
+                    TEST_ASSERT( d.Decompress( c.GetResult() ) );
+                    decompressTimeTaken += (double)t2.GetElapsedMS();
+                    TEST_ASSERT( d.GetResultSize() == pieceSize );
+
+                    uncompressedSize += pieceSize;
+                    compressedSize += c.GetResultSize();
+                }
+                ratio[ useDictionary ] = ( (double)uncompressedSize / (double)compressedSize );
+                compressThroughputMBs[ useDictionary ] = ( (double)uncompressedSize / ( compressTimeTaken / 1000.0 ) ) / (double)MEGABYTE;
+                decompressThroughputMBs[ useDictionary ] = ( (double)uncompressedSize / ( decompressTimeTaken / 1000.0 ) ) / (double)MEGABYTE;
+            }
+
+            OUTPUT( "%-6u | %-5i | %5.2f %7.1f %7.1f     | %5.2f %7.1f %7.1f\n", (uint32_t)pieceSize, compressionLevel,
+                    ratio[ 0 ], compressThroughputMBs[ 0 ], decompressThroughputMBs[ 0 ],
+                    ratio[ 1 ], compressThroughputMBs[ 1 ], decompressThroughputMBs[ 1 ] );
+
+            // The dictionary should help small pieces
+            if ( pieceSize <= 4096 )
+            {
+                TEST_ASSERT( ratio[ 1 ] > ratio[ 0 ] );
+            }
+        }
+    }
+    OUTPUT( "-------------------------------------------------------------------\n" );
+
+    Compressor::ReleaseDictionary( dictionary );
+}
+
+// LoadFile
+//------------------------------------------------------------------------------
+void TestCompressor::LoadFile( const char * fileName, MemoryStream & outData ) const
+{
+    FileStream fs;
+    TEST_ASSERT( fs.Open( fileName ) );
+    const size_t fileSize = (size_t)fs.GetFileSize();
+    UniquePtr< char > fileData( (char *)ALLOC( fileSize ) );
+    TEST_ASSERT( fs.Read( fileData.Get(), fileSize ) == fileSize );
+    outData.WriteBuffer( fileData.Get(), fileSize );
 }
 
 //------------------------------------------------------------------------------
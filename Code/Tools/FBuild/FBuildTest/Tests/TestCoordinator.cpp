@@ -0,0 +1,210 @@
+// TestCoordinator.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Protocol/Coordinator.h"
+#include "Tools/FBuild/FBuildCore/Protocol/CoordinatorConnection.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Env.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+
+// TestCoordinator
+//------------------------------------------------------------------------------
+class TestCoordinator : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void RankWorkers() const;
+    void StatusUpdates() const;
+    void WorkerDisconnected() const;
+    void CoordinatorUnavailable() const;
+
+    static bool WaitForNumWorkers( const Coordinator & coordinator, size_t numWorkers );
+    static bool WaitForFirstWorker( const Coordinator & coordinator, const char * address );
+    static void CheckWorkers( const char * clientHostName, const char * const * expected, size_t numExpected );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestCoordinator )
+    REGISTER_TEST( RankWorkers )
+    REGISTER_TEST( StatusUpdates )
+    REGISTER_TEST( WorkerDisconnected )
+    REGISTER_TEST( CoordinatorUnavailable )
+REGISTER_TESTS_END
+
+// Helper to simulate a worker reporting its status
+//------------------------------------------------------------------------------
+class TestWorker
+{
+public:
+    TestWorker( const char * hostName, const char * address, uint32_t numCPUs, uint32_t numJobsInProgress )
+        : m_Connection( AStackString<>( "127.0.0.1" ), Protocol::COORDINATOR_TEST_PORT )
+        , m_HostName( hostName )
+        , m_Address( address )
+    {
+        Update( numCPUs, numJobsInProgress );
+    }
+
+    void Update( uint32_t numCPUs, uint32_t numJobsInProgress )
+    {
+        m_Connection.UpdateStatus( m_HostName, m_Address, numCPUs, numJobsInProgress );
+    }
+
+private:
+    CoordinatorConnection   m_Connection;
+    AString                 m_HostName;
+    AString                 m_Address;
+};
+
+// RankWorkers
+//------------------------------------------------------------------------------
+void TestCoordinator::RankWorkers() const
+{
+    Coordinator coordinator;
+    TEST_ASSERT( coordinator.Listen( Protocol::COORDINATOR_TEST_PORT ) );
+
+    const TestWorker workerA( "WorkerA", "10.0.0.1", 8, 6 );   // 2 free CPUs
+    const TestWorker workerB( "WorkerB", "10.0.0.2", 4, 0 );   // 4 free CPUs
+    const TestWorker workerC( "WorkerC", "10.0.0.3", 16, 20 ); // busy (x1.25)
+    const TestWorker workerD( "WorkerD", "10.0.0.4", 2, 3 );   // busy (x1.5)
+    const TestWorker workerE( "WorkerE", "10.0.0.5", 0, 0 );   // disabled
+    TEST_ASSERT( WaitForNumWorkers( coordinator, 5 ) );
+
+    // Most free CPUs first, then busy workers (least loaded first). Disabled
+    // workers are excluded.
+    {
+        const char * const expected[] = { "10.0.0.2", "10.0.0.1", "10.0.0.3", "10.0.0.4" };
+        CheckWorkers( "Client", expected, sizeof( expected ) / sizeof( const char * ) );
+    }
+
+    // A client never receives itself as a worker
+    {
+        const char * const expected[] = { "10.0.0.1", "10.0.0.3", "10.0.0.4" };
+        CheckWorkers( "workerb", expected, sizeof( expected ) / sizeof( const char * ) );
+    }
+}
+
+// StatusUpdates
+//------------------------------------------------------------------------------
+void TestCoordinator::StatusUpdates() const
+{
+    Coordinator coordinator;
+    TEST_ASSERT( coordinator.Listen( Protocol::COORDINATOR_TEST_PORT ) );
+
+    TestWorker workerA( "WorkerA", "10.0.0.1", 8, 0 );
+    TestWorker workerB( "WorkerB", "10.0.0.2", 4, 0 );
+    TEST_ASSERT( WaitForNumWorkers( coordinator, 2 ) );
+    TEST_ASSERT( WaitForFirstWorker( coordinator, "10.0.0.1" ) );
+
+    // WorkerA becomes busy
+    workerA.Update( 8, 8 );
+    TEST_ASSERT( WaitForFirstWorker( coordinator, "10.0.0.2" ) );
+    {
+        const char * const expected[] = { "10.0.0.2", "10.0.0.1" };
+        CheckWorkers( "Client", expected, sizeof( expected ) / sizeof( const char * ) );
+    }
+
+    // WorkerB is disabled
+    workerB.Update( 0, 0 );
+    TEST_ASSERT( WaitForFirstWorker( coordinator, "10.0.0.1" ) );
+    {
+        const char * const expected[] = { "10.0.0.1" };
+        CheckWorkers( "Client", expected, sizeof( expected ) / sizeof( const char * ) );
+    }
+}
+
+// WorkerDisconnected
+//------------------------------------------------------------------------------
+void TestCoordinator::WorkerDisconnected() const
+{
+    Coordinator coordinator;
+    TEST_ASSERT( coordinator.Listen( Protocol::COORDINATOR_TEST_PORT ) );
+
+    const TestWorker workerA( "WorkerA", "10.0.0.1", 8, 0 );
+    {
+        const TestWorker workerB( "WorkerB", "10.0.0.2", 16, 0 );
+        TEST_ASSERT( WaitForNumWorkers( coordinator, 2 ) );
+        const char * const expected[] = { "10.0.0.2", "10.0.0.1" };
+        CheckWorkers( "Client", expected, sizeof( expected ) / sizeof( const char * ) );
+    }
+
+    // WorkerB is forgotten as soon as it disconnects
+    TEST_ASSERT( WaitForNumWorkers( coordinator, 1 ) );
+    const char * const expected[] = { "10.0.0.1" };
+    CheckWorkers( "Client", expected, sizeof( expected ) / sizeof( const char * ) );
+}
+
+// CoordinatorUnavailable
+//------------------------------------------------------------------------------
+void TestCoordinator::CoordinatorUnavailable() const
+{
+    // Nothing listening
+    CoordinatorConnection connection( AStackString<>( "127.0.0.1" ), Protocol::COORDINATOR_TEST_PORT );
+    Array< AString > workers;
+    TEST_ASSERT( connection.RequestWorkers( AStackString<>( "Client" ), workers ) == false );
+    TEST_ASSERT( workers.IsEmpty() );
+}
+
+// WaitForNumWorkers
+//------------------------------------------------------------------------------
+/*static*/ bool TestCoordinator::WaitForNumWorkers( const Coordinator & coordinator, size_t numWorkers )
+{
+    const Timer t;
+    while ( coordinator.GetNumWorkers() != numWorkers )
+    {
+        if ( t.GetElapsed() > 10.0f )
+        {
+            return false;
+        }
+        Thread::Sleep( 1 );
+    }
+    return true;
+}
+
+// WaitForFirstWorker
+//------------------------------------------------------------------------------
+/*static*/ bool TestCoordinator::WaitForFirstWorker( const Coordinator & coordinator, const char * address )
+{
+    const Timer t;
+    for ( ;; )
+    {
+        Array< AString > workers;
+        coordinator.GetWorkers( Protocol::PROTOCOL_VERSION, (uint8_t)Env::GetPlatform(), AStackString<>( "Client" ), workers );
+        if ( ( workers.IsEmpty() == false ) && ( workers[ 0 ] == address ) )
+        {
+            return true;
+        }
+        if ( t.GetElapsed() > 10.0f )
+        {
+            return false;
+        }
+        Thread::Sleep( 1 );
+    }
+}
+
+// CheckWorkers
+//------------------------------------------------------------------------------
+/*static*/ void TestCoordinator::CheckWorkers( const char * clientHostName, const char * const * expected, size_t numExpected )
+{
+    CoordinatorConnection client( AStackString<>( "127.0.0.1" ), Protocol::COORDINATOR_TEST_PORT );
+    Array< AString > workers;
+    TEST_ASSERT( client.RequestWorkers( AStackString<>( clientHostName ), workers ) );
+    TEST_ASSERT( workers.GetSize() == numExpected );
+    for ( size_t i = 0; i < numExpected; ++i )
+    {
+        TEST_ASSERTM( workers[ i ] == expected[ i ], "Expected '%s' but got '%s' at %zu", expected[ i ], workers[ i ].Get(), i );
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -6,12 +6,21 @@
 #include "Tools/FBuild/FBuildTest/Tests/FBuildTest.h"
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/FileNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Client.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
 
+#include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Strings/AStackString.h"
 
 // Defines
@@ -31,6 +40,7 @@ private:
 
     void TestWith1RemoteWorkerThread() const;
     void TestWith4RemoteWorkerThreads() const;
+    void DeduplicatedJobData() const;
     void WithPCH() const;
     void RegressionTest_RemoteCrashOnErrorFormatting();
     void TestLocalRace();
@@ -41,6 +51,12 @@ private:
     void WarningsAreCorrectlyReported_MSVC() const;
     void WarningsAreCorrectlyReported_Clang() const;
     void ShutdownMemoryLeak() const;
+    void UnreachableWorkers() const;
+    void SlowWorkers() const;
+    void SharedWorkers() const;
+    void BatchedJobs() const;
+    void OlderClient() const;
+    void ToolchainFilesAreShared() const;
     void TestForceInclude() const;
     void TestZiDebugFormat() const;
     void TestZiDebugFormat_Local() const;
@@ -49,7 +65,9 @@ private:
     void TestHelper( const char * target,
                      uint32_t numRemoteWorkers,
                      bool shouldFail = false,
-                     bool allowRace = false ) const;
+                     bool allowRace = false,
+                     bool deduplicate = false ) const;
+    void TestProtocolVersion( uint32_t clientProtocolVersion ) const;
 };
 
 // Register Tests
@@ -57,12 +75,19 @@ private:
 REGISTER_TESTS_BEGIN( TestDistributed )
     REGISTER_TEST( TestWith1RemoteWorkerThread )
     REGISTER_TEST( TestWith4RemoteWorkerThreads )
+    REGISTER_TEST( DeduplicatedJobData )
     REGISTER_TEST( WithPCH )
     REGISTER_TEST( RegressionTest_RemoteCrashOnErrorFormatting )
     REGISTER_TEST( TestLocalRace )
     REGISTER_TEST( RemoteRaceWinRemote )
     REGISTER_TEST( AnonymousNamespaces )
     REGISTER_TEST( ShutdownMemoryLeak )
+    REGISTER_TEST( UnreachableWorkers )
+    REGISTER_TEST( SlowWorkers )
+    REGISTER_TEST( SharedWorkers )
+    REGISTER_TEST( BatchedJobs )
+    REGISTER_TEST( OlderClient )
+    REGISTER_TEST( ToolchainFilesAreShared )
     #if defined( __WINDOWS__ )
         REGISTER_TEST( ErrorsAreCorrectlyReported_MSVC ) // TODO:B Enable for OSX and Linux
         REGISTER_TEST( ErrorsAreCorrectlyReported_Clang ) // TODO:B Enable for OSX and Linux
@@ -77,7 +102,7 @@ REGISTER_TESTS_END
 
 // Test
 //------------------------------------------------------------------------------
-void TestDistributed::TestHelper( const char * target, uint32_t numRemoteWorkers, bool shouldFail, bool allowRace ) const
+void TestDistributed::TestHelper( const char * target, uint32_t numRemoteWorkers, bool shouldFail, bool allowRace, bool deduplicate ) const
 {
     FBuildTestOptions options;
     options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
@@ -85,6 +110,7 @@ void TestDistributed::TestHelper( const char * target, uint32_t numRemoteWorkers
     options.m_NumWorkerThreads = 1;
     options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
     options.m_AllowLocalRace = allowRace;
+    options.m_DistDeduplicateJobData = deduplicate;
     options.m_EnableMonitor = true; // make sure monitor code paths are tested as well
     options.m_DistributionPort = TEST_PROTOCOL_PORT;
     FBuild fBuild( options );
@@ -136,6 +162,14 @@ void TestDistributed::TestWith4RemoteWorkerThreads() const
     TestHelper( target, 4 );
 }
 
+// DeduplicatedJobData
+//------------------------------------------------------------------------------
+void TestDistributed::DeduplicatedJobData() const
+{
+    const char * target( "../tmp/Test/Distributed/dist.lib" );
+    TestHelper( target, 4, false, false, true ); // deduplicate
+}
+
 // WithPCH
 //------------------------------------------------------------------------------
 void TestDistributed::WithPCH() const
@@ -209,6 +243,358 @@ void TestDistributed::AnonymousNamespaces()
     TestHelper( target, 1 );
 }
 
+// UnreachableWorkers
+//------------------------------------------------------------------------------
+void TestDistributed::UnreachableWorkers() const
+{
+    // Workers which don't respond shouldn't delay connecting to those which do
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/UnreachableWorkers/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_AllowLocalRace = false;
+    options.m_ForceCleanBuild = true;
+    options.m_DistributionPort = TEST_PROTOCOL_PORT;
+    FBuild fBuild( options );
+
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // start a client to emulate the other end
+    Server s( 1 );
+    s.Listen( TEST_PROTOCOL_PORT );
+
+    // Connection attempts are made concurrently, so the build shouldn't wait for
+    // the attempts to the unreachable workers to time out one after another
+    Timer t;
+    TEST_ASSERT( fBuild.Build( "UnreachableWorkers" ) );
+    TEST_ASSERT( t.GetElapsed() < 6.0f );
+}
+
+// SlowWorkers
+//------------------------------------------------------------------------------
+void TestDistributed::SlowWorkers() const
+{
+    // Jobs with known costs
+    class CostNode : public FileNode
+    {
+    public:
+        CostNode( const char * name, uint32_t cost )
+            : FileNode( AStackString<>( name ), Node::FLAG_NONE )
+        {
+            m_RecursiveCost = cost;
+            SetState( Node::BUILDING );
+        }
+    };
+    CostNode nodeA( "A", 10 );
+    CostNode nodeB( "B", 20 );
+    CostNode nodeC( "C", 30 );
+    CostNode nodeD( "D", 40 );
+    CostNode nodeE( "E", 50 );
+    CostNode nodeF( "F", 5 );
+
+    FBuildTestOptions options;
+    options.m_DistributionPort = TEST_PROTOCOL_PORT;
+    FBuild fBuild( options );
+    JobQueue jobQueue( 0 );
+
+    // Workers are judged once enough of their jobs are complete
+    {
+        const Array< AString > noWorkers;
+        Client client( noWorkers, false, TEST_PROTOCOL_PORT, 0, 1, false, false, false, Protocol::PRIORITY_NORMAL, Protocol::PROTOCOL_VERSION );
+        client.m_TimeRatio = 1.0f; // Average of all workers
+
+        Client::ServerState ss;
+        MutexHolder mh( ss.m_Mutex );
+        TEST_ASSERT( client.IsSlowWorker( ss ) == false );
+
+        // Slower than the average, but not enough jobs timed yet
+        ss.m_NumJobsCompleted = 4;
+        ss.m_NumJobsTimed = 3;
+        ss.m_TimeRatio = 2.0f;
+        TEST_ASSERT( client.IsSlowWorker( ss ) == false );
+
+        // Slower than the average
+        ss.m_NumJobsTimed = 4;
+        TEST_ASSERT( client.IsSlowWorker( ss ) );
+
+        // A little slower than the average is tolerated
+        ss.m_TimeRatio = 1.25f;
+        TEST_ASSERT( client.IsSlowWorker( ss ) == false );
+
+        // Unreliable
+        ss.m_NumJobsFailed = 2;
+        TEST_ASSERT( client.IsSlowWorker( ss ) );
+    }
+
+    // Slow workers are given the cheapest jobs, leaving expensive ones for faster workers
+    Array< Job * > jobsTaken;
+    const auto queue = [ &jobQueue ]( Node * node )
+    {
+        AtomicIncU32( &jobQueue.m_NumLocalJobsActive ); // Converted from a local job
+        jobQueue.QueueDistributableJob( FNEW( Job( node ) ) );
+    };
+    const auto take = [ &jobQueue, &jobsTaken ]( bool cheapest ) -> const Node *
+    {
+        Job * job = jobQueue.GetDistributableJobToProcess( true, cheapest );
+        if ( job == nullptr )
+        {
+            return nullptr;
+        }
+        jobsTaken.Append( job );
+        return job->GetNode();
+    };
+
+    queue( &nodeC );
+    queue( &nodeA );
+    queue( &nodeE );
+    queue( &nodeB );
+    queue( &nodeD );
+    TEST_ASSERT( take( true ) == &nodeA );
+    TEST_ASSERT( take( false ) == &nodeE );
+    TEST_ASSERT( take( true ) == &nodeB );
+    TEST_ASSERT( jobQueue.GetNumDistributableJobsAvailable() == 2 );
+
+    // Jobs queued after some were taken
+    queue( &nodeF );
+    TEST_ASSERT( jobQueue.GetNumDistributableJobsAvailable() == 3 );
+    TEST_ASSERT( take( true ) == &nodeF );
+    TEST_ASSERT( take( false ) == &nodeD );
+    TEST_ASSERT( take( true ) == &nodeC );
+    TEST_ASSERT( take( true ) == nullptr );
+    TEST_ASSERT( take( false ) == nullptr );
+    TEST_ASSERT( jobQueue.GetNumDistributableJobsAvailable() == 0 );
+
+    // Return the jobs, to be freed with the JobQueue
+    for ( Job * job : jobsTaken )
+    {
+        jobQueue.ReturnUnfinishedDistributableJob( job );
+    }
+    TEST_ASSERT( jobQueue.GetNumDistributableJobsAvailable() == 6 );
+}
+
+// SharedWorkers
+//------------------------------------------------------------------------------
+void TestDistributed::SharedWorkers() const
+{
+    // Workers share CPUs between clients based on their recent CPU time and priority
+    Server server( 1 );
+    Server::ClientState clientA( nullptr );
+    Server::ClientState clientB( nullptr );
+    Array< Server::ClientState * > clients;
+    clients.Append( &clientA );
+    clients.Append( &clientB );
+    for ( Server::ClientState * cs : clients )
+    {
+        cs->m_NumJobsAvailable = 100;
+    }
+
+    // Share the given number of jobs, returning the client given the first request
+    uint32_t numJobsA = 0;
+    uint32_t numJobsB = 0;
+    const auto share = [ & ]( uint32_t cpuTimeBucket, int32_t availableJobs ) -> const Server::ClientState *
+    {
+        for ( Server::ClientState * cs : clients )
+        {
+            cs->m_NumJobsRequested = 0;
+            cs->m_DeficitMS = 0.0f;
+            cs->m_JobTimeMS = 1000.0f; // Jobs cost the same, so only CPU time and priority matter
+        }
+        Array< Server::NeedyClient > needyClients;
+        Server::ShareJobRequests( clients, cpuTimeBucket, 1000.0f, availableJobs, needyClients );
+        TEST_ASSERT( needyClients.GetSize() == 2 );
+        numJobsA = clientA.m_NumJobsRequested;
+        numJobsB = clientB.m_NumJobsRequested;
+        return needyClients[ 0 ].m_ClientState;
+    };
+
+    // Client B has used the worker recently, so client A is first
+    {
+        MutexHolder mh( clientB.m_Mutex );
+        clientB.OnJobCompleted( 0, 60000.0f );
+    }
+    TEST_ASSERT( share( 0, 1 ) == &clientA );
+    TEST_ASSERT( ( numJobsA == 1 ) && ( numJobsB == 0 ) );
+    TEST_ASSERT( share( 0, 7 ) == &clientA );
+    TEST_ASSERT( ( numJobsA == 4 ) && ( numJobsB == 3 ) );
+
+    // CPUs are shared in proportion to priority
+    clientA.m_Priority = Protocol::PRIORITY_HIGH;
+    clientB.m_Priority = Protocol::PRIORITY_LOW;
+    TEST_ASSERT( share( 0, 10 ) == &clientA );
+    TEST_ASSERT( ( numJobsA == 8 ) && ( numJobsB == 2 ) );
+    clientA.m_Priority = Protocol::PRIORITY_NORMAL;
+    clientB.m_Priority = Protocol::PRIORITY_NORMAL;
+
+    // CPU time is forgotten once it leaves the window
+    {
+        MutexHolder mhA( clientA.m_Mutex );
+        MutexHolder mhB( clientB.m_Mutex );
+        clientA.OnJobCompleted( 6, 30000.0f );
+        TEST_ASSERT( clientA.GetRecentCPUTimeMS( 6 ) == 30000.0f );
+        TEST_ASSERT( clientB.GetRecentCPUTimeMS( 6 ) == 60000.0f );
+    }
+    TEST_ASSERT( share( 6, 1 ) == &clientA );
+    TEST_ASSERT( share( 11, 1 ) == &clientA );
+    TEST_ASSERT( share( 12, 1 ) == &clientB ); // Client B's CPU time has expired
+    {
+        MutexHolder mhA( clientA.m_Mutex );
+        MutexHolder mhB( clientB.m_Mutex );
+        TEST_ASSERT( clientA.GetRecentCPUTimeMS( 12 ) == 30000.0f );
+        TEST_ASSERT( clientB.GetRecentCPUTimeMS( 12 ) == 0.0f );
+        TEST_ASSERT( clientA.GetRecentCPUTimeMS( 100 ) == 0.0f );
+    }
+
+    // The priority is sent by the client when connecting
+    ConnectionInfo connection( &server );
+    connection.SetUserData( &clientA );
+    {
+        const Protocol::MsgConnection msg( 0, Protocol::PRIORITY_HIGH );
+        TEST_ASSERT( msg.GetPriority() == Protocol::PRIORITY_HIGH );
+        server.Process( &connection, &msg );
+        TEST_ASSERT( clientA.m_Priority == Protocol::PRIORITY_HIGH );
+        TEST_ASSERT( clientA.m_ProtocolVersion == Protocol::PROTOCOL_VERSION );
+    }
+    {
+        const Protocol::MsgConnection msg( 0, 0 ); // Older clients send 0 (padding)
+        server.Process( &connection, &msg );
+        TEST_ASSERT( clientA.m_Priority == Protocol::PRIORITY_NORMAL );
+        TEST_ASSERT( Server::GetPriorityWeight( clientA.m_Priority ) > Server::GetPriorityWeight( Protocol::PRIORITY_LOW ) );
+        TEST_ASSERT( Server::GetPriorityWeight( clientA.m_Priority ) < Server::GetPriorityWeight( Protocol::PRIORITY_HIGH ) );
+    }
+}
+
+// BatchedJobs
+//------------------------------------------------------------------------------
+void TestDistributed::BatchedJobs() const
+{
+    // Current clients are sent requests for several jobs at once, and results
+    // completing together are returned together
+    TestProtocolVersion( Protocol::PROTOCOL_VERSION );
+    TEST_ASSERT( GetRecordedOutput().Find( "Job Requests: " ) );
+    TEST_ASSERT( GetRecordedOutput().Find( "Got Results: " ) );
+}
+
+// OlderClient
+//------------------------------------------------------------------------------
+void TestDistributed::OlderClient() const
+{
+    // The oldest supported clients are sent a request for each job, and each
+    // result individually
+    TestProtocolVersion( Protocol::PROTOCOL_VERSION_MINIMUM );
+    TEST_ASSERT( GetRecordedOutput().Find( "Job Requests: " ) == nullptr );
+    TEST_ASSERT( GetRecordedOutput().Find( "Got Results: " ) == nullptr );
+}
+
+// TestProtocolVersion
+//------------------------------------------------------------------------------
+void TestDistributed::TestProtocolVersion( uint32_t clientProtocolVersion ) const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_ForceCleanBuild = true;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_AllowLocalRace = false;
+    options.m_DistVerbose = true; // messages used are checked by the caller
+    options.m_DistributionPort = TEST_PROTOCOL_PORT;
+    options.m_DistProtocolVersion_Debug = clientProtocolVersion;
+    FBuild fBuild( options );
+
+    TEST_ASSERT( fBuild.Initialize() );
+
+    Server s( 4 );
+    s.Listen( TEST_PROTOCOL_PORT );
+
+    TEST_ASSERT( fBuild.Build( "../tmp/Test/Distributed/dist.lib" ) );
+    TEST_ASSERT( GetRecordedOutput().Find( "Got Result: " ) ); // built remotely
+}
+
+// ToolchainFilesAreShared
+//------------------------------------------------------------------------------
+void TestDistributed::ToolchainFilesAreShared() const
+{
+    // Unique content (and toolchains) for each run, so files from previous runs are not found
+    const uint64_t runId = (uint64_t)Timer::GetNow();
+    AStackString<> content;
+    content.Format( "Toolchain file %" PRIu64, runId );
+    const uint32_t hash = xxHash::Calc32( content.Get(), content.GetLength() );
+    const uint64_t contentHash = xxHash::Calc64( content.Get(), content.GetLength() );
+
+    // Manifest as received by a worker, with one file
+    class Helper
+    {
+    public:
+        static void Deserialize( ToolManifest & manifest, uint64_t toolId, uint32_t fileHash, uint64_t fileContentHash, uint32_t fileSize,
+                                 uint32_t protocolVersion = Protocol::PROTOCOL_VERSION )
+        {
+            MemoryStream ms;
+            ms.Write( toolId );
+            ms.Write( AStackString<>( "" ) );   // MainExecutableRootPath
+            ms.Write( (uint32_t)1 );            // Files
+            ms.Write( AStackString<>( "compiler" ) );
+            ms.Write( (uint64_t)1 );            // TimeStamp
+            ms.Write( fileHash );
+            if ( protocolVersion >= Protocol::PROTOCOL_VERSION_CONTENT_HASHES )
+            {
+                ms.Write( fileContentHash );
+            }
+            ms.Write( fileSize );
+            ms.Write( (uint32_t)0 );            // CustomEnvironmentVariables
+            ConstMemoryStream cms( ms.GetData(), ms.GetSize() );
+            manifest.DeserializeFromRemote( cms, protocolVersion );
+        }
+    };
+
+    AStackString<> fileA, fileB, storeFile;
+    {
+        // First toolchain must synchronize the file
+        ToolManifest manifestA( runId );
+        Helper::Deserialize( manifestA, runId, hash, contentHash, content.GetLength() );
+        TEST_ASSERT( manifestA.IsSynchronized() == false );
+        Compressor c;
+        c.Compress( content.Get(), content.GetLength() ); // NOTE: Small data is stored uncompressed
+        size_t compressedSize = c.GetResultSize();
+        manifestA.MarkFileAsSynchronizing( 0 );
+        TEST_ASSERT( manifestA.ReceiveFileData( 0, c.GetResult(), compressedSize ) );
+        TEST_ASSERT( manifestA.IsSynchronized() );
+        manifestA.GetRemoteFilePath( 0, fileA );
+        manifestA.GetStoreFilePath( 0, storeFile );
+        TEST_ASSERT( FileIO::FileExists( storeFile.Get() ) );
+
+        // Another toolchain with the same file is synchronized from the store
+        ToolManifest manifestB( runId + 1 );
+        Helper::Deserialize( manifestB, runId + 1, hash, contentHash, content.GetLength() );
+        TEST_ASSERT( manifestB.IsSynchronized() );
+        manifestB.GetRemoteFilePath( 0, fileB );
+        TEST_ASSERT( FileIO::FileExists( fileB.Get() ) );
+
+        // A toolchain with a different file is not
+        ToolManifest manifestC( runId + 2 );
+        Helper::Deserialize( manifestC, runId + 2, hash + 1, contentHash + 1, content.GetLength() );
+        TEST_ASSERT( manifestC.IsSynchronized() == false );
+
+        // Even if the 32 bit hash and size of the files collide
+        ToolManifest manifestD( runId + 3 );
+        Helper::Deserialize( manifestD, runId + 3, hash, contentHash + 1, content.GetLength() );
+        TEST_ASSERT( manifestD.IsSynchronized() == false );
+
+        // Files from older clients (without 64 bit hashes) are not shared
+        ToolManifest manifestE( runId + 4 );
+        Helper::Deserialize( manifestE, runId + 4, hash, 0, content.GetLength(), Protocol::PROTOCOL_VERSION_MINIMUM );
+        TEST_ASSERT( manifestE.IsSynchronized() == false );
+    }
+
+    // The store is trimmed to its size limit
+    ToolManifest::TrimStore( 0 );
+    TEST_ASSERT( FileIO::FileExists( storeFile.Get() ) == false );
+
+    // Cleanup
+    TEST_ASSERT( FileIO::FileDelete( fileA.Get() ) );
+    TEST_ASSERT( FileIO::FileDelete( fileB.Get() ) );
+}
+
 // TestForceInclude
 //------------------------------------------------------------------------------
 void TestDistributed::TestForceInclude() const
@@ -55,6 +55,10 @@ private:
     void BFFDirtied() const;
     void DBVersionChanged() const;
     void FixupErrorPaths() const;
+    void SharedDependencies() const;
+
+    // Helpers
+    void ModifyFile( const char * fileName, const char * fileContents ) const;
 };
 
 // Register Tests
@@ -75,6 +79,7 @@ REGISTER_TESTS_BEGIN( TestGraph )
     REGISTER_TEST( BFFDirtied )
     REGISTER_TEST( DBVersionChanged )
     REGISTER_TEST( FixupErrorPaths )
+    REGISTER_TEST( SharedDependencies )
 REGISTER_TESTS_END
 
 // NodeTestHelper
@@ -922,4 +927,111 @@ void TestGraph::FixupErrorPaths() const
     #undef TEST_FIXUP
 }
 
+// SharedDependencies
+//------------------------------------------------------------------------------
+void TestGraph::SharedDependencies() const
+{
+    const char * commonHeader = "../tmp/Test/Graph/SharedDependencies/GeneratedInput/Common.h";
+    const char * extraHeader = "../tmp/Test/Graph/SharedDependencies/GeneratedInput/Extra.h";
+    const char * database = "../tmp/Test/Graph/SharedDependencies/fbuild.fdb";
+
+    // Generate the headers
+    EnsureDirExists( "../tmp/Test/Graph/SharedDependencies/GeneratedInput/" );
+    MakeFile( commonHeader, "#define COMMON_VALUE 1\n" );
+    MakeFile( extraHeader, "#define EXTRA_VALUE 1\n" );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/SharedDependencies/fbuild.bff";
+
+    // Compile
+    {
+        options.m_ForceCleanBuild = true;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "SharedDependencies" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( database ) );
+
+        // Check stats
+        //              Seen,   Built,  Type
+        CheckStatsNode( 4,      4,      Node::OBJECT_NODE );
+    }
+
+    // Check no-op
+    {
+        options.m_ForceCleanBuild = false;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( database ) );
+
+        // Objects with identical includes should share them
+        Array< const Node * > objectNodes;
+        fBuild.GetNodesOfType( Node::OBJECT_NODE, objectNodes );
+        TEST_ASSERT( objectNodes.GetSize() == 4 );
+        const DependencySet * commonSet = nullptr;
+        for ( const Node * node : objectNodes )
+        {
+            const Dependencies & deps = node->GetDynamicDependencies();
+            const bool isD = ( node->GetName().FindLast( NATIVE_SLASH )[ 1 ] == 'd' );
+            TEST_ASSERT( deps.GetSize() == ( isD ? 2u : 1u ) );
+            if ( isD )
+            {
+                continue;
+            }
+            TEST_ASSERT( deps.GetSharedSet() );
+            TEST_ASSERT( ( commonSet == nullptr ) || ( commonSet == deps.GetSharedSet() ) );
+            commonSet = deps.GetSharedSet();
+        }
+
+        TEST_ASSERT( fBuild.Build( "SharedDependencies" ) );
+
+        // Check stats
+        //              Seen,   Built,  Type
+        CheckStatsNode( 4,      0,      Node::OBJECT_NODE );
+    }
+
+    // Modify the header used by all objects
+    ModifyFile( commonHeader, "#define COMMON_VALUE 2\n" );
+
+    // Check all objects are rebuilt
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( database ) );
+        TEST_ASSERT( fBuild.Build( "SharedDependencies" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( database ) );
+
+        // Check stats
+        //              Seen,   Built,  Type
+        CheckStatsNode( 4,      4,      Node::OBJECT_NODE );
+    }
+
+    // Modify the header used by one object
+    ModifyFile( extraHeader, "#define EXTRA_VALUE 2\n" );
+
+    // Check only that object is rebuilt
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( database ) );
+        TEST_ASSERT( fBuild.Build( "SharedDependencies" ) );
+
+        // Check stats
+        //              Seen,   Built,  Type
+        CheckStatsNode( 4,      1,      Node::OBJECT_NODE );
+    }
+}
+
+// ModifyFile
+//------------------------------------------------------------------------------
+void TestGraph::ModifyFile( const char * fileName, const char * fileContents ) const
+{
+    // Jump through hoops to handle poor filetime granularity
+    const uint64_t oldModTime = FileIO::GetFileLastWriteTime( AStackString<>( fileName ) );
+    MakeFile( fileName, fileContents );
+    Timer timeout;
+    while ( FileIO::GetFileLastWriteTime( AStackString<>( fileName ) ) == oldModTime )
+    {
+        TEST_ASSERT( timeout.GetElapsed() < 30.0f );
+        Thread::Sleep( 10 );
+        TEST_ASSERT( FileIO::SetFileLastWriteTimeToNow( AStackString<>( fileName ) ) );
+    }
+}
+
 //------------------------------------------------------------------------------
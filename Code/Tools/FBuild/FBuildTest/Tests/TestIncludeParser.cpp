@@ -29,6 +29,7 @@ private:
     void TestGCCPreprocessedOutput() const;
     void TestClangPreprocessedOutput() const;
     void TestClangMSExtensionsPreprocessedOutput() const;
+    void TestGCCDepFile() const;
     void TestEdgeCases() const;
     void ClangLineEndings() const;
 };
@@ -46,6 +47,7 @@ REGISTER_TESTS_BEGIN( TestIncludeParser )
     REGISTER_TEST( TestGCCPreprocessedOutput )
     REGISTER_TEST( TestClangPreprocessedOutput )
     REGISTER_TEST( TestClangMSExtensionsPreprocessedOutput )
+    REGISTER_TEST( TestGCCDepFile )
     REGISTER_TEST( TestEdgeCases )
     REGISTER_TEST( ClangLineEndings )
 REGISTER_TESTS_END
@@ -386,6 +388,66 @@ void TestIncludeParser::TestClangMSExtensionsPreprocessedOutput() const
     OUTPUT( "Clang (ms-extensions): %2.3fs (%2.1f MiB/sec)\n", (double)time, (double)( (float)( fileSize * repeatCount ) / ( 1024.0f * 1024.0f ) / time ) );
 }
 
+// TestGCCDepFile
+//------------------------------------------------------------------------------
+void TestIncludeParser::TestGCCDepFile() const
+{
+    FBuild fBuild; // needed for CleanPath
+
+    // Typical output, with line continuations and system headers
+    {
+        const char * depFile = "/tmp/out/File.o: /code/File.cpp /code/A.h \\\n"
+                               " /usr/include/stdio.h \\\n"
+                               "  /code/B.h\n";
+        CIncludeParser parser;
+        TEST_ASSERT( parser.ParseGCC_DepFile( depFile, AString::StrLen( depFile ) ) );
+        const Array< AString > & includes = parser.GetIncludes();
+        TEST_ASSERT( includes.GetSize() == 3 ); // Source file is not an include
+        TEST_ASSERT( includes[ 0 ].EndsWith( "A.h" ) );
+        TEST_ASSERT( includes[ 1 ].EndsWith( "stdio.h" ) );
+        TEST_ASSERT( includes[ 2 ].EndsWith( "B.h" ) );
+    }
+
+    // Escaped characters, Windows line endings and duplicates
+    {
+        const char * depFile = "C:\\out\\File.o: C:\\code\\File.cpp \\\r\n"
+                               " C:\\code\\With\\ Space.h C:\\code\\Hash\\#.h C:\\code\\Dollar$$.h \\\r\n"
+                               " C:\\code\\With\\ Space.h\r\n";
+        CIncludeParser parser;
+        TEST_ASSERT( parser.ParseGCC_DepFile( depFile, AString::StrLen( depFile ) ) );
+        const Array< AString > & includes = parser.GetIncludes();
+        TEST_ASSERT( includes.GetSize() == 3 );
+        TEST_ASSERT( includes[ 0 ].EndsWith( "With Space.h" ) );
+        TEST_ASSERT( includes[ 1 ].EndsWith( "Hash#.h" ) );
+        TEST_ASSERT( includes[ 2 ].EndsWith( "Dollar$.h" ) );
+    }
+
+    // Phony targets (-MP) are ignored
+    {
+        const char * depFile = "File.o: File.cpp A.h\n"
+                               "\n"
+                               "A.h:\n";
+        CIncludeParser parser;
+        TEST_ASSERT( parser.ParseGCC_DepFile( depFile, AString::StrLen( depFile ) ) );
+        TEST_ASSERT( parser.GetIncludes().GetSize() == 1 );
+    }
+
+    // No includes
+    {
+        const char * depFile = "File.o: File.cpp\n";
+        CIncludeParser parser;
+        TEST_ASSERT( parser.ParseGCC_DepFile( depFile, AString::StrLen( depFile ) ) );
+        TEST_ASSERT( parser.GetIncludes().GetSize() == 0 );
+    }
+
+    // Corrupt
+    {
+        const char * depFile = "File.o File.cpp\n";
+        CIncludeParser parser;
+        TEST_ASSERT( parser.ParseGCC_DepFile( depFile, AString::StrLen( depFile ) ) == false );
+    }
+}
+
 //
 //------------------------------------------------------------------------------
 void TestIncludeParser::TestEdgeCases() const
@@ -32,6 +32,7 @@ private:
     void ModTimeChangeBackwards() const;
     void CacheUsingRelativePaths() const;
     void SourceMapping() const;
+    void DepFile() const;
 };
 
 // Register Tests
@@ -43,6 +44,9 @@ REGISTER_TESTS_BEGIN( TestObject )
     REGISTER_TEST( ModTimeChangeBackwards )
     REGISTER_TEST( CacheUsingRelativePaths )
     REGISTER_TEST( SourceMapping )
+    #if !defined( __WINDOWS__ )
+        REGISTER_TEST( DepFile )
+    #endif
 REGISTER_TESTS_END
 
 // MSVCArgHelpers
@@ -481,4 +485,90 @@ void TestObject::SourceMapping() const
     }
 }
 
+// DepFile
+//------------------------------------------------------------------------------
+//  - Ensure dependencies can be extracted from a compiler generated dependency file
+void TestObject::DepFile() const
+{
+    const char * header = "../tmp/Test/Object/DepFile/GeneratedInput/Header.h";
+    const char * database = "../tmp/Test/Object/DepFile/fbuild.fdb";
+
+    // Generate full path to header
+    AStackString<> headerFullPath;
+    {
+        FileIO::GetCurrentDir( headerFullPath );
+        headerFullPath += '/';
+        headerFullPath += header;
+        PathUtils::FixupFilePath( headerFullPath );
+        NodeGraph::CleanPath( headerFullPath );
+    }
+
+    // Generate the header
+    EnsureDirExists( "../tmp/Test/Object/DepFile/GeneratedInput/" );
+    MakeFile( header, "#define VALUE 1\n" );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestObject/DepFile/fbuild.bff";
+
+    // Compile
+    {
+        options.m_ForceCleanBuild = true;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "DepFile" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( database ) );
+
+        // Check stats
+        //              Seen,   Built,  Type
+        CheckStatsNode( 1,      1,      Node::OBJECT_NODE );
+
+        // Header should have been discovered from the dependency file
+        Array< const Node * > objectNodes;
+        fBuild.GetNodesOfType( Node::OBJECT_NODE, objectNodes );
+        TEST_ASSERT( objectNodes.GetSize() == 1 );
+        bool foundHeader = false;
+        for ( const Dependency & dep : objectNodes[ 0 ]->GetDynamicDependencies() )
+        {
+            foundHeader |= ( dep.GetNode()->GetName() == headerFullPath );
+        }
+        TEST_ASSERT( foundHeader );
+    }
+
+    // Check no-op
+    {
+        options.m_ForceCleanBuild = false;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( database ) );
+        TEST_ASSERT( fBuild.Build( "DepFile" ) );
+
+        // Check stats
+        //              Seen,   Built,  Type
+        CheckStatsNode( 1,      0,      Node::OBJECT_NODE );
+    }
+
+    // Modify the header (jump through hoops to handle poor filetime granularity)
+    {
+        const uint64_t oldModTime = FileIO::GetFileLastWriteTime( headerFullPath );
+        MakeFile( header, "#define VALUE 2\n" );
+        Timer timeout;
+        while ( FileIO::GetFileLastWriteTime( headerFullPath ) == oldModTime )
+        {
+            TEST_ASSERT( timeout.GetElapsed() < 30.0f );
+            Thread::Sleep( 10 );
+            TEST_ASSERT( FileIO::SetFileLastWriteTimeToNow( headerFullPath ) );
+        }
+    }
+
+    // Check object is rebuilt due to the header change
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( database ) );
+        TEST_ASSERT( fBuild.Build( "DepFile" ) );
+
+        // Check stats
+        //              Seen,   Built,  Type
+        CheckStatsNode( 1,      1,      Node::OBJECT_NODE );
+    }
+}
+
 //------------------------------------------------------------------------------
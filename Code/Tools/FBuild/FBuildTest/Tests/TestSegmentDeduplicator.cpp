@@ -0,0 +1,181 @@
+// TestSegmentDeduplicator.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/Helpers/SegmentDeduplicator.h"
+
+// Core
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Strings/AString.h"
+
+#include <memory.h>
+
+// TestSegmentDeduplicator
+//------------------------------------------------------------------------------
+class TestSegmentDeduplicator : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void RoundTrip() const;
+    void RoundTripMSVC() const;
+    void UnknownSegment() const;
+    void CorruptData() const;
+
+    void RoundTripHelper( const char * lineDirective ) const;
+    static void MakePreprocessedFile( const char * lineDirective, const char * sourceFile, AString & outData );
+    static void Check( SegmentDeduplicator & decoder, const MemoryStream & encoded, const AString & expected );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestSegmentDeduplicator )
+    REGISTER_TEST( RoundTrip )
+    REGISTER_TEST( RoundTripMSVC )
+    REGISTER_TEST( UnknownSegment )
+    REGISTER_TEST( CorruptData )
+REGISTER_TESTS_END
+
+// RoundTrip
+//------------------------------------------------------------------------------
+void TestSegmentDeduplicator::RoundTrip() const
+{
+    RoundTripHelper( "# 1" ); // GCC/Clang
+}
+
+// RoundTripMSVC
+//------------------------------------------------------------------------------
+void TestSegmentDeduplicator::RoundTripMSVC() const
+{
+    RoundTripHelper( "#line 1" );
+}
+
+// UnknownSegment
+//------------------------------------------------------------------------------
+void TestSegmentDeduplicator::UnknownSegment() const
+{
+    AString data;
+    MakePreprocessedFile( "# 1", "a.cpp", data );
+
+    // Encode twice, so the second encoding refers to segments from the first
+    SegmentDeduplicator encoder;
+    MemoryStream first;
+    encoder.Encode( data.Get(), data.GetLength(), first );
+    MemoryStream second;
+    encoder.Encode( data.Get(), data.GetLength(), second );
+
+    // A decoder which didn't see the first encoding can't reconstruct the second
+    SegmentDeduplicator decoder;
+    ConstMemoryStream ms( second.GetData(), second.GetSize() );
+    void * decoded = nullptr;
+    size_t decodedSize = 0;
+    TEST_ASSERT( decoder.Decode( ms, decoded, decodedSize ) == false );
+    TEST_ASSERT( decoded == nullptr );
+}
+
+// CorruptData
+//------------------------------------------------------------------------------
+void TestSegmentDeduplicator::CorruptData() const
+{
+    AString data;
+    MakePreprocessedFile( "# 1", "a.cpp", data );
+
+    SegmentDeduplicator encoder;
+    MemoryStream encoded;
+    encoder.Encode( data.Get(), data.GetLength(), encoded );
+
+    // Truncated data is rejected
+    const size_t sizes[] = { 0, 2, ( encoded.GetSize() / 2 ), ( encoded.GetSize() - 1 ) };
+    for ( const size_t size : sizes )
+    {
+        SegmentDeduplicator decoder;
+        ConstMemoryStream ms( encoded.GetData(), size );
+        void * decoded = nullptr;
+        size_t decodedSize = 0;
+        TEST_ASSERT( decoder.Decode( ms, decoded, decodedSize ) == false );
+    }
+}
+
+// RoundTripHelper
+//------------------------------------------------------------------------------
+void TestSegmentDeduplicator::RoundTripHelper( const char * lineDirective ) const
+{
+    // Files which share most of their headers
+    AString a, b;
+    MakePreprocessedFile( lineDirective, "a.cpp", a );
+    MakePreprocessedFile( lineDirective, "b.cpp", b );
+
+    SegmentDeduplicator encoder;
+    SegmentDeduplicator decoder;
+
+    // First file is sent in full
+    MemoryStream encodedA;
+    encoder.Encode( a.Get(), a.GetLength(), encodedA );
+    TEST_ASSERT( encodedA.GetSize() > a.GetLength() );
+    Check( decoder, encodedA, a );
+    TEST_ASSERT( encoder.GetNumSegments() > 0 );
+    TEST_ASSERT( decoder.GetNumSegments() == encoder.GetNumSegments() );
+
+    // Second file only sends what differs
+    MemoryStream encodedB;
+    encoder.Encode( b.Get(), b.GetLength(), encodedB );
+    TEST_ASSERT( encodedB.GetSize() < ( b.GetLength() / 4 ) );
+    Check( decoder, encodedB, b );
+    TEST_ASSERT( decoder.GetNumSegments() == encoder.GetNumSegments() );
+
+    // After clearing (i.e. a new connection), everything is sent again
+    encoder.Clear();
+    decoder.Clear();
+    MemoryStream encodedB2;
+    encoder.Encode( b.Get(), b.GetLength(), encodedB2 );
+    TEST_ASSERT( encodedB2.GetSize() > b.GetLength() );
+    Check( decoder, encodedB2, b );
+
+    // Empty data
+    MemoryStream encodedEmpty;
+    encoder.Encode( "", 0, encodedEmpty );
+    Check( decoder, encodedEmpty, AString::GetEmpty() );
+}
+
+// MakePreprocessedFile
+//------------------------------------------------------------------------------
+/*static*/ void TestSegmentDeduplicator::MakePreprocessedFile( const char * lineDirective, const char * sourceFile, AString & outData )
+{
+    // Emulate the output of the preprocessor for a file including some headers
+    // (each large enough to be deduplicated) before some code of its own
+    outData.AppendFormat( "%s \"%s\"\n", lineDirective, sourceFile );
+    for ( uint32_t header = 0; header < 8; ++header )
+    {
+        outData.AppendFormat( "%s \"header%u.h\"\n", lineDirective, header );
+        for ( uint32_t line = 0; line < 64; ++line )
+        {
+            outData.AppendFormat( "int Header%uFunction%u( int a, int b );\n", header, line );
+        }
+        outData.AppendFormat( "%s \"%s\"\n", lineDirective, sourceFile );
+        outData += "\n"; // The #include
+    }
+    for ( uint32_t line = 0; line < 16; ++line )
+    {
+        outData.AppendFormat( "int %s_Function%u() { return %u; }\n", sourceFile, line, line );
+    }
+}
+
+// Check
+//------------------------------------------------------------------------------
+/*static*/ void TestSegmentDeduplicator::Check( SegmentDeduplicator & decoder, const MemoryStream & encoded, const AString & expected )
+{
+    ConstMemoryStream ms( encoded.GetData(), encoded.GetSize() );
+    void * decoded = nullptr;
+    size_t decodedSize = 0;
+    TEST_ASSERT( decoder.Decode( ms, decoded, decodedSize ) );
+    TEST_ASSERT( decodedSize == expected.GetLength() );
+    TEST_ASSERT( memcmp( decoded, expected.Get(), decodedSize ) == 0 );
+    TEST_ASSERT( ms.Tell() == ms.GetSize() ); // All data consumed
+    FREE( decoded );
+}
+
+//------------------------------------------------------------------------------
@@ -31,7 +31,8 @@ FBuildWorkerOptions::FBuildWorkerOptions() :
     m_OverrideWorkMode( false ),
     m_WorkMode( WorkerSettings::WHEN_IDLE ),
     m_MinimumFreeMemoryMiB( 0 ),
-    m_ConsoleMode( false )
+    m_ConsoleMode( false ),
+    m_CacheWrite( false )
 {
     #ifdef __LINUX__
         m_ConsoleMode = true; // Only console mode supported on Linux
@@ -61,7 +62,21 @@ bool FBuildWorkerOptions::ProcessCommandLine( const AString & commandLine )
                 continue;
             }
         #endif
-        if ( token.BeginsWith( "-cpus=" ) )
+        if ( token.BeginsWith( "-cachepath=" ) )
+        {
+            m_CachePath = ( token.Get() + 11 );
+            if ( m_CachePath.IsEmpty() == false )
+            {
+                continue;
+            }
+            // problem... fall through
+        }
+        else if ( token == "-cachewrite" )
+        {
+            m_CacheWrite = true;
+            continue;
+        }
+        else if ( token.BeginsWith( "-cpus=" ) )
         {
             int32_t numCPUs = (int32_t)Env::GetNumProcessors();
             int32_t num( 0 );
@@ -165,6 +180,10 @@ void FBuildWorkerOptions::ShowUsageError()
                        "\n"
                        "Command Line Options:\n"
                        "---------------------------------------------------------------------------\n"
+                       " -cachepath=<path>\n"
+                       "        Use a cache for jobs from clients which allow it (-distcache).\n"
+                       " -cachewrite\n"
+                       "        Publish results for clients which allow it to the -cachepath cache.\n"
                        " -console\n"
                        "        (Windows/OSX) Operate from console instead of GUI.\n"
                        " -cpus=<n|-n|n%>   Set number of CPUs to use:\n"
@@ -9,10 +9,7 @@
 
 // Core
 #include "Core/Env/Types.h"
-
-// Forward Declaration
-//------------------------------------------------------------------------------
-class AString;
+#include "Core/Strings/AString.h"
 
 // FBuildWorkerOptions
 //------------------------------------------------------------------------------
@@ -39,6 +36,10 @@ public:
     // Console mode
     bool m_ConsoleMode;
 
+    // Cache (used for jobs from clients which allow it)
+    AString m_CachePath;
+    bool m_CacheWrite;
+
 private:
     void ShowUsageError();
 };
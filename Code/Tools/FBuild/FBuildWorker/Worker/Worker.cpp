@@ -14,6 +14,8 @@
 #include "Tools/FBuild/FBuildWorker/Worker/WorkerWindow.h"
 
 // FBuild
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
+#include "Tools/FBuild/FBuildCore/Cache/HTTPCache.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FBuildVersion.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
@@ -40,10 +42,11 @@
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-Worker::Worker( const AString & args, bool consoleMode )
+Worker::Worker( const AString & args, bool consoleMode, const AString & cachePath, bool cacheWrite )
     : m_ConsoleMode( consoleMode )
     , m_MainWindow( nullptr )
     , m_ConnectionPool( nullptr )
+    , m_Cache( nullptr )
     , m_NetworkStartupHelper( nullptr )
     , m_BaseArgs( args )
     , m_LastWriteTime( 0 )
@@ -56,7 +59,31 @@ Worker::Worker( const AString & args, bool consoleMode )
 {
     m_WorkerSettings = FNEW( WorkerSettings );
     m_NetworkStartupHelper = FNEW( NetworkStartupHelper );
-    m_ConnectionPool = FNEW( Server );
+
+    // Optional cache, to check again before compiling and to publish results
+    if ( cachePath.IsEmpty() == false )
+    {
+        if ( HTTPCache::IsHTTPCachePath( cachePath ) )
+        {
+            m_Cache = FNEW( HTTPCache() );
+        }
+        else
+        {
+            m_Cache = FNEW( Cache() );
+        }
+        if ( m_Cache->Init( cachePath,
+                            AString::GetEmpty(), // cachePathMountPoint
+                            true,                // cacheRead
+                            cacheWrite,          // cacheWrite
+                            false,               // cacheVerbose
+                            AString::GetEmpty() ) == false ) // pluginDLLConfig
+        {
+            FDELETE m_Cache;
+            m_Cache = nullptr;
+        }
+    }
+
+    m_ConnectionPool = FNEW( Server( 0, m_Cache, cacheWrite ) );
 
     Env::GetExePath( m_BaseExeName );
     #if defined( __WINDOWS__ )
@@ -74,6 +101,11 @@ Worker::~Worker()
 {
     FDELETE m_NetworkStartupHelper;
     FDELETE m_ConnectionPool;
+    if ( m_Cache )
+    {
+        m_Cache->Shutdown();
+        FDELETE m_Cache;
+    }
     FDELETE m_MainWindow;
     FDELETE m_WorkerSettings;
 
@@ -225,7 +257,7 @@ uint32_t Worker::WorkThread()
     // Now that we will no longer interact with the UI, we can stop the message pump
     m_MainWindow->StopMessagePump();
 
-    m_WorkerBrokerage.SetAvailability( false );
+    m_WorkerBrokerage.SetAvailability( false, 0, 0 );
 
     return 0;
 }
@@ -363,7 +395,7 @@ void Worker::UpdateAvailability()
 
     WorkerThreadRemote::SetNumCPUsToUse( numCPUsToUse );
 
-    m_WorkerBrokerage.SetAvailability( numCPUsToUse > 0 );
+    m_WorkerBrokerage.SetAvailability( numCPUsToUse > 0, numCPUsToUse, JobQueueRemote::Get().GetNumJobsInProgress() );
 }
 
 // UpdateUI
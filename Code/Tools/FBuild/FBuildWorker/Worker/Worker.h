@@ -17,6 +17,7 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class ICache;
 class Server;
 class WorkerWindow;
 class JobQueueRemote;
@@ -28,7 +29,7 @@ class WorkerSettings;
 class Worker : public Singleton<Worker>
 {
 public:
-    explicit Worker( const AString & args, bool consoleMode );
+    explicit Worker( const AString & args, bool consoleMode, const AString & cachePath, bool cacheWrite );
     ~Worker();
 
     int32_t Work();
@@ -53,6 +54,7 @@ private:
     bool                m_ConsoleMode;
     WorkerWindow        * m_MainWindow;
     Server              * m_ConnectionPool;
+    ICache              * m_Cache;          // Optional, for jobs from clients which allow it
     NetworkStartupHelper * m_NetworkStartupHelper;
     WorkerSettings      * m_WorkerSettings;
     IdleDetection       m_IdleDetection;